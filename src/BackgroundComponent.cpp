@@ -35,6 +35,19 @@ void BackgroundComponent::start() {
   Backgrounds::_StartupBackgrounds();
 }
 
+void BackgroundComponent::prepare() {
+  Backgrounds::_PrepareBackgrounds();
+}
+
+const char *BackgroundComponent::getName() const {
+  return "background";
+}
+
+const char *const *BackgroundComponent::getDependencies() const {
+  static const char *const dependencies[] = { "colors", "icons", NULL };
+  return dependencies;
+}
+
 void BackgroundComponent::stop() {
   Backgrounds::_ShutdownBackgrounds();
 }
@@ -19,6 +19,9 @@ public:
   virtual void start();
   virtual void stop();
   virtual void destroy();
+  virtual void prepare();
+  virtual const char *getName() const;
+  virtual const char *const *getDependencies() const;
   virtual void set(int desktop, const char* type, const char* value);
   virtual void loadBackground(int desktop);
 private:
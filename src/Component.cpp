@@ -5,6 +5,8 @@
  *      Author: nick
  */
 
+#include <cstddef>
+
 #include "Component.h"
 
 Component::Component() {
@@ -15,3 +17,10 @@ Component::~Component() {
 
 }
 
+const char *const *Component::getDependencies() const {
+  return NULL;
+}
+
+void Component::prepare() {
+}
+
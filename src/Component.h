@@ -18,6 +18,19 @@ public:
   virtual void destroy() = 0;
   virtual void stop() = 0;
 
+  /** Get the name used for dependencies and the startup report. */
+  virtual const char *getName() const = 0;
+
+  /** Get the startup stages and components that must start first.
+   * @return A NULL-terminated list of names (or NULL for none).
+   */
+  virtual const char *const *getDependencies() const;
+
+  /** Do work needed by start() that does not use the X connection.
+   * This may run on another thread while other stages start.
+   */
+  virtual void prepare();
+
 };
 
 #endif /* SRC_COMPONENT_H_ */
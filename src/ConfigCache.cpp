@@ -0,0 +1,759 @@
+/**
+ * @file ConfigCache.cpp
+ *
+ * @brief Compiled configuration cache.
+ *
+ */
+
+#include "jwm.h"
+#include "ConfigCache.h"
+#include "lex.h"
+#include "misc.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <string>
+#include <unordered_map>
+
+/** Identifies a cache image ("JWMC"). */
+#define CACHE_MAGIC 0x434D574A
+
+/** Version of the image layout. Bump this when the layout changes. */
+#define CACHE_VERSION 1
+
+/** Index or offset used for NULL. */
+#define CACHE_NONE 0xFFFFFFFFU
+
+/** Start of a cache image.
+ * The header is followed by the files, the tokens, the attributes and
+ * finally the strings, each as a packed array.
+ */
+typedef struct CacheHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t tokenTypes; /**< Number of token types known to the writer. */
+	uint32_t fileCount;
+	uint32_t tokenCount;
+	uint32_t attributeCount;
+	uint32_t stringSize;
+	uint32_t reserved;
+} CacheHeader;
+
+/** A file that went into the image. The first one is the configuration. */
+typedef struct CacheFile {
+	uint64_t size;
+	int64_t mtimeSeconds;
+	int64_t mtimeNanoseconds;
+	uint64_t hash;
+	uint32_t path;
+	uint32_t reserved;
+} CacheFile;
+
+/** A token. Links are indices into the tokens or attributes. */
+typedef struct CacheToken {
+	uint32_t type;
+	uint32_t invalidName;
+	uint32_t value;
+	uint32_t fileName;
+	uint32_t line;
+	uint32_t attributes;
+	uint32_t parent;
+	uint32_t subnodeHead;
+	uint32_t subnodeTail;
+	uint32_t next;
+} CacheToken;
+
+/** An attribute. */
+typedef struct CacheAttribute {
+	uint32_t name;
+	uint32_t value;
+	uint32_t next;
+} CacheAttribute;
+
+/** Builds an image from a token tree. */
+class CacheWriter {
+public:
+	std::vector<CacheFile> files;
+	std::vector<CacheToken> tokens;
+	std::vector<CacheAttribute> attributes;
+	std::string strings;
+
+	uint32_t AddString(const char *str);
+	uint32_t AddFileName(const char *str);
+	uint32_t AddTokens(const TokenNode *np, uint32_t parent, uint32_t *last);
+
+private:
+	std::unordered_map<std::string, uint32_t> offsets;
+};
+
+/** How the configuration was last loaded. */
+static struct {
+	bool hit;                 /**< Set if the cache was used. */
+	const char *reason;       /**< Why the cache was not used. */
+	unsigned long lookupUs;   /**< Time to find and check the cache. */
+	unsigned long tokenizeUs; /**< Time to tokenize on a miss. */
+	unsigned long storeUs;    /**< Time to write the cache. */
+	char *path;               /**< The cache file. */
+} stats;
+
+/** The files that went into the configuration last loaded. */
+static std::vector<char*> inputs;
+
+/** Metadata of the inputs, recorded as they are tokenized. */
+static std::vector<CacheFile> inputFiles;
+
+/** Set to leave the cache on disk untouched. */
+static char readOnly = 0;
+
+/** The mapped image of the last cache hit. */
+static char *image = NULL;
+static size_t imageSize = 0;
+static TokenNode *imageTokens = NULL;
+static AttributeNode *imageAttributes = NULL;
+
+static uint64_t HashBuffer(const char *buffer, size_t size);
+static bool MatchesFile(const char *path, const CacheFile *fp);
+static bool MakeDirectory(const char *path);
+
+/** Get the cache image for a configuration file. */
+char *ConfigCache::GetCachePath(const char *path) {
+	const char *base = getenv("XDG_CACHE_HOME");
+	std::string result;
+	char name[32];
+
+	if (base && base[0]) {
+		result = base;
+	} else {
+		base = getenv("HOME");
+		if (!base || !base[0]) {
+			return NULL;
+		}
+		result = base;
+		result += "/.cache";
+	}
+	snprintf(name, sizeof(name), "/jwm/config-%016llx",
+			(unsigned long long) HashBuffer(path, strlen(path)));
+	result += name;
+	return CopyString(result.c_str());
+}
+
+/** Load the cached tokens of a configuration file. */
+TokenNode *ConfigCache::LoadCache(const char *fileName) {
+	const CacheHeader *header;
+	const CacheFile *files;
+	const CacheToken *tokens;
+	const CacheAttribute *attributes;
+	const char *strings;
+	struct stat sbuf;
+	size_t expected;
+	unsigned long start;
+	char *path;
+	unsigned i;
+	int fd;
+
+	UnloadCache();
+	start = GetMicroseconds();
+	stats.hit = false;
+	stats.reason = "no cache";
+	stats.tokenizeUs = 0;
+	stats.storeUs = 0;
+	if (stats.path) {
+		delete[] stats.path;
+	}
+
+	path = CopyString(fileName);
+	ExpandPath(&path);
+	stats.path = GetCachePath(path);
+	if (!stats.path) {
+		delete[] path;
+		return NULL;
+	}
+
+	fd = open(stats.path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		delete[] path;
+		return NULL;
+	}
+	if (fstat(fd, &sbuf) == -1 || sbuf.st_size < (off_t) sizeof(CacheHeader)) {
+		close(fd);
+		delete[] path;
+		return NULL;
+	}
+
+	/* The parser may write into strings (strtok), so map a private copy. */
+	imageSize = sbuf.st_size;
+	image = (char*) mmap(NULL, imageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+			fd, 0);
+	close(fd);
+	if (JUNLIKELY(image == MAP_FAILED)) {
+		image = NULL;
+		delete[] path;
+		return NULL;
+	}
+
+	/* Check that the image is complete and was written by this version. */
+	stats.reason = "invalid cache";
+	header = (const CacheHeader*) image;
+	if (header->magic != CACHE_MAGIC || header->version != CACHE_VERSION
+			|| header->tokenTypes != TOK_WINDOWSTYLE + 1) {
+		stats.reason = "stale cache";
+		goto miss;
+	}
+	if (header->fileCount == 0 || header->tokenCount == 0
+			|| header->stringSize == 0) {
+		goto miss;
+	}
+	expected = sizeof(CacheHeader) + header->fileCount * sizeof(CacheFile)
+			+ header->tokenCount * sizeof(CacheToken)
+			+ header->attributeCount * sizeof(CacheAttribute)
+			+ header->stringSize;
+	if (expected != imageSize) {
+		goto miss;
+	}
+	files = (const CacheFile*) (header + 1);
+	tokens = (const CacheToken*) (files + header->fileCount);
+	attributes = (const CacheAttribute*) (tokens + header->tokenCount);
+	strings = (const char*) (attributes + header->attributeCount);
+	if (strings[header->stringSize - 1] != 0) {
+		goto miss;
+	}
+
+#define CHECK_STRING(x) ((x) == CACHE_NONE || (x) < header->stringSize)
+
+	/* Every file must be unchanged. */
+	for (i = 0; i < header->fileCount; i++) {
+		if (!CHECK_STRING(files[i].path) || files[i].path == CACHE_NONE) {
+			goto miss;
+		}
+	}
+	if (strcmp(&strings[files[0].path], path)) {
+		goto miss;
+	}
+	for (i = 0; i < header->fileCount; i++) {
+		if (!MatchesFile(&strings[files[i].path], &files[i])) {
+			stats.reason = "configuration changed";
+			goto miss;
+		}
+	}
+
+	/* Links only point forward (and parents backward), so a damaged
+	 * image can't make the parser loop. */
+	for (i = 0; i < header->tokenCount; i++) {
+		const CacheToken *cp = &tokens[i];
+		if (cp->type > TOK_WINDOWSTYLE || !CHECK_STRING(cp->invalidName)
+				|| !CHECK_STRING(cp->value) || !CHECK_STRING(cp->fileName)) {
+			goto miss;
+		}
+		if ((cp->parent != CACHE_NONE && cp->parent >= i)
+				|| (cp->subnodeHead != CACHE_NONE
+						&& (cp->subnodeHead <= i || cp->subnodeHead >= header->tokenCount))
+				|| (cp->subnodeTail != CACHE_NONE
+						&& (cp->subnodeTail <= i || cp->subnodeTail >= header->tokenCount))
+				|| (cp->next != CACHE_NONE
+						&& (cp->next <= i || cp->next >= header->tokenCount))
+				|| (cp->attributes != CACHE_NONE
+						&& cp->attributes >= header->attributeCount)) {
+			goto miss;
+		}
+	}
+	for (i = 0; i < header->attributeCount; i++) {
+		const CacheAttribute *cp = &attributes[i];
+		if (!CHECK_STRING(cp->name) || !CHECK_STRING(cp->value)
+				|| (cp->next != CACHE_NONE
+						&& (cp->next <= i || cp->next >= header->attributeCount))) {
+			goto miss;
+		}
+	}
+
+#undef CHECK_STRING
+#define STRING(x) ((x) == CACHE_NONE ? NULL : (char*) &strings[x])
+#define TOKEN(x) ((x) == CACHE_NONE ? NULL : &imageTokens[x])
+#define ATTRIBUTE(x) ((x) == CACHE_NONE ? NULL : &imageAttributes[x])
+
+	/* Fill in the links. */
+	imageTokens = new TokenNode[header->tokenCount];
+	imageAttributes = new AttributeNode[header->attributeCount];
+	for (i = 0; i < header->tokenCount; i++) {
+		const CacheToken *cp = &tokens[i];
+		TokenNode *np = &imageTokens[i];
+		np->type = (TokenType) cp->type;
+		np->invalidName = STRING(cp->invalidName);
+		np->value = STRING(cp->value);
+		np->fileName = STRING(cp->fileName);
+		np->line = cp->line;
+		np->attributes = ATTRIBUTE(cp->attributes);
+		np->parent = TOKEN(cp->parent);
+		np->subnodeHead = TOKEN(cp->subnodeHead);
+		np->subnodeTail = TOKEN(cp->subnodeTail);
+		np->next = TOKEN(cp->next);
+		np->arena = NULL;
+	}
+	for (i = 0; i < header->attributeCount; i++) {
+		const CacheAttribute *cp = &attributes[i];
+		AttributeNode *ap = &imageAttributes[i];
+		ap->name = STRING(cp->name);
+		ap->value = STRING(cp->value);
+		ap->next = ATTRIBUTE(cp->next);
+	}
+
+	ClearInputs();
+	for (i = 0; i < header->fileCount; i++) {
+		inputs.push_back(CopyString(STRING(files[i].path)));
+		inputFiles.push_back(files[i]);
+	}
+
+#undef STRING
+#undef TOKEN
+#undef ATTRIBUTE
+
+	delete[] path;
+	stats.hit = true;
+	stats.reason = NULL;
+	stats.lookupUs = GetMicroseconds() - start;
+	return imageTokens;
+
+miss:
+	delete[] path;
+	UnloadCache();
+	stats.lookupUs = GetMicroseconds() - start;
+	return NULL;
+}
+
+/** Free the tokens returned by LoadCache. */
+void ConfigCache::UnloadCache(void) {
+	if (imageTokens) {
+		delete[] imageTokens;
+		imageTokens = NULL;
+	}
+	if (imageAttributes) {
+		delete[] imageAttributes;
+		imageAttributes = NULL;
+	}
+	if (image) {
+		munmap(image, imageSize);
+		image = NULL;
+		imageSize = 0;
+	}
+}
+
+/** Free the list of inputs. */
+void ConfigCache::DestroyCache(void) {
+	UnloadCache();
+	ClearInputs();
+	if (stats.path) {
+		delete[] stats.path;
+		stats.path = NULL;
+	}
+}
+
+/** Forget the inputs of the last configuration. */
+void ConfigCache::ClearInputs(void) {
+	std::vector<char*>::iterator it;
+	for (it = inputs.begin(); it != inputs.end(); ++it) {
+		delete[] *it;
+	}
+	inputs.clear();
+	inputFiles.clear();
+}
+
+/** Use the cache without writing it. */
+void ConfigCache::SetReadOnly(void) {
+	readOnly = 1;
+}
+
+/** Get the files that went into the configuration last loaded. */
+const std::vector<char*> &ConfigCache::GetInputs(void) {
+	return inputs;
+}
+
+/** Tokenize a configuration file, inline its includes and cache it. */
+TokenNode *ConfigCache::BuildCache(const char *fileName) {
+	TokenNode *tokens;
+	unsigned long start;
+	char *cachePath;
+	bool complete;
+
+	start = GetMicroseconds();
+	ClearInputs();
+	tokens = ReadTokens(fileName);
+	if (!tokens) {
+		return NULL;
+	}
+	complete = InlineIncludes(tokens, 1);
+	stats.tokenizeUs = GetMicroseconds() - start;
+
+	/* Includes that failed are left in the tree for the parser to report
+	 * (and to retry next time), so don't cache such a tree. */
+	if (!complete) {
+		stats.reason = "unresolved include";
+		return tokens;
+	}
+
+	if (readOnly) {
+		stats.reason = "read only";
+		return tokens;
+	}
+
+	start = GetMicroseconds();
+	cachePath = GetCachePath(inputs[0]);
+	if (cachePath) {
+		StoreCache(cachePath, tokens);
+		delete[] cachePath;
+	}
+	stats.storeUs = GetMicroseconds() - start;
+
+	return tokens;
+}
+
+/** Read and tokenize a file, recording it as an input. */
+TokenNode *ConfigCache::ReadTokens(const char *fileName) {
+	struct stat sbuf;
+	TokenNode *tokens;
+	CacheFile info;
+	char *path;
+	char *buffer;
+	int fd;
+
+	path = CopyString(fileName);
+	ExpandPath(&path);
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		delete[] path;
+		return NULL;
+	}
+	if (JUNLIKELY(fstat(fd, &sbuf) == -1)) {
+		close(fd);
+		delete[] path;
+		return NULL;
+	}
+	buffer = (char*) mmap(NULL, sbuf.st_size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (JUNLIKELY(buffer == MAP_FAILED)) {
+		delete[] path;
+		return NULL;
+	}
+
+	/* A file modified in the same clock tick as it was read could change
+	 * again without its time changing, so don't trust the time of a
+	 * file that was just modified; it is hashed when checked instead. */
+	memset(&info, 0, sizeof(info));
+	info.size = sbuf.st_size;
+	if (sbuf.st_mtim.tv_sec + 2 < time(NULL)) {
+		info.mtimeSeconds = sbuf.st_mtim.tv_sec;
+		info.mtimeNanoseconds = sbuf.st_mtim.tv_nsec;
+	}
+	info.hash = HashBuffer(buffer, sbuf.st_size);
+	inputs.push_back(path);
+	inputFiles.push_back(info);
+
+	/* The tokens refer to the name, which lives as long as the inputs. */
+	tokens = TokenizeMapping(buffer, sbuf.st_size, path);
+	return tokens;
+}
+
+/** Replace the file includes below a token by the tokens they include.
+ * @return false if an include could not be resolved.
+ */
+bool ConfigCache::InlineIncludes(TokenNode *parent, int depth) {
+	TokenNode *np;
+	TokenNode *prev;
+	TokenNode *next;
+	bool complete = true;
+
+	prev = NULL;
+	for (np = parent->subnodeHead; np; np = next) {
+		next = np->next;
+
+		/* Only includes the parser resolves from a file can be inlined;
+		 * the output of a command may change at any time. */
+		if (np->type != TOK_INCLUDE
+				|| (parent->type != TOK_JWM && parent->type != TOK_MENU
+						&& parent->type != TOK_ROOTMENU)
+				|| !np->value || !strncmp(np->value, "exec:", 5)) {
+			if (np->subnodeHead) {
+				complete = InlineIncludes(np, depth) && complete;
+			}
+			prev = np;
+			continue;
+		}
+
+		TokenNode *tokens = NULL;
+		if (depth < MAX_INCLUDE_DEPTH) {
+			tokens = ReadTokens(np->value);
+		}
+		if (!tokens || tokens->type != TOK_JWM) {
+			ReleaseTokens(tokens);
+			complete = false;
+			prev = np;
+			continue;
+		}
+		complete = InlineIncludes(tokens, depth + 1) && complete;
+
+		/* Splice the children of the included root in place of the include. */
+		TokenNode *tp;
+		for (tp = tokens->subnodeHead; tp; tp = tp->next) {
+			tp->parent = parent;
+		}
+		TokenNode *head = tokens->subnodeHead ? tokens->subnodeHead : next;
+		if (prev) {
+			prev->next = head;
+		} else {
+			parent->subnodeHead = head;
+		}
+		if (tokens->subnodeHead) {
+			tokens->subnodeTail->next = next;
+			prev = tokens->subnodeTail;
+		}
+		if (!next) {
+			parent->subnodeTail = prev;
+		}
+		AdoptTokens(parent, tokens);
+	}
+
+	return complete;
+}
+
+/** Add a string to the image.
+ * Each string gets its own copy since the parser may modify it.
+ */
+uint32_t CacheWriter::AddString(const char *str) {
+	if (!str) {
+		return CACHE_NONE;
+	}
+	const uint32_t offset = strings.size();
+	strings.append(str, strlen(str) + 1);
+	return offset;
+}
+
+/** Add a file name to the image, sharing it between tokens. */
+uint32_t CacheWriter::AddFileName(const char *str) {
+	if (!str) {
+		return CACHE_NONE;
+	}
+	std::pair<std::unordered_map<std::string, uint32_t>::iterator, bool> result =
+			offsets.insert(std::make_pair(std::string(str), (uint32_t) strings.size()));
+	if (result.second) {
+		strings.append(str, strlen(str) + 1);
+	}
+	return result.first->second;
+}
+
+/** Add a list of tokens to the image (in pre-order).
+ * @return The index of the first token.
+ */
+uint32_t CacheWriter::AddTokens(const TokenNode *np, uint32_t parent,
+		uint32_t *last) {
+	uint32_t first = CACHE_NONE;
+	uint32_t prev = CACHE_NONE;
+
+	for (; np; np = np->next) {
+		const uint32_t index = tokens.size();
+		const AttributeNode *ap;
+		CacheToken token;
+		uint32_t prevAttribute = CACHE_NONE;
+
+		token.type = np->type;
+		token.invalidName = AddString(np->invalidName);
+		token.value = AddString(np->value);
+		token.fileName = AddFileName(np->fileName);
+		token.line = np->line;
+		token.attributes = CACHE_NONE;
+		token.parent = parent;
+		token.subnodeHead = CACHE_NONE;
+		token.subnodeTail = CACHE_NONE;
+		token.next = CACHE_NONE;
+		for (ap = np->attributes; ap; ap = ap->next) {
+			CacheAttribute attribute;
+			attribute.name = AddString(ap->name);
+			attribute.value = AddString(ap->value);
+			attribute.next = CACHE_NONE;
+			if (prevAttribute == CACHE_NONE) {
+				token.attributes = attributes.size();
+			} else {
+				attributes[prevAttribute].next = attributes.size();
+			}
+			prevAttribute = attributes.size();
+			attributes.push_back(attribute);
+		}
+		tokens.push_back(token);
+
+		if (np->subnodeHead) {
+			uint32_t tail;
+			const uint32_t head = AddTokens(np->subnodeHead, index, &tail);
+			tokens[index].subnodeHead = head;
+			tokens[index].subnodeTail = tail;
+		}
+		if (prev == CACHE_NONE) {
+			first = index;
+		} else {
+			tokens[prev].next = index;
+		}
+		prev = index;
+	}
+
+	*last = prev;
+	return first;
+}
+
+/** Write the image of a token tree. */
+void ConfigCache::StoreCache(const char *path, const TokenNode *tokens) {
+	CacheWriter writer;
+	CacheHeader header;
+	std::string temp;
+	std::string directory;
+	std::vector<CacheFile>::iterator it;
+	uint32_t last;
+	unsigned i;
+	bool ok;
+	FILE *fp;
+
+	for (i = 0; i < inputFiles.size(); i++) {
+		CacheFile file = inputFiles[i];
+		file.path = writer.AddFileName(inputs[i]);
+		writer.files.push_back(file);
+	}
+	writer.AddTokens(tokens, CACHE_NONE, &last);
+
+	memset(&header, 0, sizeof(header));
+	header.magic = CACHE_MAGIC;
+	header.version = CACHE_VERSION;
+	header.tokenTypes = TOK_WINDOWSTYLE + 1;
+	header.fileCount = writer.files.size();
+	header.tokenCount = writer.tokens.size();
+	header.attributeCount = writer.attributes.size();
+	header.stringSize = writer.strings.size();
+
+	directory = path;
+	directory.erase(directory.rfind('/'));
+	if (!MakeDirectory(directory.c_str())) {
+		Debug("could not create %s: %s", directory.c_str(), strerror(errno));
+		return;
+	}
+
+	/* Write to a temporary file and rename it so that a concurrent
+	 * start never sees a partial image. */
+	char suffix[16];
+	snprintf(suffix, sizeof(suffix), ".%d", (int) getpid());
+	temp = path;
+	temp += suffix;
+	fp = fopen(temp.c_str(), "wb");
+	if (!fp) {
+		Debug("could not write %s: %s", temp.c_str(), strerror(errno));
+		return;
+	}
+	ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+	if (ok && !writer.files.empty()) {
+		ok = fwrite(&writer.files[0], sizeof(CacheFile), writer.files.size(), fp)
+				== writer.files.size();
+	}
+	if (ok && !writer.tokens.empty()) {
+		ok = fwrite(&writer.tokens[0], sizeof(CacheToken), writer.tokens.size(),
+				fp) == writer.tokens.size();
+	}
+	if (ok && !writer.attributes.empty()) {
+		ok = fwrite(&writer.attributes[0], sizeof(CacheAttribute),
+				writer.attributes.size(), fp) == writer.attributes.size();
+	}
+	if (ok) {
+		ok = fwrite(writer.strings.data(), 1, writer.strings.size(), fp)
+				== writer.strings.size();
+	}
+	ok = fclose(fp) == 0 && ok;
+	if (!ok || rename(temp.c_str(), path) == -1) {
+		Debug("could not write %s: %s", path, strerror(errno));
+		unlink(temp.c_str());
+	}
+}
+
+/** Print how the configuration was loaded. */
+void ConfigCache::PrintReport(unsigned long totalUs) {
+	if (stats.hit) {
+		printf("config cache: hit (%s)\n", stats.path);
+		printf("  lookup %lu us\n", stats.lookupUs);
+	} else {
+		printf("config cache: miss, %s (%s)\n", stats.reason,
+				stats.path ? stats.path : "no cache directory");
+		printf("  lookup %lu us, tokenize %lu us, store %lu us\n",
+				stats.lookupUs, stats.tokenizeUs, stats.storeUs);
+	}
+	printf("  %u file(s), total %lu us\n", (unsigned) inputs.size(), totalUs);
+}
+
+/** Get a monotonic time in microseconds. */
+unsigned long ConfigCache::GetMicroseconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000UL + ts.tv_nsec / 1000;
+}
+
+/** Hash a buffer (64-bit FNV-1a). */
+uint64_t HashBuffer(const char *buffer, size_t size) {
+	uint64_t hash = 14695981039346656037ULL;
+	size_t i;
+	for (i = 0; i < size; i++) {
+		hash ^= (unsigned char) buffer[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+/** Determine if a file still has the contents recorded for it.
+ * Only the size and time are checked unless the time changed; a file
+ * that was touched but not modified still matches.
+ */
+bool MatchesFile(const char *path, const CacheFile *fp) {
+	struct stat sbuf;
+	char *buffer;
+	bool matches;
+	int fd;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return false;
+	}
+	if (fstat(fd, &sbuf) == -1 || (uint64_t) sbuf.st_size != fp->size) {
+		close(fd);
+		return false;
+	}
+	if (sbuf.st_mtim.tv_sec == fp->mtimeSeconds
+			&& sbuf.st_mtim.tv_nsec == fp->mtimeNanoseconds) {
+		close(fd);
+		return true;
+	}
+	if (fp->size == 0) {
+		close(fd);
+		return true;
+	}
+	buffer = (char*) mmap(NULL, fp->size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (buffer == MAP_FAILED) {
+		return false;
+	}
+	matches = HashBuffer(buffer, fp->size) == fp->hash;
+	munmap(buffer, fp->size);
+	return matches;
+}
+
+/** Create a directory and its parents. */
+bool MakeDirectory(const char *path) {
+	std::string current;
+	const char *p;
+
+	for (p = path; *p; p++) {
+		current += *p;
+		if (p[1] == '/' || p[1] == 0) {
+			if (mkdir(current.c_str(), 0700) == -1 && errno != EEXIST) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file ConfigCache.h
+ *
+ * @brief Compiled configuration cache.
+ *
+ * The configuration is cached as a flat image of its token tree with all
+ * file includes inlined. The image holds no pointers (tokens refer to
+ * each other by index and to their strings by offset), so it is loaded
+ * with a single mmap and only needs its links filled in. It records the
+ * modification time, size and hash of every file that went into it and
+ * is ignored as soon as one of them changed.
+ *
+ */
+
+#ifndef CONFIG_CACHE_H
+#define CONFIG_CACHE_H
+
+#include <vector>
+
+struct TokenNode;
+
+class ConfigCache {
+public:
+
+	/** Load the cached tokens of a configuration file.
+	 * @param fileName The configuration file.
+	 * @return The tokens or NULL if there is no valid cache.
+	 *         The tokens must be freed with UnloadCache.
+	 */
+	static TokenNode *LoadCache(const char *fileName);
+
+	/** Tokenize a configuration file, inline its includes and cache it.
+	 * The cache is only written if every include could be resolved.
+	 * @param fileName The configuration file.
+	 * @return The tokens or NULL if the file could not be read.
+	 *         The tokens must be freed with ReleaseTokens.
+	 */
+	static TokenNode *BuildCache(const char *fileName);
+
+	/** Use the cache without writing it.
+	 * This is used when checking a configuration that may not be loaded.
+	 */
+	static void SetReadOnly(void);
+
+	/** Free the tokens returned by LoadCache. */
+	static void UnloadCache(void);
+
+	/** Free the list of inputs. */
+	static void DestroyCache(void);
+
+	/** Get the files that went into the configuration last loaded.
+	 * The first entry is the configuration file itself.
+	 */
+	static const std::vector<char*> &GetInputs(void);
+
+	/** Print how the configuration was loaded (for jwm -p).
+	 * @param totalUs Microseconds taken to load and parse the configuration.
+	 */
+	static void PrintReport(unsigned long totalUs);
+
+	/** Get a monotonic time in microseconds. */
+	static unsigned long GetMicroseconds(void);
+
+private:
+	static char *GetCachePath(const char *path);
+	static TokenNode *ReadTokens(const char *fileName);
+	static bool InlineIncludes(TokenNode *parent, int depth);
+	static void StoreCache(const char *path, const TokenNode *tokens);
+	static void ClearInputs(void);
+};
+
+#endif /* CONFIG_CACHE_H */
@@ -0,0 +1,301 @@
+/**
+ * @file ConfigWatcher.cpp
+ *
+ * @brief Automatic reload of the configuration when it changes.
+ *
+ */
+
+#include "jwm.h"
+#include "ConfigWatcher.h"
+#include "ConfigCache.h"
+#include "event.h"
+#include "error.h"
+#include "root.h"
+#include "main.h"
+#include "logger.h"
+
+#include <fcntl.h>
+#include <errno.h>
+#ifdef __linux__
+#  include <sys/inotify.h>
+#endif
+
+#include <string>
+#include <vector>
+
+/** Program run to check the configuration. */
+#define CHECK_PROGRAM "/proc/self/exe"
+
+/** A watched directory. */
+typedef struct WatchNode {
+	int wd; /**< The inotify watch. */
+	std::vector<std::string> names; /**< Watched files in the directory. */
+} WatchNode;
+
+/** The inotify descriptor or -1 if not watching. */
+static int watchDescriptor = -1;
+
+/** Watched directories. */
+static std::vector<WatchNode> watches;
+
+/** Read end of the pipe from a running check or -1. */
+static int checkDescriptor = -1;
+
+/** Set if the configuration changed while it was being checked. */
+static char changedDuringCheck = 0;
+
+/** Start watching the files of the configuration last loaded. */
+void ConfigWatcher::StartupWatcher(void) {
+#ifdef __linux__
+	watchDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (JUNLIKELY(watchDescriptor < 0)) {
+		Warning(_("could not watch the configuration: %s"), strerror(errno));
+		return;
+	}
+	Events::_RegisterDescriptor(watchDescriptor, HandleChange, NULL);
+	Events::_RegisterCallback(-1, SignalCheck, NULL);
+	changedDuringCheck = 0;
+	UpdateWatches();
+#endif
+}
+
+/** Stop watching. */
+void ConfigWatcher::ShutdownWatcher(void) {
+	if (checkDescriptor >= 0) {
+		Events::_UnregisterDescriptor(checkDescriptor);
+		close(checkDescriptor);
+		checkDescriptor = -1;
+	}
+	if (watchDescriptor >= 0) {
+		Events::_UnregisterCallback(SignalCheck, NULL);
+		Events::_UnregisterDescriptor(watchDescriptor);
+		close(watchDescriptor);
+		watchDescriptor = -1;
+	}
+	watches.clear();
+}
+
+/** Watch the files of the configuration last loaded. */
+void ConfigWatcher::UpdateWatches(void) {
+	const std::vector<char*> &inputs = ConfigCache::GetInputs();
+	std::vector<char*>::const_iterator it;
+
+	if (watchDescriptor < 0) {
+		return;
+	}
+	ClearWatches();
+	for (it = inputs.begin(); it != inputs.end(); ++it) {
+		AddWatch(*it);
+	}
+}
+
+/** Watch the directory containing a file. */
+void ConfigWatcher::AddWatch(const char *path) {
+#ifdef __linux__
+	const char *slash = strrchr(path, '/');
+	std::string directory;
+	std::vector<WatchNode>::iterator it;
+	const char *name;
+	int wd;
+
+	if (slash) {
+		directory.assign(path, slash == path ? 1 : slash - path);
+		name = slash + 1;
+	} else {
+		directory = ".";
+		name = path;
+	}
+
+	wd = inotify_add_watch(watchDescriptor, directory.c_str(),
+			IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_MOVED_FROM);
+	if (JUNLIKELY(wd < 0)) {
+		Warning(_("could not watch %s: %s"), directory.c_str(), strerror(errno));
+		return;
+	}
+
+	/* Adding a directory twice returns the same watch. */
+	for (it = watches.begin(); it != watches.end(); ++it) {
+		if (it->wd == wd) {
+			it->names.push_back(name);
+			return;
+		}
+	}
+	WatchNode node;
+	node.wd = wd;
+	node.names.push_back(name);
+	watches.push_back(node);
+#endif
+}
+
+/** Remove all watches. */
+void ConfigWatcher::ClearWatches(void) {
+#ifdef __linux__
+	std::vector<WatchNode>::iterator it;
+	for (it = watches.begin(); it != watches.end(); ++it) {
+		inotify_rm_watch(watchDescriptor, it->wd);
+	}
+#endif
+	watches.clear();
+}
+
+/** Read inotify events and restart the delay if a watched file changed. */
+void ConfigWatcher::HandleChange(int fd, void *data) {
+#ifdef __linux__
+	char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *event;
+	std::vector<WatchNode>::const_iterator it;
+	char changed = 0;
+	ssize_t len;
+	ssize_t i;
+
+	for (;;) {
+		len = read(fd, buffer, sizeof(buffer));
+		if (len <= 0) {
+			break;
+		}
+		for (i = 0; i < len; i += sizeof(struct inotify_event) + event->len) {
+			event = (const struct inotify_event*) &buffer[i];
+			if (event->mask & IN_Q_OVERFLOW) {
+				changed = 1;
+				continue;
+			}
+			if (!event->len) {
+				continue;
+			}
+			for (it = watches.begin(); it != watches.end(); ++it) {
+				if (it->wd == event->wd) {
+					std::vector<std::string>::const_iterator name;
+					for (name = it->names.begin(); name != it->names.end(); ++name) {
+						if (*name == event->name) {
+							changed = 1;
+							break;
+						}
+					}
+					break;
+				}
+			}
+		}
+	}
+
+	/* Editors often write a file in several steps; wait for them to finish. */
+	if (changed) {
+		Events::_RescheduleCallback(SignalCheck, NULL, CONFIG_WATCH_DELAY);
+	}
+#endif
+}
+
+/** Check the configuration once it stopped changing. */
+void ConfigWatcher::SignalCheck(const TimeType *now, int x, int y, Window w,
+		void *data) {
+	Events::_RescheduleCallback(SignalCheck, NULL, -1);
+	if (checkDescriptor >= 0) {
+		changedDuringCheck = 1;
+	} else {
+		StartCheck();
+	}
+}
+
+/**
+ * Start checking the configuration in the background.
+ * The window manager reaps every child it has, so the
+ * result of the check is collected by an intermediate process and passed
+ * back through a pipe.
+ */
+void ConfigWatcher::StartCheck(void) {
+	char result;
+	pid_t pid;
+	int fds[2];
+
+	if (JUNLIKELY(pipe(fds))) {
+		Warning(_("could not create pipe"));
+		return;
+	}
+	fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+
+	pid = fork();
+	if (pid == 0) {
+		signal(SIGCHLD, SIG_DFL);
+		close(ConnectionNumber(display));
+		close(fds[0]);
+		result = RunCheck();
+		if (write(fds[1], &result, 1) != 1) {
+			_exit(1);
+		}
+		_exit(0);
+	}
+
+	close(fds[1]);
+	if (JUNLIKELY(pid < 0)) {
+		Warning(_("could not check the configuration: %s"), strerror(errno));
+		close(fds[0]);
+		return;
+	}
+	checkDescriptor = fds[0];
+	Events::_RegisterDescriptor(checkDescriptor, HandleCheck, NULL);
+}
+
+/**
+ * Run "jwm -check-config" on the configuration and wait for it.
+ * This runs in the intermediate process.
+ * @return 1 if the configuration parsed without warnings, 0 otherwise.
+ */
+char ConfigWatcher::RunCheck(void) {
+	const char *argv[5];
+	int argc = 0;
+	int status;
+	pid_t pid;
+
+	argv[argc++] = "jwm";
+	argv[argc++] = CHECK_OPTION;
+	if (configPath) {
+		argv[argc++] = "-f";
+		argv[argc++] = configPath;
+	}
+	argv[argc] = NULL;
+
+	pid = fork();
+	if (pid == 0) {
+		/* Keep the warnings, but not the log. */
+		const int fd = open("/dev/null", O_WRONLY);
+		if (fd >= 0) {
+			dup2(fd, 1);
+		}
+		execv(CHECK_PROGRAM, (char* const*) argv);
+		_exit(127);
+	} else if (JUNLIKELY(pid < 0)) {
+		return 0;
+	}
+
+	while (waitpid(pid, &status, 0) < 0) {
+		if (errno != EINTR) {
+			return 0;
+		}
+	}
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/** Reload the configuration if it passed the check. */
+void ConfigWatcher::HandleCheck(int fd, void *data) {
+	char result = 0;
+
+	if (read(fd, &result, 1) < 0 && errno == EINTR) {
+		return;
+	}
+	Events::_UnregisterDescriptor(fd);
+	close(fd);
+	checkDescriptor = -1;
+
+	/* The result is stale if the files changed again in the meantime. */
+	if (changedDuringCheck) {
+		changedDuringCheck = 0;
+		StartCheck();
+		return;
+	}
+
+	if (result == 1) {
+		Log("Reloading the changed configuration\n");
+		Roots::ReloadMenu();
+	} else {
+		Warning(_("the configuration has errors; it was not reloaded"));
+	}
+}
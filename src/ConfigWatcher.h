@@ -0,0 +1,48 @@
+/**
+ * @file ConfigWatcher.h
+ *
+ * @brief Automatic reload of the configuration when it changes.
+ *
+ * The directories holding the configuration file and the files it
+ * includes are watched with inotify. Directories are watched rather than
+ * the files themselves so that editors that save by renaming a new file
+ * over the old one are noticed as well. Changes are debounced, then the
+ * new configuration is checked in a separate process (without running
+ * exec includes or writing the compiled configuration); only when
+ * it parses without warnings is the configuration reloaded. A broken or
+ * half-written configuration therefore never reaches the running session.
+ *
+ */
+
+#ifndef CONFIG_WATCHER_H
+#define CONFIG_WATCHER_H
+
+/** Milliseconds without changes before the configuration is checked. */
+#define CONFIG_WATCH_DELAY 500
+
+class ConfigWatcher {
+public:
+
+	/** Start watching the files of the configuration last loaded. */
+	static void StartupWatcher(void);
+
+	/** Stop watching and abandon a check in progress. */
+	static void ShutdownWatcher(void);
+
+	/** Watch the files of the configuration last loaded.
+	 * This is called after a reload since the includes may have changed.
+	 */
+	static void UpdateWatches(void);
+
+private:
+	static void AddWatch(const char *path);
+	static void ClearWatches(void);
+	static void StartCheck(void);
+	static char RunCheck(void);
+	static void HandleChange(int fd, void *data);
+	static void HandleCheck(int fd, void *data);
+	static void SignalCheck(const struct TimeType *now, int x, int y,
+			Window w, void *data);
+};
+
+#endif /* CONFIG_WATCHER_H */
@@ -19,6 +19,15 @@ void DesktopComponent::start() {
 	Desktops::_StartupDesktops();
 }
 
+const char *DesktopComponent::getName() const {
+	return "desktops";
+}
+
+const char *const *DesktopComponent::getDependencies() const {
+	static const char *const dependencies[] = { "settings", NULL };
+	return dependencies;
+}
+
 void DesktopComponent::stop() {
 	Desktops::_ShutdownDesktops();
 }
@@ -19,6 +19,8 @@ public:
   virtual void start();
   virtual void stop();
   virtual void destroy();
+  virtual const char *getName() const;
+  virtual const char *const *getDependencies() const;
 private:
   static bool registered;
 };
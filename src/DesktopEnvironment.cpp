@@ -45,6 +45,13 @@ int shapeEvent;
 #ifdef USE_XRENDER
 char haveRender;
 #endif
+#ifdef USE_XCOMPOSITE
+char haveComposite;
+#endif
+#ifdef USE_XDAMAGE
+char haveDamage;
+int damageEvent;
+#endif
 
 char *configPath = NULL;
 
@@ -130,6 +137,7 @@ void DesktopEnvironment::InitializeComponents() {
 
 void DesktopEnvironment::StartupComponents() {
   for (std::vector<Component*>::iterator it = this->_components.begin(); it != this->_components.end(); ++it) {
+    (*it)->prepare();
     (*it)->start();
   }
 }
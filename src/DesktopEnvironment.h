@@ -27,6 +27,7 @@ public:
   virtual void DestroyComponents();
   virtual bool RegisterComponent(Component *component);
   virtual unsigned int ComponentCount() {return _componentCount;}
+  virtual const std::vector<Component*> &GetComponents() const {return _components;}
 
   virtual bool OpenConnection();
   virtual void ShowDesktop();
@@ -22,6 +22,15 @@ void DockComponent::start() {
   DockType::_StartupDock();
 }
 
+const char *DockComponent::getName() const {
+  return "dock";
+}
+
+const char *const *DockComponent::getDependencies() const {
+  static const char *const dependencies[] = { "colors", NULL };
+  return dependencies;
+}
+
 void DockComponent::stop() {
   DockType::_ShutdownDock();
 }
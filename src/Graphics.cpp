@@ -7,11 +7,28 @@
 
 #include "jwm.h"
 #include "main.h"
+#include "misc.h"
 #include "Graphics.h"
 #include "button.h"
 
+/** Pixmap sizes are rounded up to a multiple of this for pooling. */
+#define PIXMAP_GRANULE 64
+
+/** Most unused pixmaps kept for each size class. */
+#define MAX_CACHED_PIXMAPS 2
+
+/** Most unused GCs kept for each kind. */
+#define MAX_CACHED_GCS 4
+
+std::vector<Graphics*> Graphics::freeGraphics;
+std::unordered_map<unsigned long, std::vector<GC> > Graphics::freeGCs;
+std::unordered_map<GC, unsigned long> Graphics::gcKeys;
+std::unordered_map<unsigned long, std::vector<Pixmap> > Graphics::freePixmaps;
+std::unordered_map<Pixmap, unsigned long> Graphics::pixmapKeys;
+GraphicsStats Graphics::stats;
+
 Graphics::Graphics(const Pixmap p, GC gc, Display *display) :
-		surface(p), context(gc), _display(display) {
+		surface(p), context(gc), _display(display), pooled(0) {
 
 }
 
@@ -39,8 +56,17 @@ void Graphics::copy(Drawable dest, int srcX, int srcY, int width, int height, in
 	JXCopyArea(_display, surface, dest, context, srcX, srcY, width, height, destX, destY);
 }
 
+/** Release the surface. */
 void Graphics::free() {
-	JXFreePixmap(_display, surface);
+	if (surface == None) {
+		return;
+	}
+	if (pooled) {
+		ReleasePixmap(surface);
+	} else {
+		JXFreePixmap(_display, surface);
+	}
+	surface = None;
 }
 
 void Graphics::setForeground(unsigned short index) {
@@ -56,37 +82,163 @@ void Graphics::drawButton(ButtonType type, AlignmentType alignment, FontType fon
 	DrawButton(type, alignment, font, text, fill, border, this->surface, icon, x, y, width, height, xoffset, yoffset);
 }
 
-std::vector<Graphics*> Graphics::graphics;
-
 Graphics* Graphics::create(Display *display, GC gc, Drawable d, int width, int height, int rootDepth) {
-	Pixmap map = JXCreatePixmap(display, d, width, height, rootDepth);
-	return wrap(map, gc, display);
+	Graphics *g = allocate(AcquirePixmap(width, height, rootDepth), gc, display);
+	g->pooled = 1;
+	return g;
 }
 
 void Graphics::destroy(Graphics *g) {
+	g->free();
+	freeGraphics.push_back(g);
+}
+
+Graphics* Graphics::wrap(const Pixmap p, GC gc, Display *display) {
+	return allocate(p, gc, display);
+}
+
+Graphics* Graphics::getRootGraphics(const Pixmap p) {
+	return wrap(p, rootGC, display);
+}
+
+/** Get a graphics object, reusing a destroyed one if possible. */
+Graphics *Graphics::allocate(const Pixmap p, GC gc, Display *display) {
+	Graphics *g;
+	if (freeGraphics.empty()) {
+		return new Graphics(p, gc, display);
+	}
+	g = freeGraphics.back();
+	freeGraphics.pop_back();
+	g->surface = p;
+	g->context = gc;
+	g->_display = display;
+	g->pooled = 0;
+	return g;
+}
+
+/** Free the resources in the pools. */
+void Graphics::ShutdownGraphics(void) {
+	std::unordered_map<unsigned long, std::vector<GC> >::iterator git;
+	std::unordered_map<unsigned long, std::vector<Pixmap> >::iterator pit;
 	std::vector<Graphics*>::iterator it;
-	char found = 0;
-	for (it = graphics.begin(); it != graphics.end(); ++it) {
-		if (*it == g) {
-			found = 1;
-			break;
+
+	for (git = freeGCs.begin(); git != freeGCs.end(); ++git) {
+		for (GC gc : git->second) {
+			gcKeys.erase(gc);
+			JXFreeGC(display, gc);
+			stats.gcs -= 1;
 		}
 	}
+	freeGCs.clear();
+	for (pit = freePixmaps.begin(); pit != freePixmaps.end(); ++pit) {
+		for (Pixmap p : pit->second) {
+			pixmapKeys.erase(p);
+			JXFreePixmap(display, p);
+			stats.pixmaps -= 1;
+		}
+	}
+	freePixmaps.clear();
+	for (it = freeGraphics.begin(); it != freeGraphics.end(); ++it) {
+		delete *it;
+	}
+	freeGraphics.clear();
+	stats.cachedGCs = 0;
+	stats.cachedPixmaps = 0;
 
-	if (found) {
-		graphics.erase(it);
+	Debug("graphics: %lu hits, %lu misses, %u GCs and %u pixmaps still in use",
+			stats.hits, stats.misses, stats.gcs, stats.pixmaps);
+}
+
+/** Get a GC from the pool. */
+GC Graphics::AcquireGC(int depth, int function, int lineWidth) {
+	const unsigned long key = (unsigned long) (depth & 0xFF)
+			| ((unsigned long) (function & 0xF) << 8)
+			| ((unsigned long) (lineWidth & 0xFFFF) << 12);
+	std::vector<GC> &pool = freeGCs[key];
+	XGCValues gcValues;
+	Drawable d;
+	GC gc;
+
+	if (!pool.empty()) {
+		gc = pool.back();
+		pool.pop_back();
+		stats.cachedGCs -= 1;
+		stats.hits += 1;
+		return gc;
 	}
 
-	g->free();
-	delete g;
+	/* A GC can be used with any drawable of the same depth and screen. */
+	d = rootWindow;
+	if (depth != rootDepth) {
+		d = AcquirePixmap(1, 1, depth);
+	}
+	gcValues.function = function;
+	gcValues.line_width = lineWidth;
+	gcValues.graphics_exposures = False;
+	gc = JXCreateGC(display, d, GCFunction | GCLineWidth | GCGraphicsExposures,
+			&gcValues);
+	if (depth != rootDepth) {
+		ReleasePixmap(d);
+	}
+	gcKeys[gc] = key;
+	stats.gcs += 1;
+	stats.misses += 1;
+	return gc;
 }
 
-Graphics* Graphics::wrap(const Pixmap p, GC gc, Display *display) {
-	Graphics *g = new Graphics(p, gc, display);
-	graphics.push_back(g);
-	return g;
+/** Return a GC to the pool. */
+void Graphics::ReleaseGC(GC gc) {
+	std::unordered_map<GC, unsigned long>::iterator it = gcKeys.find(gc);
+	Assert(it != gcKeys.end());
+	std::vector<GC> &pool = freeGCs[it->second];
+	if (pool.size() < MAX_CACHED_GCS) {
+		pool.push_back(gc);
+		stats.cachedGCs += 1;
+	} else {
+		gcKeys.erase(it);
+		JXFreeGC(display, gc);
+		stats.gcs -= 1;
+	}
 }
 
-Graphics* Graphics::getRootGraphics(const Pixmap p) {
-	return wrap(p, rootGC, display);
+/** Get a scratch pixmap from the pool. */
+Pixmap Graphics::AcquirePixmap(int width, int height, int depth) {
+	const unsigned long columns = (Max(width, 1) + PIXMAP_GRANULE - 1)
+			/ PIXMAP_GRANULE;
+	const unsigned long rows = (Max(height, 1) + PIXMAP_GRANULE - 1)
+			/ PIXMAP_GRANULE;
+	const unsigned long key = (unsigned long) (depth & 0xFF)
+			| ((columns & 0xFFF) << 8) | ((rows & 0xFFF) << 20);
+	std::vector<Pixmap> &pool = freePixmaps[key];
+	Pixmap p;
+
+	if (!pool.empty()) {
+		p = pool.back();
+		pool.pop_back();
+		stats.cachedPixmaps -= 1;
+		stats.hits += 1;
+		return p;
+	}
+
+	p = JXCreatePixmap(display, rootWindow, columns * PIXMAP_GRANULE,
+			rows * PIXMAP_GRANULE, depth);
+	pixmapKeys[p] = key;
+	stats.pixmaps += 1;
+	stats.misses += 1;
+	return p;
+}
+
+/** Return a scratch pixmap to the pool. */
+void Graphics::ReleasePixmap(Pixmap p) {
+	std::unordered_map<Pixmap, unsigned long>::iterator it = pixmapKeys.find(p);
+	Assert(it != pixmapKeys.end());
+	std::vector<Pixmap> &pool = freePixmaps[it->second];
+	if (pool.size() < MAX_CACHED_PIXMAPS) {
+		pool.push_back(p);
+		stats.cachedPixmaps += 1;
+	} else {
+		pixmapKeys.erase(it);
+		JXFreePixmap(display, p);
+		stats.pixmaps -= 1;
+	}
 }
@@ -9,9 +9,20 @@
 #define SRC_GRAPHICS_H_
 
 #include "jwm.h"
+#include <unordered_map>
 #include <vector>
 #include "button.h"
 
+/** Counters for the server resources managed by Graphics. */
+typedef struct GraphicsStats {
+	unsigned int gcs; /**< GCs that exist on the server. */
+	unsigned int pixmaps; /**< Pooled pixmaps that exist on the server. */
+	unsigned int cachedGCs; /**< GCs waiting in the pool. */
+	unsigned int cachedPixmaps; /**< Pixmaps waiting in the pool. */
+	unsigned long hits; /**< Requests served from the pool. */
+	unsigned long misses; /**< Requests that needed a new resource. */
+} GraphicsStats;
+
 class Graphics {
 private:
 	Graphics(const Pixmap p, GC gc, Display *display);
@@ -33,13 +44,67 @@ public:
 	Display *_display;
 
 public:
+	/** Create a graphics object with a scratch surface from the pool.
+	 * The surface may be larger than requested.
+	 */
 	static Graphics *create(Display *display, GC gc, Drawable d, int width, int height, int rootDepth);
+
+	/** Destroy a graphics object, returning a pooled surface to the pool. */
 	static void destroy(Graphics* g);
+
+	/** Create a graphics object for a surface owned by the caller. */
 	static Graphics *wrap(const Pixmap p, GC gc, Display *display);
 
 	static Graphics *getRootGraphics(const Pixmap p);
+
+	/*@{*/
+	static void ShutdownGraphics(void);
+	/*@}*/
+
+	/** Get a GC from the pool.
+	 * The GC has the requested function and line width and does not
+	 * generate graphics exposures. Any other state is whatever the last
+	 * user left, so set what you depend on and remove clip masks before
+	 * handing the GC back.
+	 * @param depth The depth of the drawables the GC will be used with.
+	 * @param function The raster operation.
+	 * @param lineWidth The line width.
+	 * @return The GC.
+	 */
+	static GC AcquireGC(int depth, int function = GXcopy, int lineWidth = 0);
+
+	/** Return a GC to the pool. */
+	static void ReleaseGC(GC gc);
+
+	/** Get a scratch pixmap from the pool.
+	 * Pixmaps are pooled by size class, so the pixmap may be larger than
+	 * requested and its contents are undefined.
+	 * @param width The minimum width.
+	 * @param height The minimum height.
+	 * @param depth The depth.
+	 * @return The pixmap.
+	 */
+	static Pixmap AcquirePixmap(int width, int height, int depth);
+
+	/** Return a scratch pixmap to the pool. */
+	static void ReleasePixmap(Pixmap p);
+
+	/** Get the resource counters. */
+	static const GraphicsStats &GetStats(void) {
+		return stats;
+	}
+
 private:
-	static std::vector<Graphics*> graphics;
+	char pooled; /**< Set if the surface came from AcquirePixmap. */
+
+	static std::vector<Graphics*> freeGraphics;
+	static std::unordered_map<unsigned long, std::vector<GC> > freeGCs;
+	static std::unordered_map<GC, unsigned long> gcKeys;
+	static std::unordered_map<unsigned long, std::vector<Pixmap> > freePixmaps;
+	static std::unordered_map<Pixmap, unsigned long> pixmapKeys;
+	static GraphicsStats stats;
+
+	static Graphics *allocate(const Pixmap p, GC gc, Display *display);
 };
 
 #endif /* SRC_GRAPHICS_H_ */
@@ -0,0 +1,235 @@
+/**
+ * @file PowerMonitor.cpp
+ *
+ * @brief Event-driven monitoring of batteries and external power.
+ *
+ */
+
+#include "jwm.h"
+#include "PowerMonitor.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#ifdef __linux__
+#  include <linux/netlink.h>
+#endif
+
+const char *PowerMonitor::DEFAULT_ROOT = "/sys/class/power_supply";
+
+/** Largest uevent message we expect (the kernel limit is 2048). */
+#define UEVENT_BUFFER_SIZE 4096
+
+/** Open a netlink socket for kernel uevents. */
+UeventSource *UeventSource::Open(void) {
+#if defined(__linux__) && defined(NETLINK_KOBJECT_UEVENT)
+	struct sockaddr_nl addr;
+	int fd;
+
+	fd = socket(AF_NETLINK, SOCK_DGRAM, NETLINK_KOBJECT_UEVENT);
+	if (fd < 0) {
+		return NULL;
+	}
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.nl_family = AF_NETLINK;
+	addr.nl_pid = 0;
+	addr.nl_groups = 1; /* Kernel events, not udev. */
+	if (bind(fd, (struct sockaddr*) &addr, sizeof(addr)) < 0) {
+		close(fd);
+		return NULL;
+	}
+	return new UeventSource(fd);
+#else
+	return NULL;
+#endif
+}
+
+/** Create a source reading from an existing socket. */
+UeventSource::UeventSource(int fd) :
+		fd(fd) {
+}
+
+UeventSource::~UeventSource() {
+	if (fd >= 0) {
+		close(fd);
+	}
+}
+
+int UeventSource::GetDescriptor() const {
+	return fd;
+}
+
+/** Read all pending uevents. */
+char UeventSource::ReadEvents() {
+	char buffer[UEVENT_BUFFER_SIZE];
+	char found = 0;
+	ssize_t len;
+
+	for (;;) {
+		len = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+		if (len <= 0) {
+			break;
+		}
+		if (IsPowerSupplyEvent(buffer, len)) {
+			found = 1;
+		}
+	}
+	return found;
+}
+
+/** Determine if a uevent message is for a power supply. */
+char UeventSource::IsPowerSupplyEvent(const char *msg, size_t len) {
+	static const char SUBSYSTEM[] = "SUBSYSTEM=power_supply";
+	size_t offset = 0;
+
+	/* The first string is "action@devpath", the rest are KEY=value. */
+	while (offset < len) {
+		const char *str = &msg[offset];
+		const size_t remaining = len - offset;
+		const size_t slen = strnlen(str, remaining);
+		if (slen == sizeof(SUBSYSTEM) - 1
+				&& !memcmp(str, SUBSYSTEM, sizeof(SUBSYSTEM) - 1)) {
+			return 1;
+		}
+		offset += slen + 1;
+	}
+	return 0;
+}
+
+/** Create a monitor. */
+PowerMonitor::PowerMonitor(const char *root, PowerEventSource *source) :
+		root(root), source(source) {
+	state.percentage = -1;
+	state.online = 0;
+}
+
+PowerMonitor::~PowerMonitor() {
+	if (source) {
+		delete source;
+	}
+}
+
+int PowerMonitor::GetDescriptor(void) const {
+	return source ? source->GetDescriptor() : -1;
+}
+
+/** Handle pending notifications from the event source. */
+char PowerMonitor::HandleEvents(void) {
+	if (source && source->ReadEvents()) {
+		return Refresh();
+	}
+	return 0;
+}
+
+/** Read an attribute of a power supply as a string. */
+char PowerMonitor::ReadString(const char *supply, const char *attribute,
+		char *buffer, size_t size) const {
+	char path[512];
+	ssize_t len;
+	int fd;
+
+	snprintf(path, sizeof(path), "%s/%s/%s", root.c_str(), supply, attribute);
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return 0;
+	}
+	len = read(fd, buffer, size - 1);
+	close(fd);
+	if (len <= 0) {
+		return 0;
+	}
+	while (len > 0 && (buffer[len - 1] == '\n' || buffer[len - 1] == ' ')) {
+		len -= 1;
+	}
+	buffer[len] = 0;
+	return 1;
+}
+
+/** Read an attribute of a power supply as a number. */
+char PowerMonitor::ReadValue(const char *supply, const char *attribute,
+		long long *value) const {
+	char buffer[32];
+	char *end;
+	if (!ReadString(supply, attribute, buffer, sizeof(buffer))) {
+		return 0;
+	}
+	*value = strtoll(buffer, &end, 10);
+	return end != buffer;
+}
+
+/** Re-read the power supplies. */
+char PowerMonitor::Refresh(void) {
+	struct dirent *entry;
+	PowerState next;
+	long long totalNow, totalFull;
+	char batteries;
+	DIR *dir;
+
+	next.percentage = -1;
+	next.online = 0;
+	totalNow = 0;
+	totalFull = 0;
+	batteries = 0;
+
+	dir = opendir(root.c_str());
+	if (dir) {
+		while ((entry = readdir(dir)) != NULL) {
+			char type[32];
+			long long value, now, full;
+
+			if (entry->d_name[0] == '.') {
+				continue;
+			}
+			if (!ReadString(entry->d_name, "type", type, sizeof(type))) {
+				continue;
+			}
+
+			if (!strcmp(type, "Battery")) {
+				if (ReadValue(entry->d_name, "present", &value) && value == 0) {
+					continue;
+				}
+				/* Prefer energy (uWh), then charge (uAh), then percent. */
+				char found = ReadValue(entry->d_name, "energy_now", &now)
+						&& ReadValue(entry->d_name, "energy_full", &full);
+				if (!found) {
+					found = ReadValue(entry->d_name, "charge_now", &now)
+							&& ReadValue(entry->d_name, "charge_full", &full);
+				}
+				if (!found && ReadValue(entry->d_name, "capacity", &now)) {
+					full = 100;
+					found = 1;
+				}
+				if (!found) {
+					continue;
+				}
+				if (full > 0) {
+					totalNow += now;
+					totalFull += full;
+					batteries = 1;
+				}
+			} else if (!strcmp(type, "Mains") || !strncmp(type, "USB", 3)) {
+				if (ReadValue(entry->d_name, "online", &value) && value) {
+					next.online = 1;
+				}
+			}
+		}
+		closedir(dir);
+	}
+
+	if (batteries) {
+		next.percentage = (int) ((100 * totalNow) / totalFull);
+		if (next.percentage > 100) {
+			next.percentage = 100;
+		} else if (next.percentage < 0) {
+			next.percentage = 0;
+		}
+	}
+
+	if (next.percentage == state.percentage && next.online == state.online) {
+		return 0;
+	}
+	state = next;
+	return 1;
+}
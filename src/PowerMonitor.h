@@ -0,0 +1,121 @@
+/**
+ * @file PowerMonitor.h
+ *
+ * @brief Event-driven monitoring of batteries and external power.
+ *
+ * The monitor reads the power_supply class in sysfs, combining every
+ * battery into one percentage and every mains/USB supply into one
+ * "online" flag. Instead of polling, it waits on a source of kernel
+ * uevents and only re-reads sysfs when a power supply changed; callers
+ * are told about a change only when the integer percentage or the
+ * online state differ from what was last reported.
+ *
+ */
+
+#ifndef POWER_MONITOR_H
+#define POWER_MONITOR_H
+
+#include <string>
+
+/** Combined state of the power supplies. */
+typedef struct PowerState {
+	int percentage; /**< Charge of all batteries (0-100) or -1 if none. */
+	char online; /**< Set if external power is connected. */
+} PowerState;
+
+/** A source of power supply change notifications. */
+class PowerEventSource {
+public:
+	virtual ~PowerEventSource() {
+	}
+
+	/** Get the descriptor to wait on. */
+	virtual int GetDescriptor() const = 0;
+
+	/** Read all pending notifications without blocking.
+	 * @return 1 if any of them concerned a power supply.
+	 */
+	virtual char ReadEvents() = 0;
+};
+
+/** Kernel uevents.
+ * Messages are read from a NETLINK_KOBJECT_UEVENT socket or from any
+ * other message socket that delivers them in the same format.
+ */
+class UeventSource: public PowerEventSource {
+public:
+
+	/** Open a netlink socket for kernel uevents.
+	 * @return The source or NULL if uevents are not available.
+	 */
+	static UeventSource *Open(void);
+
+	/** Create a source reading from an existing socket.
+	 * The source takes ownership of the descriptor.
+	 * @param fd The descriptor.
+	 */
+	explicit UeventSource(int fd);
+	virtual ~UeventSource();
+
+	virtual int GetDescriptor() const;
+	virtual char ReadEvents();
+
+	/** Determine if a uevent message is for a power supply.
+	 * @param msg The message (NUL-separated KEY=value strings).
+	 * @param len The length of the message.
+	 * @return 1 if the message has SUBSYSTEM=power_supply.
+	 */
+	static char IsPowerSupplyEvent(const char *msg, size_t len);
+
+private:
+	int fd;
+};
+
+class PowerMonitor {
+public:
+
+	/** The power_supply class in sysfs. */
+	static const char *DEFAULT_ROOT;
+
+	/** Create a monitor.
+	 * @param root The power_supply directory to read.
+	 * @param source The event source (owned) or NULL to rely on Refresh.
+	 */
+	PowerMonitor(const char *root, PowerEventSource *source);
+	~PowerMonitor();
+
+	/** Re-read the power supplies.
+	 * @return 1 if the reported state changed.
+	 */
+	char Refresh(void);
+
+	/** Handle pending notifications from the event source.
+	 * All queued notifications are coalesced into at most one Refresh.
+	 * @return 1 if the reported state changed.
+	 */
+	char HandleEvents(void);
+
+	/** Get the descriptor of the event source.
+	 * @return The descriptor or -1 if there is no event source.
+	 */
+	int GetDescriptor(void) const;
+
+	/** Get the state last read. */
+	const PowerState &GetState(void) const {
+		return state;
+	}
+
+private:
+
+	std::string root;
+	PowerEventSource *source;
+	PowerState state;
+
+	char ReadValue(const char *supply, const char *attribute,
+			long long *value) const;
+	char ReadString(const char *supply, const char *attribute, char *buffer,
+			size_t size) const;
+
+};
+
+#endif /* POWER_MONITOR_H */
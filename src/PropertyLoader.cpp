@@ -0,0 +1,327 @@
+/**
+ * @file PropertyLoader.cpp
+ *
+ * @brief Pipelined loading of client window properties.
+ *
+ */
+
+#include "jwm.h"
+#include "PropertyLoader.h"
+#include "hint.h"
+#include "misc.h"
+#include "main.h"
+
+#ifdef USE_XCB
+#  include <X11/Xlib-xcb.h>
+#  include <xcb/xcb.h>
+#endif
+
+/** Properties requested for each client window.
+ * The lengths are in 32-bit units and cover what the readers in hint.c,
+ * client.c, icon.c and place.c ask for.
+ */
+typedef struct {
+	int atom; /**< Index into Hints::atoms or a predefined atom. */
+	char predefined; /**< Set if atom is a predefined (XA_*) atom. */
+	long length;
+} PropertyRequest;
+
+static const PropertyRequest REQUESTS[] = {
+	{ XA_WM_NAME, 1, 1024 },
+	{ XA_WM_CLASS, 1, 2048 },
+	{ XA_WM_HINTS, 1, 9 },
+	{ XA_WM_NORMAL_HINTS, 1, 18 },
+	{ XA_WM_TRANSIENT_FOR, 1, 1 },
+	{ ATOM_WM_COLORMAP_WINDOWS, 0, 256 },
+	{ ATOM_WM_PROTOCOLS, 0, 32 },
+	{ ATOM_WM_STATE, 0, 2 },
+	{ ATOM_MOTIF_WM_HINTS, 0, 20 },
+	{ ATOM_NET_WM_NAME, 0, 1024 },
+	{ ATOM_NET_WM_WINDOW_OPACITY, 0, 1 },
+	{ ATOM_NET_WM_DESKTOP, 0, 1 },
+	{ ATOM_NET_WM_STATE, 0, 32 },
+	{ ATOM_NET_WM_WINDOW_TYPE, 0, 32 },
+	{ ATOM_NET_WM_USER_TIME_WINDOW, 0, 1 },
+	{ ATOM_NET_WM_USER_TIME, 0, 1 },
+	{ ATOM_NET_WM_ICON, 0, 1 << 20 },
+	{ ATOM_NET_WM_STRUT_PARTIAL, 0, 12 },
+	{ ATOM_NET_WM_STRUT, 0, 4 }
+};
+static const unsigned int REQUEST_COUNT = ARRAY_LENGTH(REQUESTS);
+
+/** A prefetched property. */
+typedef struct PropertyEntry {
+	Atom property;
+	long length; /**< Requested length in 32-bit units. */
+	char pending; /**< Set until the reply has been collected. */
+	char valid; /**< Set if the reply arrived without error. */
+#ifdef USE_XCB
+	xcb_get_property_cookie_t cookie;
+	xcb_get_property_reply_t *reply;
+#endif
+} PropertyEntry;
+
+/** Prefetched properties for a window. */
+struct PropertyLoader::PropertySet {
+	PropertyEntry entries[REQUEST_COUNT];
+};
+
+std::map<Window, PropertyLoader::PropertySet*> PropertyLoader::windows;
+
+#ifdef USE_XCB
+static xcb_connection_t *connection = NULL;
+#endif
+
+/** Startup the property loader. */
+void PropertyLoader::StartupPropertyLoader(void) {
+#ifdef USE_XCB
+	connection = XGetXCBConnection(display);
+#endif
+}
+
+/** Shutdown the property loader. */
+void PropertyLoader::ShutdownPropertyLoader(void) {
+	std::map<Window, PropertySet*>::iterator it;
+	for (it = windows.begin(); it != windows.end(); ++it) {
+		DestroySet(it->second);
+	}
+	windows.clear();
+#ifdef USE_XCB
+	connection = NULL;
+#endif
+}
+
+/** Send requests for the properties of a client window. */
+void PropertyLoader::Prefetch(Window w) {
+#ifdef USE_XCB
+	PropertySet *sp;
+	unsigned int i;
+
+	if (connection == NULL || windows.find(w) != windows.end()) {
+		return;
+	}
+
+	sp = new PropertySet;
+	for (i = 0; i < REQUEST_COUNT; i++) {
+		PropertyEntry *ep = &sp->entries[i];
+		if (REQUESTS[i].predefined) {
+			ep->property = REQUESTS[i].atom;
+		} else {
+			ep->property = Hints::atoms[REQUESTS[i].atom];
+		}
+		ep->length = REQUESTS[i].length;
+		ep->cookie = xcb_get_property(connection, 0, w, ep->property,
+				XCB_GET_PROPERTY_TYPE_ANY, 0, ep->length);
+		ep->reply = NULL;
+		ep->pending = 1;
+		ep->valid = 0;
+	}
+	xcb_flush(connection);
+	windows[w] = sp;
+#endif
+}
+
+/** Get the attributes of several windows. */
+void PropertyLoader::GetWindowAttributes(const Window *windows, unsigned count,
+		XWindowAttributes *attrs, char *valid) {
+	unsigned int i;
+#ifdef USE_XCB
+	if (connection) {
+		xcb_get_window_attributes_cookie_t *attrCookies;
+		xcb_get_geometry_cookie_t *geometryCookies;
+
+		attrCookies = new xcb_get_window_attributes_cookie_t[count];
+		geometryCookies = new xcb_get_geometry_cookie_t[count];
+		for (i = 0; i < count; i++) {
+			attrCookies[i] = xcb_get_window_attributes(connection, windows[i]);
+			geometryCookies[i] = xcb_get_geometry(connection, windows[i]);
+		}
+		xcb_flush(connection);
+
+		for (i = 0; i < count; i++) {
+			xcb_get_window_attributes_reply_t *ar;
+			xcb_get_geometry_reply_t *gr;
+			XWindowAttributes *ap = &attrs[i];
+
+			ar = xcb_get_window_attributes_reply(connection, attrCookies[i], NULL);
+			gr = xcb_get_geometry_reply(connection, geometryCookies[i], NULL);
+			valid[i] = ar && gr;
+			memset(ap, 0, sizeof(XWindowAttributes));
+			if (valid[i]) {
+				ap->x = gr->x;
+				ap->y = gr->y;
+				ap->width = gr->width;
+				ap->height = gr->height;
+				ap->border_width = gr->border_width;
+				ap->depth = gr->depth;
+				ap->root = gr->root;
+				ap->c_class = ar->_class;
+				ap->bit_gravity = ar->bit_gravity;
+				ap->win_gravity = ar->win_gravity;
+				ap->backing_store = ar->backing_store;
+				ap->backing_planes = ar->backing_planes;
+				ap->backing_pixel = ar->backing_pixel;
+				ap->save_under = ar->save_under;
+				ap->colormap = ar->colormap;
+				ap->map_installed = ar->map_is_installed;
+				ap->map_state = ar->map_state;
+				ap->all_event_masks = ar->all_event_masks;
+				ap->your_event_mask = ar->your_event_mask;
+				ap->do_not_propagate_mask = ar->do_not_propagate_mask;
+				ap->override_redirect = ar->override_redirect;
+			}
+			free(ar);
+			free(gr);
+		}
+
+		delete[] attrCookies;
+		delete[] geometryCookies;
+		return;
+	}
+#endif
+	for (i = 0; i < count; i++) {
+		valid[i] = JXGetWindowAttributes(display, windows[i], &attrs[i]) != 0;
+	}
+}
+
+/** Drop any prefetched properties for a window. */
+void PropertyLoader::ReleaseWindow(Window w) {
+	std::map<Window, PropertySet*>::iterator it;
+	it = windows.find(w);
+	if (it != windows.end()) {
+		DestroySet(it->second);
+		windows.erase(it);
+	}
+}
+
+/** Free a property set, discarding replies that were never used. */
+void PropertyLoader::DestroySet(PropertySet *sp) {
+#ifdef USE_XCB
+	unsigned int i;
+	for (i = 0; i < REQUEST_COUNT; i++) {
+		PropertyEntry *ep = &sp->entries[i];
+		if (ep->pending) {
+			if (connection) {
+				xcb_discard_reply(connection, ep->cookie.sequence);
+			}
+		} else if (ep->reply) {
+			free(ep->reply);
+		}
+	}
+#endif
+	delete sp;
+}
+
+/** Determine if a window has prefetched properties. */
+char PropertyLoader::IsLoaded(Window w) {
+	return windows.find(w) != windows.end();
+}
+
+/** Read a prefetched property. */
+char PropertyLoader::GetProperty(Window w, Atom property, long offset,
+		long length, Atom reqType, Atom *actualType, int *actualFormat,
+		unsigned long *count, unsigned long *bytesAfter,
+		unsigned char **data) {
+#ifdef USE_XCB
+	std::map<Window, PropertySet*>::iterator it;
+	PropertyEntry *ep;
+	xcb_get_property_reply_t *reply;
+	unsigned long available, total, wanted, items, x;
+	unsigned int i;
+	int size;
+	const unsigned char *value;
+
+	it = windows.find(w);
+	if (it == windows.end() || offset != 0) {
+		return 0;
+	}
+
+	/* Find the entry for this property. */
+	ep = NULL;
+	for (i = 0; i < REQUEST_COUNT; i++) {
+		if (it->second->entries[i].property == property) {
+			ep = &it->second->entries[i];
+			break;
+		}
+	}
+	if (ep == NULL) {
+		return 0;
+	}
+
+	/* Collect the reply if we haven't already. */
+	if (ep->pending) {
+		xcb_generic_error_t *error = NULL;
+		ep->reply = xcb_get_property_reply(connection, ep->cookie, &error);
+		ep->pending = 0;
+		ep->valid = ep->reply != NULL;
+		if (error) {
+			free(error);
+		}
+	}
+	if (!ep->valid) {
+		return 0;
+	}
+	reply = ep->reply;
+
+	*data = NULL;
+	*count = 0;
+	*actualType = reply->type;
+	*actualFormat = reply->format;
+	if (reply->type == None) {
+		*bytesAfter = 0;
+		return 1;
+	}
+
+	size = reply->format / 8;
+	available = xcb_get_property_value_length(reply);
+	total = available + reply->bytes_after;
+
+	/* Type mismatch: report the type and size only, like the server. */
+	if (reqType != AnyPropertyType && reqType != reply->type) {
+		*bytesAfter = total;
+		return 1;
+	}
+
+	/* Make sure we have enough data to answer the request. */
+	wanted = (unsigned long) length * 4;
+	if (wanted > available && reply->bytes_after > 0) {
+		return 0;
+	}
+	if (wanted > available) {
+		wanted = available;
+	}
+	items = size > 0 ? wanted / size : 0;
+	*count = items;
+	*bytesAfter = total - items * size;
+
+	/* Convert to the Xlib representation (format 32 is stored as long). */
+	value = (const unsigned char*) xcb_get_property_value(reply);
+	switch (reply->format) {
+	case 32:
+		*data = (unsigned char*) malloc(items * sizeof(long) + 1);
+		for (x = 0; x < items; x++) {
+			((unsigned long*) *data)[x] = ((const uint32_t*) value)[x];
+		}
+		break;
+	case 16:
+		*data = (unsigned char*) malloc(items * sizeof(short) + 1);
+		for (x = 0; x < items; x++) {
+			((short*) *data)[x] = ((const int16_t*) value)[x];
+		}
+		break;
+	default:
+		*data = (unsigned char*) malloc(items + 1);
+		memcpy(*data, value, items);
+		break;
+	}
+	if (reply->format != 32 && reply->format != 16) {
+		(*data)[items] = 0;
+	} else {
+		(*data)[items * (reply->format == 32 ? sizeof(long) : sizeof(short))]
+				= 0;
+	}
+	return 1;
+#else
+	return 0;
+#endif
+}
@@ -0,0 +1,79 @@
+/**
+ * @file PropertyLoader.h
+ *
+ * @brief Pipelined loading of client window properties.
+ *
+ * When a window is managed, JWM reads a long list of properties from it.
+ * Issuing those reads one at a time costs a round trip each. The loader
+ * sends all of the requests up front (using XCB when available) and
+ * serves the replies to the normal property reading functions in
+ * Hints, so managing a window costs about one round trip.
+ *
+ */
+
+#ifndef PROPERTY_LOADER_H
+#define PROPERTY_LOADER_H
+
+#include <map>
+
+class PropertyLoader {
+public:
+
+	/*@{*/
+	static void StartupPropertyLoader(void);
+	static void ShutdownPropertyLoader(void);
+	/*@}*/
+
+	/** Send requests for the properties of a client window.
+	 * The replies are collected when they are first needed.
+	 * This does nothing if pipelining is not available.
+	 * @param w The client window.
+	 */
+	static void Prefetch(Window w);
+
+	/** Get the attributes of several windows.
+	 * With XCB the requests for all windows are sent before any reply is
+	 * read, so this costs one round trip; otherwise each window is
+	 * queried with XGetWindowAttributes.
+	 * With XCB the visual and screen fields are not set.
+	 * @param windows The windows.
+	 * @param count The number of windows.
+	 * @param attrs Filled with the attributes of each window.
+	 * @param valid Set to 1 for each window whose attributes were read.
+	 */
+	static void GetWindowAttributes(const Window *windows, unsigned count,
+			XWindowAttributes *attrs, char *valid);
+
+	/** Drop any prefetched properties for a window.
+	 * @param w The client window.
+	 */
+	static void ReleaseWindow(Window w);
+
+	/** Determine if a window has prefetched properties.
+	 * @param w The window.
+	 * @return 1 if properties were prefetched for the window.
+	 */
+	static char IsLoaded(Window w);
+
+	/** Read a prefetched property.
+	 * This takes the same arguments as XGetWindowProperty and returns
+	 * the data the same way (free it with JXFree).
+	 * @return 1 if the request was served from the prefetched data, 0 if
+	 *         the caller must query the server.
+	 */
+	static char GetProperty(Window w, Atom property, long offset, long length,
+			Atom reqType, Atom *actualType, int *actualFormat,
+			unsigned long *count, unsigned long *bytesAfter,
+			unsigned char **data);
+
+private:
+
+	struct PropertySet;
+
+	static std::map<Window, PropertySet*> windows;
+
+	static void DestroySet(PropertySet *sp);
+
+};
+
+#endif /* PROPERTY_LOADER_H */
@@ -0,0 +1,201 @@
+/**
+ * @file StatusComponent.cpp
+ *
+ * @brief Status tray component.
+ *
+ */
+
+#include "jwm.h"
+#include "StatusComponent.h"
+#include "StatusSource.h"
+#include "tray.h"
+#include "color.h"
+#include "font.h"
+#include "main.h"
+#include "misc.h"
+#include "error.h"
+#include "event.h"
+#include "Graphics.h"
+
+StatusWorker *StatusComponent::worker = NULL;
+std::vector<StatusComponent*> StatusComponent::components;
+
+/** Start the status worker. */
+void StatusComponent::StartupStatus(void) {
+  if (!worker) {
+    return;
+  }
+  if (worker->Start()) {
+    Events::_RegisterDescriptor(worker->GetDescriptor(), HandleStatus, NULL);
+  } else {
+    Warning(_("could not start the status thread"));
+  }
+}
+
+/** Stop the status worker. */
+void StatusComponent::ShutdownStatus(void) {
+  if (worker && worker->GetDescriptor() >= 0) {
+    Events::_UnregisterDescriptor(worker->GetDescriptor());
+    worker->Stop();
+  }
+}
+
+/** Destroy the status worker and its producers. */
+void StatusComponent::DestroyStatus(void) {
+  if (worker) {
+    delete worker;
+    worker = NULL;
+  }
+  components.clear();
+}
+
+/** Handle snapshots queued by the worker. */
+void StatusComponent::HandleStatus(int fd, void *data) {
+  const StatusSnapshot *sp;
+  worker->Acknowledge();
+  while ((sp = worker->Next()) != NULL) {
+    if (sp->source < components.size()) {
+      components[sp->source]->SetValue(sp->text);
+    }
+    delete sp;
+  }
+}
+
+/** Create a status tray component. */
+StatusComponent *StatusComponent::CreateStatus(StatusType type,
+    const char *label, const char *argument, unsigned int interval,
+    unsigned int timeout, int width, int height, Tray *tray,
+    TrayComponent *parent) {
+  StatusProducer *producer;
+
+  switch (type) {
+  case STATUS_MEMORY:
+    producer = new MemoryProducer();
+    if (!label) {
+      label = "MEM ";
+    }
+    break;
+  case STATUS_NETWORK:
+    producer = new NetworkProducer(argument);
+    if (!label) {
+      label = "NET ";
+    }
+    break;
+  case STATUS_COMMAND:
+    producer = new CommandProducer(argument ? argument : "", timeout);
+    break;
+  case STATUS_CPU:
+  default:
+    producer = new CpuProducer();
+    if (!label) {
+      label = "CPU ";
+    }
+    break;
+  }
+
+  if (!worker) {
+    worker = new StatusWorker();
+  }
+  StatusComponent *cp = new StatusComponent(label, width, height, tray,
+      parent);
+  worker->AddProducer(producer, interval);
+  components.push_back(cp);
+  return cp;
+}
+
+/** Create a status tray component. */
+StatusComponent::StatusComponent(const char *label, int width, int height,
+    Tray *tray, TrayComponent *parent) :
+    TrayComponent(tray, parent), label(label ? label : ""), value("--"),
+    graphics(NULL) {
+  if (width > 0) {
+    this->requestedWidth = width;
+    this->userWidth = 1;
+  } else {
+    this->requestedWidth = 0;
+    this->userWidth = 0;
+  }
+  this->requestedHeight = height;
+}
+
+StatusComponent::~StatusComponent() {
+  this->Destroy();
+}
+
+void StatusComponent::Create() {
+
+}
+
+/** Destroy a status tray component. */
+void StatusComponent::Destroy() {
+  if (this->graphics) {
+    Graphics::destroy(this->graphics);
+    this->graphics = NULL;
+    this->setPixmap(None);
+  }
+}
+
+/** Resize a status tray component. */
+void StatusComponent::Resize() {
+  TrayComponent::Resize();
+  this->Destroy();
+
+  this->setPixmap(
+      JXCreatePixmap(display, rootWindow, this->getWidth(), this->getHeight(),
+          rootDepth));
+  this->graphics = Graphics::wrap(this->pixmap, rootGC, display);
+
+  Draw();
+}
+
+void StatusComponent::Draw(Graphics *g) {
+
+}
+
+/** Redraw a status tray component. */
+void StatusComponent::Draw() {
+  this->text.clear();
+  this->SetValue(this->value);
+}
+
+/** Update the status and draw it if the text changed. */
+void StatusComponent::SetValue(const std::string &value) {
+  int strWidth;
+
+  this->value = value;
+  const std::string str = this->label + value;
+  if (this->text == str || !this->graphics) {
+    return;
+  }
+
+  /* Grow to fit the text, but don't shrink: a status that changes
+   * often would otherwise make the whole tray jitter. */
+  strWidth = Fonts::GetStringWidth(FONT_CLOCK, str.c_str()) + 4;
+  if (!this->userWidth && strWidth > this->getRequestedWidth()) {
+    this->requestNewSize(strWidth, this->getRequestedHeight());
+    this->getTray()->ResizeTray();
+    return;
+  }
+
+  this->graphics->setForeground(COLOR_MENU_BG);
+  this->graphics->fillRectangle(0, 0, this->getWidth(), this->getHeight());
+  Fonts::RenderString(this->getPixmap(), FONT_CLOCK, COLOR_CLOCK_FG,
+      Max(0, (this->getWidth() - strWidth) / 2),
+      (this->getHeight() - Fonts::GetStringHeight(FONT_CLOCK)) / 2,
+      this->getWidth(), str.c_str());
+  this->graphics->setForeground(COLOR_MENU_ACTIVE_BG1);
+  this->graphics->drawRectangle(0, 0, this->getWidth() - 1,
+      this->getHeight() - 1);
+  this->text = str;
+  this->UpdateSpecificTray(this->getTray());
+}
+
+/** Process a press event on a status tray component. */
+void StatusComponent::ProcessButtonPress(int x, int y, int button) {
+  this->handlePressActions(x, y, button);
+}
+
+/** Process a release event on a status tray component. */
+void StatusComponent::ProcessButtonRelease(int x, int y, int button) {
+  this->handleReleaseActions(x, y, button);
+}
@@ -0,0 +1,88 @@
+/**
+ * @file StatusComponent.h
+ *
+ * @brief Status tray component.
+ *
+ * Shows a line of text from a StatusProducer (CPU, memory, network or the
+ * output of a command). All producers share one StatusWorker; the event
+ * loop is woken through its descriptor and a component is only redrawn
+ * when its text changed.
+ *
+ */
+
+#ifndef STATUS_COMPONENT_H
+#define STATUS_COMPONENT_H
+
+#include <string>
+#include <vector>
+
+#include "TrayComponent.h"
+
+class Graphics;
+class StatusProducer;
+class StatusWorker;
+
+class StatusComponent : public TrayComponent {
+public:
+
+  /** Types of status. */
+  typedef enum {
+    STATUS_CPU,
+    STATUS_MEMORY,
+    STATUS_NETWORK,
+    STATUS_COMMAND
+  } StatusType;
+
+  /*@{*/
+  static void StartupStatus(void);
+  static void ShutdownStatus(void);
+  static void DestroyStatus(void);
+  /*@}*/
+
+  /** Create a status tray component.
+   * @param type The type of status.
+   * @param label Text shown before the status (NULL for the default).
+   * @param argument The command or the network device (may be NULL).
+   * @param interval Milliseconds between samples.
+   * @param timeout Milliseconds a command may run.
+   * @param width The width (0 to fit the text).
+   * @param height The height (0 to fit the font).
+   * @param tray The tray.
+   * @param parent The previous component in the tray.
+   * @return The component.
+   */
+  static StatusComponent *CreateStatus(StatusType type, const char *label,
+      const char *argument, unsigned int interval, unsigned int timeout,
+      int width, int height, Tray *tray, TrayComponent *parent);
+
+  virtual ~StatusComponent();
+
+  virtual void Create();
+  virtual void Destroy();
+  virtual void Resize();
+  virtual void Draw();
+  virtual void Draw(Graphics *g);
+  virtual void ProcessButtonPress(int x, int y, int button);
+  virtual void ProcessButtonRelease(int x, int y, int button);
+  virtual void ProcessMotionEvent(int x, int y, int mask) {}
+
+private:
+  StatusComponent(const char *label, int width, int height, Tray *tray,
+      TrayComponent *parent);
+
+  std::string label; /**< Text shown before the status. */
+  std::string value; /**< Last status received. */
+  std::string text; /**< Currently displayed text. */
+  int userWidth; /**< Set if the width was specified. */
+  Graphics *graphics;
+
+  void SetValue(const std::string &value);
+
+  static StatusWorker *worker;
+  static std::vector<StatusComponent*> components;
+
+  static void HandleStatus(int fd, void *data);
+
+};
+
+#endif /* STATUS_COMPONENT_H */
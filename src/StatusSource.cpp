@@ -0,0 +1,585 @@
+/**
+ * @file StatusSource.cpp
+ *
+ * @brief Asynchronous producers of status text for the tray.
+ *
+ */
+
+#include "jwm.h"
+#include "StatusSource.h"
+#include "misc.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include <time.h>
+
+/** Largest amount of command output kept. */
+#define STATUS_OUTPUT_SIZE 256
+
+/** Milliseconds between checks for the exit of a command. */
+#define STATUS_POLL_INTERVAL 10
+
+/** Read a small file into a buffer.
+ * @return The number of bytes read or -1 on error.
+ */
+static ssize_t ReadFile(const std::string &path, char *buffer, size_t size) {
+	ssize_t len, total;
+	int fd;
+
+	fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return -1;
+	}
+	total = 0;
+	while ((size_t) total < size - 1) {
+		len = read(fd, &buffer[total], size - 1 - total);
+		if (len < 0 && errno == EINTR) {
+			continue;
+		} else if (len <= 0) {
+			break;
+		}
+		total += len;
+	}
+	close(fd);
+	buffer[total] = 0;
+	return total;
+}
+
+/** Create a CPU producer. */
+CpuProducer::CpuProducer(const char *path) :
+		path(path), lastBusy(0), lastTotal(0), primed(0) {
+}
+
+/** Sample CPU usage since the last sample. */
+char CpuProducer::Sample(std::string *text) {
+	unsigned long long values[8];
+	unsigned long long busy, total, idle;
+	char buffer[512];
+	char temp[16];
+	const char *str;
+	char *end;
+	int i;
+
+	if (ReadFile(path, buffer, sizeof(buffer)) <= 0) {
+		return 0;
+	}
+	if (strncmp(buffer, "cpu ", 4)) {
+		return 0;
+	}
+
+	/* user nice system idle iowait irq softirq steal */
+	str = &buffer[4];
+	total = 0;
+	for (i = 0; i < 8; i++) {
+		values[i] = strtoull(str, &end, 10);
+		if (end == str) {
+			values[i] = 0;
+		}
+		total += values[i];
+		str = end;
+	}
+	idle = values[3] + values[4];
+	busy = total - idle;
+
+	if (!primed || total <= lastTotal || busy < lastBusy) {
+		primed = 1;
+		lastBusy = busy;
+		lastTotal = total;
+		return 0;
+	}
+
+	snprintf(temp, sizeof(temp), "%d%%",
+			(int) ((100 * (busy - lastBusy)) / (total - lastTotal)));
+	lastBusy = busy;
+	lastTotal = total;
+	*text = temp;
+	return 1;
+}
+
+/** Create a memory producer. */
+MemoryProducer::MemoryProducer(const char *path) :
+		path(path) {
+}
+
+/** Sample memory in use. */
+char MemoryProducer::Sample(std::string *text) {
+	static const char *KEYS[] = {
+		"MemTotal:", "MemAvailable:", "MemFree:", "Buffers:", "Cached:"
+	};
+	long long values[ARRAY_LENGTH(KEYS)];
+	long long available;
+	char buffer[4096];
+	char temp[16];
+	const char *line;
+	unsigned int i;
+
+	if (ReadFile(path, buffer, sizeof(buffer)) <= 0) {
+		return 0;
+	}
+
+	for (i = 0; i < ARRAY_LENGTH(KEYS); i++) {
+		values[i] = -1;
+	}
+	for (line = buffer; line && *line; line = strchr(line, '\n')) {
+		if (*line == '\n') {
+			line += 1;
+		}
+		for (i = 0; i < ARRAY_LENGTH(KEYS); i++) {
+			const size_t len = strlen(KEYS[i]);
+			if (!strncmp(line, KEYS[i], len)) {
+				values[i] = strtoll(&line[len], NULL, 10);
+				break;
+			}
+		}
+	}
+
+	if (values[0] <= 0) {
+		return 0;
+	}
+	available = values[1];
+	if (available < 0) {
+		/* Kernels before 3.14 don't have MemAvailable. */
+		available = Max(values[2], 0) + Max(values[3], 0) + Max(values[4], 0);
+	}
+	if (available > values[0]) {
+		available = values[0];
+	}
+
+	snprintf(temp, sizeof(temp), "%d%%",
+			(int) ((100 * (values[0] - available)) / values[0]));
+	*text = temp;
+	return 1;
+}
+
+/** Create a network producer. */
+NetworkProducer::NetworkProducer(const char *device, const char *path) :
+		device(device ? device : ""), path(path), lastReceived(0), lastSent(0),
+		primed(0) {
+}
+
+/** Format a rate in bytes per second. */
+void NetworkProducer::FormatRate(unsigned long long rate, char *buffer,
+		size_t size) {
+	static const char UNITS[] = "BKMGT";
+	double value = (double) rate;
+	unsigned int unit = 0;
+
+	while (value >= 1000.0 && unit + 1 < sizeof(UNITS) - 1) {
+		value /= 1024.0;
+		unit += 1;
+	}
+	if (unit > 0 && value < 10.0) {
+		snprintf(buffer, size, "%.1f%c", value, UNITS[unit]);
+	} else {
+		snprintf(buffer, size, "%d%c", (int) value, UNITS[unit]);
+	}
+}
+
+/** Sample network rates since the last sample. */
+char NetworkProducer::Sample(std::string *text) {
+	std::chrono::steady_clock::time_point now;
+	unsigned long long received, sent;
+	long long elapsed;
+	char buffer[8192];
+	char rx[16], tx[16];
+	char found;
+	const char *line;
+
+	if (ReadFile(path, buffer, sizeof(buffer)) <= 0) {
+		return 0;
+	}
+	now = std::chrono::steady_clock::now();
+
+	/* The first two lines are headers. Each other line is
+	 * "name: rx_bytes rx_packets ... (8 values) tx_bytes ...". */
+	received = 0;
+	sent = 0;
+	found = 0;
+	line = strchr(buffer, '\n');
+	line = line ? strchr(line + 1, '\n') : NULL;
+	while (line) {
+		const char *name, *colon;
+		char *end;
+		unsigned long long value;
+		int i;
+
+		line += 1;
+		colon = strchr(line, ':');
+		if (!colon) {
+			break;
+		}
+		name = line;
+		while (name < colon && *name == ' ') {
+			name += 1;
+		}
+		const std::string current(name, colon - name);
+		line = strchr(colon, '\n');
+
+		if (device.empty() ? current == "lo" : current != device) {
+			continue;
+		}
+		found = 1;
+		const char *str = colon + 1;
+		for (i = 0; i < 9; i++) {
+			value = strtoull(str, &end, 10);
+			str = end;
+			if (i == 0) {
+				received += value;
+			} else if (i == 8) {
+				sent += value;
+			}
+		}
+	}
+	if (!found) {
+		return 0;
+	}
+
+	elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+			now - lastTime).count();
+	if (!primed || elapsed <= 0) {
+		primed = 1;
+		lastReceived = received;
+		lastSent = sent;
+		lastTime = now;
+		return 0;
+	}
+
+	/* Counters are reset when an interface goes away. */
+	FormatRate(received >= lastReceived
+			? (received - lastReceived) * 1000 / elapsed : 0, rx, sizeof(rx));
+	FormatRate(sent >= lastSent ? (sent - lastSent) * 1000 / elapsed : 0, tx,
+			sizeof(tx));
+	lastReceived = received;
+	lastSent = sent;
+	lastTime = now;
+
+	*text = rx;
+	*text += "/";
+	*text += tx;
+	return 1;
+}
+
+/** Create a command producer. */
+CommandProducer::CommandProducer(const char *command, unsigned int timeout) :
+		command(command), timeout(timeout) {
+}
+
+/** Run the command and collect its first line of output. */
+char CommandProducer::Sample(std::string *text) {
+	std::chrono::steady_clock::time_point deadline;
+	char buffer[STATUS_OUTPUT_SIZE];
+	const char *argv[4];
+	struct timespec tick;
+	size_t total;
+	char expired;
+	sigset_t set;
+	pid_t pid;
+	int fds[2];
+
+	if (pipe(fds) < 0) {
+		return 0;
+	}
+	fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+	fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+	/* Everything the children need is prepared before the fork since only
+	 * async-signal-safe calls are allowed in them. */
+	argv[0] = "sh";
+	argv[1] = "-c";
+	argv[2] = command.c_str();
+	argv[3] = NULL;
+	sigemptyset(&set);
+	tick.tv_sec = 0;
+	tick.tv_nsec = STATUS_POLL_INTERVAL * 1000000L;
+
+	/* The main thread reaps every child it sees, so the command is run
+	 * from an intermediate process. That process alone waits for the
+	 * command and kills it when it runs out of time, so the signal can
+	 * never reach a process that reused its id. */
+	pid = fork();
+	if (pid == 0) {
+		const pid_t child = fork();
+		unsigned int waited;
+		if (child == 0) {
+			/* The worker blocks all signals; don't pass that on. */
+			sigprocmask(SIG_SETMASK, &set, NULL);
+			dup2(fds[1], STDOUT_FILENO);
+			execv(SHELL_NAME, (char* const *) argv);
+			_exit(127);
+		}
+		close(fds[0]);
+		close(fds[1]);
+		if (child > 0) {
+			for (waited = 0; waitpid(child, NULL, WNOHANG) == 0;
+					waited += STATUS_POLL_INTERVAL) {
+				if (waited >= timeout) {
+					kill(child, SIGKILL);
+					waitpid(child, NULL, 0);
+					break;
+				}
+				nanosleep(&tick, NULL);
+			}
+		}
+		_exit(0);
+	}
+	close(fds[1]);
+	if (pid < 0) {
+		close(fds[0]);
+		return 0;
+	}
+
+	/* Read until the command exits or runs out of time.
+	 * The intermediate process is reaped by the main thread. */
+	deadline = std::chrono::steady_clock::now()
+			+ std::chrono::milliseconds(timeout);
+	total = 0;
+	expired = 0;
+	for (;;) {
+		struct pollfd pfd;
+		long long remaining;
+		ssize_t len;
+
+		remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+				deadline - std::chrono::steady_clock::now()).count();
+		if (remaining <= 0) {
+			expired = 1;
+			break;
+		}
+		pfd.fd = fds[0];
+		pfd.events = POLLIN;
+		if (poll(&pfd, 1, (int) remaining) <= 0) {
+			continue;
+		}
+		if (total < sizeof(buffer) - 1) {
+			len = read(fds[0], &buffer[total], sizeof(buffer) - 1 - total);
+		} else {
+			char discard[STATUS_OUTPUT_SIZE];
+			len = read(fds[0], discard, sizeof(discard));
+			if (len > 0) {
+				continue;
+			}
+		}
+		if (len < 0 && errno == EINTR) {
+			continue;
+		} else if (len <= 0) {
+			break;
+		}
+		total += len;
+	}
+	close(fds[0]);
+
+	/* Keep showing the old text if the command hung without output. */
+	if (expired && total == 0) {
+		return 0;
+	}
+	buffer[total] = 0;
+	buffer[strcspn(buffer, "\r\n")] = 0;
+	*text = buffer;
+	return 1;
+}
+
+/** Create an empty queue. */
+StatusQueue::StatusQueue() :
+		head(0), tail(0) {
+}
+
+/** Destroy a queue and the snapshots still in it. */
+StatusQueue::~StatusQueue() {
+	const StatusSnapshot *sp;
+	while ((sp = Pop()) != NULL) {
+		delete sp;
+	}
+}
+
+/** Add a snapshot. */
+char StatusQueue::Push(const StatusSnapshot *snapshot) {
+	const unsigned int t = tail.load(std::memory_order_relaxed);
+	const unsigned int h = head.load(std::memory_order_acquire);
+	if (t - h >= CAPACITY) {
+		return 0;
+	}
+	slots[t % CAPACITY] = snapshot;
+	tail.store(t + 1, std::memory_order_release);
+	return 1;
+}
+
+/** Remove a snapshot. */
+const StatusSnapshot *StatusQueue::Pop() {
+	const unsigned int h = head.load(std::memory_order_relaxed);
+	const unsigned int t = tail.load(std::memory_order_acquire);
+	const StatusSnapshot *sp;
+	if (h == t) {
+		return NULL;
+	}
+	sp = slots[h % CAPACITY];
+	head.store(h + 1, std::memory_order_release);
+	return sp;
+}
+
+/** Create a worker. */
+StatusWorker::StatusWorker() :
+		stopping(0) {
+	wakeFds[0] = -1;
+	wakeFds[1] = -1;
+}
+
+/** Destroy a worker and its producers. */
+StatusWorker::~StatusWorker() {
+	std::vector<ProducerNode>::iterator it;
+	Stop();
+	for (it = producers.begin(); it != producers.end(); ++it) {
+		delete it->producer;
+	}
+}
+
+/** Add a producer. */
+unsigned int StatusWorker::AddProducer(StatusProducer *producer,
+		unsigned int interval) {
+	ProducerNode node;
+	node.producer = producer;
+	node.interval = std::chrono::milliseconds(
+			Max(interval, (unsigned int) STATUS_MIN_INTERVAL));
+	node.sent = 0;
+	producers.push_back(node);
+	return producers.size() - 1;
+}
+
+/** Start the worker thread. */
+char StatusWorker::Start() {
+	std::vector<ProducerNode>::iterator it;
+	sigset_t set, old;
+	int i;
+
+	if (wakeFds[0] >= 0 || producers.empty()) {
+		return 0;
+	}
+	if (pipe(wakeFds) < 0) {
+		wakeFds[0] = -1;
+		wakeFds[1] = -1;
+		return 0;
+	}
+	for (i = 0; i < 2; i++) {
+		fcntl(wakeFds[i], F_SETFD, FD_CLOEXEC);
+		fcntl(wakeFds[i], F_SETFL, O_NONBLOCK);
+	}
+
+	const std::chrono::steady_clock::time_point now =
+			std::chrono::steady_clock::now();
+	for (it = producers.begin(); it != producers.end(); ++it) {
+		it->due = now;
+	}
+	stopping = 0;
+
+	/* Signals are handled by the main thread only. */
+	sigfillset(&set);
+	pthread_sigmask(SIG_SETMASK, &set, &old);
+	try {
+		thread = std::thread(&StatusWorker::Run, this);
+	} catch (const std::system_error&) {
+	}
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+	if (!thread.joinable()) {
+		close(wakeFds[0]);
+		close(wakeFds[1]);
+		wakeFds[0] = -1;
+		wakeFds[1] = -1;
+		return 0;
+	}
+	return 1;
+}
+
+/** Stop the worker thread.
+ * This waits for a command that is running, at most for its timeout.
+ */
+void StatusWorker::Stop() {
+	const StatusSnapshot *sp;
+
+	if (thread.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = 1;
+		}
+		wake.notify_one();
+		thread.join();
+	}
+	if (wakeFds[0] >= 0) {
+		close(wakeFds[0]);
+		close(wakeFds[1]);
+		wakeFds[0] = -1;
+		wakeFds[1] = -1;
+	}
+	while ((sp = queue.Pop()) != NULL) {
+		delete sp;
+	}
+}
+
+/** Clear the wakeup. */
+void StatusWorker::Acknowledge() {
+	char buffer[64];
+	while (read(wakeFds[0], buffer, sizeof(buffer)) > 0) {
+	}
+}
+
+/** Get the next snapshot. */
+const StatusSnapshot *StatusWorker::Next() {
+	return queue.Pop();
+}
+
+/** Wake the event loop. */
+void StatusWorker::Notify() {
+	/* If the pipe is full the event loop is already awake. */
+	const char c = 0;
+	ssize_t rc = write(wakeFds[1], &c, 1);
+	(void) rc;
+}
+
+/** Sample producers as they become due. */
+void StatusWorker::Run() {
+	std::unique_lock<std::mutex> lock(mutex);
+	unsigned int i;
+
+	while (!stopping) {
+		std::chrono::steady_clock::time_point now, next;
+
+		now = std::chrono::steady_clock::now();
+		next = now + std::chrono::hours(1);
+		for (i = 0; i < producers.size() && !stopping; i++) {
+			ProducerNode *node = &producers[i];
+			if (node->due <= now) {
+				std::string text;
+				lock.unlock();
+
+				/* Only changes are passed on. If the queue is full the
+				 * text isn't recorded, so it will be sent next time. */
+				if (node->producer->Sample(&text)
+						&& (!node->sent || text != node->last)) {
+					StatusSnapshot *sp = new StatusSnapshot;
+					sp->source = i;
+					sp->text = text;
+					if (queue.Push(sp)) {
+						node->last = text;
+						node->sent = 1;
+						Notify();
+					} else {
+						delete sp;
+					}
+				}
+
+				/* The interval counts from the end of the sample so that a
+				 * slow producer can't keep the worker busy. */
+				node->due = std::chrono::steady_clock::now() + node->interval;
+				lock.lock();
+			}
+			if (node->due < next) {
+				next = node->due;
+			}
+		}
+		if (!stopping) {
+			wake.wait_until(lock, next);
+		}
+	}
+}
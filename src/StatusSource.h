@@ -0,0 +1,205 @@
+/**
+ * @file StatusSource.h
+ *
+ * @brief Asynchronous producers of status text for the tray.
+ *
+ * Producers sample something outside of the X server (CPU load, memory,
+ * network counters or the output of a command) and turn it into a short
+ * line of text. Sampling can block (reading /proc is cheap, but a command
+ * may take seconds), so it is done by a StatusWorker on its own thread.
+ * The worker only hands over text that differs from what it handed over
+ * last for the same producer, never samples a producer more often than
+ * its interval, and passes each result as an immutable snapshot through
+ * a lock-free queue. A byte written to a pipe wakes the event loop, which
+ * then drains the queue.
+ *
+ */
+
+#ifndef STATUS_SOURCE_H
+#define STATUS_SOURCE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** Shortest time between two samples of a producer in milliseconds. */
+#define STATUS_MIN_INTERVAL 250
+
+/** Default time between two samples of a producer in milliseconds. */
+#define STATUS_DEFAULT_INTERVAL 2000
+
+/** Something that can be sampled for status text. */
+class StatusProducer {
+public:
+	virtual ~StatusProducer() {
+	}
+
+	/** Take a sample.
+	 * This is called from the worker thread.
+	 * @param text Set to the text to show.
+	 * @return 1 if text was set, 0 if there is nothing to show yet.
+	 */
+	virtual char Sample(std::string *text) = 0;
+};
+
+/** CPU usage from the first line of /proc/stat. */
+class CpuProducer: public StatusProducer {
+public:
+	explicit CpuProducer(const char *path = "/proc/stat");
+	virtual char Sample(std::string *text);
+
+private:
+	std::string path;
+	unsigned long long lastBusy;
+	unsigned long long lastTotal;
+	char primed;
+};
+
+/** Used memory from /proc/meminfo. */
+class MemoryProducer: public StatusProducer {
+public:
+	explicit MemoryProducer(const char *path = "/proc/meminfo");
+	virtual char Sample(std::string *text);
+
+private:
+	std::string path;
+};
+
+/** Receive and transmit rates from /proc/net/dev. */
+class NetworkProducer: public StatusProducer {
+public:
+
+	/** Create a network producer.
+	 * @param device The interface or NULL for all but loopback.
+	 * @param path The file to read.
+	 */
+	explicit NetworkProducer(const char *device,
+			const char *path = "/proc/net/dev");
+	virtual char Sample(std::string *text);
+
+	/** Format a rate in bytes per second, for example "1.5M". */
+	static void FormatRate(unsigned long long rate, char *buffer,
+			size_t size);
+
+private:
+	std::string device;
+	std::string path;
+	unsigned long long lastReceived;
+	unsigned long long lastSent;
+	std::chrono::steady_clock::time_point lastTime;
+	char primed;
+};
+
+/** The first line of output of a shell command. */
+class CommandProducer: public StatusProducer {
+public:
+
+	/** Create a command producer.
+	 * @param command The command to run with /bin/sh.
+	 * @param timeout Milliseconds to wait for output before killing it.
+	 */
+	CommandProducer(const char *command, unsigned int timeout);
+	virtual char Sample(std::string *text);
+
+private:
+	std::string command;
+	unsigned int timeout;
+};
+
+/** The result of a sample. Snapshots are never modified once queued. */
+typedef struct StatusSnapshot {
+	unsigned int source; /**< Index returned by StatusWorker::AddProducer. */
+	std::string text;
+} StatusSnapshot;
+
+/** A bounded single-producer, single-consumer queue of snapshots. */
+class StatusQueue {
+public:
+	StatusQueue();
+	~StatusQueue();
+
+	/** Add a snapshot (producer side).
+	 * @return 1 if the snapshot was queued (and is now owned by the queue),
+	 *         0 if the queue is full.
+	 */
+	char Push(const StatusSnapshot *snapshot);
+
+	/** Remove a snapshot (consumer side).
+	 * @return The snapshot (to be deleted by the caller) or NULL if empty.
+	 */
+	const StatusSnapshot *Pop();
+
+private:
+	static const unsigned int CAPACITY = 64;
+	const StatusSnapshot *slots[CAPACITY];
+	std::atomic<unsigned int> head; /**< Next slot to pop. */
+	std::atomic<unsigned int> tail; /**< Next slot to push. */
+};
+
+/** Runs producers on a background thread. */
+class StatusWorker {
+public:
+	StatusWorker();
+	~StatusWorker();
+
+	/** Add a producer. This must be called before Start.
+	 * @param producer The producer (owned by the worker).
+	 * @param interval Milliseconds between samples.
+	 * @return The source index reported in snapshots.
+	 */
+	unsigned int AddProducer(StatusProducer *producer, unsigned int interval);
+
+	/** Start the worker thread.
+	 * @return 1 on success, 0 if the thread or pipe could not be created.
+	 */
+	char Start();
+
+	/** Stop the worker thread and wait for it to exit. */
+	void Stop();
+
+	/** Get the descriptor that becomes readable when snapshots are queued.
+	 * @return The descriptor or -1 if the worker is not running.
+	 */
+	int GetDescriptor() const {
+		return wakeFds[0];
+	}
+
+	/** Clear the wakeup after the descriptor becomes readable.
+	 * Call this before draining the queue with Next so that snapshots
+	 * queued while draining wake the event loop again.
+	 */
+	void Acknowledge();
+
+	/** Get the next snapshot.
+	 * @return The snapshot (to be deleted by the caller) or NULL.
+	 */
+	const StatusSnapshot *Next();
+
+private:
+
+	typedef struct ProducerNode {
+		StatusProducer *producer;
+		std::chrono::milliseconds interval;
+		std::chrono::steady_clock::time_point due;
+		std::string last; /**< Text of the last snapshot queued. */
+		char sent; /**< Set once a snapshot has been queued. */
+	} ProducerNode;
+
+	std::vector<ProducerNode> producers;
+	StatusQueue queue;
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable wake;
+	char stopping; /**< Protected by mutex. */
+	int wakeFds[2];
+
+	void Run();
+	void Notify();
+
+};
+
+#endif /* STATUS_SOURCE_H */
@@ -24,6 +24,8 @@ TrayComponent::TrayComponent(Tray *tray, TrayComponent *parent) :
   this->width = 0;
   this->height = 0;
   this->grabbed = 0;
+  this->resizedWidth = -1;
+  this->resizedHeight = -1;
 
   this->window = None;
   this->pixmap = None;
@@ -105,11 +107,41 @@ void TrayComponent::UpdateSpecificTray(const Tray *tp) {
 
   /* If the tray is hidden, draw only the background. */
   if (this->getPixmap() != None) {
+    /* Keep the tray buffer current so exposes can be served from it. */
+    if (this->getTray()->getBuffer() != None) {
+      JXCopyArea(display, this->getPixmap(), this->getTray()->getBuffer(),
+          rootGC, 0, 0, this->getWidth(), this->getHeight(), this->getX(),
+          this->getY());
+    }
     JXCopyArea(display, this->getPixmap(), this->getTray()->getWindow(), rootGC,
         0, 0, this->getWidth(), this->getHeight(), this->getX(), this->getY());
   }
 }
 
+/** Copy part of the component pixmap to its tray. */
+void TrayComponent::UpdateArea(int x, int y, int width, int height) {
+  if (JUNLIKELY(shouldExit) || this->getPixmap() == None) {
+    return;
+  }
+  if (this->getTray()->getBuffer() != None) {
+    JXCopyArea(display, this->getPixmap(), this->getTray()->getBuffer(),
+        rootGC, x, y, width, height, this->getX() + x, this->getY() + y);
+  }
+  JXCopyArea(display, this->getPixmap(), this->getTray()->getWindow(), rootGC,
+      x, y, width, height, this->getX() + x, this->getY() + y);
+}
+
+/** Resize the component if its size changed. */
+void TrayComponent::UpdateSize() {
+  if (this->width == this->resizedWidth && this->height == this->resizedHeight
+      && (this->pixmap != None || this->window != None)) {
+    return;
+  }
+  this->Resize();
+  this->resizedWidth = this->width;
+  this->resizedHeight = this->height;
+}
+
 void TrayComponent::Draw() {
   Log("TrayComponent Draw called but not implemented\n");
 }
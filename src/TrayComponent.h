@@ -47,6 +47,9 @@ private:
 
 	char grabbed; /**< 1 if the mouse was grabbed by this component. */
 
+	int resizedWidth; /**< Width at the last Resize (-1 before the first). */
+	int resizedHeight; /**< Height at the last Resize (-1 before the first). */
+
 public:
 	TrayComponent(Tray *tray, TrayComponent *parent);
 	virtual ~TrayComponent();
@@ -87,6 +90,14 @@ public:
 	 */
 	void UpdateSpecificTray(const Tray *tp);
 
+	/** Copy part of the component pixmap to its tray.
+	 * @param x The x-coordinate in the component.
+	 * @param y The y-coordinate in the component.
+	 * @param width The width of the area.
+	 * @param height The height of the area.
+	 */
+	void UpdateArea(int x, int y, int width, int height);
+
 	virtual void SetSize(int width, int height) {
 		this->width = width;
 		this->height = height;
@@ -104,6 +115,11 @@ public:
 		this->Create();
 	}
 
+	/** Call Resize if the size changed since it was last called.
+	 * This lets the component keep its pixmap across tray redraws.
+	 */
+	void UpdateSize();
+
 	virtual void Draw();
 
 	virtual void Create() = 0;
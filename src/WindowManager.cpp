@@ -16,6 +16,12 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
 
 #include "battery.h"
 #include "binding.h"
@@ -24,6 +30,7 @@
 #include "clock.h"
 #include "color.h"
 #include "command.h"
+#include "ConfigWatcher.h"
 #include "confirm.h"
 #include "cursor.h"
 #include "debug.h"
@@ -34,6 +41,7 @@
 #include "event.h"
 #include "font.h"
 #include "grab.h"
+#include "Graphics.h"
 #include "group.h"
 #include "hint.h"
 #include "icon.h"
@@ -44,9 +52,13 @@
 #include "pager.h"
 #include "place.h"
 #include "popup.h"
+#include "PropertyLoader.h"
+#include "thumbnail.h"
 #include "root.h"
 #include "screen.h"
 #include "settings.h"
+#include "ConfigCache.h"
+#include "StatusComponent.h"
 #include "swallow.h"
 #include "taskbar.h"
 #include "timing.h"
@@ -65,11 +77,6 @@ WindowManager::~WindowManager() {
 
 void WindowManager::Initialize(void) {
 
-	Log("Registering Components\n");
-	DesktopEnvironment::DefaultEnvironment()->RegisterComponent(new DockComponent());
-	DesktopEnvironment::DefaultEnvironment()->RegisterComponent(new DesktopComponent());
-	DesktopEnvironment::DefaultEnvironment()->RegisterComponent(new BackgroundComponent());
-
 	ILog(Binding::InitializeBindings);
 	ILog(ClientNode::InitializeClients);
 	ILog(Battery::InitializeBattery);
@@ -96,42 +103,301 @@ void WindowManager::Initialize(void) {
 	ILog(TrayButton::InitializeTrayButtons);
 }
 
+/** Name of the stage that stands for the registered components. */
+#define COMPONENT_STAGES NULL
+
+/** A step of the startup sequence. */
+typedef struct StageEntry {
+	const char *name;          /**< Name other stages depend on. */
+	void (*startup)(void);     /**< Startup, run on the main thread. */
+	void (*prepare)(void);     /**< Work without X requests or NULL. */
+	const char *dependencies;  /**< Space separated stage names. */
+} StageEntry;
+
+/** The startup sequence.
+ * Stages are started in this order; the dependencies are checked and
+ * give the order when the list and the dependencies disagree.
+ * The components registered with the desktop environment are inserted
+ * at COMPONENT_STAGES with the dependencies they declare.
+ */
+static const StageEntry STAGES[] = {
+	{ "settings",    Setting::StartupSettings,         NULL, "" },
+	{ "screens",     Screens::StartupScreens,          NULL, "settings" },
+	{ "groups",      Groups::StartupGroups,            NULL, "settings" },
+	{ "colors",      Colors::StartupColors,            NULL, "settings" },
+	{ "fonts",       Fonts::StartupFonts,  Fonts::PrepareFonts, "settings" },
+	{ "icons",       Icons::StartupIcons,              NULL, "settings" },
+	{ "cursors",     Cursors::StartupCursors,          NULL, "" },
+	{ "pager",       PagerType::StartupPager,          NULL, "colors fonts" },
+	{ "thumbnails",  Thumbnails::StartupThumbnails,    NULL, "pager" },
+	{ "battery",     Battery::StartupBattery,          NULL, "colors fonts" },
+	{ "status",      StatusComponent::StartupStatus,   NULL, "colors fonts" },
+	{ "taskbar",     TaskBar::StartupTaskBar,          NULL, "colors fonts icons" },
+	{ "traybuttons", TrayButton::StartupTrayButtons,   NULL, "colors fonts icons" },
+	{ COMPONENT_STAGES, NULL, NULL, NULL },
+	{ "hints",       Hints::StartupHints,              NULL, "screens" },
+	{ "properties",  PropertyLoader::StartupPropertyLoader, NULL, "hints" },
+	{ "tray",        Tray::StartupTray,                NULL,
+			"screens pager battery status taskbar traybuttons dock hints" },
+	{ "bindings",    Binding::StartupBindings,         NULL, "settings" },
+	{ "placement",   Places::StartupPlacement,         NULL, "screens tray" },
+#ifndef DISABLE_CONFIRM
+	{ "dialogs",     Dialogs::StartupDialogs,          NULL, "colors fonts" },
+#endif
+	{ "popups",      Popups::StartupPopup,             NULL, "colors fonts" },
+	{ "rootmenu",    Roots::StartupRootMenu,           NULL, "fonts icons cursors" }
+};
+static const unsigned STAGE_COUNT = sizeof(STAGES) / sizeof(STAGES[0]);
+
+/** A stage of the current startup. */
+typedef struct StartupStage {
+	const char *name;
+	void (*startup)(void);
+	void (*prepare)(void);
+	Component *component;       /**< The component or NULL. */
+	std::vector<int> dependencies;
+	unsigned long prepareTime;  /**< Microseconds spent preparing. */
+	unsigned long startupTime;  /**< Microseconds spent starting. */
+	char prepared;              /**< Protected by stageMutex. */
+} StartupStage;
+
+static std::vector<StartupStage> stages;
+static std::vector<int> stageOrder;
+static std::mutex stageMutex;
+static std::condition_variable stagePrepared;
+static std::thread prepareThread;
+
+/** Get the index of a stage or -1 if there is none by that name. */
+static int FindStage(const char *name, size_t len) {
+	unsigned i;
+	for (i = 0; i < stages.size(); i++) {
+		if (strlen(stages[i].name) == len && !strncmp(stages[i].name, name, len)) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/** Add a dependency of a stage, returning 0 if it does not exist. */
+static char AddDependency(StartupStage *sp, const char *name, size_t len) {
+	const int index = FindStage(name, len);
+	if (JUNLIKELY(index < 0)) {
+		Warning(_("unknown startup dependency of %s: %.*s"),
+				sp->name, (int) len, name);
+		return 0;
+	}
+	sp->dependencies.push_back(index);
+	return 1;
+}
+
+/** Add a stage to the startup. */
+static void AddStage(const char *name, void (*startup)(void),
+		void (*prepare)(void), Component *component) {
+	StartupStage stage;
+	stage.name = name;
+	stage.startup = startup;
+	stage.prepare = prepare;
+	stage.component = component;
+	stage.prepareTime = 0;
+	stage.startupTime = 0;
+	stage.prepared = 0;
+	stages.push_back(stage);
+}
+
+/** Build the startup graph.
+ * @return 1 if all dependencies exist, 0 otherwise.
+ */
+static char CreateStages(void) {
+	const std::vector<Component*> &components =
+			DesktopEnvironment::DefaultEnvironment()->GetComponents();
+	std::vector<const char*> dependencies;
+	unsigned i, j;
+	char valid = 1;
+
+	stages.clear();
+	for (i = 0; i < STAGE_COUNT; i++) {
+		if (STAGES[i].name == COMPONENT_STAGES) {
+			for (j = 0; j < components.size(); j++) {
+				AddStage(components[j]->getName(), NULL, NULL, components[j]);
+				dependencies.push_back(NULL);
+			}
+		} else {
+			AddStage(STAGES[i].name, STAGES[i].startup, STAGES[i].prepare, NULL);
+			dependencies.push_back(STAGES[i].dependencies);
+		}
+	}
+
+	/* Dependencies are resolved once every stage exists. */
+	for (i = 0; i < stages.size(); i++) {
+		StartupStage *sp = &stages[i];
+		if (sp->component) {
+			const char *const *names = sp->component->getDependencies();
+			for (; names && *names; names++) {
+				valid &= AddDependency(sp, *names, strlen(*names));
+			}
+		} else {
+			const char *names = dependencies[i];
+			while (*names) {
+				const size_t len = strcspn(names, " ");
+				if (len > 0) {
+					valid &= AddDependency(sp, names, len);
+				}
+				names += len;
+				names += strspn(names, " ");
+			}
+		}
+	}
+	return valid;
+}
+
+/** Order the stages so that each follows its dependencies.
+ * Among the stages that are ready, the one listed first is taken, so the
+ * list order is kept wherever it already respects the dependencies.
+ * If there is a cycle, the list order is used.
+ */
+static void SortStages(char valid) {
+	std::vector<int> remaining(stages.size());
+	std::vector<char> done(stages.size(), 0);
+	unsigned i, j;
+
+	stageOrder.clear();
+	if (valid) {
+		for (i = 0; i < stages.size(); i++) {
+			remaining[i] = stages[i].dependencies.size();
+		}
+		while (stageOrder.size() < stages.size()) {
+			for (i = 0; i < stages.size(); i++) {
+				if (!done[i] && remaining[i] == 0) {
+					break;
+				}
+			}
+			if (JUNLIKELY(i == stages.size())) {
+				Warning(_("startup dependencies contain a cycle"));
+				break;
+			}
+			done[i] = 1;
+			stageOrder.push_back(i);
+			for (j = 0; j < stages.size(); j++) {
+				std::vector<int>::const_iterator it;
+				const std::vector<int> &deps = stages[j].dependencies;
+				for (it = deps.begin(); it != deps.end(); ++it) {
+					remaining[j] -= *it == (int) i;
+				}
+			}
+		}
+	}
+	if (stageOrder.size() != stages.size()) {
+		stageOrder.clear();
+		for (i = 0; i < stages.size(); i++) {
+			stageOrder.push_back(i);
+		}
+	}
+}
+
+/** Run the prepare step of each stage in startup order.
+ * This runs on its own thread while the main thread talks to the X server.
+ */
+static void PrepareStages(void) {
+	std::vector<int>::const_iterator it;
+	for (it = stageOrder.begin(); it != stageOrder.end(); ++it) {
+		StartupStage *sp = &stages[*it];
+		if (sp->component || sp->prepare) {
+			const unsigned long start = ConfigCache::GetMicroseconds();
+			if (sp->component) {
+				sp->component->prepare();
+			} else {
+				(sp->prepare)();
+			}
+			sp->prepareTime = ConfigCache::GetMicroseconds() - start;
+		}
+
+		std::lock_guard<std::mutex> lock(stageMutex);
+		sp->prepared = 1;
+		stagePrepared.notify_all();
+	}
+}
+
+/** Start preparing the stages.
+ * The work is done here if a thread cannot be used.
+ */
+static void StartPrepare(void) {
+	sigset_t set, old;
+
+#ifdef DEBUG
+	/* The allocation tracker is not thread-safe. */
+	PrepareStages();
+	return;
+#endif
+
+	sigfillset(&set);
+	pthread_sigmask(SIG_SETMASK, &set, &old);
+	try {
+		prepareThread = std::thread(PrepareStages);
+	} catch (const std::system_error&) {
+		PrepareStages();
+	}
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+}
+
+/** Wait for a stage to be prepared. */
+static void WaitPrepared(StartupStage *sp) {
+	std::unique_lock<std::mutex> lock(stageMutex);
+	while (!sp->prepared) {
+		stagePrepared.wait(lock);
+	}
+}
+
+/** Log the time spent on each stage. */
+static void ReportStartup(unsigned long total) {
+	std::vector<int>::const_iterator it;
+	char line[128];
+
+	for (it = stageOrder.begin(); it != stageOrder.end(); ++it) {
+		const StartupStage *sp = &stages[*it];
+		if (sp->prepareTime > 0) {
+			snprintf(line, sizeof(line), "startup: %-12s %8lu us (prepared in %lu us)\n",
+					sp->name, sp->startupTime, sp->prepareTime);
+		} else {
+			snprintf(line, sizeof(line), "startup: %-12s %8lu us\n",
+					sp->name, sp->startupTime);
+		}
+		Log(line);
+	}
+	snprintf(line, sizeof(line), "startup: %-12s %8lu us\n", "total", total);
+	Log(line);
+}
+
 /** Startup the various JWM components.
  * This is called after the X connection is opened.
  */
 void WindowManager::Startup(void) {
+	std::vector<int>::const_iterator it;
+	const unsigned long start = ConfigCache::GetMicroseconds();
 
-	/* This order is important. */
+	/* The order is given by the stage dependencies. */
+	SortStages(CreateStages());
+	StartPrepare();
 
 	/* First we grab the server to prevent clients from changing things
 	 * while we're still loading. */
 	Grabs::GrabServer();
 
-	Setting::StartupSettings();
-	Screens::StartupScreens();
-
-	Groups::StartupGroups();
-	Colors::StartupColors();
-	Fonts::StartupFonts();
-	Icons::StartupIcons();
-	Cursors::StartupCursors();
-
-	PagerType::StartupPager();
-	Battery::StartupBattery();
-	TaskBar::StartupTaskBar();
-	TrayButton::StartupTrayButtons();
-	DesktopEnvironment::DefaultEnvironment()->StartupComponents();
-	Hints::StartupHints();
-	Tray::StartupTray();
-	Binding::StartupBindings();
-	Places::StartupPlacement();
-
-#  ifndef DISABLE_CONFIRM
-	Dialogs::StartupDialogs();
-#  endif
-	Popups::StartupPopup();
-
-	Roots::StartupRootMenu();
+	/* Requests are not synchronized between stages; they are flushed
+	 * along with the rest once everything has started. */
+	for (it = stageOrder.begin(); it != stageOrder.end(); ++it) {
+		StartupStage *sp = &stages[*it];
+		WaitPrepared(sp);
+		const unsigned long stageStart = ConfigCache::GetMicroseconds();
+		if (sp->component) {
+			sp->component->start();
+		} else {
+			(sp->startup)();
+		}
+		sp->startupTime = ConfigCache::GetMicroseconds() - stageStart;
+	}
+	if (prepareThread.joinable()) {
+		prepareThread.join();
+	}
 
 	Cursors::SetDefaultCursor(rootWindow);
 	Hints::ReadCurrentDesktop();
@@ -157,11 +423,15 @@ void WindowManager::Startup(void) {
 	/* Run any startup commands. */
 	Commands::StartupCommands();
 
+	ConfigWatcher::StartupWatcher();
+
 //	LogWindow::Add(30, 30, 300, 200);
 	LogWindow::StartupPortals();
 //	LogWindow::DrawAll();
 
 	Flex::Create();
+
+	ReportStartup(ConfigCache::GetMicroseconds() - start);
 }
 
 /** Shutdown the various JWM components.
@@ -171,6 +441,7 @@ void WindowManager::Shutdown(void) {
 
 	/* This order is important. */
 
+	ConfigWatcher::ShutdownWatcher();
 	SwallowNode::ShutdownSwallow();
 
 #  ifndef DISABLE_CONFIRM
@@ -182,19 +453,23 @@ void WindowManager::Shutdown(void) {
 	PagerType::ShutdownPager();
 	Roots::ShutdownRootMenu();
 	ClientNode::ShutdownClients();
+	Thumbnails::ShutdownThumbnails();
 	DesktopEnvironment::DefaultEnvironment()->ShutdownComponents();
 	Tray::ShutdownTray();
 	TrayButton::ShutdownTrayButtons();
 	TaskBar::ShutdownTaskBar();
 	ClockType::ShutdownClock();
 	Battery::ShutdownBattery();
+	StatusComponent::ShutdownStatus();
 	Icons::ShutdownIcons();
 	Cursors::ShutdownCursors();
 	Fonts::ShutdownFonts();
+	Graphics::ShutdownGraphics();
 	Colors::ShutdownColors();
 	Groups::ShutdownGroups();
 
 	Places::ShutdownPlacement();
+	PropertyLoader::ShutdownPropertyLoader();
 	Hints::ShutdownHints();
 	Screens::ShutdownScreens();
 	Setting::ShutdownSettings();
@@ -209,8 +484,10 @@ void WindowManager::Shutdown(void) {
 void WindowManager::Destroy(void) {
 	ClientNode::DestroyClients();
 	Battery::DestroyBattery();
+	StatusComponent::DestroyStatus();
 	Colors::DestroyColors();
 	Commands::DestroyCommands();
+	ConfigCache::DestroyCache();
 	Cursors::DestroyCursors();
 #ifndef DISABLE_CONFIRM
 	Dialogs::DestroyDialogs();
@@ -274,6 +551,13 @@ void WindowManager::StartupConnection(void) {
 #ifdef USE_XRENDER
 	int renderEvent;
 	int renderError;
+#endif
+#ifdef USE_XCOMPOSITE
+	int compositeEvent;
+	int compositeError;
+#endif
+#ifdef USE_XDAMAGE
+	int damageError;
 #endif
 	struct sigaction sa;
 	char name[32];
@@ -368,6 +652,25 @@ void WindowManager::StartupConnection(void) {
 	}
 #endif
 
+#ifdef USE_XCOMPOSITE
+	haveComposite = JXCompositeQueryExtension(display, &compositeEvent,
+			&compositeError);
+	if (haveComposite) {
+		Debug("composite extension enabled");
+	} else {
+		Debug("composite extension disabled");
+	}
+#endif
+
+#ifdef USE_XDAMAGE
+	haveDamage = JXDamageQueryExtension(display, &damageEvent, &damageError);
+	if (haveDamage) {
+		Debug("damage extension enabled");
+	} else {
+		Debug("damage extension disabled");
+	}
+#endif
+
 	/* Make sure we have input focus. */
 	win = None;
 	JXGetInputFocus(display, &win, &revert);
@@ -398,8 +701,10 @@ void WindowManager::HandleExit(int sig) {
 /** Signal handler for SIGCHLD. */
 void WindowManager::HandleChild(int sig) {
 	const int savedErrno = errno;
-	while (waitpid((pid_t) -1, NULL, WNOHANG) > 0)
-		;
+	if (!Commands::NotifyChild()) {
+		while (waitpid((pid_t) -1, NULL, WNOHANG) > 0)
+			;
+	}
 	errno = savedErrno;
 }
 
@@ -34,6 +34,7 @@ typedef struct BackgroundNode {
 	BackgroundType type; /**< The type of background. */
 	char *value;
 	Pixmap pixmap;
+	ImageNode *image; /**< Image decoded before startup (or NULL). */
 	struct BackgroundNode *next; /**< Next background in the list. */
 } BackgroundNode;
 
@@ -90,6 +91,28 @@ void Backgrounds::_StartupBackgrounds(void) {
 
 }
 
+/** Decode image backgrounds before startup.
+ * This does not use the X connection, so it can run on another thread.
+ */
+void Backgrounds::_PrepareBackgrounds(void) {
+	BackgroundNode *bp;
+	for (bp = backgrounds; bp; bp = bp->next) {
+		switch (bp->type) {
+		case BACKGROUND_STRETCH:
+		case BACKGROUND_TILE:
+		case BACKGROUND_SCALE:
+			ExpandPath(&bp->value);
+			if (bp->value[0] == '/' && !bp->image
+					&& !Images::NeedsDisplay(bp->value)) {
+				bp->image = Images::LoadImage(bp->value, 0, 0, 1, 0);
+			}
+			break;
+		default:
+			break;
+		}
+	}
+}
+
 /** Shutdown background support. */
 void Backgrounds::_ShutdownBackgrounds(void) {
 	BackgroundNode *bp;
@@ -98,6 +121,8 @@ void Backgrounds::_ShutdownBackgrounds(void) {
 			JXFreePixmap(display, bp->pixmap);
 			bp->pixmap = None;
 		}
+		Images::DestroyImage(bp->image);
+		bp->image = NULL;
 	}
 }
 
@@ -166,6 +191,7 @@ void Backgrounds::_SetBackground(int desktop, const char *type,
 	bp->type = bgType;
 	bp->value = CopyString(value);
 	bp->pixmap = None;
+	bp->image = NULL;
 
 	/* Insert the node into the list. */
 	bp->next = backgrounds;
@@ -274,9 +300,15 @@ void LoadImageBackground(BackgroundNode *bp) {
 	IconNode *ip;
 	int width, height;
 
-	/* Load the icon. */
-	ExpandPath(&bp->value);
-	ip = Icons::LoadNamedIcon(bp->value, 0, bp->type == BACKGROUND_SCALE);
+	/* Load the icon.
+	 * The path was expanded when the background was prepared. */
+	if (bp->image) {
+		ip = Icons::CreateImageIcon(bp->image, bp->value,
+				bp->type == BACKGROUND_SCALE);
+		bp->image = NULL;
+	} else {
+		ip = Icons::LoadNamedIcon(bp->value, 0, bp->type == BACKGROUND_SCALE);
+	}
 	if (JUNLIKELY(!ip || ip->width == 0)) {
 		bp->pixmap = None;
 		Warning(_("background image not found: \"%s\""), bp->value);
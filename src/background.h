@@ -15,6 +15,7 @@ public:
   /*@{*/
   static void _InitializeBackgrounds(void);
   static void _StartupBackgrounds(void);
+  static void _PrepareBackgrounds(void);
   static void _ShutdownBackgrounds(void);
   static void _DestroyBackgrounds(void);
   /*@}*/
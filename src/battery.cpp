@@ -24,17 +24,20 @@
 #include "action.h"
 #include "Graphics.h"
 
-static void PollBattery(const struct TimeType *now, int x, int y, Window w,
-    void *data);
-static char* quickFileRead(int fd);
-static int readAsInt(int fd);
-static float QueryBatteryPercentage();
+#include "PowerMonitor.h"
 
-#include <fcntl.h>
-#define FILEMODE S_IRWXU | S_IRGRP | S_IROTH
+/** Poll delay when the kernel doesn't report power supply changes. */
+#define BATTERY_POLL_DELAY 900
 
-static int chargeNowFile;
-static int chargeFullFile;
+/** Poll delay with kernel notifications.
+ * Some firmware doesn't send a uevent for every change in charge,
+ * so check now and then anyway.
+ */
+#define BATTERY_CHECK_DELAY 60000
+
+static PowerMonitor *monitor = NULL;
+
+std::vector<Battery*> Battery::batteries;
 
 /** Initialize Batterys. */
 void Battery::InitializeBattery(void) {
@@ -43,32 +46,67 @@ void Battery::InitializeBattery(void) {
 
 /** Destroy Battery(s). */
 void Battery::DestroyBattery(void) {
-  close(chargeFullFile);
-  close(chargeNowFile);
-  Warning(_("Battery destroyed files closed"));
+  batteries.clear();
 }
 
 /** Start Battery(s). */
 void Battery::StartupBattery(void) {
-  if ((chargeNowFile = open("/sys/class/power_supply/BAT1/charge_now", O_RDONLY,
-  FILEMODE)) < 0) {
-    perror("Error in file opening");
+  PowerEventSource *source;
+
+  /* Don't watch the power supplies if no battery is shown. */
+  if (batteries.empty()) {
     return;
   }
-  if ((chargeFullFile = open("/sys/class/power_supply/BAT1/charge_full",
-  O_RDONLY, FILEMODE)) < 0) {
-    perror("Error in file opening");
-    return;
+
+  source = UeventSource::Open();
+  monitor = new PowerMonitor(PowerMonitor::DEFAULT_ROOT, source);
+  monitor->Refresh();
+  if (source) {
+    Events::_RegisterDescriptor(monitor->GetDescriptor(), HandlePowerEvent,
+        NULL);
+    Events::_RegisterCallback(BATTERY_CHECK_DELAY, PollBattery, NULL);
+  } else {
+    Events::_RegisterCallback(BATTERY_POLL_DELAY, PollBattery, NULL);
+  }
+}
+
+/** Stop Battery(s). */
+void Battery::ShutdownBattery(void) {
+  if (monitor) {
+    if (monitor->GetDescriptor() >= 0) {
+      Events::_UnregisterDescriptor(monitor->GetDescriptor());
+    }
+    Events::_UnregisterCallback(PollBattery, NULL);
+    delete monitor;
+    monitor = NULL;
+  }
+}
+
+/** Redraw all batteries. */
+void Battery::UpdateBatteries(void) {
+  for (auto bp : batteries) {
+    bp->Draw();
+  }
+}
+
+/** Handle power supply notifications. */
+void Battery::HandlePowerEvent(int fd, void *data) {
+  if (monitor->HandleEvents()) {
+    UpdateBatteries();
+  }
+}
+
+/** Check the power supplies without a notification. */
+void Battery::PollBattery(const TimeType *now, int x, int y, Window w,
+    void *data) {
+  if (monitor->Refresh()) {
+    UpdateBatteries();
   }
-  Warning(_("Battery started and files opened bat at %.02f"),
-      QueryBatteryPercentage());
-  Warning(_("Battery started and files opened bat at %.02f"),
-      QueryBatteryPercentage());
 }
 
 /** Create a Battery tray component. */
 Battery::Battery(int width, int height, Tray *tray, TrayComponent *parent) :
-    TrayComponent(tray, parent), lastLevel(0.0) {
+    TrayComponent(tray, parent) {
   Warning(_("Creating Battery Component"));
   this->SetSize(width, height);
 
@@ -76,11 +114,17 @@ Battery::Battery(int width, int height, Tray *tray, TrayComponent *parent) :
       JXCreatePixmap(display, rootWindow, width, height, rootDepth));
   this->graphics = Graphics::wrap(this->getPixmap(), rootGC, display);
 
-  Events::_RegisterCallback(900, PollBattery, this);
+  batteries.push_back(this);
 }
 
 Battery::~Battery() {
-
+  std::vector<Battery*>::iterator it;
+  for (it = batteries.begin(); it != batteries.end(); ++it) {
+    if (*it == this) {
+      batteries.erase(it);
+      break;
+    }
+  }
 }
 
 /** Add an action to a Battery. */
@@ -115,31 +159,27 @@ void Battery::Draw(Graphics *g) {
 
 }
 
-float QueryBatteryPercentage() {
-  int chargeNow = (int) readAsInt(chargeNowFile);
-  int chargeFull = (int) readAsInt(chargeFullFile);
-  return (100 * (chargeNow / (float) chargeFull));
-}
-
-/** Update a Battery tray component. */
-void PollBattery(const TimeType *now, int x, int y, Window w, void *data) {
-  //Log("Polling battery state\n");
-  ((Battery*) data)->Draw();
-}
-
 /** Draw a Battery tray component. */
 void Battery::Draw() {
 
-  float percentage = QueryBatteryPercentage();
-  if (percentage == this->lastLevel) {
-    return; //no change
+  PowerState state;
+  if (monitor) {
+    state = monitor->GetState();
+  } else {
+    state.percentage = -1;
+    state.online = 0;
   }
 
   this->graphics->setForeground(COLOR_TRAYBUTTON_BG2);
   this->graphics->fillRectangle(0, 0, this->getWidth(), this->getHeight());
 
   static char buf[80];
-  sprintf(buf, "%d%%", (int) percentage);
+  if (state.percentage >= 0) {
+    snprintf(buf, sizeof(buf), state.online ? "%d%% AC" : "%d%%",
+        state.percentage);
+  } else {
+    snprintf(buf, sizeof(buf), "%s", state.online ? "AC" : "--");
+  }
   int strWidth = Fonts::GetStringWidth(FONT_CLOCK, buf);
   strWidth += 16;
   if (strWidth == this->getRequestedWidth()) {
@@ -147,8 +187,6 @@ void Battery::Draw() {
         (this->getWidth() - strWidth) / 2,
         (this->getHeight() - Fonts::GetStringHeight(FONT_CLOCK)) / 2,
         this->getWidth(), buf);
-
-    this->UpdateSpecificTray(this->getTray());
   } else {
     Warning(_("Requesting the tray to give us a better size"));
     this->requestNewSize(strWidth, this->getRequestedHeight());
@@ -157,25 +195,6 @@ void Battery::Draw() {
 
   this->graphics->setForeground(COLOR_MENU_ACTIVE_BG1);
   this->graphics->drawRectangle(0, 0, this->getWidth()-1, this->getHeight()-1);
-  //update battery level
-  this->lastLevel = percentage;
 
-  graphics->copy(this->getTray()->getWindow(), 0, 0, this->getWidth(), this->getHeight(),
-      this->getX(), this->getY());
+  this->UpdateSpecificTray(this->getTray());
 }
-
-int readAsInt(int fd) {
-  char buf[255];
-  memset(buf, 0, 255);
-
-  lseek(fd, 0, SEEK_SET);
-
-  size_t count = read(fd, buf, 254);
-
-  if (count < 0) {
-    perror("Could not read any of the file!");
-    return 0;
-  }
-  return (int) atoi(buf);
-}
-
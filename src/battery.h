@@ -10,6 +10,7 @@
 #ifndef BATTERY_H
 #define BATTERY_H
 
+#include <vector>
 #include "TrayComponent.h"
 
 class Graphics;
@@ -19,7 +20,7 @@ public:
 	/*@{*/
 	static void InitializeBattery(void);
 	static void StartupBattery(void);
-	static void ShutdownBattery() {}
+	static void ShutdownBattery(void);
 	static void DestroyBattery(void);
 	/*@}*/
 
@@ -45,7 +46,13 @@ public:
 	void ProcessMotionEvent(int x, int y, int mask) {}
 private:
 	Graphics *graphics;
-	float lastLevel; /**< Currently displayed level */
+
+	static std::vector<Battery*> batteries;
+
+	static void UpdateBatteries(void);
+	static void HandlePowerEvent(int fd, void *data);
+	static void PollBattery(const struct TimeType *now, int x, int y,
+			Window w, void *data);
 
 };
 
@@ -53,6 +53,9 @@ typedef struct KeyNode {
 	/* This is filled in by StartupKeys if it isn't already set. */
 	int code;
 
+	/* Root menu index for ROOT bindings (-1 if none). */
+	int rootMenu;
+
 } KeyNode;
 
 typedef struct LockNode {
@@ -65,13 +68,31 @@ static LockNode lockMods[] = { { XK_Caps_Lock, 0 }, { XK_Num_Lock, 0 } };
 static KeyNode *bindings[MC_COUNT];
 unsigned Binding::lockMask;
 
+/** Open-addressing hash table of bindings keyed by (context, state, code).
+ * The size is a power of two and at most half full.
+ */
+static KeyNode **bindingTable = NULL;
+static unsigned int bindingTableMask = 0;
+static char bindingTableDirty = 1;
+
 static unsigned int GetModifierMask(XModifierKeymap *modmap, KeySym key);
 static KeySym ParseKeyString(const char *str);
 static char ShouldGrab(ActionType key);
+static unsigned int HashBinding(MouseContextType context, unsigned int state,
+		int code);
+static void BuildBindingTable(void);
+static void DestroyBindingTable(void);
+static const KeyNode *FindBinding(MouseContextType context, unsigned state,
+		int code);
+static int GetRootMenu(ActionType action, const char *command);
+
 /** Initialize binding data. */
 void Binding::InitializeBindings(void) {
 	memset(bindings, 0, sizeof(bindings));
 	lockMask = 0;
+	bindingTable = NULL;
+	bindingTableMask = 0;
+	bindingTableDirty = 1;
 }
 
 /** Startup bindings. */
@@ -113,6 +134,9 @@ void Binding::StartupBindings(void) {
 		}
 
 	}
+
+	/* Key codes are known now, so build the dispatch table. */
+	BuildBindingTable();
 }
 
 /** Shutdown bindings. */
@@ -140,6 +164,114 @@ void Binding::DestroyBindings(void) {
 			bindings[i] = np;
 		}
 	}
+	DestroyBindingTable();
+}
+
+/** Hash a binding key. */
+unsigned int HashBinding(MouseContextType context, unsigned int state,
+		int code) {
+	unsigned int hash;
+	hash = (unsigned int) code;
+	hash = hash * 31 + state;
+	hash = hash * 31 + context;
+	hash ^= hash >> 16;
+	hash *= 0x45D9F3B;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+/** Build the binding dispatch table from the binding lists.
+ * Bindings earlier in a list take precedence, which matches the order
+ * in which the lists were searched before.
+ */
+void BuildBindingTable(void) {
+	KeyNode *np;
+	unsigned int count;
+	unsigned int size;
+	unsigned int i;
+
+	DestroyBindingTable();
+
+	count = 0;
+	for (i = 0; i < MC_COUNT; i++) {
+		for (np = bindings[i]; np; np = np->next) {
+			count += 1;
+		}
+	}
+
+	size = 16;
+	while (size < count * 2) {
+		size *= 2;
+	}
+	bindingTable = new KeyNode*[size];
+	memset(bindingTable, 0, size * sizeof(KeyNode*));
+	bindingTableMask = size - 1;
+
+	for (i = 0; i < MC_COUNT; i++) {
+		for (np = bindings[i]; np; np = np->next) {
+			unsigned int slot = HashBinding(np->context, np->state, np->code)
+					& bindingTableMask;
+			for (;;) {
+				KeyNode *tp = bindingTable[slot];
+				if (tp == NULL) {
+					bindingTable[slot] = np;
+					break;
+				}
+				if (tp->context == np->context && tp->state == np->state
+						&& tp->code == np->code) {
+					/* Shadowed by an earlier binding. */
+					break;
+				}
+				slot = (slot + 1) & bindingTableMask;
+			}
+		}
+	}
+
+	bindingTableDirty = 0;
+}
+
+/** Release the binding dispatch table. */
+void DestroyBindingTable(void) {
+	if (bindingTable) {
+		delete[] bindingTable;
+		bindingTable = NULL;
+	}
+	bindingTableMask = 0;
+	bindingTableDirty = 1;
+}
+
+/** Look up the binding for an event. */
+const KeyNode *FindBinding(MouseContextType context, unsigned state,
+		int code) {
+	unsigned int slot;
+	KeyNode *np;
+
+	if (JUNLIKELY(bindingTableDirty)) {
+		BuildBindingTable();
+	}
+
+	/* Remove modifiers we don't care about from the state. */
+	state &= ~Binding::lockMask;
+
+	/* Mask off flags. */
+	context &= MC_MASK;
+
+	slot = HashBinding(context, state, code) & bindingTableMask;
+	while ((np = bindingTable[slot]) != NULL) {
+		if (np->context == context && np->state == state && np->code == code) {
+			return np;
+		}
+		slot = (slot + 1) & bindingTableMask;
+	}
+	return NULL;
+}
+
+/** Get the root menu index for a ROOT binding. */
+int GetRootMenu(ActionType action, const char *command) {
+	if (action.action == ROOT && command) {
+		return Roots::GetRootMenuIndexFromString(command);
+	}
+	return -1;
 }
 
 /** Grab a key. */
@@ -176,20 +308,12 @@ void Binding::GrabKey(KeyNode *np, Window win) {
 
 /** Get the key action from an event. */
 ActionType Binding::GetKey(MouseContextType context, unsigned state, int code) {
-	KeyNode *np;
+	const KeyNode *np;
 	ActionType result;
 
-	/* Remove modifiers we don't care about from the state. */
-	state &= ~lockMask;
-
-	/* Mask off flags. */
-	context &= MC_MASK;
-
-	/* Loop looking for a matching key binding. */
-	for (np = bindings[context]; np; np = np->next) {
-		if (np->state == state && np->code == code) {
-			return np->action;
-		}
+	np = FindBinding(context, state, code);
+	if (np) {
+		return np->action;
 	}
 
 	result.action = NONE;
@@ -200,41 +324,21 @@ ActionType Binding::GetKey(MouseContextType context, unsigned state, int code) {
 /** Run a command invoked from a key binding. */
 void Binding::RunKeyCommand(MouseContextType context, unsigned state,
 		int code) {
-	KeyNode *np;
+	const KeyNode *np;
 
-	/* Remove the lock key modifiers. */
-	state &= ~lockMask;
-
-	/* Mask off flags. */
-	context &= MC_MASK;
-
-	for (np = bindings[context]; np; np = np->next) {
-		if (np->state == state && np->code == code) {
-			Commands::RunCommand(np->command);
-			return;
-		}
+	np = FindBinding(context, state, code);
+	if (np) {
+		Commands::RunCommand(np->command);
 	}
 }
 
 /** Show a root menu caused by a key binding. */
 void Binding::ShowKeyMenu(MouseContextType context, unsigned state, int code) {
-	Log("Show key menu\n");
-	KeyNode *np;
-
-	/* Remove the lock key modifiers. */
-	state &= ~lockMask;
-
-	/* Mask off flags. */
-	context &= MC_MASK;
+	const KeyNode *np;
 
-	for (np = bindings[context]; np; np = np->next) {
-		if (np->state == state && np->code == code) {
-			const int button = Roots::GetRootMenuIndexFromString(np->command);
-			if (JLIKELY(button >= 0)) {
-				Roots::ShowRootMenu(button, -1, -1, 1);
-			}
-			return;
-		}
+	np = FindBinding(context, state, code);
+	if (np && JLIKELY(np->rootMenu >= 0)) {
+		Roots::ShowRootMenu(np->rootMenu, -1, -1, 1);
 	}
 }
 
@@ -347,6 +451,7 @@ KeySym ParseKeyString(const char *str) {
 /** Remove a binding. */
 void RemoveDuplicates(KeyNode *bp) {
 	KeyNode **npp = &bindings[bp->context];
+	bindingTableDirty = 1;
 	while (*npp) {
 		KeyNode *np = *npp;
 		if (np != bp && np->symbol == bp->symbol && np->state == bp->state
@@ -400,6 +505,7 @@ void Binding::InsertBinding(ActionType action, const char *modifiers,
 					np->symbol = sym;
 					np->command = NULL;
 					np->code = 0;
+					np->rootMenu = -1;
 					RemoveDuplicates(np);
 
 				}
@@ -425,6 +531,7 @@ void Binding::InsertBinding(ActionType action, const char *modifiers,
 		np->symbol = sym;
 		np->command = CopyString(command);
 		np->code = 0;
+		np->rootMenu = GetRootMenu(action, command);
 		RemoveDuplicates(np);
 
 	} else if (code && strlen(code) > 0) {
@@ -439,6 +546,7 @@ void Binding::InsertBinding(ActionType action, const char *modifiers,
 		np->symbol = NoSymbol;
 		np->command = CopyString(command);
 		np->code = atoi(code);
+		np->rootMenu = GetRootMenu(action, command);
 		RemoveDuplicates(np);
 
 	} else {
@@ -462,6 +570,7 @@ void Binding::InsertMouseBinding(int button, const char *mask,
 	np->symbol = NoSymbol;
 	np->code = button;
 	np->context = context;
+	np->rootMenu = GetRootMenu(action, command);
 	RemoveDuplicates(np);
 }
 
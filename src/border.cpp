@@ -17,18 +17,36 @@
 #include "settings.h"
 #include "grab.h"
 #include "DesktopEnvironment.h"
+#include "Graphics.h"
 
 bool Border::_registered = environment->RegisterComponent(new Border());
 char *Border::buttonNames[BI_COUNT];
 IconNode *Border::buttonIcons[BI_COUNT];
+std::map<Window, Border::FrameBuffer> Border::buffers;
 
 /** Initialize structures. */
 void Border::initialize(void) {
 	memset(buttonNames, 0, sizeof(buttonNames));
 }
 
+/** Release server resources. */
 void Border::stop(void) {
+	std::map<Window, FrameBuffer>::iterator it;
+	for (it = buffers.begin(); it != buffers.end(); ++it) {
+		FreeFrameBuffer(&it->second);
+	}
+	buffers.clear();
+}
 
+/** Get the component name. */
+const char *Border::getName(void) const {
+	return "border";
+}
+
+/** Button icons are loaded when the border starts. */
+const char *const *Border::getDependencies(void) const {
+	static const char *const dependencies[] = { "icons", NULL };
+	return dependencies;
 }
 
 /** Initialize server resources. */
@@ -259,11 +277,12 @@ void Border::ResetBorder(const ClientNode *np) {
       || (np->isShaped())) {
 
 		/* First set the shape to the window border. */
-		shapePixmap = JXCreatePixmap(display, np->getParent(), width, height,
-				1);
-		shapeGC = JXCreateGC(display, shapePixmap, 0, NULL);
+		shapePixmap = Graphics::AcquirePixmap(width, height, 1);
+		shapeGC = Graphics::AcquireGC(1);
 
-		/* Make the whole area transparent. */
+		/* Make the whole area transparent.
+		 * The pooled pixmap can be larger than the frame; anything outside
+		 * of the frame is clipped from the shape by the server. */
 		JXSetForeground(display, shapeGC, 0);
 		JXFillRectangle(display, shapePixmap, shapeGC, 0, 0, width, height);
 
@@ -311,8 +330,8 @@ void Border::ResetBorder(const ClientNode *np) {
 		JXShapeCombineMask(display, np->getParent(), ShapeBounding, 0, 0,
 				shapePixmap, ShapeSet);
 
-		JXFreeGC(display, shapeGC);
-		JXFreePixmap(display, shapePixmap);
+		Graphics::ReleaseGC(shapeGC);
+		Graphics::ReleasePixmap(shapePixmap);
 	}
 #endif
 
@@ -364,14 +383,21 @@ void Border::DrawBorderHelper(const ClientNode *np) {
 	unsigned int width, height;
 	const int titleHeight = Border::GetTitleHeight();
 
-	Pixmap canvas;
+	FrameBuffer *fp;
+	FrameStrip strips[4];
+	int count, i;
+
 	GC gc;
 
 	Assert(np);
 
 	GetBorderSize(np, &north, &south, &east, &west);
 	width = np->getWidth() + east + west;
-	height = np->getHeight() + north + south;
+	if (np->isShaded()) {
+		height = north + south;
+	} else {
+		height = np->getHeight() + north + south;
+	}
 
 	/* Determine the colors and gradients to use. */
 	if (np->isStatus(STAT_ACTIVE | STAT_FLASH)) {
@@ -393,27 +419,43 @@ void Border::DrawBorderHelper(const ClientNode *np) {
 	/* Set parent background to reduce flicker. */
 	JXSetWindowBackground(display, np->getParent(), titleColor2);
 
-	canvas = JXCreatePixmap(display, np->getParent(), width, north, rootDepth);
-	gc = JXCreateGC(display, canvas, 0, NULL);
+	/* The border is drawn straight into the back buffer of the frame.
+	 * The north border is kept at its place in the frame, so the title is
+	 * drawn as is. The button drawing code leaves the GC with one pixel
+	 * lines. */
+	fp = GetFrameBuffer(np, width, height, north, south, east, west);
+	if (fp->exposed) {
+		XDestroyRegion(fp->exposed);
+		fp->exposed = NULL;
+	}
+	gc = Graphics::AcquireGC(rootDepth, GXcopy, 1);
 
-	/* Clear the window with the right color. */
+	/* Clear the border with the right color. */
 	JXSetForeground(display, gc, titleColor2);
-	JXFillRectangle(display, canvas, gc, 0, 0, width, north);
+	if (fp->horizontal != None) {
+		JXFillRectangle(display, fp->horizontal, gc, 0, 0, width,
+				north + south);
+	}
+	if (fp->vertical != None) {
+		JXFillRectangle(display, fp->vertical, gc, 0, 0, east + west,
+				height - north - south);
+	}
 
 	/* Draw the top part (either a title or north border). */
 	if ((np->getBorder() & BORDER_TITLE)
-			&& titleHeight > settings.borderWidth) {
+			&& titleHeight > (int) settings.borderWidth
+			&& fp->horizontal != None) {
 
 		XPoint point;
 
 		/* Draw a title bar. */
-		DrawHorizontalGradient(canvas, gc, titleColor1, titleColor2, 0, 1,
-				width, titleHeight - 2);
+		DrawHorizontalGradient(fp->horizontal, gc, titleColor1, titleColor2,
+				0, 1, width, titleHeight - 2);
 
 		/* Draw the buttons.
 		 * This returns the start and end positions of the title as `x` and `y`.
 		 */
-		point = DrawBorderButtons(np, canvas, gc);
+		point = DrawBorderButtons(np, fp->horizontal, gc);
 
 		/* Draw the title. */
 		if (np->getName() && np->getName()[0] && point.x < point.y) {
@@ -434,7 +476,7 @@ void Border::DrawBorderHelper(const ClientNode *np) {
 			}
 			xoffset = Max(xoffset, 0);
 			titlex = point.x + xoffset;
-			titlex = Min(Max(titlex, point.x), point.y);
+			titlex = Min(Max(titlex, (unsigned) point.x), (unsigned) point.y);
 
 			titleWidth = Min(titleWidth, point.y - titlex);
 
@@ -442,50 +484,254 @@ void Border::DrawBorderHelper(const ClientNode *np) {
 			if (settings.windowDecorations == DECO_MOTIF) {
 				titley += settings.borderWidth - 1;
 			}
-			Fonts::RenderString(canvas, FONT_BORDER, borderTextColor, titlex,
-					titley, titleWidth, np->getName());
+			Fonts::RenderString(fp->horizontal, FONT_BORDER, borderTextColor,
+					titlex, titley, titleWidth, np->getName());
 		}
 
 	}
 
-	/* Copy the pixmap (for the title bar) to the window. */
+	/* Window outline, drawn into each part of the buffer in turn. */
+	count = GetFrameStrips(fp, strips);
+	for (i = 0; i < count; i++) {
+		const int dx = strips[i].bufferX - strips[i].x;
+		const int dy = strips[i].bufferY - strips[i].y;
+		XRectangle rect;
+
+		rect.x = strips[i].bufferX;
+		rect.y = strips[i].bufferY;
+		rect.width = strips[i].width;
+		rect.height = strips[i].height;
+		JXSetClipRectangles(display, gc, 0, 0, &rect, 1, Unsorted);
+		if (settings.windowDecorations == DECO_MOTIF) {
+			DrawBorderHandles(np, strips[i].buffer, gc, dx, dy);
+		} else {
+			JXSetForeground(display, gc, outlineColor);
+			if (np->isShaded()) {
+				DrawRoundedRectangle(strips[i].buffer, gc, dx, dy, width - 1,
+						north - 1, settings.cornerRadius);
+			} else {
+				DrawRoundedRectangle(strips[i].buffer, gc, dx, dy, width - 1,
+						height - 1, settings.cornerRadius);
+			}
+		}
+	}
+	JXSetClipMask(display, gc, None);
 
-	/* Copy the pixmap for the title bar and clear the part of
-	 * the window to be drawn directly. */
-	if (settings.windowDecorations == DECO_MOTIF) {
-		const int off = 2;
-		JXCopyArea(display, canvas, np->getParent(), gc, off, off,
-				width - 2 * off, north - off, off, off);
-		JXClearArea(display, np->getParent(), off, north, width - 2 * off,
-				height - north - off, False);
+	/* Show the border all at once. */
+	for (i = 0; i < count; i++) {
+		JXCopyArea(display, strips[i].buffer, np->getParent(), gc,
+				strips[i].bufferX, strips[i].bufferY, strips[i].width,
+				strips[i].height, strips[i].x, strips[i].y);
+	}
+	Graphics::ReleaseGC(gc);
+
+}
+
+/** Get the back buffer of a frame, (re)allocating it for the frame size. */
+Border::FrameBuffer *Border::GetFrameBuffer(const ClientNode *np, int width,
+		int height, int north, int south, int east, int west) {
+	FrameBuffer *fp;
+	std::map<Window, FrameBuffer>::iterator it;
+	const int middle = Max(height - north - south, 0);
+
+	it = buffers.find(np->getParent());
+	if (it == buffers.end()) {
+		fp = &buffers[np->getParent()];
+		fp->horizontal = None;
+		fp->vertical = None;
+		fp->exposed = NULL;
+		fp->width = -1;
 	} else {
-		JXCopyArea(display, canvas, np->getParent(), gc, 1, 1, width - 2,
-				north - 1, 1, 1);
-		JXClearArea(display, np->getParent(), 1, north, width - 2,
-				height - north - 1, False);
+		fp = &it->second;
 	}
 
-	/* Window outline. */
-	if (settings.windowDecorations == DECO_MOTIF) {
-		DrawBorderHandles(np, np->getParent(), gc);
+	if (fp->width != width || fp->height != height || fp->north != north
+			|| fp->south != south || fp->east != east || fp->west != west) {
+		if (fp->horizontal != None) {
+			JXFreePixmap(display, fp->horizontal);
+			fp->horizontal = None;
+		}
+		if (fp->vertical != None) {
+			JXFreePixmap(display, fp->vertical);
+			fp->vertical = None;
+		}
+		if (width > 0 && north + south > 0) {
+			fp->horizontal = JXCreatePixmap(display, np->getParent(), width,
+					north + south, rootDepth);
+		}
+		if (east + west > 0 && middle > 0) {
+			fp->vertical = JXCreatePixmap(display, np->getParent(), east + west,
+					middle, rootDepth);
+		}
+		fp->width = width;
+		fp->height = height;
+		fp->north = north;
+		fp->south = south;
+		fp->east = east;
+		fp->west = west;
+	}
+	return fp;
+}
+
+/** Get the parts of a frame kept in its back buffer. */
+int Border::GetFrameStrips(const FrameBuffer *fp, FrameStrip *strips) {
+	const int middle = Max(fp->height - fp->north - fp->south, 0);
+	int count = 0;
+
+	if (fp->horizontal != None) {
+		if (fp->north > 0) {
+			FrameStrip *sp = &strips[count++];
+			sp->buffer = fp->horizontal;
+			sp->bufferX = 0;
+			sp->bufferY = 0;
+			sp->x = 0;
+			sp->y = 0;
+			sp->width = fp->width;
+			sp->height = fp->north;
+		}
+		if (fp->south > 0) {
+			FrameStrip *sp = &strips[count++];
+			sp->buffer = fp->horizontal;
+			sp->bufferX = 0;
+			sp->bufferY = fp->north;
+			sp->x = 0;
+			sp->y = fp->height - fp->south;
+			sp->width = fp->width;
+			sp->height = fp->south;
+		}
+	}
+	if (fp->vertical != None) {
+		if (fp->west > 0) {
+			FrameStrip *sp = &strips[count++];
+			sp->buffer = fp->vertical;
+			sp->bufferX = 0;
+			sp->bufferY = 0;
+			sp->x = 0;
+			sp->y = fp->north;
+			sp->width = fp->west;
+			sp->height = middle;
+		}
+		if (fp->east > 0) {
+			FrameStrip *sp = &strips[count++];
+			sp->buffer = fp->vertical;
+			sp->bufferX = fp->west;
+			sp->bufferY = 0;
+			sp->x = fp->width - fp->east;
+			sp->y = fp->north;
+			sp->width = fp->east;
+			sp->height = middle;
+		}
+	}
+	return count;
+}
+
+/** Handle an expose event on a frame. */
+void Border::ExposeBorder(ClientNode *np, const XExposeEvent *event) {
+	std::map<Window, FrameBuffer>::iterator it;
+	FrameBuffer *fp;
+	FrameStrip strips[4];
+	XRectangle rect;
+	int north, south, east, west;
+	int width, height;
+	int count, i;
+	GC gc;
+
+	it = buffers.find(np->getParent());
+	if (it == buffers.end()) {
+		if (event->count == 0) {
+			DrawBorder(np);
+		}
+		return;
+	}
+	fp = &it->second;
+
+	/* Merge the exposed areas until the last event of the series. */
+	if (fp->exposed == NULL) {
+		fp->exposed = XCreateRegion();
+	}
+	rect.x = event->x;
+	rect.y = event->y;
+	rect.width = event->width;
+	rect.height = event->height;
+	XUnionRectWithRegion(&rect, fp->exposed, fp->exposed);
+	if (event->count > 0) {
+		return;
+	}
+
+	/* Draw from scratch if the frame changed since it was last drawn. */
+	GetBorderSize(np, &north, &south, &east, &west);
+	width = np->getWidth() + east + west;
+	if (np->isShaded()) {
+		height = north + south;
 	} else {
-		JXSetForeground(display, gc, outlineColor);
-		if (np->isShaded()) {
-			DrawRoundedRectangle(np->getParent(), gc, 0, 0, width - 1,
-					north - 1, settings.cornerRadius);
-		} else {
-			DrawRoundedRectangle(np->getParent(), gc, 0, 0, width - 1,
-					height - 1, settings.cornerRadius);
+		height = np->getHeight() + north + south;
+	}
+	if (fp->width != width || fp->height != height || fp->north != north
+			|| fp->south != south || fp->east != east || fp->west != west) {
+		XDestroyRegion(fp->exposed);
+		fp->exposed = NULL;
+		DrawBorder(np);
+		return;
+	}
+
+	/* Copy the buffer clipped to the exposed area. */
+	gc = Graphics::AcquireGC(rootDepth);
+	JXSetRegion(display, gc, fp->exposed);
+	count = GetFrameStrips(fp, strips);
+	for (i = 0; i < count; i++) {
+		if (XRectInRegion(fp->exposed, strips[i].x, strips[i].y,
+				strips[i].width, strips[i].height) != RectangleOut) {
+			JXCopyArea(display, strips[i].buffer, np->getParent(), gc,
+					strips[i].bufferX, strips[i].bufferY, strips[i].width,
+					strips[i].height, strips[i].x, strips[i].y);
 		}
 	}
+	JXSetClipMask(display, gc, None);
+	Graphics::ReleaseGC(gc);
+
+	XDestroyRegion(fp->exposed);
+	fp->exposed = NULL;
+}
+
+/** Free the back buffer of a frame. */
+void Border::ReleaseBorder(const ClientNode *np) {
+	std::map<Window, FrameBuffer>::iterator it;
+	it = buffers.find(np->getParent());
+	if (it != buffers.end()) {
+		FreeFrameBuffer(&it->second);
+		buffers.erase(it);
+	}
+}
 
-	JXFreePixmap(display, canvas);
-	JXFreeGC(display, gc);
+/** Free the resources of a back buffer. */
+void Border::FreeFrameBuffer(FrameBuffer *fp) {
+	if (fp->horizontal != None) {
+		JXFreePixmap(display, fp->horizontal);
+	}
+	if (fp->vertical != None) {
+		JXFreePixmap(display, fp->vertical);
+	}
+	if (fp->exposed) {
+		XDestroyRegion(fp->exposed);
+	}
+}
 
+/** Draw line segments moved by dx and dy. */
+void Border::DrawSegments(Drawable d, GC gc, XSegment *segments, int count,
+		int dx, int dy) {
+	int i;
+	for (i = 0; i < count; i++) {
+		segments[i].x1 += dx;
+		segments[i].y1 += dy;
+		segments[i].x2 += dx;
+		segments[i].y2 += dy;
+	}
+	JXDrawSegments(display, d, gc, segments, count);
 }
 
-/** Draw window handles. */
-void Border::DrawBorderHandles(const ClientNode *np, Pixmap canvas, GC gc) {
+/** Draw window handles, moved by dx and dy. */
+void Border::DrawBorderHandles(const ClientNode *np, Drawable d, GC gc,
+		int dx, int dy) {
 	XSegment segments[9];
 	long pixelUp, pixelDown;
 	int width, height;
@@ -577,7 +823,7 @@ void Border::DrawBorderHandles(const ClientNode *np, Pixmap canvas, GC gc) {
 
 	/* Draw pixel-up segments. */
 	JXSetForeground(display, gc, pixelUp);
-	JXDrawSegments(display, canvas, gc, segments, offset);
+	DrawSegments(d, gc, segments, offset, dx, dy);
 	offset = 0;
 
 	/* Bottom title border. */
@@ -634,7 +880,7 @@ void Border::DrawBorderHandles(const ClientNode *np, Pixmap canvas, GC gc) {
 
 	/* Draw pixel-down segments. */
 	JXSetForeground(display, gc, pixelDown);
-	JXDrawSegments(display, canvas, gc, segments, offset);
+	DrawSegments(d, gc, segments, offset, dx, dy);
 	offset = 0;
 
 	/* Draw marks */
@@ -683,7 +929,7 @@ void Border::DrawBorderHandles(const ClientNode *np, Pixmap canvas, GC gc) {
 
 		/* Draw pixel-down segments. */
 		JXSetForeground(display, gc, pixelDown);
-		JXDrawSegments(display, canvas, gc, segments, 8);
+		DrawSegments(d, gc, segments, 8, dx, dy);
 
 		/* Upper left */
 		segments[0].x1 = titleHeight + settings.borderWidth;
@@ -727,7 +973,7 @@ void Border::DrawBorderHandles(const ClientNode *np, Pixmap canvas, GC gc) {
 
 		/* Draw pixel-up segments. */
 		JXSetForeground(display, gc, pixelUp);
-		JXDrawSegments(display, canvas, gc, segments, 8);
+		DrawSegments(d, gc, segments, 8, dx, dy);
 	}
 }
 
@@ -10,6 +10,8 @@
 #ifndef BORDER_H
 #define BORDER_H
 
+#include <map>
+
 #include "gradient.h"
 #include "icon.h"
 #include "Component.h"
@@ -41,6 +43,8 @@ public:
   void start(void);
   void stop(void);
   void destroy(void);
+  const char *getName(void) const;
+  const char *const *getDependencies(void) const;
   /*@}*/
 
   /** Determine the mouse context for a location.
@@ -58,10 +62,25 @@ public:
   static void ResetBorder(const struct ClientNode *np);
 
   /** Draw a window border.
+   * The frame is rendered into its back buffer and then shown.
    * @param np The client whose frame to draw.
    */
   static void DrawBorder(struct ClientNode *np);
 
+  /** Handle an expose event on a frame.
+   * Exposed areas are collected until the last event of a series and
+   * then copied from the back buffer of the frame.
+   * @param np The client.
+   * @param event The event.
+   */
+  static void ExposeBorder(struct ClientNode *np, const XExposeEvent *event);
+
+  /** Free the back buffer of a frame.
+   * This must be called before the frame is destroyed.
+   * @param np The client.
+   */
+  static void ReleaseBorder(const struct ClientNode *np);
+
   /** Get the size of a border icon.
    * @return The size in pixels (note that icons are square).
    */
@@ -99,13 +118,40 @@ public:
   static void SetBorderIcon(BorderIconType t, const char *name);
 
 private:
+  /** Back buffer of a frame.
+   * Only the border is kept: the north and south parts side by side
+   * in one pixmap and the west and east parts in another.
+   */
+  typedef struct FrameBuffer {
+    Pixmap horizontal; /**< North and south borders (or None). */
+    Pixmap vertical; /**< West and east borders (or None). */
+    int width, height; /**< Size of the frame. */
+    int north, south, east, west; /**< Border sizes. */
+    Region exposed; /**< Areas exposed since the last repaint (or NULL). */
+  } FrameBuffer;
+
+  /** A part of a frame and where it is kept in the back buffer. */
+  typedef struct FrameStrip {
+    Pixmap buffer;
+    int bufferX, bufferY;
+    int x, y, width, height; /**< Frame coordinates. */
+  } FrameStrip;
+
   static char *buttonNames[BI_COUNT];
   static IconNode *buttonIcons[BI_COUNT];
+  static std::map<Window, FrameBuffer> buffers;
+
+  static FrameBuffer *GetFrameBuffer(const ClientNode *np, int width,
+      int height, int north, int south, int east, int west);
+  static int GetFrameStrips(const FrameBuffer *fp, FrameStrip *strips);
+  static void FreeFrameBuffer(FrameBuffer *fp);
 
   static char IsContextEnabled(MouseContextType context, const ClientNode *np);
   static void DrawBorderHelper(const ClientNode *np);
-  static void DrawBorderHandles(const ClientNode *np,
-      Pixmap canvas, GC gc);
+  static void DrawBorderHandles(const ClientNode *np, Drawable d, GC gc,
+      int dx, int dy);
+  static void DrawSegments(Drawable d, GC gc, XSegment *segments, int count,
+      int dx, int dy);
   static void DrawBorderButton(const ClientNode *np, MouseContextType context,
       int x, int y, Pixmap canvas, GC gc, long fg);
   static void DrawButtonBorder(const ClientNode *np, int x,
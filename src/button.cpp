@@ -15,6 +15,7 @@
 #include "image.h"
 #include "misc.h"
 #include "settings.h"
+#include "Graphics.h"
 
 /** Draw a button. */
 void DrawButton(ButtonType type, AlignmentType alignment, FontType font, const char *text, bool fill, bool border,
@@ -30,7 +31,7 @@ void DrawButton(ButtonType type, AlignmentType alignment, FontType font, const c
 	int iconWidth, iconHeight;
 	int textWidth, textHeight;
 
-	gc = JXCreateGC(display, drawable, 0, NULL);
+	gc = Graphics::AcquireGC(rootDepth);
 
 	/* Determine the colors to use. */
 	switch (type) {
@@ -183,6 +184,6 @@ void DrawButton(ButtonType type, AlignmentType alignment, FontType font, const c
 		Fonts::RenderString(drawable, font, fg, x + xoffset, y + yoffset, textWidth, text);
 	}
 
-	JXFreeGC(display, gc);
+	Graphics::ReleaseGC(gc);
 
 }
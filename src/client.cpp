@@ -8,6 +8,7 @@
  */
 
 #include <algorithm>
+#include <map>
 #include "jwm.h"
 #include "client.h"
 #include "clientlist.h"
@@ -34,6 +35,8 @@
 #include "resize.h"
 #include "binding.h"
 #include "status.h"
+#include "PropertyLoader.h"
+#include "thumbnail.h"
 
 #include <X11/Xlibint.h>
 
@@ -43,36 +46,77 @@ unsigned int ClientNode::clientCount;
 
 std::vector<ClientNode*> ClientNode::nodes;
 
+std::vector<Window> ClientNode::stackOrder;
+
 /** Load windows that are already mapped. */
 void ClientNode::StartupClients(void) {
 
-  XWindowAttributes attr;
   Window rootReturn, parentReturn, *childrenReturn;
   unsigned int childrenCount;
   unsigned int x;
+  std::vector<XWindowAttributes> attrs;
+  std::vector<char> valid;
+  std::vector<Window> adopt;
+  std::vector<unsigned> adoptIndex;
+  TimeType start, prefetched, done;
+  char buf[128];
 
   clientCount = 0;
   activeClient = NULL;
   currentDesktop = 0;
+  stackOrder.clear();
 
   /* Clear out the client lists. */
   ClientList::Initialize();
 
-  /* Query client windows. */
+  GetCurrentTime(&start);
+
+  /* Query client windows.
+   * The attributes of all windows are requested at once and passed on
+   * to the clients so they are not queried again. The server is grabbed
+   * first so that the attributes are still current when the clients are
+   * added. */
+  Grabs::GrabServer();
   JXQueryTree(display, rootWindow, &rootReturn, &parentReturn, &childrenReturn,
       &childrenCount);
-
-  /* Add each client. */
+  attrs.resize(childrenCount);
+  valid.resize(childrenCount);
+  if (childrenCount > 0) {
+    PropertyLoader::GetWindowAttributes(childrenReturn, childrenCount,
+        &attrs[0], &valid[0]);
+  }
   for (x = 0; x < childrenCount; x++) {
-    if (JXGetWindowAttributes(display, childrenReturn[x], &attr)) {
-      if (attr.override_redirect == False && attr.map_state == IsViewable) {
-        Create(childrenReturn[x], 1, 1);
-      }
+    if (valid[x] && attrs[x].override_redirect == False
+        && attrs[x].map_state == IsViewable) {
+      adopt.push_back(childrenReturn[x]);
+      adoptIndex.push_back(x);
     }
   }
-
   JXFree(childrenReturn);
 
+  /* Request the properties of every window before reading any of them. */
+  for (x = 0; x < adopt.size(); x++) {
+    PropertyLoader::Prefetch(adopt[x]);
+  }
+  GetCurrentTime(&prefetched);
+
+  /* Add each client under the same grab. Restacking and task bar/pager
+   * updates are only flagged here and run once from Events::_Signal. */
+  for (x = 0; x < adopt.size(); x++) {
+    Create(adopt[x], 1, 1, &attrs[adoptIndex[x]]);
+    PropertyLoader::ReleaseWindow(adopt[x]);
+  }
+  Grabs::UngrabServer();
+  Events::_RequireRestack();
+
+  GetCurrentTime(&done);
+  snprintf(buf, sizeof(buf),
+      "Adopted %u of %u windows in %lu ms (query %lu ms, manage %lu ms)\n",
+      clientCount, (unsigned) adopt.size(),
+      GetTimeDifference(&start, &done), GetTimeDifference(&start, &prefetched),
+      GetTimeDifference(&prefetched, &done));
+  Logger::Log(buf);
+
   LoadFocus();
 
   Events::_RequireTaskUpdate();
@@ -91,8 +135,9 @@ void ClientNode::StartupClients(void) {
 
 }
 
-ClientNode* ClientNode::Create(Window w, char alreadyMapped, char notOwner) {
-  ClientNode *node = new ClientNode(w, alreadyMapped, notOwner);
+ClientNode* ClientNode::Create(Window w, char alreadyMapped, char notOwner,
+    const XWindowAttributes *attributes) {
+  ClientNode *node = new ClientNode(w, alreadyMapped, notOwner, attributes);
   nodes.push_back(node);
   return node;
 }
@@ -187,6 +232,7 @@ void ClientNode::CascadeClient(const BoundingBox *box) {
 void ClientNode::ShutdownClients(void) {
 
   ClientList::Shutdown();
+  stackOrder.clear();
 
   Strut *sp;
 
@@ -280,7 +326,11 @@ ClientNode::~ClientNode() {
   }
 
   /* Destroy the parent */
+  RemoveFromStack(this->window);
   if (this->parent) {
+    RemoveFromStack(this->parent);
+    Thumbnails::UntrackClient(this);
+    Border::ReleaseBorder(this);
     JXDestroyWindow(display, this->parent);
   }
 
@@ -293,6 +343,8 @@ ClientNode::~ClientNode() {
 
   TaskBar::RemoveClientFromTaskBar(this);
   Places::RemoveClientStrut(this);
+  PagerType::RemoveClient(this);
+  Events::_RequirePagerUpdate();
 
   while (this->colormaps) {
     cp = this->colormaps->next;
@@ -311,8 +363,11 @@ ClientNode::~ClientNode() {
 
 }
 
-/** Add a window to management. */
-ClientNode::ClientNode(Window w, char alreadyMapped, char notOwner) :
+/** Add a window to management.
+ * The attributes are queried here unless they were already read.
+ */
+ClientNode::ClientNode(Window w, char alreadyMapped, char notOwner,
+    const XWindowAttributes *attributes) :
     oldx(0), oldy(0), oldWidth(0), oldHeight(0), yinc(0), minWidth(0), maxWidth(
         0), minHeight(0), maxHeight(0), gravity(0), controller(0), instanceName(
         0), baseHeight(0), baseWidth(0), colormaps(), icon(0), sizeFlags(0), className(
@@ -323,7 +378,9 @@ ClientNode::ClientNode(Window w, char alreadyMapped, char notOwner) :
   Assert(w != None);
 
   /* Get window attributes. */
-  if (JXGetWindowAttributes(display, w, &attr) == 0) {
+  if (attributes) {
+    attr = *attributes;
+  } else if (JXGetWindowAttributes(display, w, &attr) == 0) {
     return;
   }
 
@@ -354,6 +411,9 @@ ClientNode::ClientNode(Window w, char alreadyMapped, char notOwner) :
   this->resetBorder();
   this->mouseContext = MC_NONE;
 
+  /* Request all of the properties we need at once. */
+  PropertyLoader::Prefetch(w);
+
   Hints::ReadClientInfo(this, alreadyMapped);
 
   if (!notOwner) {
@@ -452,6 +512,7 @@ ClientNode::ClientNode(Window w, char alreadyMapped, char notOwner) :
   }
 
   Places::ReadClientStrut(this);
+  PropertyLoader::ReleaseWindow(w);
 
   /* Focus transients if their parent has focus. */
   if (this->owner != None) {
@@ -1514,6 +1575,8 @@ void ClientNode::keyboardFocus() {
       }
       Border::DrawBorder(activeClient);
       Hints::WriteNetState(activeClient);
+      Events::_RequireTaskUpdate(activeClient);
+      Events::_RequirePagerUpdate(activeClient);
     }
     this->setActive();
     activeClient = this;
@@ -1522,8 +1585,8 @@ void ClientNode::keyboardFocus() {
     }
 
     Border::DrawBorder(this);
-    Events::_RequirePagerUpdate();
-    Events::_RequireTaskUpdate();
+    Events::_RequirePagerUpdate(this);
+    Events::_RequireTaskUpdate(this);
   }
 
   if (this->isMapped()) {
@@ -1659,22 +1722,17 @@ void ClientNode::RestackClient(Window above, int detail) {
 /** Restack the clients according the way we want them. */
 void ClientNode::RestackClients(void) {
 
-  unsigned int layer, index;
-  int trayCount;
-  Window *stack;
+  unsigned int layer;
+  std::vector<Window> stack;
   Window fw;
 
   if (JUNLIKELY(shouldExit)) {
     return;
   }
 
-  /* Allocate memory for restacking. */
-  trayCount = Tray::GetTrayCount();
-  stack = AllocateStack((clientCount + trayCount) * sizeof(Window));
-
   /* Prepare the stacking array. */
+  stack.reserve(clientCount + Tray::GetTrayCount());
   fw = None;
-  index = 0;
   if (activeClient && (activeClient->isFullscreen())) {
     fw = activeClient->window;
     std::vector<ClientNode*> clients = ClientList::GetLayerList(
@@ -1683,19 +1741,17 @@ void ClientNode::RestackClients(void) {
       ClientNode *np = clients[i];
       if (np->getOwner() == fw) {
         if (np->getParent() != None) {
-          stack[index] = np->getParent();
+          stack.push_back(np->getParent());
         } else {
-          stack[index] = np->getWindow();
+          stack.push_back(np->getWindow());
         }
-        index += 1;
       }
     }
     if (activeClient->parent != None) {
-      stack[index] = activeClient->parent;
+      stack.push_back(activeClient->parent);
     } else {
-      stack[index] = activeClient->window;
+      stack.push_back(activeClient->window);
     }
-    index += 1;
   }
   layer = LAST_LAYER;
   for (;;) {
@@ -1708,20 +1764,15 @@ void ClientNode::RestackClients(void) {
           continue;
         }
         if (np->getParent() != None) {
-          stack[index] = np->getParent();
+          stack.push_back(np->getParent());
         } else {
-          stack[index] = np->getWindow();
+          stack.push_back(np->getWindow());
         }
-        index += 1;
       }
     }
 
     std::vector<Window> windows = Tray::getTrayWindowsAt(layer);
-    std::vector<Window>::iterator it;
-    for (it = windows.begin(); it != windows.end(); ++it) {
-      stack[index] = (*it);
-      index += 1;
-    }
+    stack.insert(stack.end(), windows.begin(), windows.end());
 
     if (layer == FIRST_LAYER) {
       break;
@@ -1730,12 +1781,136 @@ void ClientNode::RestackClients(void) {
 
   }
 
-  JXRestackWindows(display, stack, index);
+  if (ApplyStack(stack)) {
+    TaskBar::UpdateNetClientList();
+    Events::_RequirePagerUpdate();
+  }
 
-  ReleaseStack(stack);
-  TaskBar::UpdateNetClientList();
-  Events::_RequirePagerUpdate();
+}
+
+/** Send a new stacking order to the X server.
+ * Only the windows that moved relative to the last stacking order we sent
+ * are restacked. Windows that keep their relative order are found as the
+ * longest increasing run of their old positions; everything else is
+ * placed relative to its new neighbor with a single XConfigureWindow.
+ * @param stack The desired stacking order (top to bottom).
+ * @return 1 if the stacking order changed, 0 if it was already current.
+ */
+char ClientNode::ApplyStack(const std::vector<Window> &stack) {
+
+  std::map<Window, unsigned int> oldIndex;
+  std::map<Window, unsigned int>::const_iterator found;
+  std::vector<unsigned int> tails;
+  std::vector<int> previous;
+  std::vector<int> positions;
+  std::vector<char> fixed;
+  XWindowChanges changes;
+  unsigned int count, moves, first, i;
+  int p;
+
+  if (stack == stackOrder) {
+    return 0;
+  }
+
+  count = stack.size();
+  if (count == 0) {
+    stackOrder.clear();
+    return 1;
+  }
+
+  /* Look up where each window was in the last stacking order. */
+  for (i = 0; i < stackOrder.size(); i++) {
+    oldIndex[stackOrder[i]] = i;
+  }
+  positions.resize(count);
+  for (i = 0; i < count; i++) {
+    found = oldIndex.find(stack[i]);
+    positions[i] = found != oldIndex.end() ? (int) found->second : -1;
+  }
 
+  /* Find the longest run of windows whose relative order is unchanged. */
+  previous.resize(count, -1);
+  for (i = 0; i < count; i++) {
+    unsigned int low, high;
+    if (positions[i] < 0) {
+      continue;
+    }
+    low = 0;
+    high = tails.size();
+    while (low < high) {
+      const unsigned int mid = (low + high) / 2;
+      if (positions[tails[mid]] < positions[i]) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    if (low > 0) {
+      previous[i] = tails[low - 1];
+    }
+    if (low == tails.size()) {
+      tails.push_back(i);
+    } else {
+      tails[low] = i;
+    }
+  }
+  fixed.resize(count, 0);
+  if (!tails.empty()) {
+    for (p = tails.back(); p >= 0; p = previous[p]) {
+      fixed[p] = 1;
+    }
+  }
+  moves = count - tails.size();
+
+  if (tails.empty() || moves + 1 >= count) {
+
+    /* Restacking every window is no more expensive. */
+    JXRestackWindows(display, (Window*) &stack[0], count);
+
+  } else {
+
+    /* Put the top window above the first window that stays put;
+     * everything else goes directly below its new upper neighbor. */
+    first = 0;
+    while (!fixed[first]) {
+      first += 1;
+    }
+    if (first > 0) {
+      changes.sibling = stack[first];
+      changes.stack_mode = Above;
+      JXConfigureWindow(display, stack[0], CWSibling | CWStackMode, &changes);
+    }
+    for (i = 1; i < count; i++) {
+      if (!fixed[i]) {
+        changes.sibling = stack[i - 1];
+        changes.stack_mode = Below;
+        JXConfigureWindow(display, stack[i], CWSibling | CWStackMode,
+            &changes);
+      }
+    }
+
+  }
+
+  stackOrder = stack;
+  return 1;
+
+}
+
+/** Forget the stacking order sent to the X server.
+ * This must be called after restacking managed windows directly so that
+ * the next restack sends the complete stacking order.
+ */
+void ClientNode::InvalidateStack(void) {
+  stackOrder.clear();
+}
+
+/** Drop a window that is going away from the last stacking order. */
+void ClientNode::RemoveFromStack(Window w) {
+  std::vector<Window>::iterator found;
+  found = std::find(stackOrder.begin(), stackOrder.end(), w);
+  if (found != stackOrder.end()) {
+    stackOrder.erase(found);
+  }
 }
 
 /** Send a client message to a window. */
@@ -1783,8 +1958,8 @@ void ClientNode::ReadWMName() {
     delete[] (this->getName());
   }
 
-  status = JXGetWindowProperty(display, this->getWindow(),
-      Hints::atoms[ATOM_NET_WM_NAME], 0, 1024, False,
+  status = Hints::GetProperty(this->getWindow(),
+      Hints::atoms[ATOM_NET_WM_NAME], 0, 1024,
       Hints::atoms[ATOM_UTF8_STRING], &realType, &realFormat, &count, &extra,
       &name);
   if (status != Success || realFormat == 0) {
@@ -1799,8 +1974,8 @@ void ClientNode::ReadWMName() {
 
 #ifdef USE_XUTF8
   if (!this->getName()) {
-    status = JXGetWindowProperty(display, this->getWindow(), XA_WM_NAME, 0,
-        1024, False, Hints::atoms[ATOM_COMPOUND_TEXT], &realType, &realFormat,
+    status = Hints::GetProperty(this->getWindow(), XA_WM_NAME, 0,
+        1024, Hints::atoms[ATOM_COMPOUND_TEXT], &realType, &realFormat,
         &count, &extra, &name);
     if (status == Success && realFormat != 0) {
       char **tlist;
@@ -1824,7 +1999,7 @@ void ClientNode::ReadWMName() {
 
   if (!this->getName()) {
     char *temp = NULL;
-    if (JXFetchName(display, this->getWindow(), &temp)) {
+    if (Hints::FetchName(this->getWindow(), &temp)) {
       const size_t len = strlen(temp) + 1;
       this->name = new char[len];
       memcpy(this->name, temp, len);
@@ -1837,7 +2012,7 @@ void ClientNode::ReadWMName() {
 /** Read the window class for a client. */
 void ClientNode::ReadWMClass() {
   XClassHint hint;
-  if (JXGetClassHint(display, this->getWindow(), &hint)) {
+  if (Hints::GetClassHint(this->getWindow(), &hint)) {
     this->instanceName = hint.res_name;
     this->className = hint.res_class;
   }
@@ -1895,6 +2070,9 @@ void ClientNode::ReparentClient() {
 
     JXReparentWindow(display, this->window, rootWindow, this->x, this->y);
     XDeleteContext(display, this->parent, frameContext);
+    RemoveFromStack(this->parent);
+    Thumbnails::UntrackClient(this);
+    Border::ReleaseBorder(this);
     JXDestroyWindow(display, this->parent);
     this->parent = None;
 
@@ -2027,8 +2205,8 @@ void ClientNode::SignalUrgent(const TimeType *now, int x, int y, Window w,
     np->setFlash();
   }
   Border::DrawBorder(np);
-  Events::_RequireTaskUpdate();
-  Events::_RequirePagerUpdate();
+  Events::_RequireTaskUpdate(np);
+  Events::_RequirePagerUpdate(np);
 
 }
 
@@ -2056,7 +2234,7 @@ void ClientNode::ReadWMColormaps() {
   ColormapNode *cp;
   int count;
 
-  if (JXGetWMColormapWindows(display, this->getWindow(), &windows, &count)) {
+  if (Hints::GetWMColormapWindows(this->getWindow(), &windows, &count)) {
     if (count > 0) {
       int x;
 
@@ -2160,7 +2338,7 @@ void ClientNode::ReadWMNormalHints() {
   XSizeHints hints;
   long temp;
 
-  if (!JXGetWMNormalHints(display, this->getWindow(), &hints, &temp)) {
+  if (!Hints::GetWMNormalHints(this->getWindow(), &hints, &temp)) {
     this->sizeFlags = 0;
   } else {
     this->sizeFlags = hints.flags;
@@ -2362,6 +2540,7 @@ Window ClientNode::getOwner() const {
 
 void ClientNode::setOwner(Window owner) {
   this->owner = owner;
+  this->InvalidateTask();
 }
 
 int ClientNode::getX() const {
@@ -2456,8 +2635,17 @@ void ClientNode::setDelete() {
   this->status |= STAT_DELETE;
 }
 
+/** Mark the task bar state of this client as stale.
+ * The task bar caches counts derived from the status and desktop of its
+ * clients, so every setter that changes them calls this.
+ */
+void ClientNode::InvalidateTask() {
+  TaskBar::InvalidateClient(this);
+}
+
 void ClientNode::setTakeFocus() {
   this->status |= STAT_TAKEFOCUS;
+  this->InvalidateTask();
 }
 
 void ClientNode::setNoDelete() {
@@ -2466,6 +2654,7 @@ void ClientNode::setNoDelete() {
 
 void ClientNode::setNoTakeFocus() {
   this->status &= ~STAT_TAKEFOCUS;
+  this->InvalidateTask();
 }
 
 void ClientNode::setLayer(unsigned char layer) {
@@ -2502,10 +2691,12 @@ void ClientNode::clearBorder() {
 
 void ClientNode::clearStatus() {
   this->status = STAT_NONE;
+  this->InvalidateTask();
 }
 
 void ClientNode::setNotMapped() {
   this->status &= ~STAT_MAPPED;
+  this->InvalidateTask();
 }
 
 unsigned int ClientNode::getOpacity() {
@@ -2527,6 +2718,7 @@ void ClientNode::resetLayerToDefault() {
 
 void ClientNode::setDesktop(unsigned short desktop) {
   this->desktop = desktop;
+  this->InvalidateTask();
 }
 
 unsigned char ClientNode::getLayer() const {
@@ -2671,10 +2863,12 @@ bool ClientNode::isAeroSnapEnabled() const {
 
 void ClientNode::setActive() {
   this->status |= STAT_ACTIVE;
+  this->InvalidateTask();
 }
 
 void ClientNode::setNotActive() {
   this->status &= ~STAT_ACTIVE;
+  this->InvalidateTask();
 }
 
 void ClientNode::setMaxFlags(MaxFlags flags) {
@@ -2696,10 +2890,12 @@ void ClientNode::setSDesktopStatus() {
 
 void ClientNode::setMapped() {
   this->status |= STAT_MAPPED;
+  this->InvalidateTask();
 }
 
 void ClientNode::setCanFocus() {
   this->status |= STAT_CANFOCUS;
+  this->InvalidateTask();
 }
 
 void ClientNode::setUrgent() {
@@ -2708,14 +2904,17 @@ void ClientNode::setUrgent() {
 
 void ClientNode::setNoFlash() {
   this->status &= ~STAT_FLASH;
+  this->InvalidateTask();
 }
 
 void ClientNode::setShaded() {
   this->status |= STAT_SHADED;
+  this->InvalidateTask();
 }
 
 void ClientNode::setMinimized() {
   this->status |= STAT_MINIMIZED;
+  this->InvalidateTask();
 }
 
 void ClientNode::setNoPager() {
@@ -2732,22 +2931,27 @@ void ClientNode::setPositionFromConfig() {
 
 void ClientNode::setHasNoList() {
   this->status ^= STAT_NOLIST;
+  this->InvalidateTask();
 }
 
 void ClientNode::setNoShaded() {
   this->status &= ~STAT_SHADED;
+  this->InvalidateTask();
 }
 
 void ClientNode::setNoList() {
   this->status |= STAT_NOLIST;
+  this->InvalidateTask();
 }
 
 void ClientNode::setSticky() {
   this->status |= STAT_STICKY;
+  this->InvalidateTask();
 }
 
 void ClientNode::setNoSticky() {
   this->status &= ~STAT_STICKY;
+  this->InvalidateTask();
 }
 
 void ClientNode::setNoDrag() {
@@ -2756,6 +2960,7 @@ void ClientNode::setNoDrag() {
 
 void ClientNode::setNoMinimized() {
   this->status &= ~STAT_MINIMIZED;
+  this->InvalidateTask();
 }
 
 void ClientNode::setNoSDesktop() {
@@ -2764,6 +2969,7 @@ void ClientNode::setNoSDesktop() {
 
 void ClientNode::clearToNoList() {
   this->status &= ~STAT_NOLIST;
+  this->InvalidateTask();
 }
 
 void ClientNode::clearToNoPager() {
@@ -2772,10 +2978,12 @@ void ClientNode::clearToNoPager() {
 
 void ClientNode::resetMappedState() {
   this->status &= ~STAT_MAPPED;
+  this->InvalidateTask();
 }
 
 void ClientNode::clearToSticky() {
   this->status &= ~STAT_STICKY;
+  this->InvalidateTask();
 }
 
 void ClientNode::setEdgeSnap() {
@@ -2792,6 +3000,7 @@ void ClientNode::setFixed() {
 
 void ClientNode::setCurrentDesktop(unsigned int desktop) {
   this->desktop = desktop;
+  this->InvalidateTask();
 }
 
 void ClientNode::ignoreProgramList() {
@@ -2816,6 +3025,7 @@ void ClientNode::setCentered() {
 
 void ClientNode::setFlash() {
   this->status |= STAT_FLASH;
+  this->InvalidateTask();
 }
 
 void ClientNode::setTiled() {
@@ -2828,6 +3038,7 @@ void ClientNode::setNotUrgent() {
 
 void ClientNode::setTaskListSkipped() {
   this->status |= STAT_NOLIST;
+  this->InvalidateTask();
 }
 
 void ClientNode::setNoFocus() {
@@ -2980,14 +3191,17 @@ void ClientNode::unsetNoPager() {
 
 void ClientNode::unsetSkippingInTaskList() {
   this->status &= ~STAT_NOLIST;
+  this->InvalidateTask();
 }
 
 void ClientNode::setNotHidden() {
   this->status &= ~STAT_HIDDEN;
+  this->InvalidateTask();
 }
 
 void ClientNode::setHidden() {
   this->status |= STAT_HIDDEN;
+  this->InvalidateTask();
 }
 
 
@@ -3154,7 +3368,7 @@ void ClientNode::ResizeClient(MouseContextType context, int startx, int starty)
           this->SendConfigureEvent();
         }
 
-        Events::_RequirePagerUpdate();
+        Events::_RequirePagerUpdate(this);
 
       }
 
@@ -3328,7 +3542,7 @@ void ClientNode::ResizeClientKeyboard(MouseContextType context) {
         this->SendConfigureEvent();
       }
 
-      Events::_RequirePagerUpdate();
+      Events::_RequirePagerUpdate(this);
 
     }
 
@@ -3604,7 +3818,7 @@ char ClientNode::MoveClient(int startx, int starty) {
           this->SendConfigureEvent();
         }
         UpdateMoveWindow(this);
-        Events::_RequirePagerUpdate();
+        Events::_RequirePagerUpdate(this);
       }
 
       break;
@@ -3740,7 +3954,7 @@ char ClientNode::MoveClientKeyboard() {
       }
 
       UpdateMoveWindow(this);
-      Events::_RequirePagerUpdate();
+      Events::_RequirePagerUpdate(this);
 
     }
 
@@ -140,7 +140,8 @@ typedef struct Strut {
 class ClientNode {
 
 private:
-  ClientNode(Window w, char alreadyMapped, char notOwner);
+  ClientNode(Window w, char alreadyMapped, char notOwner,
+      const XWindowAttributes *attributes);
 
 protected:
   virtual ~ClientNode();
@@ -193,11 +194,13 @@ public:
   static char DoRemoveClientStrut(ClientNode *np);
   static void InsertStrut(const BoundingBox *box, ClientNode *np);
   static void RestackClients(void);
+  static void InvalidateStack(void);
   static void GetScreenBounds(const struct ScreenType *sp, BoundingBox *box);
   static void SubtractStrutBounds(BoundingBox *box, const ClientNode *np);
   static void SubtractTrayBounds(BoundingBox *box, unsigned int layer);
   static void SubtractBounds(const BoundingBox *src, BoundingBox *dest);
-  static ClientNode *Create(Window w, char alreadyMapped, char notOwner);
+  static ClientNode *Create(Window w, char alreadyMapped, char notOwner,
+      const XWindowAttributes *attributes = NULL);
   static ClientNode *FindClient(Window w); // by window or parent
   static ClientNode *FindClientByWindow(Window w);
   static ClientNode *FindClientByParent(Window p);
@@ -404,6 +407,8 @@ private:
   unsigned char layer; /**< Current window layer. */
   unsigned char defaultLayer; /**< Default window layer. */
 
+  void InvalidateTask();
+
 public:
 
   void resetMaxFlags();
@@ -549,6 +554,12 @@ private:
   static int *cascadeOffsets;
   static ClientNode *activeClient;
 
+  /** The stacking order last sent to the X server (top to bottom). */
+  static std::vector<Window> stackOrder;
+
+  static char ApplyStack(const std::vector<Window> &stack);
+  static void RemoveFromStack(Window w);
+
   static void LoadFocus(void);
   static void KillClientHandler(ClientNode *np);
 
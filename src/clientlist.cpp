@@ -170,6 +170,7 @@ void ClientList::WalkWindowStack(char forward) {
       }
       JXRaiseWindow(display,
           np->getParent() ? np->getParent() : np->getWindow());
+      ClientNode::InvalidateStack();
       np->keyboardFocus();
       break;
 
@@ -25,6 +25,54 @@
 
 std::vector<ClockType*> ClockType::clocks;
 
+/** Longest delay between clock checks.
+ * GetTimeDifference saturates at a minute, so callbacks can't wait longer.
+ */
+#define MAX_CLOCK_DELAY 60000
+
+/** Determine how often the text of a clock format can change.
+ * @param format The strftime format.
+ * @return The period in seconds.
+ */
+static int GetFormatPeriod(const char *format) {
+  int period = 15 * 60;
+  const char *p;
+
+  for (p = format; *p; p++) {
+    if (*p != '%') {
+      continue;
+    }
+
+    /* Skip flags, field widths, and the E and O modifiers. */
+    p += 1;
+    while (*p && strchr("_-0^#EO123456789", *p)) {
+      p += 1;
+    }
+
+    switch (*p) {
+    case 0:
+      return period;
+    case 'S': /* Seconds */
+    case 's':
+    case 'T':
+    case 'r':
+    case 'c':
+    case 'X':
+    case '+':
+      return 1;
+    case 'M': /* Minutes */
+    case 'R':
+      period = 60;
+      break;
+    default:
+      /* Hours or longer: use quarter hours so that time zones with
+       * half hour offsets still change on time. */
+      break;
+    }
+  }
+  return period;
+}
+
 /** Initialize clocks. */
 void ClockType::InitializeClock(void) {
 
@@ -62,6 +110,8 @@ ClockType::ClockType(const char *format, const char *zone, int width,
   this->format = CopyString(format);
   this->zone = CopyString(zone);
   memset(&this->lastTime, 0, sizeof(this->lastTime));
+  this->period = GetFormatPeriod(this->format);
+  this->deadline = 0;
 
   if (width > 0) {
     this->requestedWidth = width;
@@ -113,6 +163,7 @@ void ClockType::Resize() {
 void ClockType::Draw() {
   TimeType now;
   GetCurrentTime(&now);
+  this->text.clear();
   this->DrawClock(&now);
 }
 
@@ -136,6 +187,9 @@ void ClockType::ProcessMotionEvent(int x, int y, int mask) {
   clk->mousex = this->getScreenX() + x;
   clk->mousey = this->getScreenY() + y;
   GetCurrentTime(&clk->mouseTime);
+
+  /* Check for a popup sooner than the next change of the time. */
+  clk->ScheduleClock(&clk->mouseTime, 1);
 }
 
 /** Update a clock tray component. */
@@ -143,17 +197,47 @@ void ClockType::SignalClock(const TimeType *now, int x, int y, Window w,
     void *data) {
   const char *longTime;
   ClockType *clk = (ClockType*) data;
+  char hover;
+
+  /* A deadline more than a period away means the clock was set back. */
+  if (now->seconds >= clk->deadline
+      || clk->deadline > now->seconds + clk->period) {
+    clk->DrawClock(now);
+    clk->deadline = (now->seconds / clk->period + 1) * clk->period;
+  }
 
-  clk->DrawClock(now);
+  hover = 0;
   if (clk->getTray()->getWindow() == w
       && abs(clk->mousex - x) < settings.doubleClickDelta
       && abs(clk->mousey - y) < settings.doubleClickDelta) {
+    hover = 1;
     if (GetTimeDifference(now, &clk->mouseTime) >= settings.popupDelay) {
       longTime = GetTimeString("%c", clk->zone);
       Popups::ShowPopup(x, y, longTime, POPUP_CLOCK);
     }
   }
 
+  clk->ScheduleClock(now, hover);
+
+}
+
+/** Schedule the next clock update.
+ * The clock wakes up when its text can next change or, while the mouse
+ * is over it, often enough to show the popup.
+ */
+void ClockType::ScheduleClock(const TimeType *now, char hover) {
+  long delay;
+
+  if (this->deadline > now->seconds) {
+    delay = (long) (this->deadline - now->seconds) * 1000 - now->ms;
+  } else {
+    delay = 0;
+  }
+  delay = Min(delay, MAX_CLOCK_DELAY);
+  if (hover) {
+    delay = Min(delay, settings.popupDelay / 2);
+  }
+  Events::_RescheduleCallback(SignalClock, this, Max(delay, 1));
 }
 
 void ClockType::Draw(Graphics *g) {
@@ -166,11 +250,16 @@ void ClockType::DrawClock(const TimeType *now) {
   int strWidth;
   int rwidth;
 
+  /* Nothing to do if the text hasn't changed. */
+  timeString = GetTimeString(this->format, this->zone);
+  if (this->text == timeString) {
+    return;
+  }
+
   graphics->setForeground(COLOR_MENU_BG);
   graphics->fillRectangle(0, 0, this->getWidth(), this->getHeight());
   // clear area
 //  /* Determine if the clock is the right size. */
-  timeString = GetTimeString(this->format, this->zone);
   strWidth = Fonts::GetStringWidth(FONT_CLOCK, timeString)+4;
 //
 
@@ -183,8 +272,7 @@ void ClockType::DrawClock(const TimeType *now) {
         (this->getWidth() - strWidth) / 2,
         (this->getHeight() - Fonts::GetStringHeight(FONT_CLOCK)) / 2,
         this->getWidth(), timeString);
-
-    this->UpdateSpecificTray(this->getTray());
+    this->text = timeString;
   } else {
     //Warning(_("Requesting the tray to give us a better size"));
     this->requestNewSize(strWidth, this->getRequestedHeight());
@@ -192,8 +280,7 @@ void ClockType::DrawClock(const TimeType *now) {
   }
   this->graphics->setForeground(COLOR_MENU_ACTIVE_BG1);
   this->graphics->drawRectangle(0, 0, this->getWidth()-1, this->getHeight()-1);
-  graphics->copy(this->getTray()->getWindow(), 0, 0, this->getWidth(), this->getHeight(),
-      this->getX(), this->getY());
+  this->UpdateSpecificTray(this->getTray());
 
 }
 
@@ -10,6 +10,8 @@
 #ifndef CLOCK_H
 #define CLOCK_H
 
+#include <string>
+
 #include "timing.h"
 #include "TrayComponent.h"
 
@@ -25,6 +27,9 @@ private:
   char *zone; /**< The time zone to use (NULL = local). */
   //struct ActionNode *actions; /**< Actions */
   TimeType lastTime; /**< Currently displayed time. */
+  std::string text; /**< Currently displayed text. */
+  int period; /**< Seconds between possible changes of the text. */
+  unsigned long deadline; /**< Time of the next possible change. */
 
   /* The following are used to control popups. */
   int mousex; /**< Last mouse x-coordinate. */
@@ -51,6 +56,7 @@ public:
   virtual void Draw();
 
   void DrawClock(const TimeType *now);
+  void ScheduleClock(const TimeType *now, char hover);
 
   static void SignalClock(const struct TimeType *now, int x, int y, Window w, void *data);
 
@@ -13,17 +13,36 @@
 #include "main.h"
 #include "error.h"
 #include "timing.h"
+#include "event.h"
+#include "logger.h"
 
+#include <algorithm>
 #include <vector>
+#include <errno.h>
 #include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+
+/** Characters that need the shell to run a command. */
+static const char SHELL_CHARACTERS[] = "|&;<>()$`\\\"'*?[]#~={}!\n";
 
 std::vector<char*> Commands::startupCommands;
 std::vector<char*> Commands::shutdownCommands;
 std::vector<char*> Commands::restartCommands;
 std::vector<pid_t> Commands::pids;
+int Commands::childFds[2] = { -1, -1 };
+volatile sig_atomic_t Commands::reaping = 0;
 
 /** Process startup/restart commands. */
 void Commands::StartupCommands(void) {
+
+  /* Reap children from the event loop. */
+  if (childFds[0] >= 0) {
+    Events::_RegisterDescriptor(childFds[0], HandleChildren, NULL);
+    reaping = 1;
+    HandleChildren(childFds[0], NULL);
+  }
+
   if (isRestarting) {
     RunCommands(restartCommands);
   } else {
@@ -38,6 +57,12 @@ void Commands::ShutdownCommands(void) {
     RunCommands(shutdownCommands);
   }
 
+  if (reaping) {
+    reaping = 0;
+    Events::_UnregisterDescriptor(childFds[0]);
+    HandleChildren(childFds[0], NULL);
+  }
+
   for (auto pid : pids) {
     int ret = kill(pid, SIGKILL);
     char buf[80];
@@ -53,16 +78,65 @@ void Commands::DestroyCommands(void) {
   ReleaseCommands(startupCommands);
   ReleaseCommands(shutdownCommands);
   ReleaseCommands(restartCommands);
+  if (childFds[0] >= 0) {
+    close(childFds[0]);
+    close(childFds[1]);
+    childFds[0] = -1;
+    childFds[1] = -1;
+  }
 }
 
+/** Initialize the command lists and the child notification pipe. */
 void Commands::InitializeCommands() {
+  int i;
+
+  /* Children inherit the display we are using. */
+  if (display) {
+    setenv("DISPLAY", DisplayString(display), 1);
+  }
+
+  if (childFds[0] < 0 && pipe(childFds) == 0) {
+    for (i = 0; i < 2; i++) {
+      fcntl(childFds[i], F_SETFD, FD_CLOEXEC);
+      fcntl(childFds[i], F_SETFL, O_NONBLOCK);
+    }
+  }
+}
+
+/** Note that a child exited. */
+char Commands::NotifyChild(void) {
+  const int savedErrno = errno;
+  const char c = 0;
+  ssize_t rc;
+  if (!reaping) {
+    return 0;
+  }
+  /* If the pipe is full the event loop is already awake. */
+  rc = write(childFds[1], &c, 1);
+  (void) rc;
+  errno = savedErrno;
+  return 1;
+}
+
+/** Reap children that exited. */
+void Commands::HandleChildren(int fd, void *data) {
+  char buffer[64];
+  pid_t pid;
 
+  while (read(fd, buffer, sizeof(buffer)) > 0) {
+  }
+  while ((pid = waitpid((pid_t) -1, NULL, WNOHANG)) > 0) {
+    std::vector<pid_t>::iterator it = std::find(pids.begin(), pids.end(), pid);
+    if (it != pids.end()) {
+      pids.erase(it);
+    }
+  }
 }
 
 /** Run the commands in a command list. */
-void Commands::RunCommands(std::vector<char*> commands) {
+void Commands::RunCommands(const std::vector<char*> &commands) {
 
-  std::vector<char*>::iterator it;
+  std::vector<char*>::const_iterator it;
   for (it = commands.begin(); it != commands.end(); ++it) {
     Commands::RunCommand((*it));
   }
@@ -70,15 +144,15 @@ void Commands::RunCommands(std::vector<char*> commands) {
 }
 
 /** Release a command list. */
-void Commands::ReleaseCommands(std::vector<char*> commands) {
+void Commands::ReleaseCommands(std::vector<char*> &commands) {
   for (auto command : commands) {
-    Release(command);
+    free(command);
   }
   commands.clear();
 }
 
 /** Add a command to a command list. */
-void Commands::AddCommand(std::vector<char*> commands, const char *command) {
+void Commands::AddCommand(std::vector<char*> &commands, const char *command) {
   commands.push_back(strdup(command));
 }
 
@@ -97,38 +171,112 @@ void Commands::AddRestartCommand(const char *command) {
   AddCommand(restartCommands, command);
 }
 
+/** Split a command into words if it can run without the shell.
+ * @return 1 if the command was split, 0 if it needs the shell.
+ */
+char Commands::SplitCommand(const char *command,
+    std::vector<std::string> *words) {
+  const char *start;
+
+  if (strpbrk(command, SHELL_CHARACTERS)) {
+    return 0;
+  }
+  for (;;) {
+    while (*command == ' ' || *command == '\t') {
+      command += 1;
+    }
+    if (!*command) {
+      break;
+    }
+    start = command;
+    while (*command && *command != ' ' && *command != '\t') {
+      command += 1;
+    }
+    words->push_back(std::string(start, command - start));
+  }
+  return !words->empty();
+}
+
+/** Start a process without copying the window manager.
+ * Commands without shell syntax are executed directly.
+ * @param command The command to run.
+ * @param output Descriptor to use for standard output or -1 to inherit it.
+ * @return The process ID or -1 on error.
+ */
+pid_t Commands::Spawn(const char *command, int output) {
+  std::vector<std::string> words;
+  std::vector<char*> argv;
+  std::vector<std::string>::iterator it;
+  posix_spawn_file_actions_t actions;
+  posix_spawnattr_t attr;
+  sigset_t mask;
+  short flags;
+  pid_t pid;
+  int rc;
+
+  if (SplitCommand(command, &words)) {
+    for (it = words.begin(); it != words.end(); ++it) {
+      argv.push_back(&(*it)[0]);
+    }
+  } else {
+    argv.push_back((char*) SHELL_NAME);
+    argv.push_back((char*) "-c");
+    argv.push_back((char*) command);
+  }
+  argv.push_back(NULL);
+
+  /* Start a new session with no blocked signals. */
+  posix_spawnattr_init(&attr);
+  flags = POSIX_SPAWN_SETSIGMASK;
+#ifdef POSIX_SPAWN_SETSID
+  flags |= POSIX_SPAWN_SETSID;
+#else
+  flags |= POSIX_SPAWN_SETPGROUP;
+  posix_spawnattr_setpgroup(&attr, 0);
+#endif
+  posix_spawnattr_setflags(&attr, flags);
+  sigemptyset(&mask);
+  posix_spawnattr_setsigmask(&attr, &mask);
+
+  posix_spawn_file_actions_init(&actions);
+  if (display) {
+    posix_spawn_file_actions_addclose(&actions, ConnectionNumber(display));
+  }
+  if (output >= 0) {
+    posix_spawn_file_actions_adddup2(&actions, output, 1);
+  }
+
+  if (words.empty()) {
+    rc = posix_spawn(&pid, SHELL_NAME, &actions, &attr, &argv[0], environ);
+  } else {
+    rc = posix_spawnp(&pid, argv[0], &actions, &attr, &argv[0], environ);
+  }
+  posix_spawn_file_actions_destroy(&actions);
+  posix_spawnattr_destroy(&attr);
+
+  if (JUNLIKELY(rc != 0)) {
+    Warning(_("exec failed: (%s) %s"), argv[0], strerror(rc));
+    return -1;
+  }
+  return pid;
+}
+
 /** Execute an external program. */
 void Commands::RunCommand(const char *command) {
 
-  const char *displayString;
+  pid_t pid;
 
   if (JUNLIKELY(!command)) {
     return;
   }
 
-  displayString = DisplayString(display);
-  pid_t pid = fork();
-  if (!pid) {
-    close(ConnectionNumber(display));
-    if (displayString && displayString[0]) {
-      const size_t var_len = strlen(displayString) + 9;
-      char *str = (char*) malloc(var_len);
-      snprintf(str, var_len, "DISPLAY=%s", displayString);
-      putenv(str);
-    }
-    setsid();
-    execl(SHELL_NAME, SHELL_NAME, "-c", command, NULL);
-    Warning(_("exec failed: (%s) %s"), SHELL_NAME, command);
-    exit(EXIT_SUCCESS);
-  } else if (pid != -1) {
+  pid = Spawn(command, -1);
+  if (pid != -1) {
     //store pid
     char buf[80];
     sprintf(buf, "\nLaunched pid=%d\n", pid);
     Logger::Log(buf);
     pids.push_back(pid);
-  } else {
-    //error
-    Log("Could not fork process");
   }
 
 }
@@ -136,6 +284,9 @@ void Commands::RunCommand(const char *command) {
 /** Reads the output of an exernal program. */
 char* Commands::ReadFromProcess(const char *command, unsigned timeout_ms) {
   const unsigned BLOCK_SIZE = 256;
+  char *buffer;
+  unsigned buffer_size, max_size;
+  TimeType start_time, current_time;
   pid_t pid;
   int fds[2];
 
@@ -143,85 +294,76 @@ char* Commands::ReadFromProcess(const char *command, unsigned timeout_ms) {
     Warning(_("could not create pipe"));
     return NULL;
   }
+  fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+  fcntl(fds[1], F_SETFD, FD_CLOEXEC);
   if (fcntl(fds[0], F_SETFL, O_NONBLOCK) == -1) {
     /* We don't return here since we can still process the output
      * of the command, but the timeout won't work. */
     Warning(_("could not set O_NONBLOCK"));
   }
 
-  pid = fork();
-  if (pid == 0) {
-    /* The child process. */
-    close(ConnectionNumber(display));
+  pid = Spawn(command, fds[1]);
+  close(fds[1]);
+  if (pid == -1) {
     close(fds[0]);
-    dup2(fds[1], 1); /* stdout */
-    setsid();
-    execl("/bin/sh", "/bin/sh", "-c", command, NULL);
-    Warning(_("exec failed: (%s) %s"), SHELL_NAME, command);
-    exit(EXIT_SUCCESS);
-  } else if (pid > 0) {
-    char *buffer;
-    unsigned buffer_size, max_size;
-    TimeType start_time, current_time;
-
-    max_size = BLOCK_SIZE;
-    buffer_size = 0;
-    buffer = new char[max_size];
-
-    GetCurrentTime(&start_time);
-    for (;;) {
-      struct timeval tv;
-      unsigned long diff_ms;
-      fd_set fs;
-      int rc;
-
-      /* Make sure we have room to read. */
-      if (buffer_size + BLOCK_SIZE > max_size) {
-        max_size *= 2;
-        buffer = (char*) Reallocate(buffer, max_size);
-      }
+    return NULL;
+  }
+
+  max_size = BLOCK_SIZE;
+  buffer_size = 0;
+  buffer = new char[max_size];
+
+  GetCurrentTime(&start_time);
+  for (;;) {
+    struct timeval tv;
+    unsigned long diff_ms;
+    fd_set fs;
+    int rc;
+
+    /* Make sure we have room to read. */
+    if (buffer_size + BLOCK_SIZE > max_size) {
+      max_size *= 2;
+      buffer = (char*) Reallocate(buffer, max_size);
+    }
 
-      FD_ZERO(&fs);
-      FD_SET(fds[0], &fs);
-
-      /* Determine the max time to sit in select. */
-      GetCurrentTime(&current_time);
-      diff_ms = GetTimeDifference(&start_time, &current_time);
-      diff_ms = timeout_ms > diff_ms ? (timeout_ms - diff_ms) : 0;
-      tv.tv_sec = diff_ms / 1000;
-      tv.tv_usec = (diff_ms % 1000) * 1000;
-
-      /* Wait for data (or a timeout). */
-      rc = select(fds[0] + 1, &fs, NULL, &fs, &tv);
-      if (rc == 0) {
-        /* Timeout */
-        Warning(_("timeout: %s did not complete in %u milliseconds"), command,
-            timeout_ms);
-        kill(pid, SIGKILL);
+    FD_ZERO(&fs);
+    FD_SET(fds[0], &fs);
+
+    /* Determine the max time to sit in select. */
+    GetCurrentTime(&current_time);
+    diff_ms = GetTimeDifference(&start_time, &current_time);
+    diff_ms = timeout_ms > diff_ms ? (timeout_ms - diff_ms) : 0;
+    tv.tv_sec = diff_ms / 1000;
+    tv.tv_usec = (diff_ms % 1000) * 1000;
+
+    /* Wait for data (or a timeout). */
+    rc = select(fds[0] + 1, &fs, NULL, NULL, &tv);
+    if (rc == 0) {
+      /* Timeout */
+      Warning(_("timeout: %s did not complete in %u milliseconds"), command,
+          timeout_ms);
+      kill(pid, SIGKILL);
+      if (!reaping) {
         waitpid(pid, NULL, 0);
-        break;
       }
-
-      rc = read(fds[0], &buffer[buffer_size], BLOCK_SIZE);
-      if (rc > 0) {
-        buffer_size += rc;
-      } else {
-        /* Process exited, check for any leftovers and return. */
-        do {
-          if (buffer_size + BLOCK_SIZE > max_size) {
-            max_size *= 2;
-            buffer = (char*) Reallocate(buffer, max_size);
-          }
-          rc = read(fds[0], &buffer[buffer_size], BLOCK_SIZE);
-          buffer_size += (rc > 0) ? rc : 0;
-        } while (rc > 0);
-        break;
+      break;
+    } else if (rc < 0) {
+      if (errno == EINTR) {
+        continue;
       }
+      break;
+    }
+
+    /* Read until the process closes its output. */
+    rc = read(fds[0], &buffer[buffer_size], BLOCK_SIZE);
+    if (rc > 0) {
+      buffer_size += rc;
+    } else if (rc == 0 || (errno != EAGAIN && errno != EINTR)) {
+      break;
     }
-    close(fds[1]);
-    buffer[buffer_size] = 0;
-    return buffer;
   }
+  close(fds[0]);
 
-  return NULL;
+  buffer[buffer_size] = 0;
+  return buffer;
 }
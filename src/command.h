@@ -10,6 +10,10 @@
 #ifndef COMMAND_H
 #define COMMAND_H
 
+#include <signal.h>
+#include <string>
+#include <vector>
+
 class Commands {
 public:
 	/*@{*/
@@ -46,15 +50,26 @@ public:
 	 */
 	static char *ReadFromProcess(const char *command, unsigned timeout_ms);
 
+	/** Note that a child exited (called from the SIGCHLD handler).
+	 * Children are reaped by the event loop once it is running.
+	 * @return 1 if the event loop will reap the child, 0 otherwise.
+	 */
+	static char NotifyChild(void);
+
 private:
 	static std::vector<char*> startupCommands;
 	static std::vector<char*> shutdownCommands;
 	static std::vector<char*> restartCommands;
 	static std::vector<pid_t> pids;
+	static int childFds[2];
+	static volatile sig_atomic_t reaping;
 
-	static void RunCommands(std::vector<char*> commands);
-	static void ReleaseCommands(std::vector<char*> commands);
-	static void AddCommand(std::vector<char*> commands, const char *command);
+	static void RunCommands(const std::vector<char*> &commands);
+	static void ReleaseCommands(std::vector<char*> &commands);
+	static void AddCommand(std::vector<char*> &commands, const char *command);
+	static pid_t Spawn(const char *command, int output);
+	static char SplitCommand(const char *command, std::vector<std::string> *words);
+	static void HandleChildren(int fd, void *data);
 };
 
 #endif /* COMMAND_H */
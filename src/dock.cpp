@@ -364,8 +364,10 @@ void DockType::_DockWindow(Window win) {
   JXReparentWindow(display, win, dock->getWindow(), 0, 0);
   JXMapRaised(display, win);
 
-  /* Resize the tray containing the dock. */
+  /* Resize the tray containing the dock.
+   * The dock size may not change, so position the icons here too. */
   dock->getTray()->ResizeTray();
+  _UpdateDock();
 
 }
 
@@ -394,6 +396,7 @@ char DockType::_HandleDockDestroy(Window win) {
 
       /* Resize the tray. */
       dock->getTray()->ResizeTray();
+      _UpdateDock();
 
       return 1;
     }
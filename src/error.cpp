@@ -11,6 +11,9 @@
 #include "error.h"
 #include "main.h"
 
+/** Number of warnings displayed. */
+static unsigned warningCount = 0;
+
 /** Log a fatal error and exit. */
 void FatalError(const char *str, ...) {
 
@@ -48,6 +51,7 @@ void WarningVA(const char *part, const char *str, va_list ap) {
 
    Assert(str);
 
+   warningCount += 1;
    fprintf(stderr, _("JWM: warning: "));
    if(part) {
       fprintf(stderr, "%s: ", part);
@@ -57,6 +61,11 @@ void WarningVA(const char *part, const char *str, va_list ap) {
 
 }
 
+/** Get the number of warnings displayed so far. */
+unsigned GetWarningCount(void) {
+   return warningCount;
+}
+
 /** Callback to handle errors from Xlib.
  * Note that if debug output is directed to an X terminal, emitting too
  * much output can cause a dead lock (this happens on HP-UX). Therefore
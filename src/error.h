@@ -27,6 +27,11 @@ void Warning(const char *str, ...);
  */
 void WarningVA(const char *part, const char *str, va_list ap);
 
+/** Get the number of warnings displayed so far.
+ * @return The number of warnings.
+ */
+unsigned GetWarningCount(void);
+
 /** Handle an XError event.
  * @param d The display on which the event occurred.
  * @param e The error event.
@@ -31,6 +31,7 @@
 #include "action.h"
 #include "binding.h"
 #include "pager.h"
+#include "thumbnail.h"
 #include "DesktopEnvironment.h"
 #include "LogWindow.h"
 #include "Flex.h"
@@ -40,6 +41,7 @@
 Time Events::eventTime = CurrentTime;
 
 std::vector<CallbackNode*> Events::callbacks;
+std::vector<DescriptorNode> Events::descriptors;
 
 char Events::restack_pending = 0;
 char Events::task_update_pending = 0;
@@ -49,6 +51,7 @@ char Events::pager_update_pending = 0;
 char Events::_WaitForEvent(XEvent *event) {
   struct timeval timeout;
   CallbackNode *cp;
+  TimeType now;
   fd_set fds;
   long sleepTime;
   int fd;
@@ -60,23 +63,39 @@ char Events::_WaitForEvent(XEvent *event) {
   fd = JXConnectionNumber(display);
 #endif
 
-  /* Compute how long we should sleep. */
+  /* Compute how long we should sleep (until the next callback is due). */
   sleepTime = 10 * 1000; /* 10 seconds. */
+  GetCurrentTime(&now);
   for (auto cp : callbacks) {
-    if (cp->freq > 0 && cp->freq < sleepTime) {
-      sleepTime = cp->freq;
+    if (cp->freq > 0) {
+      long remaining = cp->freq - (long) GetTimeDifference(&now, &cp->last);
+      if (remaining < MIN_TIME_DELTA) {
+        remaining = MIN_TIME_DELTA;
+      }
+      if (remaining < sleepTime) {
+        sleepTime = remaining;
+      }
     }
   }
 
   do {
 
     while (JXPending(display) == 0) {
+      int maxfd = fd;
       FD_ZERO(&fds);
       FD_SET(fd, &fds);
+      for (auto &dn : descriptors) {
+        FD_SET(dn.fd, &fds);
+        if (dn.fd > maxfd) {
+          maxfd = dn.fd;
+        }
+      }
       timeout.tv_sec = sleepTime / 1000;
       timeout.tv_usec = (sleepTime % 1000) * 1000;
-      if (select(fd + 1, &fds, NULL, NULL, &timeout) <= 0) {
+      if (select(maxfd + 1, &fds, NULL, NULL, &timeout) <= 0) {
         _Signal();
+      } else if (!descriptors.empty()) {
+        _HandleDescriptors(&fds);
       }
       if (JUNLIKELY(shouldExit)) {
         return 0;
@@ -200,6 +219,11 @@ char Events::_WaitForEvent(XEvent *event) {
       } else if (haveShape && event->type == shapeEvent) {
         _HandleShapeEvent((XShapeEvent*) event);
         handled = 1;
+#endif
+#ifdef USE_XDAMAGE
+      } else if (haveDamage && event->type == damageEvent + XDamageNotify) {
+        Thumbnails::HandleDamageEvent((XDamageNotifyEvent*) event);
+        handled = 1;
 #endif
       } else {
         handled = 0;
@@ -265,6 +289,9 @@ void Events::_Signal(void) {
 
   Cursors::GetMousePosition(&x, &y, &w);
   for (auto cp : callbacks) {
+    if (cp->freq < 0) {
+      continue;
+    }
     if (cp->freq == 0 || GetTimeDifference(&now, &cp->last) >= cp->freq) {
       cp->last = now;
       (cp->callback)(&now, x, y, w, cp->data);
@@ -828,7 +855,7 @@ void Events::_HandleConfigureRequest(const XConfigureRequestEvent *event) {
       }
     }
 
-    _RequirePagerUpdate();
+    _RequirePagerUpdate(np);
 
   } else {
 
@@ -889,9 +916,7 @@ char Events::_HandleExpose(const XExposeEvent *event) {
   ClientNode *np;
   np = ClientNode::FindClientByParent(event->window);
   if (np) {
-    if (event->count == 0) {
-      Border::DrawBorder(np);
-    }
+    Border::ExposeBorder(np, event);
     return 1;
   } else {
     np = ClientNode::FindClientByWindow(event->window);
@@ -975,8 +1000,8 @@ char Events::_HandlePropertyNotify(const XPropertyEvent *event) {
 
     if (changed) {
       Border::DrawBorder(np);
-      _RequireTaskUpdate();
-      _RequirePagerUpdate();
+      _RequireTaskUpdate(np);
+      _RequirePagerUpdate(np);
     }
     if (np->isDialogWindow()) {
       return 0;
@@ -1194,7 +1219,7 @@ void Events::_HandleNetMoveResize(const XClientMessageEvent *event,
   np->ConstrainSize();
   Border::ResetBorder(np);
   np->SendConfigureEvent();
-  _RequirePagerUpdate();
+  _RequirePagerUpdate(np);
 
 }
 
@@ -1342,7 +1367,7 @@ void Events::_HandleNetWMState(const XClientMessageEvent *event,
     }
     if (actionNolist && !(np->shouldIgnoreSpecifiedList())) {
       np->clearToNoList();
-      _RequireTaskUpdate();
+      _RequireTaskUpdate(np);
     }
     if (actionNopager && !(np->shouldIgnorePager())) {
       np->clearToNoPager();
@@ -1373,7 +1398,7 @@ void Events::_HandleNetWMState(const XClientMessageEvent *event,
     }
     if (actionNolist && !(np->shouldIgnoreSpecifiedList())) {
       np->setNoList();
-      _RequireTaskUpdate();
+      _RequireTaskUpdate(np);
     }
     if (actionNopager && !(np->shouldIgnorePager())) {
       np->setNoPager();
@@ -1429,7 +1454,7 @@ void Events::_HandleNetWMState(const XClientMessageEvent *event,
      * recommendations. */
     if (actionNolist && !(np->shouldIgnoreSpecifiedList())) {
       np->setHasNoList();
-      _RequireTaskUpdate();
+      _RequireTaskUpdate(np);
     }
     if (actionNopager && !(np->shouldIgnorePager())) {
       np->setNoPager();
@@ -1673,6 +1698,56 @@ void Events::_UnregisterCallback(SignalCallback callback, void *data) {
 
 }
 
+/** Change when a callback next runs. */
+void Events::_RescheduleCallback(SignalCallback callback, void *data,
+    int delay) {
+  for (auto cp : callbacks) {
+    if (cp->callback == callback && cp->data == data) {
+      GetCurrentTime(&cp->last);
+      cp->freq = delay;
+      return;
+    }
+  }
+}
+
+/** Watch a file descriptor. */
+void Events::_RegisterDescriptor(int fd, DescriptorCallback callback,
+    void *data) {
+  DescriptorNode dn;
+  dn.fd = fd;
+  dn.callback = callback;
+  dn.data = data;
+  descriptors.push_back(dn);
+}
+
+/** Stop watching a file descriptor. */
+void Events::_UnregisterDescriptor(int fd) {
+  std::vector<DescriptorNode>::iterator it;
+  for (it = descriptors.begin(); it != descriptors.end(); ++it) {
+    if (it->fd == fd) {
+      descriptors.erase(it);
+      return;
+    }
+  }
+}
+
+/** Run the callbacks of readable descriptors. */
+void Events::_HandleDescriptors(const fd_set *fds) {
+  /* Callbacks may register or unregister descriptors. */
+  const std::vector<DescriptorNode> ready = descriptors;
+  for (auto &dn : ready) {
+    if (!FD_ISSET(dn.fd, fds)) {
+      continue;
+    }
+    for (auto &current : descriptors) {
+      if (current.fd == dn.fd && current.callback == dn.callback) {
+        (dn.callback)(dn.fd, dn.data);
+        break;
+      }
+    }
+  }
+}
+
 /** Restack clients before waiting for an event. */
 void Events::_RequireRestack() {
   restack_pending = 1;
@@ -1680,10 +1755,24 @@ void Events::_RequireRestack() {
 
 /** Update the task bar before waiting for an event. */
 void Events::_RequireTaskUpdate() {
+  TaskBar::InvalidateEntries();
+  task_update_pending = 1;
+}
+
+/** Update the task bar entry of a client before waiting for an event. */
+void Events::_RequireTaskUpdate(const ClientNode *np) {
+  TaskBar::InvalidateClient(np);
   task_update_pending = 1;
 }
 
 /** Update the pager before waiting for an event. */
 void Events::_RequirePagerUpdate() {
+  PagerType::InvalidatePager();
+  pager_update_pending = 1;
+}
+
+/** Update a client on the pager before waiting for an event. */
+void Events::_RequirePagerUpdate(const ClientNode *np) {
+  PagerType::InvalidateClient(np);
   pager_update_pending = 1;
 }
@@ -29,6 +29,15 @@ typedef struct CallbackNode {
   struct CallbackNode *next;
 } CallbackNode;
 
+typedef void (*DescriptorCallback)(int fd, void *data);
+
+/** A file descriptor watched by the event loop. */
+typedef struct DescriptorNode {
+  int fd;
+  DescriptorCallback callback;
+  void *data;
+} DescriptorNode;
+
 class Events {
 public:
 
@@ -78,23 +87,63 @@ public:
    */
   static void _UnregisterCallback(SignalCallback callback, void *data);
 
+  /** Change when a callback next runs.
+   * This may be called from the callback itself.
+   * @param callback The callback.
+   * @param data The data passed to the register function.
+   * @param delay Milliseconds from now until the callback runs (and the
+   *        new frequency), or -1 to suspend the callback.
+   */
+  static void _RescheduleCallback(SignalCallback callback, void *data,
+      int delay);
+
+  /** Watch a file descriptor.
+   * The callback runs from the event loop whenever the descriptor is
+   * readable, so it must not block.
+   * @param fd The descriptor.
+   * @param callback The callback function.
+   * @param data Data to pass to the callback.
+   */
+  static void _RegisterDescriptor(int fd, DescriptorCallback callback,
+      void *data);
+
+  /** Stop watching a file descriptor.
+   * @param fd The descriptor.
+   */
+  static void _UnregisterDescriptor(int fd);
+
   /** Restack clients before waiting for an event. */
   static void _RequireRestack();
 
   /** Update the task bar before waiting for an event. */
   static void _RequireTaskUpdate();
 
+  /** Update the task bar entry of a client before waiting for an event.
+   * Use this instead of _RequireTaskUpdate() when only one client changed.
+   * @param np The client.
+   */
+  static void _RequireTaskUpdate(const ClientNode *np);
+
   /** Update the pager before waiting for an event. */
   static void _RequirePagerUpdate();
 
+  /** Update a client on the pager before waiting for an event.
+   * Use this instead of _RequirePagerUpdate() when only one client moved,
+   * resized, or changed state.
+   * @param np The client.
+   */
+  static void _RequirePagerUpdate(const ClientNode *np);
+
 private:
 
   static std::vector<CallbackNode*> callbacks;
+  static std::vector<DescriptorNode> descriptors;
   static char restack_pending;
   static char task_update_pending;
   static char pager_update_pending;
 
   static void _Signal(void);
+  static void _HandleDescriptors(const fd_set *fds);
 
   static void _ProcessBinding(MouseContextType context, ClientNode *np,
       unsigned state, int code, int x, int y);
@@ -12,6 +12,7 @@
 #include "main.h"
 #include "error.h"
 #include "misc.h"
+#include "Graphics.h"
 
 #ifdef USE_ICONV
 #  ifdef HAVE_LANGINFO_H
@@ -77,6 +78,13 @@ void Fonts::InitializeFonts(void) {
 
 }
 
+/** Load the font configuration and caches. */
+void Fonts::PrepareFonts(void) {
+#ifdef USE_XFT
+	XftInit(NULL);
+#endif
+}
+
 /** Startup font support. */
 void Fonts::StartupFonts(void) {
 
@@ -324,8 +332,6 @@ void Fonts::RenderString(Drawable d, FontType font, ColorName color, int x,
 	XftDraw *xd;
 	XGlyphInfo extents;
 #else
-   XGCValues gcValues;
-   unsigned long gcMask;
    GC gc;
 #endif
 	char *utf8String;
@@ -344,9 +350,7 @@ void Fonts::RenderString(Drawable d, FontType font, ColorName color, int x,
 #ifdef USE_XFT
 	xd = XftDrawCreate(display, d, rootVisual, rootColormap);
 #else
-   gcMask = GCGraphicsExposures;
-   gcValues.graphics_exposures = False;
-   gc = JXCreateGC(display, d, gcMask, &gcValues);
+   gc = Graphics::AcquireGC(rootDepth);
 #endif
 
 	/* Apply the bidi algorithm if requested. */
@@ -407,7 +411,8 @@ void Fonts::RenderString(Drawable d, FontType font, ColorName color, int x,
 #ifdef USE_XFT
 	XftDrawDestroy(xd);
 #else
-   JXFreeGC(display, gc);
+   JXSetClipMask(display, gc, None);
+   Graphics::ReleaseGC(gc);
 #endif
 
 }
@@ -31,6 +31,11 @@ public:
 	static void InitializeFonts(void);
 	static void StartupFonts(void);
 	static void ShutdownFonts(void);
+
+	/** Load the font configuration ahead of StartupFonts.
+	 * This does not use the X connection, so it can run on another thread.
+	 */
+	static void PrepareFonts(void);
 	static void DestroyFonts(void);
 
 	/** Set the font to use for a component.
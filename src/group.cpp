@@ -16,15 +16,34 @@
 #include "settings.h"
 
 #include <regex.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
 
 /** What part of the window to match. */
 typedef unsigned int MatchType;
 #define MATCH_NAME   0  /**< Match the window name. */
 #define MATCH_CLASS  1  /**< Match the window class. */
 
+/** How a pattern is evaluated.
+ * Patterns without regular expression operators are compared directly
+ * instead of going through regexec.
+ */
+typedef unsigned char PatternKind;
+#define PATTERN_REGEX     0  /**< Compiled regular expression. */
+#define PATTERN_INVALID   1  /**< Regular expression that failed to compile. */
+#define PATTERN_EXACT     2  /**< "^literal$": exact comparison. */
+#define PATTERN_PREFIX    3  /**< "^literal": prefix comparison. */
+#define PATTERN_SUBSTRING 4  /**< "literal": substring search. */
+
 /** List of match patterns for a group. */
 typedef struct PatternListType {
 	char *pattern;
+	char *literal; /**< The literal text for non-regex patterns. */
+	size_t literalLength;
+	regex_t re; /**< The compiled pattern for PATTERN_REGEX. */
+	PatternKind kind;
 	MatchType match;
 	struct PatternListType *next;
 } PatternListType;
@@ -44,19 +63,38 @@ typedef struct OptionListType {
 typedef struct GroupType {
 	PatternListType *patterns;
 	OptionListType *options;
+	unsigned int order; /**< Position in the group list (set by the index). */
 	struct GroupType *next;
 } GroupType;
 
+typedef std::vector<GroupType*> GroupVector;
+typedef std::unordered_map<std::string, GroupVector> GroupIndex;
+
 static GroupType *groups = NULL;
 
+/** Groups made only of exact patterns, keyed by class or name. */
+static GroupIndex classIndex;
+static GroupIndex nameIndex;
+
+/** Groups that must be checked for every client. */
+static GroupVector otherGroups;
+
+/** Set when the index needs to be rebuilt. */
+static char indexDirty = 1;
+
 static void ReleasePatternList(PatternListType *lp);
 static void ReleaseOptionList(OptionListType *lp);
 static void AddPattern(PatternListType **lp, const char *pattern,
 		MatchType match);
 static void ApplyGroup(const GroupType *gp, ClientNode *np);
+static char MatchesGroup(const GroupType *gp, ClientNode *np);
+static void BuildIndex(void);
+static void AddCandidates(const GroupIndex &index, const char *key,
+		GroupVector &candidates);
+static bool CompareGroupOrder(const GroupType *a, const GroupType *b);
 
-/** Determine if expression matches pattern. */
-static char Match(const char *pattern, const char *expression);
+/** Determine if expression matches a compiled pattern. */
+static char Match(const PatternListType *lp, const char *expression);
 
 /** Destroy group data. */
 void Groups::DestroyGroups(void) {
@@ -68,6 +106,10 @@ void Groups::DestroyGroups(void) {
 		Release(groups);
 		groups = gp;
 	}
+	classIndex.clear();
+	nameIndex.clear();
+	otherGroups.clear();
+	indexDirty = 1;
 }
 
 /** Release a group pattern list. */
@@ -75,6 +117,12 @@ void ReleasePatternList(PatternListType *lp) {
 	PatternListType *tp;
 	while (lp) {
 		tp = lp->next;
+		if (lp->kind == PATTERN_REGEX) {
+			regfree(&lp->re);
+		}
+		if (lp->literal) {
+			delete[](lp->literal);
+		}
 		delete[](lp->pattern);
 		Release(lp);
 		lp = tp;
@@ -100,8 +148,10 @@ GroupType* Groups::CreateGroup(void) {
 	tp = new GroupType;
 	tp->patterns = NULL;
 	tp->options = NULL;
+	tp->order = 0;
 	tp->next = groups;
 	groups = tp;
+	indexDirty = 1;
 	return tp;
 }
 
@@ -125,16 +175,59 @@ void Groups::AddGroupName(GroupType *gp, const char *pattern) {
 	}
 }
 
-/** Add a pattern to a pattern list. */
+/** Add a pattern to a pattern list.
+ * The pattern is classified and, if needed, compiled here so that
+ * matching a client never has to call regcomp.
+ */
 void AddPattern(PatternListType **lp, const char *pattern, MatchType match) {
 	PatternListType *tp;
+	const char *start;
+	size_t len;
+	char anchorStart, anchorEnd;
 	Assert(lp);
 	Assert(pattern);
 	tp = new PatternListType;
 	tp->next = *lp;
 	*lp = tp;
 	tp->pattern = CopyString(pattern);
+	tp->literal = NULL;
+	tp->literalLength = 0;
 	tp->match = match;
+	indexDirty = 1;
+
+	/* Strip anchors and check if what is left is a literal. */
+	start = pattern;
+	len = strlen(pattern);
+	anchorStart = 0;
+	anchorEnd = 0;
+	if (len > 0 && start[0] == '^') {
+		anchorStart = 1;
+		start += 1;
+		len -= 1;
+	}
+	if (len > 0 && start[len - 1] == '$') {
+		anchorEnd = 1;
+		len -= 1;
+	}
+	if (strcspn(start, ".[]()*+?{}|^$\\") >= len
+			&& (anchorStart || !anchorEnd)) {
+		tp->literal = new char[len + 1];
+		memcpy(tp->literal, start, len);
+		tp->literal[len] = 0;
+		tp->literalLength = len;
+		if (anchorEnd) {
+			tp->kind = PATTERN_EXACT;
+		} else if (anchorStart) {
+			tp->kind = PATTERN_PREFIX;
+		} else {
+			tp->kind = PATTERN_SUBSTRING;
+		}
+	} else if (regcomp(&tp->re, pattern, REG_EXTENDED | REG_NOSUB) == 0) {
+		tp->kind = PATTERN_REGEX;
+	} else {
+		Warning(_("invalid group pattern: %s"), pattern);
+		tp->kind = PATTERN_INVALID;
+	}
 }
 
 /** Add an option to a group. */
@@ -184,39 +277,126 @@ void Groups::AddGroupOptionSigned(GroupType *gp, OptionType option, int value) {
 
 /** Apply groups to a client. */
 void Groups::ApplyGroups(ClientNode *np) {
+	GroupVector candidates;
+	GroupVector::const_iterator it;
+
+	Assert(np);
+	if (indexDirty) {
+		BuildIndex();
+	}
+
+	/* Only groups that could match this client are considered. */
+	candidates = otherGroups;
+	AddCandidates(classIndex, np->getClassName(), candidates);
+	AddCandidates(nameIndex, np->getInstanceName(), candidates);
+	std::sort(candidates.begin(), candidates.end(), CompareGroupOrder);
+	candidates.erase(std::unique(candidates.begin(), candidates.end()),
+			candidates.end());
+
+	for (it = candidates.begin(); it != candidates.end(); ++it) {
+		if (MatchesGroup(*it, np)) {
+			ApplyGroup(*it, np);
+		}
+	}
+
+}
+
+/** Determine if a group applies to a client. */
+char MatchesGroup(const GroupType *gp, ClientNode *np) {
 	PatternListType *lp;
-	GroupType *gp;
 	char hasClass;
 	char hasName;
 	char matchesClass;
 	char matchesName;
 
-	Assert(np);
+	hasClass = 0;
+	hasName = 0;
+	matchesClass = 0;
+	matchesName = 0;
+	for (lp = gp->patterns; lp; lp = lp->next) {
+		if (lp->match == MATCH_CLASS) {
+			if (!matchesClass && Match(lp, np->getClassName())) {
+				matchesClass = 1;
+			}
+			hasClass = 1;
+		} else if (lp->match == MATCH_NAME) {
+			if (!matchesName
+					&& Match(lp, np->getInstanceName())) {
+				matchesName = 1;
+			}
+			hasName = 1;
+		} else {
+			Debug("invalid match in ApplyGroups: %d", lp->match);
+		}
+	}
+	return hasName == matchesName && hasClass == matchesClass;
+}
+
+/** Rebuild the group index.
+ * A group made only of exact patterns can only match a client whose
+ * class (or, for groups without class patterns, name) equals one of its
+ * patterns, so it is filed under those keys. Everything else is checked
+ * for every client.
+ */
+void BuildIndex(void) {
+	GroupType *gp;
+	PatternListType *lp;
+	unsigned int order;
+	char exact;
+	char hasClass;
+
+	classIndex.clear();
+	nameIndex.clear();
+	otherGroups.clear();
+
+	order = 0;
 	for (gp = groups; gp; gp = gp->next) {
+		gp->order = order;
+		order += 1;
+
+		exact = gp->patterns != NULL;
 		hasClass = 0;
-		hasName = 0;
-		matchesClass = 0;
-		matchesName = 0;
 		for (lp = gp->patterns; lp; lp = lp->next) {
+			if (lp->kind != PATTERN_EXACT) {
+				exact = 0;
+			}
 			if (lp->match == MATCH_CLASS) {
-				if (Match(lp->pattern, np->getClassName())) {
-					matchesClass = 1;
-				}
 				hasClass = 1;
-			} else if (lp->match == MATCH_NAME) {
-				if (Match(lp->pattern, np->getInstanceName())) {
-					matchesName = 1;
-				}
-				hasName = 1;
-			} else {
-				Debug("invalid match in ApplyGroups: %d", lp->match);
 			}
 		}
-		if (hasName == matchesName && hasClass == matchesClass) {
-			ApplyGroup(gp, np);
+
+		if (!exact) {
+			otherGroups.push_back(gp);
+			continue;
+		}
+		for (lp = gp->patterns; lp; lp = lp->next) {
+			if (hasClass && lp->match == MATCH_CLASS) {
+				classIndex[lp->literal].push_back(gp);
+			} else if (!hasClass && lp->match == MATCH_NAME) {
+				nameIndex[lp->literal].push_back(gp);
+			}
 		}
 	}
+	indexDirty = 0;
+}
 
+/** Add the groups filed under a key to a candidate list. */
+void AddCandidates(const GroupIndex &index, const char *key,
+		GroupVector &candidates) {
+	GroupIndex::const_iterator found;
+	if (key == NULL || index.empty()) {
+		return;
+	}
+	found = index.find(key);
+	if (found != index.end()) {
+		candidates.insert(candidates.end(), found->second.begin(),
+				found->second.end());
+	}
+}
+
+/** Order groups the way they appear in the group list. */
+bool CompareGroupOrder(const GroupType *a, const GroupType *b) {
+	return a->order < b->order;
 }
 
 /** Apply a group to a client. */
@@ -395,28 +575,24 @@ void ApplyGroup(const GroupType *gp, ClientNode *np) {
 
 }
 
-/** Determine if expression matches pattern. */
-char Match(const char *pattern, const char *expression) {
-
-	regex_t re;
-	regmatch_t rm;
-	int rc;
+/** Determine if expression matches a compiled pattern. */
+char Match(const PatternListType *lp, const char *expression) {
 
-	if (!pattern && !expression) {
-		return 1;
-	} else if (!pattern || !expression) {
+	if (!expression) {
 		return 0;
 	}
 
-	if (regcomp(&re, pattern, REG_EXTENDED) != 0) {
+	switch (lp->kind) {
+	case PATTERN_EXACT:
+		return strcmp(lp->literal, expression) == 0;
+	case PATTERN_PREFIX:
+		return strncmp(lp->literal, expression, lp->literalLength) == 0;
+	case PATTERN_SUBSTRING:
+		return strstr(expression, lp->literal) != NULL;
+	case PATTERN_REGEX:
+		return regexec(&lp->re, expression, 0, NULL, 0) == 0;
+	default:
 		return 0;
 	}
 
-	rc = regexec(&re, expression, 0, &rm, 0);
-
-	regfree(&re);
-
-	return rc == 0 ? 1 : 0;
-
 }
-
@@ -72,7 +72,7 @@ void Help::DisplayHelp(void) {
 			"  -f file     Use specified configuration file\n"
 			"  -h          Display this help message\n"
 			"  -p          Parse the configuration file and exit\n"
-			"  -reload     Reload menu (send _JWM_RELOAD to the root)\n"
+			"  -reload     Reload config (send _JWM_RELOAD to the root)\n"
 			"  -restart    Restart JWM (send _JWM_RESTART to the root)\n"
 			"  -v          Display version information\n");
 }
@@ -14,6 +14,7 @@
 #include "font.h"
 #include "settings.h"
 #include "DesktopEnvironment.h"
+#include "PropertyLoader.h"
 
 #include <X11/Xlibint.h>
 
@@ -67,74 +68,12 @@ const char jwmExit[] = "_JWM_EXIT";
 const char jwmReload[] = "_JWM_RELOAD";
 const char managerProperty[] = "MANAGER";
 
-const Hints::AtomNode Hints::atomList[] = {
-
-{ &atoms[ATOM_COMPOUND_TEXT], "COMPOUND_TEXT" }, { &atoms[ATOM_UTF8_STRING], "UTF8_STRING" }, {
-		&atoms[ATOM_XROOTPMAP_ID], "_XROOTPMAP_ID" }, { &atoms[ATOM_MANAGER], &managerProperty[0] },
-
-{ &atoms[ATOM_WM_STATE], "WM_STATE" }, { &atoms[ATOM_WM_PROTOCOLS], "WM_PROTOCOLS" }, { &atoms[ATOM_WM_DELETE_WINDOW],
-		"WM_DELETE_WINDOW" }, { &atoms[ATOM_WM_TAKE_FOCUS], "WM_TAKE_FOCUS" }, { &atoms[ATOM_WM_CHANGE_STATE],
-		"WM_CHANGE_STATE" }, { &atoms[ATOM_WM_COLORMAP_WINDOWS], "WM_COLORMAP_WINDOWS" },
-
-{ &atoms[ATOM_NET_SUPPORTED], "_NET_SUPPORTED" }, { &atoms[ATOM_NET_NUMBER_OF_DESKTOPS], "_NET_NUMBER_OF_DESKTOPS" }, {
-		&atoms[ATOM_NET_DESKTOP_NAMES], "_NET_DESKTOP_NAMES" }, { &atoms[ATOM_NET_DESKTOP_GEOMETRY],
-		"_NET_DESKTOP_GEOMETRY" }, { &atoms[ATOM_NET_DESKTOP_VIEWPORT], "_NET_DESKTOP_VIEWPORT" }, {
-		&atoms[ATOM_NET_CURRENT_DESKTOP], "_NET_CURRENT_DESKTOP" }, { &atoms[ATOM_NET_ACTIVE_WINDOW],
-		"_NET_ACTIVE_WINDOW" }, { &atoms[ATOM_NET_WORKAREA], "_NET_WORKAREA" }, { &atoms[ATOM_NET_SUPPORTING_WM_CHECK],
-		"_NET_SUPPORTING_WM_CHECK" }, { &atoms[ATOM_NET_SHOWING_DESKTOP], "_NET_SHOWING_DESKTOP" }, {
-		&atoms[ATOM_NET_FRAME_EXTENTS], "_NET_FRAME_EXTENTS" }, { &atoms[ATOM_NET_WM_DESKTOP], "_NET_WM_DESKTOP" }, {
-		&atoms[ATOM_NET_WM_STATE], "_NET_WM_STATE" }, { &atoms[ATOM_NET_WM_STATE_STICKY], "_NET_WM_STATE_STICKY" }, {
-		&atoms[ATOM_NET_WM_STATE_MAXIMIZED_VERT], "_NET_WM_STATE_MAXIMIZED_VERT" }, {
-		&atoms[ATOM_NET_WM_STATE_MAXIMIZED_HORZ], "_NET_WM_STATE_MAXIMIZED_HORZ" }, { &atoms[ATOM_NET_WM_STATE_SHADED],
-		"_NET_WM_STATE_SHADED" }, { &atoms[ATOM_NET_WM_STATE_FULLSCREEN], "_NET_WM_STATE_FULLSCREEN" }, {
-		&atoms[ATOM_NET_WM_STATE_HIDDEN], "_NET_WM_STATE_HIDDEN" }, { &atoms[ATOM_NET_WM_STATE_SKIP_TASKBAR],
-		"_NET_WM_STATE_SKIP_TASKBAR" }, { &atoms[ATOM_NET_WM_STATE_SKIP_PAGER], "_NET_WM_STATE_SKIP_PAGER" }, {
-		&atoms[ATOM_NET_WM_STATE_BELOW], "_NET_WM_STATE_BELOW" }, { &atoms[ATOM_NET_WM_STATE_ABOVE],
-		"_NET_WM_STATE_ABOVE" }, { &atoms[ATOM_NET_WM_STATE_DEMANDS_ATTENTION], "_NET_WM_STATE_DEMANDS_ATTENTION" }, {
-		&atoms[ATOM_NET_WM_STATE_FOCUSED], "_NET_WM_STATE_FOCUSED" }, { &atoms[ATOM_NET_WM_ALLOWED_ACTIONS],
-		"_NET_WM_ALLOWED_ACTIONS" }, { &atoms[ATOM_NET_WM_ACTION_MOVE], "_NET_WM_ACTION_MOVE" }, {
-		&atoms[ATOM_NET_WM_ACTION_RESIZE], "_NET_WM_ACTION_RESIZE" }, { &atoms[ATOM_NET_WM_ACTION_MINIMIZE],
-		"_NET_WM_ACTION_MINIMIZE" }, { &atoms[ATOM_NET_WM_ACTION_SHADE], "_NET_WM_ACTION_SHADE" }, {
-		&atoms[ATOM_NET_WM_ACTION_STICK], "_NET_WM_ACTION_STICK" }, { &atoms[ATOM_NET_WM_ACTION_FULLSCREEN],
-		"_NET_WM_ACTION_FULLSCREEN" }, { &atoms[ATOM_NET_WM_ACTION_MAXIMIZE_HORZ], "_NET_WM_ACTION_MAXIMIZE_HORZ" }, {
-		&atoms[ATOM_NET_WM_ACTION_MAXIMIZE_VERT], "_NET_WM_ACTION_MAXIMIZE_VERT" }, {
-		&atoms[ATOM_NET_WM_ACTION_CHANGE_DESKTOP], "_NET_WM_ACTION_CHANGE_DESKTOP" }, {
-		&atoms[ATOM_NET_WM_ACTION_CLOSE], "_NET_WM_ACTION_CLOSE" }, { &atoms[ATOM_NET_WM_ACTION_BELOW],
-		"_NET_WM_ACTION_BELOW" }, { &atoms[ATOM_NET_WM_ACTION_ABOVE], "_NET_WM_ACTION_ABOVE" }, {
-		&atoms[ATOM_NET_CLOSE_WINDOW], "_NET_CLOSE_WINDOW" }, { &atoms[ATOM_NET_MOVERESIZE_WINDOW],
-		"_NET_MOVERESIZE_WINDOW" }, { &atoms[ATOM_NET_RESTACK_WINDOW], "_NET_RESTACK_WINDOW" }, {
-		&atoms[ATOM_NET_REQUEST_FRAME_EXTENTS], "_NET_REQUEST_FRAME_EXTENTS" },
-		{ &atoms[ATOM_NET_WM_PID], "_NET_WM_PID" }, { &atoms[ATOM_NET_WM_NAME], "_NET_WM_NAME" }, {
-				&atoms[ATOM_NET_WM_VISIBLE_NAME], "_NET_WM_VISIBLE_NAME" }, { &atoms[ATOM_NET_WM_HANDLED_ICONS],
-				"_NET_WM_HANDLED_ICONS" }, { &atoms[ATOM_NET_WM_ICON], "_NET_WM_ICON" }, {
-				&atoms[ATOM_NET_WM_ICON_NAME], "_NET_WM_ICON_NAME" }, { &atoms[ATOM_NET_WM_USER_TIME],
-				"_NET_WM_USER_TIME" }, { &atoms[ATOM_NET_WM_USER_TIME_WINDOW], "_NET_WM_USER_TIME_WINDOW" }, {
-				&atoms[ATOM_NET_WM_VISIBLE_ICON_NAME], "_NET_WM_VISIBLE_ICON_NAME" }, { &atoms[ATOM_NET_WM_WINDOW_TYPE],
-				"_NET_WM_WINDOW_TYPE" }, { &atoms[ATOM_NET_WM_WINDOW_TYPE_DESKTOP], "_NET_WM_WINDOW_TYPE_DESKTOP" }, {
-				&atoms[ATOM_NET_WM_WINDOW_TYPE_DOCK], "_NET_WM_WINDOW_TYPE_DOCK" }, {
-				&atoms[ATOM_NET_WM_WINDOW_TYPE_SPLASH], "_NET_WM_WINDOW_TYPE_SPLASH" }, {
-				&atoms[ATOM_NET_WM_WINDOW_TYPE_DIALOG], "_NET_WM_WINDOW_TYPE_DIALOG" }, {
-				&atoms[ATOM_NET_WM_WINDOW_TYPE_NORMAL], "_NET_WM_WINDOW_TYPE_NORMAL" }, {
-				&atoms[ATOM_NET_WM_WINDOW_TYPE_MENU], "_NET_WM_WINDOW_TYPE_MENU" }, {
-				&atoms[ATOM_NET_WM_WINDOW_TYPE_NOTIFICATION], "_NET_WM_WINDOW_TYPE_NOTIFICATION" }, {
-				&atoms[ATOM_NET_WM_WINDOW_TYPE_TOOLBAR], "_NET_WM_WINDOW_TYPE_TOOLBAR" }, {
-				&atoms[ATOM_NET_WM_WINDOW_TYPE_UTILITY], "_NET_WM_WINDOW_TYPE_UTILITY" }, {
-				&atoms[ATOM_NET_CLIENT_LIST], "_NET_CLIENT_LIST" }, { &atoms[ATOM_NET_CLIENT_LIST_STACKING],
-				"_NET_CLIENT_LIST_STACKING" }, { &atoms[ATOM_NET_WM_STRUT_PARTIAL], "_NET_WM_STRUT_PARTIAL" }, {
-				&atoms[ATOM_NET_WM_STRUT], "_NET_WM_STRUT" }, { &atoms[ATOM_NET_WM_WINDOW_OPACITY],
-				"_NET_WM_WINDOW_OPACITY" }, { &atoms[ATOM_NET_WM_MOVERESIZE], "_NET_WM_MOVERESIZE" }, {
-				&atoms[ATOM_NET_SYSTEM_TRAY_OPCODE], "_NET_SYSTEM_TRAY_OPCODE" }, {
-				&atoms[ATOM_NET_SYSTEM_TRAY_ORIENTATION], "_NET_SYSTEM_TRAY_ORIENTATION" },
-
-		{ &atoms[ATOM_MOTIF_WM_HINTS], "_MOTIF_WM_HINTS" },
-
-		{ &atoms[ATOM_JWM_RESTART], &jwmRestart[0] }, { &atoms[ATOM_JWM_EXIT], &jwmExit[0] }, { &atoms[ATOM_JWM_RELOAD],
-				&jwmReload[0] }, { &atoms[ATOM_JWM_WM_STATE_MAXIMIZED_TOP], "_JWM_WM_STATE_MAXIMIZED_TOP" }, {
-				&atoms[ATOM_JWM_WM_STATE_MAXIMIZED_BOTTOM], "_JWM_WM_STATE_MAXIMIZED_BOTTOM" }, {
-				&atoms[ATOM_JWM_WM_STATE_MAXIMIZED_LEFT], "_JWM_WM_STATE_MAXIMIZED_LEFT" }, {
-				&atoms[ATOM_JWM_WM_STATE_MAXIMIZED_RIGHT], "_JWM_WM_STATE_MAXIMIZED_RIGHT" }
-
+/** Atom names, indexed by AtomType. */
+#define ATOM_NAME(id, name) name,
+const char *const Hints::atomNames[ATOM_COUNT] = {
+	ATOM_LIST(ATOM_NAME)
 };
+#undef ATOM_NAME
 
 /** Set root hints and intern atoms. */
 void Hints::StartupHints(void) {
@@ -161,10 +100,8 @@ void Hints::StartupHints(void) {
 	array = (unsigned long*) data;
 	supported = (Atom*) data;
 
-	/* Intern the atoms */
-	for (x = 0; x < ATOM_COUNT; x++) {
-		*atomList[x].atom = JXInternAtom(display, atomList[x].name, False);
-	}
+	/* Intern the atoms with a single round trip. */
+	JXInternAtoms(display, (char**) atomNames, ATOM_COUNT, False, atoms);
 
 	/* _NET_SUPPORTED */
 	for (x = FIRST_NET_ATOM; x <= LAST_NET_ATOM; x++) {
@@ -242,7 +179,7 @@ void Hints::ReadClientInfo(ClientNode *np, char alreadyMapped) {
 	np->ReadWMColormaps();
 
 	Window owner;
-	status = JXGetTransientForHint(display, np->getWindow(), &owner);
+	status = GetTransientForHint(np->getWindow(), &owner);
 	np->setOwner(owner);
 	if (!status) {
 		np->setOwner(None);
@@ -485,7 +422,7 @@ void Hints::ReadWindowState(ClientNode *result, Window win, char alreadyMapped)
 	}
 
 	/* _NET_WM_STATE */
-	status = JXGetWindowProperty(display, win, atoms[ATOM_NET_WM_STATE], 0, 32, False, XA_ATOM, &realType, &realFormat,
+	status = GetProperty(win, atoms[ATOM_NET_WM_STATE], 0, 32, XA_ATOM, &realType, &realFormat,
 			&count, &extra, &temp);
 	if (status == Success && realFormat != 0) {
 		if (count > 0) {
@@ -531,7 +468,7 @@ void Hints::ReadWindowState(ClientNode *result, Window win, char alreadyMapped)
 	}
 
 	/* _NET_WM_WINDOW_TYPE */
-	status = JXGetWindowProperty(display, win, atoms[ATOM_NET_WM_WINDOW_TYPE], 0, 32, False, XA_ATOM, &realType,
+	status = GetProperty(win, atoms[ATOM_NET_WM_WINDOW_TYPE], 0, 32, XA_ATOM, &realType,
 			&realFormat, &count, &extra, &temp);
 	if (status == Success && realFormat != 0) {
 		/* Loop until we hit a window type we recognize. */
@@ -622,7 +559,7 @@ void Hints::ReadWMProtocols(Window w, ClientNode *state) {
 
 	state->setNoTakeFocus();
 	state->setNoDelete();
-	status = JXGetWindowProperty(display, w, atoms[ATOM_WM_PROTOCOLS], 0, 32, False, XA_ATOM, &realType, &realFormat,
+	status = GetProperty(w, atoms[ATOM_WM_PROTOCOLS], 0, 32, XA_ATOM, &realType, &realFormat,
 			&count, &extra, &temp);
 	p = (Atom*) temp;
 	if (status != Success || realFormat == 0 || !p) {
@@ -652,7 +589,7 @@ bool Hints::IsDeleteAtomSet(Window w) {
 
   Assert(w != None);
 
-  status = JXGetWindowProperty(display, w, atoms[ATOM_WM_PROTOCOLS], 0, 32, False, XA_ATOM, &realType, &realFormat,
+  status = GetProperty(w, atoms[ATOM_WM_PROTOCOLS], 0, 32, XA_ATOM, &realType, &realFormat,
       &count, &extra, &temp);
   p = (Atom*) temp;
   if (status != Success || realFormat == 0 || !p) {
@@ -679,7 +616,7 @@ void Hints::ReadWMState(Window win, ClientNode *node) {
 	unsigned long *temp;
 
 	count = 0;
-	status = JXGetWindowProperty(display, win, Hints::atoms[ATOM_WM_STATE], 0, 2, False, Hints::atoms[ATOM_WM_STATE],
+	status = GetProperty(win, Hints::atoms[ATOM_WM_STATE], 0, 2, Hints::atoms[ATOM_WM_STATE],
 			&realType, &realFormat, &count, &extra, (unsigned char** )&temp);
 	if (JLIKELY(status == Success && realFormat != 0)) {
 		if (JLIKELY(count == 2)) {
@@ -709,7 +646,7 @@ void Hints::ReadWMHints(Window win, ClientNode *node, char alreadyMapped) {
 
 	node->setCanFocus();
 
-	wmhints = JXGetWMHints(display, win);
+	wmhints = GetWMHints(win);
 	if (wmhints) {
 		if (!alreadyMapped && (wmhints->flags & StateHint)) {
 			switch (wmhints->initial_state) {
@@ -757,7 +694,7 @@ void Hints::ReadMotifHints(Window win, ClientNode *state) {
 	Assert(win != None);
 	Assert(state);
 
-	status = JXGetWindowProperty(display, win, Hints::atoms[ATOM_MOTIF_WM_HINTS], 0L, 20L, False,
+	status = GetProperty(win, Hints::atoms[ATOM_MOTIF_WM_HINTS], 0L, 20L,
 			Hints::atoms[ATOM_MOTIF_WM_HINTS], &type, &format, &itemCount, &bytesLeft, &data);
 	if (status != Success || type == 0) {
 		return;
@@ -814,7 +751,7 @@ char Hints::GetCardinalAtom(Window window, AtomType atom, unsigned long *value)
 	Assert(value);
 
 	count = 0;
-	status = JXGetWindowProperty(display, window, atoms[atom], 0, 1, False, XA_CARDINAL, &realType, &realFormat, &count,
+	status = GetProperty(window, atoms[atom], 0, 1, XA_CARDINAL, &realType, &realFormat, &count,
 			&extra, &data);
 	ret = 0;
 	if (status == Success && realFormat != 0 && data) {
@@ -850,7 +787,7 @@ char Hints::GetWindowAtom(Window window, AtomType atom, Window *value) {
 	Assert(value);
 
 	count = 0;
-	status = JXGetWindowProperty(display, window, atoms[atom], 0, 1, False, XA_WINDOW, &realType, &realFormat, &count,
+	status = GetProperty(window, atoms[atom], 0, 1, XA_WINDOW, &realType, &realFormat, &count,
 			&extra, &data);
 	ret = 0;
 	if (status == Success && realFormat != 0 && data) {
@@ -882,3 +819,229 @@ void Hints::SetAtomAtom(Window window, AtomType atom, AtomType value) {
 	Assert(window != None);
 	JXChangeProperty(display, window, atoms[atom], XA_ATOM, 32, PropModeReplace, (unsigned char* )&atoms[value], 1);
 }
+
+/** Read a window property, using prefetched data when available. */
+int Hints::GetProperty(Window w, Atom property, long offset, long length,
+		Atom reqType, Atom *actualType, int *actualFormat,
+		unsigned long *count, unsigned long *bytesAfter,
+		unsigned char **data) {
+	if (PropertyLoader::GetProperty(w, property, offset, length, reqType,
+			actualType, actualFormat, count, bytesAfter, data)) {
+		return Success;
+	}
+	return JXGetWindowProperty(display, w, property, offset, length, False,
+			reqType, actualType, actualFormat, count, bytesAfter, data);
+}
+
+/** Read WM_HINTS (see XGetWMHints). */
+XWMHints *Hints::GetWMHints(Window w) {
+	unsigned long count, extra;
+	Atom realType;
+	int realFormat;
+	unsigned char *data;
+	unsigned long *prop;
+	XWMHints *hints;
+
+	if (!PropertyLoader::IsLoaded(w)) {
+		return JXGetWMHints(display, w);
+	}
+
+	if (GetProperty(w, XA_WM_HINTS, 0, 9, XA_WM_HINTS, &realType, &realFormat,
+			&count, &extra, &data) != Success) {
+		return NULL;
+	}
+	prop = (unsigned long*) data;
+	if (realType != XA_WM_HINTS || realFormat != 32 || count < 8) {
+		if (data) {
+			JXFree(data);
+		}
+		return NULL;
+	}
+
+	hints = XAllocWMHints();
+	if (hints) {
+		hints->flags = prop[0];
+		hints->input = prop[1] ? True : False;
+		hints->initial_state = prop[2];
+		hints->icon_pixmap = prop[3];
+		hints->icon_window = prop[4];
+		hints->icon_x = prop[5];
+		hints->icon_y = prop[6];
+		hints->icon_mask = prop[7];
+		hints->window_group = count >= 9 ? prop[8] : 0;
+	}
+	JXFree(data);
+	return hints;
+}
+
+/** Read WM_CLASS (see XGetClassHint). */
+Status Hints::GetClassHint(Window w, XClassHint *hint) {
+	unsigned long count, extra;
+	Atom realType;
+	int realFormat;
+	unsigned char *data;
+	size_t len;
+
+	if (!PropertyLoader::IsLoaded(w)) {
+		return JXGetClassHint(display, w, hint);
+	}
+
+	if (GetProperty(w, XA_WM_CLASS, 0, 2048, XA_STRING, &realType, &realFormat,
+			&count, &extra, &data) != Success) {
+		return 0;
+	}
+	if (realType != XA_STRING || realFormat != 8 || data == NULL) {
+		if (data) {
+			JXFree(data);
+		}
+		return 0;
+	}
+
+	len = strlen((char*) data);
+	hint->res_name = (char*) malloc(len + 1);
+	memcpy(hint->res_name, data, len + 1);
+	if (len == count) {
+		len -= 1;
+	}
+	hint->res_class = strdup((char*) data + len + 1);
+	JXFree(data);
+	return 1;
+}
+
+/** Read WM_NORMAL_HINTS (see XGetWMNormalHints). */
+Status Hints::GetWMNormalHints(Window w, XSizeHints *hints, long *supplied) {
+	unsigned long count, extra;
+	Atom realType;
+	int realFormat;
+	unsigned char *data;
+	unsigned long *prop;
+
+	if (!PropertyLoader::IsLoaded(w)) {
+		return JXGetWMNormalHints(display, w, hints, supplied);
+	}
+
+	if (GetProperty(w, XA_WM_NORMAL_HINTS, 0, 18, XA_WM_SIZE_HINTS, &realType,
+			&realFormat, &count, &extra, &data) != Success) {
+		return 0;
+	}
+	prop = (unsigned long*) data;
+	if (realType != XA_WM_SIZE_HINTS || realFormat != 32 || count < 15) {
+		if (data) {
+			JXFree(data);
+		}
+		return 0;
+	}
+
+	hints->flags = prop[0];
+	hints->x = prop[1];
+	hints->y = prop[2];
+	hints->width = prop[3];
+	hints->height = prop[4];
+	hints->min_width = prop[5];
+	hints->min_height = prop[6];
+	hints->max_width = prop[7];
+	hints->max_height = prop[8];
+	hints->width_inc = prop[9];
+	hints->height_inc = prop[10];
+	hints->min_aspect.x = prop[11];
+	hints->min_aspect.y = prop[12];
+	hints->max_aspect.x = prop[13];
+	hints->max_aspect.y = prop[14];
+	*supplied = USPosition | USSize | PAllHints;
+	if (count >= 18) {
+		hints->base_width = prop[15];
+		hints->base_height = prop[16];
+		hints->win_gravity = prop[17];
+		*supplied |= PBaseSize | PWinGravity;
+	}
+	hints->flags &= *supplied;
+	JXFree(data);
+	return 1;
+}
+
+/** Read WM_TRANSIENT_FOR (see XGetTransientForHint). */
+Status Hints::GetTransientForHint(Window w, Window *owner) {
+	unsigned long count, extra;
+	Atom realType;
+	int realFormat;
+	unsigned char *data;
+
+	if (!PropertyLoader::IsLoaded(w)) {
+		return JXGetTransientForHint(display, w, owner);
+	}
+
+	*owner = None;
+	if (GetProperty(w, XA_WM_TRANSIENT_FOR, 0, 1, XA_WINDOW, &realType,
+			&realFormat, &count, &extra, &data) != Success) {
+		return 0;
+	}
+	if (data == NULL) {
+		return 0;
+	}
+	if (realType == XA_WINDOW && realFormat == 32 && count > 0) {
+		*owner = *(Window*) data;
+		JXFree(data);
+		return 1;
+	}
+	JXFree(data);
+	return 0;
+}
+
+/** Read WM_COLORMAP_WINDOWS (see XGetWMColormapWindows). */
+Status Hints::GetWMColormapWindows(Window w, Window **windows, int *count) {
+	unsigned long items, extra;
+	Atom realType;
+	int realFormat;
+	unsigned char *data;
+
+	if (!PropertyLoader::IsLoaded(w)) {
+		return JXGetWMColormapWindows(display, w, windows, count);
+	}
+
+	if (GetProperty(w, atoms[ATOM_WM_COLORMAP_WINDOWS], 0, 256, XA_WINDOW,
+			&realType, &realFormat, &items, &extra, &data) != Success) {
+		return 0;
+	}
+	if (realType != XA_WINDOW || realFormat != 32) {
+		if (data) {
+			JXFree(data);
+		}
+		return 0;
+	}
+	*windows = (Window*) data;
+	*count = (int) items;
+	return 1;
+}
+
+/** Read WM_NAME as a string (see XFetchName). */
+Status Hints::FetchName(Window w, char **name) {
+	unsigned long count, extra;
+	Atom realType;
+	int realFormat;
+	unsigned char *data;
+
+	if (!PropertyLoader::IsLoaded(w)) {
+		return JXFetchName(display, w, name);
+	}
+
+	*name = NULL;
+	if (GetProperty(w, XA_WM_NAME, 0, 1024, XA_STRING, &realType, &realFormat,
+			&count, &extra, &data) != Success) {
+		return 0;
+	}
+	if (extra > 0) {
+		/* Longer than the prefetch; let Xlib read the whole thing. */
+		if (data) {
+			JXFree(data);
+		}
+		return JXFetchName(display, w, name);
+	}
+	if (realType == XA_STRING && realFormat == 8 && data) {
+		*name = (char*) data;
+		return 1;
+	}
+	if (data) {
+		JXFree(data);
+	}
+	return 0;
+}
@@ -12,121 +12,129 @@
 
 struct ClientNode;
 
-/** Enumeration of atoms. */
-typedef enum {
-
-	/* Misc */
-	ATOM_COMPOUND_TEXT,
-	ATOM_UTF8_STRING,
-	ATOM_XROOTPMAP_ID,
-	ATOM_MANAGER,
-
-	/* Standard atoms */
-	ATOM_WM_STATE,
-	ATOM_WM_PROTOCOLS,
-	ATOM_WM_DELETE_WINDOW,
-	ATOM_WM_TAKE_FOCUS,
-	ATOM_WM_CHANGE_STATE,
-	ATOM_WM_COLORMAP_WINDOWS,
-
-	/* WM Spec atoms */
-	ATOM_NET_SUPPORTED,
-	ATOM_NET_NUMBER_OF_DESKTOPS,
-	ATOM_NET_DESKTOP_NAMES,
-	ATOM_NET_DESKTOP_GEOMETRY,
-	ATOM_NET_DESKTOP_VIEWPORT,
-	ATOM_NET_CURRENT_DESKTOP,
-	ATOM_NET_ACTIVE_WINDOW,
-	ATOM_NET_WORKAREA,
-	ATOM_NET_SUPPORTING_WM_CHECK,
-	ATOM_NET_SHOWING_DESKTOP,
-	ATOM_NET_FRAME_EXTENTS,
-	ATOM_NET_WM_DESKTOP,
-
-	ATOM_NET_WM_STATE,
-	ATOM_NET_WM_STATE_STICKY,
-	ATOM_NET_WM_STATE_MAXIMIZED_VERT,
-	ATOM_NET_WM_STATE_MAXIMIZED_HORZ,
-	ATOM_NET_WM_STATE_SHADED,
-	ATOM_NET_WM_STATE_FULLSCREEN,
-	ATOM_NET_WM_STATE_HIDDEN,
-	ATOM_NET_WM_STATE_SKIP_TASKBAR,
-	ATOM_NET_WM_STATE_SKIP_PAGER,
-	ATOM_NET_WM_STATE_BELOW,
-	ATOM_NET_WM_STATE_ABOVE,
-	ATOM_NET_WM_STATE_DEMANDS_ATTENTION,
-	ATOM_NET_WM_STATE_FOCUSED,
-
-	ATOM_NET_WM_ALLOWED_ACTIONS,
-	ATOM_NET_WM_ACTION_MOVE,
-	ATOM_NET_WM_ACTION_RESIZE,
-	ATOM_NET_WM_ACTION_MINIMIZE,
-	ATOM_NET_WM_ACTION_SHADE,
-	ATOM_NET_WM_ACTION_STICK,
-	ATOM_NET_WM_ACTION_FULLSCREEN,
-	ATOM_NET_WM_ACTION_MAXIMIZE_HORZ,
-	ATOM_NET_WM_ACTION_MAXIMIZE_VERT,
-	ATOM_NET_WM_ACTION_CHANGE_DESKTOP,
-	ATOM_NET_WM_ACTION_CLOSE,
-	ATOM_NET_WM_ACTION_BELOW,
-	ATOM_NET_WM_ACTION_ABOVE,
-
-	ATOM_NET_CLOSE_WINDOW,
-	ATOM_NET_MOVERESIZE_WINDOW,
-	ATOM_NET_RESTACK_WINDOW,
-	ATOM_NET_REQUEST_FRAME_EXTENTS,
-
-	ATOM_NET_WM_PID,
-	ATOM_NET_WM_NAME,
-	ATOM_NET_WM_VISIBLE_NAME,
-	ATOM_NET_WM_HANDLED_ICONS,
-	ATOM_NET_WM_ICON,
-	ATOM_NET_WM_ICON_NAME,
-	ATOM_NET_WM_USER_TIME,
-	ATOM_NET_WM_USER_TIME_WINDOW,
-	ATOM_NET_WM_VISIBLE_ICON_NAME,
-	ATOM_NET_WM_WINDOW_TYPE,
-	ATOM_NET_WM_WINDOW_TYPE_DESKTOP,
-	ATOM_NET_WM_WINDOW_TYPE_DOCK,
-	ATOM_NET_WM_WINDOW_TYPE_SPLASH,
-	ATOM_NET_WM_WINDOW_TYPE_DIALOG,
-	ATOM_NET_WM_WINDOW_TYPE_NORMAL,
-	ATOM_NET_WM_WINDOW_TYPE_MENU,
-	ATOM_NET_WM_WINDOW_TYPE_NOTIFICATION,
-	ATOM_NET_WM_WINDOW_TYPE_TOOLBAR,
-	ATOM_NET_WM_WINDOW_TYPE_UTILITY,
-
-	ATOM_NET_CLIENT_LIST,
-	ATOM_NET_CLIENT_LIST_STACKING,
-
-	ATOM_NET_WM_STRUT_PARTIAL,
-	ATOM_NET_WM_WINDOW_OPACITY,
-	ATOM_NET_WM_STRUT,
-	ATOM_NET_WM_MOVERESIZE,
-
-	ATOM_NET_SYSTEM_TRAY_OPCODE,
-	ATOM_NET_SYSTEM_TRAY_ORIENTATION,
-
-	/* MWM atoms */
-	ATOM_MOTIF_WM_HINTS,
-
-	/* JWM-specific atoms. */
-	ATOM_JWM_RESTART,
-	ATOM_JWM_EXIT,
-	ATOM_JWM_RELOAD,
-	ATOM_JWM_WM_STATE_MAXIMIZED_TOP,
-	ATOM_JWM_WM_STATE_MAXIMIZED_BOTTOM,
-	ATOM_JWM_WM_STATE_MAXIMIZED_LEFT,
-	ATOM_JWM_WM_STATE_MAXIMIZED_RIGHT,
-
-	ATOM_COUNT
-} AtomType;
-
 extern const char jwmRestart[];
 extern const char jwmExit[];
 extern const char jwmReload[];
 extern const char managerProperty[];
 
+/** The atoms used by JWM.
+ * Each entry is X(id, name); the AtomType enumeration and the names
+ * passed to XInternAtoms are both generated from this list, so every
+ * atom added here is interned with the others in a single request.
+ */
+#define ATOM_LIST(X) \
+	/* Misc */ \
+	X(COMPOUND_TEXT, "COMPOUND_TEXT") \
+	X(UTF8_STRING, "UTF8_STRING") \
+	X(XROOTPMAP_ID, "_XROOTPMAP_ID") \
+	X(MANAGER, managerProperty) \
+	\
+	/* Standard atoms */ \
+	X(WM_STATE, "WM_STATE") \
+	X(WM_PROTOCOLS, "WM_PROTOCOLS") \
+	X(WM_DELETE_WINDOW, "WM_DELETE_WINDOW") \
+	X(WM_TAKE_FOCUS, "WM_TAKE_FOCUS") \
+	X(WM_CHANGE_STATE, "WM_CHANGE_STATE") \
+	X(WM_COLORMAP_WINDOWS, "WM_COLORMAP_WINDOWS") \
+	\
+	/* WM Spec atoms */ \
+	X(NET_SUPPORTED, "_NET_SUPPORTED") \
+	X(NET_NUMBER_OF_DESKTOPS, "_NET_NUMBER_OF_DESKTOPS") \
+	X(NET_DESKTOP_NAMES, "_NET_DESKTOP_NAMES") \
+	X(NET_DESKTOP_GEOMETRY, "_NET_DESKTOP_GEOMETRY") \
+	X(NET_DESKTOP_VIEWPORT, "_NET_DESKTOP_VIEWPORT") \
+	X(NET_CURRENT_DESKTOP, "_NET_CURRENT_DESKTOP") \
+	X(NET_ACTIVE_WINDOW, "_NET_ACTIVE_WINDOW") \
+	X(NET_WORKAREA, "_NET_WORKAREA") \
+	X(NET_SUPPORTING_WM_CHECK, "_NET_SUPPORTING_WM_CHECK") \
+	X(NET_SHOWING_DESKTOP, "_NET_SHOWING_DESKTOP") \
+	X(NET_FRAME_EXTENTS, "_NET_FRAME_EXTENTS") \
+	X(NET_WM_DESKTOP, "_NET_WM_DESKTOP") \
+	\
+	X(NET_WM_STATE, "_NET_WM_STATE") \
+	X(NET_WM_STATE_STICKY, "_NET_WM_STATE_STICKY") \
+	X(NET_WM_STATE_MAXIMIZED_VERT, "_NET_WM_STATE_MAXIMIZED_VERT") \
+	X(NET_WM_STATE_MAXIMIZED_HORZ, "_NET_WM_STATE_MAXIMIZED_HORZ") \
+	X(NET_WM_STATE_SHADED, "_NET_WM_STATE_SHADED") \
+	X(NET_WM_STATE_FULLSCREEN, "_NET_WM_STATE_FULLSCREEN") \
+	X(NET_WM_STATE_HIDDEN, "_NET_WM_STATE_HIDDEN") \
+	X(NET_WM_STATE_SKIP_TASKBAR, "_NET_WM_STATE_SKIP_TASKBAR") \
+	X(NET_WM_STATE_SKIP_PAGER, "_NET_WM_STATE_SKIP_PAGER") \
+	X(NET_WM_STATE_BELOW, "_NET_WM_STATE_BELOW") \
+	X(NET_WM_STATE_ABOVE, "_NET_WM_STATE_ABOVE") \
+	X(NET_WM_STATE_DEMANDS_ATTENTION, "_NET_WM_STATE_DEMANDS_ATTENTION") \
+	X(NET_WM_STATE_FOCUSED, "_NET_WM_STATE_FOCUSED") \
+	\
+	X(NET_WM_ALLOWED_ACTIONS, "_NET_WM_ALLOWED_ACTIONS") \
+	X(NET_WM_ACTION_MOVE, "_NET_WM_ACTION_MOVE") \
+	X(NET_WM_ACTION_RESIZE, "_NET_WM_ACTION_RESIZE") \
+	X(NET_WM_ACTION_MINIMIZE, "_NET_WM_ACTION_MINIMIZE") \
+	X(NET_WM_ACTION_SHADE, "_NET_WM_ACTION_SHADE") \
+	X(NET_WM_ACTION_STICK, "_NET_WM_ACTION_STICK") \
+	X(NET_WM_ACTION_FULLSCREEN, "_NET_WM_ACTION_FULLSCREEN") \
+	X(NET_WM_ACTION_MAXIMIZE_HORZ, "_NET_WM_ACTION_MAXIMIZE_HORZ") \
+	X(NET_WM_ACTION_MAXIMIZE_VERT, "_NET_WM_ACTION_MAXIMIZE_VERT") \
+	X(NET_WM_ACTION_CHANGE_DESKTOP, "_NET_WM_ACTION_CHANGE_DESKTOP") \
+	X(NET_WM_ACTION_CLOSE, "_NET_WM_ACTION_CLOSE") \
+	X(NET_WM_ACTION_BELOW, "_NET_WM_ACTION_BELOW") \
+	X(NET_WM_ACTION_ABOVE, "_NET_WM_ACTION_ABOVE") \
+	\
+	X(NET_CLOSE_WINDOW, "_NET_CLOSE_WINDOW") \
+	X(NET_MOVERESIZE_WINDOW, "_NET_MOVERESIZE_WINDOW") \
+	X(NET_RESTACK_WINDOW, "_NET_RESTACK_WINDOW") \
+	X(NET_REQUEST_FRAME_EXTENTS, "_NET_REQUEST_FRAME_EXTENTS") \
+	\
+	X(NET_WM_PID, "_NET_WM_PID") \
+	X(NET_WM_NAME, "_NET_WM_NAME") \
+	X(NET_WM_VISIBLE_NAME, "_NET_WM_VISIBLE_NAME") \
+	X(NET_WM_HANDLED_ICONS, "_NET_WM_HANDLED_ICONS") \
+	X(NET_WM_ICON, "_NET_WM_ICON") \
+	X(NET_WM_ICON_NAME, "_NET_WM_ICON_NAME") \
+	X(NET_WM_USER_TIME, "_NET_WM_USER_TIME") \
+	X(NET_WM_USER_TIME_WINDOW, "_NET_WM_USER_TIME_WINDOW") \
+	X(NET_WM_VISIBLE_ICON_NAME, "_NET_WM_VISIBLE_ICON_NAME") \
+	X(NET_WM_WINDOW_TYPE, "_NET_WM_WINDOW_TYPE") \
+	X(NET_WM_WINDOW_TYPE_DESKTOP, "_NET_WM_WINDOW_TYPE_DESKTOP") \
+	X(NET_WM_WINDOW_TYPE_DOCK, "_NET_WM_WINDOW_TYPE_DOCK") \
+	X(NET_WM_WINDOW_TYPE_SPLASH, "_NET_WM_WINDOW_TYPE_SPLASH") \
+	X(NET_WM_WINDOW_TYPE_DIALOG, "_NET_WM_WINDOW_TYPE_DIALOG") \
+	X(NET_WM_WINDOW_TYPE_NORMAL, "_NET_WM_WINDOW_TYPE_NORMAL") \
+	X(NET_WM_WINDOW_TYPE_MENU, "_NET_WM_WINDOW_TYPE_MENU") \
+	X(NET_WM_WINDOW_TYPE_NOTIFICATION, "_NET_WM_WINDOW_TYPE_NOTIFICATION") \
+	X(NET_WM_WINDOW_TYPE_TOOLBAR, "_NET_WM_WINDOW_TYPE_TOOLBAR") \
+	X(NET_WM_WINDOW_TYPE_UTILITY, "_NET_WM_WINDOW_TYPE_UTILITY") \
+	\
+	X(NET_CLIENT_LIST, "_NET_CLIENT_LIST") \
+	X(NET_CLIENT_LIST_STACKING, "_NET_CLIENT_LIST_STACKING") \
+	\
+	X(NET_WM_STRUT_PARTIAL, "_NET_WM_STRUT_PARTIAL") \
+	X(NET_WM_WINDOW_OPACITY, "_NET_WM_WINDOW_OPACITY") \
+	X(NET_WM_STRUT, "_NET_WM_STRUT") \
+	X(NET_WM_MOVERESIZE, "_NET_WM_MOVERESIZE") \
+	\
+	X(NET_SYSTEM_TRAY_OPCODE, "_NET_SYSTEM_TRAY_OPCODE") \
+	X(NET_SYSTEM_TRAY_ORIENTATION, "_NET_SYSTEM_TRAY_ORIENTATION") \
+	\
+	/* MWM atoms */ \
+	X(MOTIF_WM_HINTS, "_MOTIF_WM_HINTS") \
+	\
+	/* JWM-specific atoms. */ \
+	X(JWM_RESTART, jwmRestart) \
+	X(JWM_EXIT, jwmExit) \
+	X(JWM_RELOAD, jwmReload) \
+	X(JWM_WM_STATE_MAXIMIZED_TOP, "_JWM_WM_STATE_MAXIMIZED_TOP") \
+	X(JWM_WM_STATE_MAXIMIZED_BOTTOM, "_JWM_WM_STATE_MAXIMIZED_BOTTOM") \
+	X(JWM_WM_STATE_MAXIMIZED_LEFT, "_JWM_WM_STATE_MAXIMIZED_LEFT") \
+	X(JWM_WM_STATE_MAXIMIZED_RIGHT, "_JWM_WM_STATE_MAXIMIZED_RIGHT")
+
+/** Enumeration of atoms. */
+#define ATOM_ENUM(id, name) ATOM_##id,
+typedef enum {
+	ATOM_LIST(ATOM_ENUM)
+	ATOM_COUNT
+} AtomType;
+#undef ATOM_ENUM
+
 #define FIRST_NET_ATOM ATOM_NET_SUPPORTED
 #define LAST_NET_ATOM  ATOM_NET_WM_STRUT
 
@@ -138,11 +146,7 @@ typedef unsigned char WinLayerType;
 class Hints {
 public:
 	static Atom atoms[ATOM_COUNT];
-	typedef struct {
-	  Atom *atom;
-	  const char *name;
-	} AtomNode;
-	static const AtomNode atomList[];
+	static const char *const atomNames[ATOM_COUNT];
 
 	/*@{*/
 	static void InitializeHints() {}
@@ -283,6 +287,28 @@ public:
 	static void SetAtomAtom(Window window, AtomType atom, AtomType value);
 
 	static bool IsDeleteAtomSet(Window w);
+
+	/** Read a window property.
+	 * This is XGetWindowProperty, but it will use data prefetched by the
+	 * PropertyLoader when available.
+	 */
+	static int GetProperty(Window w, Atom property, long offset, long length,
+			Atom reqType, Atom *actualType, int *actualFormat,
+			unsigned long *count, unsigned long *bytesAfter,
+			unsigned char **data);
+
+	/*@{*/
+	/** Prefetch-aware versions of the Xlib ICCCM property readers.
+	 * These return the same values as their Xlib counterparts.
+	 */
+	static XWMHints *GetWMHints(Window w);
+	static Status GetClassHint(Window w, XClassHint *hint);
+	static Status GetWMNormalHints(Window w, XSizeHints *hints, long *supplied);
+	static Status GetTransientForHint(Window w, Window *owner);
+	static Status GetWMColormapWindows(Window w, Window **windows, int *count);
+	static Status FetchName(Window w, char **name);
+	/*@}*/
+
 private:
 
 	static char CheckShape(Window win);
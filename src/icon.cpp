@@ -18,6 +18,19 @@
 #include "color.h"
 #include "settings.h"
 #include "border.h"
+#include "Graphics.h"
+#include "event.h"
+
+#include <fcntl.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 IconNode Icons::emptyIcon;
 
@@ -62,6 +75,31 @@ static GC iconGC;
 static char iconSizeSet = 0;
 static char *defaultIconName;
 
+/** An icon loaded in the background. */
+typedef struct IconRequest {
+	std::string name; /**< The requested name. */
+	std::string path; /**< The file that was found. */
+	ImageNode *image; /**< The decoded image or NULL. */
+	char preserveAspect; /**< Set to preserve the aspect ratio. */
+	char deferred; /**< Set if the file must be decoded by the main thread. */
+} IconRequest;
+
+/* The loader thread takes requests from the front of loaderRequests and
+ * appends them to loaderResults once it tried to load them. */
+static std::thread loaderThread;
+static std::mutex loaderMutex;
+static std::condition_variable loaderWake;
+static std::deque<IconRequest> loaderRequests; /**< Protected by loaderMutex. */
+static std::vector<IconRequest> loaderResults; /**< Protected by loaderMutex. */
+static char loaderStopping; /**< Protected by loaderMutex. */
+static std::vector<std::string> loaderPaths; /**< Icon paths for the thread. */
+static int loaderFds[2] = { -1, -1 };
+
+/** Icons requested by name (NULL if they could not be found). */
+static std::unordered_map<std::string, IconNode*> namedIcons;
+static std::unordered_set<std::string> pendingIcons;
+static void (*iconListener)(void) = NULL;
+
 static void DoDestroyIcon(int index, IconNode *icon);
 static IconNode* ReadNetWMIcon(Window win);
 static IconNode* ReadWMHintIcon(Window win);
@@ -80,6 +118,13 @@ static void InsertIcon(IconNode *icon);
 static IconNode* FindIcon(const char *name);
 static unsigned int GetHash(const char *str);
 
+static char StartLoader(void);
+static void StopLoader(void);
+static void RunLoader(void);
+static void LoadRequest(IconRequest *request);
+static char LoadCandidate(const std::string &fileName, IconRequest *request);
+static void HandleLoadedIcons(int fd, void *data);
+
 /** Initialize icon data.
  * This must be initialized before parsing the configuration.
  */
@@ -117,6 +162,9 @@ void Icons::StartupIcons(void) {
 /** Shutdown icon support. */
 void Icons::ShutdownIcons(void) {
 	unsigned int x;
+	StopLoader();
+	namedIcons.clear();
+	pendingIcons.clear();
 	for (x = 0; x < HASH_SIZE; x++) {
 		while (iconHash[x]) {
 			DoDestroyIcon(x, iconHash[x]);
@@ -330,6 +378,255 @@ IconNode* Icons::LoadNamedIcon(const char *name, char save,
 	return NULL;
 }
 
+/** Create an icon from a decoded image. */
+IconNode* Icons::CreateImageIcon(ImageNode *image, const char *name,
+		char preserveAspect) {
+	IconNode *icon = CreateIcon(image);
+	icon->preserveAspect = preserveAspect;
+	icon->name = CopyString(name);
+
+	/* Keeping the image means it is not decoded again when drawn. */
+	icon->images = image;
+	return icon;
+}
+
+/** Look up an icon by name without blocking. */
+char Icons::RequestNamedIcon(const char *name, char preserveAspect,
+		IconNode **icon) {
+	std::unordered_map<std::string, IconNode*>::const_iterator it;
+	IconRequest request;
+
+	Assert(name);
+
+	if (name[0] == 0) {
+		*icon = &emptyIcon;
+		return 1;
+	}
+	it = namedIcons.find(name);
+	if (it != namedIcons.end()) {
+		*icon = it->second;
+		return 1;
+	}
+	if (pendingIcons.count(name)) {
+		return 0;
+	}
+
+	/* Without a loader thread, load it now. */
+	if (JUNLIKELY(loaderFds[0] < 0 && !StartLoader())) {
+		*icon = LoadNamedIcon(name, 1, preserveAspect);
+		namedIcons[name] = *icon;
+		return 1;
+	}
+
+	request.name = name;
+	request.image = NULL;
+	request.preserveAspect = preserveAspect;
+	request.deferred = 0;
+	pendingIcons.insert(request.name);
+	{
+		std::lock_guard<std::mutex> lock(loaderMutex);
+		loaderRequests.push_back(request);
+	}
+	loaderWake.notify_one();
+	return 0;
+}
+
+/** Set the function to call when icons finished loading. */
+void Icons::SetIconListener(void (*listener)(void)) {
+	iconListener = listener;
+}
+
+/** Start the loader thread. */
+char StartLoader(void) {
+	IconPathNode *ip;
+	sigset_t set, old;
+	int i;
+
+#ifdef DEBUG
+	/* The allocation tracker is not thread-safe. */
+	return 0;
+#endif
+
+	if (pipe(loaderFds) < 0) {
+		loaderFds[0] = -1;
+		loaderFds[1] = -1;
+		return 0;
+	}
+	for (i = 0; i < 2; i++) {
+		fcntl(loaderFds[i], F_SETFD, FD_CLOEXEC);
+		fcntl(loaderFds[i], F_SETFL, O_NONBLOCK);
+	}
+
+	/* The paths don't change until the icons are shut down. */
+	loaderPaths.clear();
+	for (ip = iconPaths; ip; ip = ip->next) {
+		loaderPaths.push_back(ip->path);
+	}
+	loaderStopping = 0;
+
+	/* Signals are handled by the main thread only. */
+	sigfillset(&set);
+	pthread_sigmask(SIG_SETMASK, &set, &old);
+	try {
+		loaderThread = std::thread(RunLoader);
+	} catch (const std::system_error&) {
+	}
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+	if (!loaderThread.joinable()) {
+		close(loaderFds[0]);
+		close(loaderFds[1]);
+		loaderFds[0] = -1;
+		loaderFds[1] = -1;
+		return 0;
+	}
+	Events::_RegisterDescriptor(loaderFds[0], HandleLoadedIcons, NULL);
+	return 1;
+}
+
+/** Stop the loader thread and drop the icons it did not deliver. */
+void StopLoader(void) {
+	std::vector<IconRequest>::iterator it;
+	if (loaderThread.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(loaderMutex);
+			loaderStopping = 1;
+		}
+		loaderWake.notify_one();
+		loaderThread.join();
+	}
+	if (loaderFds[0] >= 0) {
+		Events::_UnregisterDescriptor(loaderFds[0]);
+		close(loaderFds[0]);
+		close(loaderFds[1]);
+		loaderFds[0] = -1;
+		loaderFds[1] = -1;
+	}
+	for (it = loaderResults.begin(); it != loaderResults.end(); ++it) {
+		Images::DestroyImage(it->image);
+	}
+	loaderResults.clear();
+	loaderRequests.clear();
+}
+
+/** Load requested icons until stopped (runs on the loader thread). */
+void RunLoader(void) {
+	std::unique_lock<std::mutex> lock(loaderMutex);
+	while (!loaderStopping) {
+		if (loaderRequests.empty()) {
+			loaderWake.wait(lock);
+			continue;
+		}
+		IconRequest request = loaderRequests.front();
+		loaderRequests.pop_front();
+		lock.unlock();
+
+		LoadRequest(&request);
+
+		lock.lock();
+		loaderResults.push_back(request);
+
+		/* If the pipe is full the event loop is already awake. */
+		const char c = 0;
+		ssize_t rc = write(loaderFds[1], &c, 1);
+		(void) rc;
+	}
+}
+
+/** Search the icon paths for a requested icon (runs on the loader thread).
+ * This follows LoadNamedIcon, but files that need the X connection to be
+ * decoded are left to the main thread.
+ */
+void LoadRequest(IconRequest *request) {
+	std::vector<std::string>::const_iterator it;
+	const std::string &name = request->name;
+	unsigned i;
+
+	if (name[0] == '/') {
+		LoadCandidate(name, request);
+		return;
+	}
+
+	for (it = loaderPaths.begin(); it != loaderPaths.end(); ++it) {
+		const std::string base = *it + name;
+		char hasExtension = 0;
+		for (i = 1; i < EXTENSION_COUNT; i++) {
+			const size_t extLength = strlen(ICON_EXTENSIONS[i]);
+			if (base.size() >= extLength
+					&& !base.compare(base.size() - extLength, extLength, ICON_EXTENSIONS[i])) {
+				hasExtension = 1;
+				break;
+			}
+		}
+		if (hasExtension) {
+			if (LoadCandidate(base, request)) {
+				return;
+			}
+		} else {
+			for (i = 0; i < EXTENSION_COUNT; i++) {
+				if (LoadCandidate(base + ICON_EXTENSIONS[i], request)) {
+					return;
+				}
+			}
+		}
+	}
+}
+
+/** Try to load an icon from a file (runs on the loader thread).
+ * @return 1 if the file was loaded or left to the main thread.
+ */
+char LoadCandidate(const std::string &fileName, IconRequest *request) {
+	if (Images::NeedsDisplay(fileName.c_str())) {
+		if (access(fileName.c_str(), R_OK) == 0) {
+			request->path = fileName;
+			request->deferred = 1;
+			return 1;
+		}
+		return 0;
+	}
+	request->image = Images::LoadImage(fileName.c_str(), 0, 0, 1, 0);
+	if (request->image) {
+		request->path = fileName;
+		return 1;
+	}
+	return 0;
+}
+
+/** Turn the images decoded by the loader thread into icons. */
+void HandleLoadedIcons(int fd, void *data) {
+	std::vector<IconRequest> results;
+	std::vector<IconRequest>::iterator it;
+	char buffer[64];
+
+	while (read(fd, buffer, sizeof(buffer)) > 0) {
+	}
+	{
+		std::lock_guard<std::mutex> lock(loaderMutex);
+		results.swap(loaderResults);
+	}
+
+	for (it = results.begin(); it != results.end(); ++it) {
+		IconNode *icon = NULL;
+		ImageNode *image = it->image;
+		if (it->deferred) {
+			image = Images::LoadImage(it->path.c_str(), 0, 0, 1);
+		}
+		if (image) {
+			icon = CreateIcon(image);
+			icon->preserveAspect = it->preserveAspect;
+			icon->name = CopyString(it->path.c_str());
+			InsertIcon(icon);
+			Images::DestroyImage(image);
+		}
+		pendingIcons.erase(it->name);
+		namedIcons[it->name] = icon;
+	}
+
+	if (!results.empty() && iconListener) {
+		(iconListener)();
+	}
+}
+
 /** Helper for loading icons by name. */
 IconNode* LoadNamedIconHelper(const char *name, const char *path, char save,
 		char preserveAspect) {
@@ -402,8 +699,8 @@ IconNode* ReadNetWMIcon(Window win) {
 	Atom realType;
 	int realFormat;
 	unsigned char *data;
-	status = JXGetWindowProperty(display, win, Hints::atoms[ATOM_NET_WM_ICON],
-			0, MAX_LENGTH, False, XA_CARDINAL, &realType, &realFormat, &count,
+	status = Hints::GetProperty(win, Hints::atoms[ATOM_NET_WM_ICON],
+			0, MAX_LENGTH, XA_CARDINAL, &realType, &realFormat, &count,
 			&extra, &data);
 	if (status == Success && realFormat != 0 && data) {
 		icon = CreateIconFromBinary((unsigned long*) data, count);
@@ -415,7 +712,7 @@ IconNode* ReadNetWMIcon(Window win) {
 /** Read the icon WMHint property from a client. */
 IconNode* ReadWMHintIcon(Window win) {
 	IconNode *icon = NULL;
-	XWMHints *hints = JXGetWMHints(display, win);
+	XWMHints *hints = Hints::GetWMHints(win);
 	if (hints) {
 		Drawable d = None;
 		Pixmap mask = None;
@@ -640,7 +937,7 @@ ScaledIconNode* GetScaledIcon(IconNode *icon, long fg, int rwidth,
 
 	/* Create a mask. */
 	np->mask = JXCreatePixmap(display, rootWindow, nwidth, nheight, 1);
-	maskGC = JXCreateGC(display, np->mask, 0, NULL);
+	maskGC = Graphics::AcquireGC(1);
 	JXSetForeground(display, maskGC, 0);
 	JXFillRectangle(display, np->mask, maskGC, 0, 0, nwidth, nheight);
 	JXSetForeground(display, maskGC, 1);
@@ -703,7 +1000,7 @@ ScaledIconNode* GetScaledIcon(IconNode *icon, long fg, int rwidth,
 	delete[] points;
 
 	/* Release the mask GC. */
-	JXFreeGC(display, maskGC);
+	Graphics::ReleaseGC(maskGC);
 
 	/* Create the color data pixmap. */
 	np->image = JXCreatePixmap(display, rootWindow, nwidth, nheight, rootDepth);
@@ -93,6 +93,31 @@ public:
 	 */
 	static IconNode *LoadNamedIcon(const char *name, char save, char preserveAspect);
 
+	/** Create an icon from a decoded image.
+	 * @param image The image (owned by the icon afterwards).
+	 * @param name The file the image was loaded from.
+	 * @param preserveAspect Set to preserve the aspect ratio when scaling.
+	 * @return The icon (destroy with DestroyIcon).
+	 */
+	static IconNode *CreateImageIcon(struct ImageNode *image, const char *name,
+			char preserveAspect);
+
+	/** Look up an icon by name without blocking.
+	 * Icons that are not loaded yet are searched for and decoded on a
+	 * background thread; the icon listener is called once they arrive.
+	 * @param name The name of the icon.
+	 * @param preserveAspect Set to preserve the aspect ratio when scaling.
+	 * @param icon Set to the icon (NULL if not found) if it is available.
+	 * @return 1 if icon was set, 0 if the icon is still loading.
+	 */
+	static char RequestNamedIcon(const char *name, char preserveAspect,
+			IconNode **icon);
+
+	/** Set the function called when requested icons finished loading.
+	 * @param listener The function (NULL for none).
+	 */
+	static void SetIconListener(void (*listener)(void));
+
 	/** Load the default icon.
 	 * @return The default icon.
 	 */
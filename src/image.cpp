@@ -15,6 +15,8 @@
 #include "color.h"
 #include "misc.h"
 
+#include <mutex>
+
 typedef ImageNode* (*ImageLoader)(const char *fileName, int rwidth, int rheight,
     char preserveAspect);
 
@@ -22,30 +24,34 @@ typedef ImageNode* (*ImageLoader)(const char *fileName, int rwidth, int rheight,
 static const struct {
   const char *extension;
   ImageLoader loader;
+  char usesDisplay; /**< Set if the loader talks to the X server. */
 } IMAGE_LOADERS[] = {
 #ifdef USE_PNG
-    { ".png", Images::LoadPNGImage },
+    { ".png", Images::LoadPNGImage, 0 },
 #endif
 #ifdef USE_JPEG
-    { ".jpg", Images::LoadJPEGImage }, { ".jpeg", Images::LoadJPEGImage },
+    { ".jpg", Images::LoadJPEGImage, 0 }, { ".jpeg", Images::LoadJPEGImage, 0 },
 #endif
 #ifdef USE_CAIRO
 #ifdef USE_RSVG
-    { ".svg", Images::LoadSVGImage },
+    { ".svg", Images::LoadSVGImage, 0 },
 #endif
 #endif
 #ifdef USE_XPM
-    { ".xpm", Images::LoadXPMImage },
+    { ".xpm", Images::LoadXPMImage, 1 },
 #endif
 #ifdef USE_XBM
-    { ".xbm", Images::LoadXBMImage },
+    { ".xbm", Images::LoadXBMImage, 0 },
 #endif
     };
 static const unsigned IMAGE_LOADER_COUNT = ARRAY_LENGTH(IMAGE_LOADERS);
 
+/** Serializes the loaders, some of which keep static state. */
+static std::mutex loaderLock;
+
 /** Load an image from the specified file. */
 ImageNode* Images::LoadImage(const char *fileName, int rwidth, int rheight,
-    char preserveAspect) {
+    char preserveAspect, char useDisplay) {
   unsigned i;
   unsigned name_length;
   ImageNode *result = NULL;
@@ -64,6 +70,8 @@ ImageNode* Images::LoadImage(const char *fileName, int rwidth, int rheight,
     return result;
   }
 
+  std::lock_guard<std::mutex> lock(loaderLock);
+
   /* First we attempt to use the extension to determine the type
    * to avoid trying all loaders. */
   for (i = 0; i < IMAGE_LOADER_COUNT; i++) {
@@ -73,6 +81,9 @@ ImageNode* Images::LoadImage(const char *fileName, int rwidth, int rheight,
       const unsigned offset = name_length - ext_length;
       if (!StrCmpNoCase(&fileName[offset], ext)) {
         const ImageLoader loader = IMAGE_LOADERS[i].loader;
+        if (IMAGE_LOADERS[i].usesDisplay && !useDisplay) {
+          break;
+        }
         result = (loader)(fileName, rwidth, rheight, preserveAspect);
         if (JLIKELY(result)) {
           return result;
@@ -85,6 +96,9 @@ ImageNode* Images::LoadImage(const char *fileName, int rwidth, int rheight,
   /* We were unable to load by extension, so try everything. */
   for (i = 0; i < IMAGE_LOADER_COUNT; i++) {
     const ImageLoader loader = IMAGE_LOADERS[i].loader;
+    if (IMAGE_LOADERS[i].usesDisplay && !useDisplay) {
+      continue;
+    }
     result = (loader)(fileName, rwidth, rheight, preserveAspect);
     if (result) {
       /* We were able to load the image, so it must have either the
@@ -99,6 +113,21 @@ ImageNode* Images::LoadImage(const char *fileName, int rwidth, int rheight,
   return result;
 }
 
+/** Determine if loading a file needs the X connection. */
+char Images::NeedsDisplay(const char *fileName) {
+  const unsigned name_length = strlen(fileName);
+  unsigned i;
+  for (i = 0; i < IMAGE_LOADER_COUNT; i++) {
+    const char *ext = IMAGE_LOADERS[i].extension;
+    const unsigned ext_length = strlen(ext);
+    if (name_length >= ext_length
+        && !StrCmpNoCase(&fileName[name_length - ext_length], ext)) {
+      return IMAGE_LOADERS[i].usesDisplay;
+    }
+  }
+  return 0;
+}
+
 /** Load an image from a pixmap. */
 #ifdef USE_ICONS
 ImageNode* Images::LoadImageFromDrawable(Drawable pmap, Pixmap mask) {
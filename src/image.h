@@ -51,10 +51,19 @@ public:
    * @param rwidth The preferred width.
    * @param rheight The preferred height.
    * @param preserveAspect Set to preserve image aspect when scaling.
+   * @param useDisplay Clear to skip formats that need the X connection.
+   *        This must be clear when loading from another thread.
    * @return A new image node (NULL if the image could not be loaded).
    */
   static ImageNode *LoadImage(const char *fileName, int rwidth, int rheight,
-      char preserveAspect);
+      char preserveAspect, char useDisplay = 1);
+
+  /** Determine if loading a file needs the X connection.
+   * This is decided by the extension of the file.
+   * @param fileName The file containing the image.
+   * @return 1 if the file must be loaded from the main thread.
+   */
+  static char NeedsDisplay(const char *fileName);
 
   /** Load an image from a Drawable.
    * @param pmap The drawable.
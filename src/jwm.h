@@ -100,6 +100,12 @@
 #  ifdef USE_XRENDER
 #     include <X11/extensions/Xrender.h>
 #  endif
+#  ifdef USE_XCOMPOSITE
+#     include <X11/extensions/Xcomposite.h>
+#  endif
+#  ifdef USE_XDAMAGE
+#     include <X11/extensions/Xdamage.h>
+#  endif
 #  ifdef USE_FRIBIDI
 #     include <fribidi/fribidi.h>
 #  endif
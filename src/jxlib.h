@@ -225,6 +225,8 @@
 #define JXInstallColormap( a, b ) JFUNC2(XInstallColormap, a, b)
 
 #define JXInternAtom( a, b, c ) JFUNC3(XInternAtom, a, b, c)
+#define JXInternAtoms( a, b, c, d, e ) \
+   JFUNC5(XInternAtoms, a, b, c, d, e)
 
 #define JXKeysymToKeycode( a, b ) JFUNC2(XKeysymToKeycode, a, b)
 
@@ -232,6 +234,8 @@
 
 #define JXLoadQueryFont( a, b ) JFUNC2(XLoadQueryFont, a, b)
 
+#define JXLookupString( a, b, c, d, e ) JFUNC5(XLookupString, a, b, c, d, e)
+
 #define JXMapRaised( a, b ) JFUNC2(XMapRaised, a, b)
 
 #define JXMapWindow( a, b ) JFUNC2(XMapWindow, a, b)
@@ -300,6 +304,8 @@
 
 #define JXSetInputFocus( a, b, c, d ) JFUNC4(XSetInputFocus, a, b, c, d)
 
+#define JXSetSubwindowMode( a, b, c ) JFUNC3(XSetSubwindowMode, a, b, c)
+
 #define JXSetWindowBackground( a, b, c ) JFUNC3(XSetWindowBackground, a, b, c)
 
 #define JXSetWindowBorderWidth( a, b, c ) \
@@ -413,4 +419,35 @@
 #define JXRenderComposite( a, b, c, d, e, f, g, h, i, j, k, l, m ) \
    JFUNC13(XRenderComposite, a, b, c, d, e, f, g, h, i, j, k, l, m)
 
+#define JXRenderSetPictureTransform( a, b, c ) \
+   JFUNC3(XRenderSetPictureTransform, a, b, c)
+
+#define JXRenderSetPictureFilter( a, b, c, d, e ) \
+   JFUNC5(XRenderSetPictureFilter, a, b, c, d, e)
+
+/* Xcomposite */
+
+#define JXCompositeQueryExtension( a, b, c ) \
+   JFUNC3(XCompositeQueryExtension, a, b, c)
+
+#define JXCompositeRedirectWindow( a, b, c ) \
+   JFUNC3(XCompositeRedirectWindow, a, b, c)
+
+#define JXCompositeUnredirectWindow( a, b, c ) \
+   JFUNC3(XCompositeUnredirectWindow, a, b, c)
+
+#define JXCompositeNameWindowPixmap( a, b ) \
+   JFUNC2(XCompositeNameWindowPixmap, a, b)
+
+/* Xdamage */
+
+#define JXDamageQueryExtension( a, b, c ) \
+   JFUNC3(XDamageQueryExtension, a, b, c)
+
+#define JXDamageCreate( a, b, c ) JFUNC3(XDamageCreate, a, b, c)
+
+#define JXDamageDestroy( a, b ) JFUNC2(XDamageDestroy, a, b)
+
+#define JXDamageSubtract( a, b, c, d ) JFUNC4(XDamageSubtract, a, b, c, d)
+
 #endif /* JXLIB_H */
@@ -12,13 +12,10 @@
 #include "error.h"
 #include "misc.h"
 
-/** Amount to increase allocations by when reading text. */
-static const int BLOCK_SIZE = 16;
+#include <sys/mman.h>
 
-/** Mapping between token names and tokens.
- * These must be sorted.
- */
-static const StringMappingType TOKEN_MAP[] = {
+/** Mapping between token names and tokens. */
+static constexpr StringMappingType TOKEN_MAP[] = {
     { "Active", TOK_ACTIVE }, //
     { "Background", TOK_BACKGROUND }, //
     { "Battery", TOK_BATTERY }, //
@@ -37,35 +34,205 @@ static const StringMappingType TOKEN_MAP[] = {
         "Resize", TOK_RESIZE }, { "ResizeMode", TOK_RESIZEMODE }, { "Restart", TOK_RESTART }, { "RestartCommand",
         TOK_RESTARTCOMMAND }, { "RootMenu", TOK_ROOTMENU }, { "SendTo", TOK_SENDTO }, { "Separator", TOK_SEPARATOR }, {
         "Shade", TOK_SHADE }, { "ShutdownCommand", TOK_SHUTDOWNCOMMAND }, { "SnapMode", TOK_SNAPMODE }, { "Spacer",
-        TOK_SPACER }, { "StartupCommand", TOK_STARTUPCOMMAND }, { "Stick", TOK_STICK }, { "Swallow", TOK_SWALLOW }, {
+        TOK_SPACER }, { "StartupCommand", TOK_STARTUPCOMMAND }, { "Status", TOK_STATUS }, { "Stick", TOK_STICK }, { "Swallow", TOK_SWALLOW }, {
         "TaskList", TOK_TASKLIST }, { "TaskListStyle", TOK_TASKLISTSTYLE }, { "Text", TOK_TEXT }, { "TitleButtonOrder",
         TOK_TITLEBUTTONORDER }, { "Tray", TOK_TRAY }, { "TrayButton", TOK_TRAYBUTTON }, { "TrayButtonStyle",
         TOK_TRAYBUTTONSTYLE }, { "TrayStyle", TOK_TRAYSTYLE }, { "Width", TOK_WIDTH },
     { "WindowStyle", TOK_WINDOWSTYLE } };
-static const unsigned int TOKEN_MAP_COUNT = ARRAY_LENGTH(TOKEN_MAP);
+static constexpr unsigned int TOKEN_MAP_COUNT = ARRAY_LENGTH(TOKEN_MAP);
+
+/** Size of the first block of a token arena. */
+static const size_t ARENA_BLOCK_SIZE = 4096;
+
+/** Size that the blocks of a token arena stop growing at. */
+static const size_t ARENA_MAX_BLOCK_SIZE = 65536;
+
+/** Memory for a token tree.
+ * Tokens and copied strings are carved out of blocks that are only freed
+ * with the arena. Strings that need no decoding point into the buffer
+ * being tokenized, which the arena owns if it is a mapped file.
+ */
+struct TokenArena {
+
+  /** Header of a block, followed by its memory. */
+  struct Block {
+    Block *next;
+    size_t size;
+    size_t used;
+  };
+
+  Block *blocks;        /**< Blocks, the current one first. */
+  size_t nextSize;      /**< Size of the next block. */
+  char *mapping;        /**< Mapped file that strings point into. */
+  size_t mappingSize;   /**< Size of the mapped file. */
+  TokenArena *adopted;  /**< Arenas of tokens moved into this tree. */
+  TokenArena *sibling;  /**< Next arena adopted by the same arena. */
+
+  TokenArena() :
+      blocks(NULL), nextSize(ARENA_BLOCK_SIZE), mapping(NULL), mappingSize(0),
+      adopted(NULL), sibling(NULL) {
+  }
+
+  ~TokenArena() {
+    while (blocks) {
+      Block *next = blocks->next;
+      delete[] (char*) blocks;
+      blocks = next;
+    }
+    if (mapping) {
+      munmap(mapping, mappingSize);
+    }
+    while (adopted) {
+      TokenArena *next = adopted->sibling;
+      delete adopted;
+      adopted = next;
+    }
+  }
+
+  /** Get uninitialized memory aligned for any token structure. */
+  void *AllocateBytes(size_t size) {
+    size = (size + 7) & ~(size_t) 7;
+    if (JUNLIKELY(!blocks || blocks->used + size > blocks->size)) {
+      const size_t blockSize = Max(nextSize, size);
+      Block *bp = (Block*) new char[sizeof(Block) + blockSize];
+      bp->size = blockSize;
+      bp->used = 0;
+      bp->next = blocks;
+      blocks = bp;
+      nextSize = Min(nextSize * 2, ARENA_MAX_BLOCK_SIZE);
+    }
+    char *result = (char*) (blocks + 1) + blocks->used;
+    blocks->used += size;
+    return result;
+  }
+
+  /** Copy a string into the arena. */
+  char *CopyBytes(const char *str, size_t len) {
+    char *result = (char*) AllocateBytes(len + 1);
+    memcpy(result, str, len);
+    result[len] = 0;
+    return result;
+  }
+
+};
+
+/** A string found by the lexer.
+ * Unless it was copied, the string is not terminated until the lexer
+ * moved past its end.
+ */
+typedef struct {
+  char *start;       /**< First character. */
+  unsigned length;   /**< Length after trimming. */
+  unsigned offset;   /**< Characters consumed from the buffer. */
+  bool copied;       /**< Set if decoded into the arena (and terminated). */
+} TokenView;
+
+/** Size of the tag name hash table (a power of two). */
+#define TOKEN_HASH_SIZE 1024
+
+/** Seeds to try for a perfect hash of the tag names. */
+#define TOKEN_HASH_TRIES 1000
+
+/** Perfect hash table of the tag names, built at compile time. */
+typedef struct {
+  unsigned seed;
+  unsigned char slots[TOKEN_HASH_SIZE];  /**< TOKEN_MAP index + 1 or 0. */
+} TokenHashTable;
+
+/** Hash a tag name. */
+static constexpr unsigned HashName(unsigned seed, const char *name,
+    unsigned len) {
+  unsigned hash = 2166136261U ^ seed;
+  for (unsigned i = 0; i < len; i++) {
+    hash ^= (unsigned char) name[i];
+    hash *= 16777619U;
+  }
+  return (hash ^ (hash >> 15)) & (TOKEN_HASH_SIZE - 1);
+}
+
+/** Get the length of a tag name. */
+static constexpr unsigned NameLength(const char *name) {
+  unsigned len = 0;
+  while (name[len]) {
+    len += 1;
+  }
+  return len;
+}
+
+/** Find a seed for which no two tag names share a slot. */
+static constexpr TokenHashTable CreateTokenHash() {
+  TokenHashTable table = { };
+  for (table.seed = 0; table.seed < TOKEN_HASH_TRIES; table.seed++) {
+    bool found = true;
+    for (unsigned i = 0; i < TOKEN_HASH_SIZE; i++) {
+      table.slots[i] = 0;
+    }
+    for (unsigned i = 0; found && i < TOKEN_MAP_COUNT; i++) {
+      const char *key = TOKEN_MAP[i].key;
+      const unsigned h = HashName(table.seed, key, NameLength(key));
+      if (table.slots[h]) {
+        found = false;
+      } else {
+        table.slots[h] = i + 1;
+      }
+    }
+    if (found) {
+      break;
+    }
+  }
+  return table;
+}
+
+static constexpr TokenHashTable TOKEN_HASH = CreateTokenHash();
+static_assert(TOKEN_MAP_COUNT < 255, "too many tokens for the hash table");
+static_assert(TOKEN_HASH.seed < TOKEN_HASH_TRIES,
+    "no perfect hash for the tag names, increase TOKEN_HASH_SIZE");
 
 static TokenNode *head;
+static TokenArena *arena;
 
+static TokenNode *TokenizeBuffer(char *line, const char *fileName);
 static TokenNode *CreateNode(TokenNode *current, const char *file, unsigned int line);
 static AttributeNode *CreateAttribute(TokenNode *np);
+static char *AppendValue(char *value, const TokenView *view);
 
 static bool IsElementEnd(char ch);
 static bool IsValueEnd(char ch);
 static bool IsAttributeEnd(char ch);
-static char *ReadElementName(const char *line);
-static char *ReadValue(const char *line, const char *file, bool (*IsEnd)(char), unsigned int *offset,
-    unsigned int *lineNumber);
-static char *ReadElementValue(const char *line, const char *file, unsigned int *offset, unsigned int *lineNumber);
-static char *ReadAttributeValue(const char *line, const char *file, unsigned int *offset, unsigned int *lineNumber);
+static unsigned ReadElementName(const char *line);
+static TokenView ReadValue(char *line, const char *file, bool (*IsEnd)(char), unsigned int *lineNumber);
+static TokenView ReadElementValue(char *line, const char *file, unsigned int *lineNumber);
+static TokenView ReadAttributeValue(char *line, const char *file, unsigned int *lineNumber);
 static int ParseEntity(const char *entity, char *ch, const char *file, unsigned int line);
-static TokenType LookupType(const char *name, TokenNode *np);
+static TokenType LookupType(const char *name, unsigned len, TokenNode *np);
 
 /** Tokenize data. */
 TokenNode *Tokenize(const char *line, const char *fileName) {
+  arena = new TokenArena();
+  return TokenizeBuffer(arena->CopyBytes(line, strlen(line)), fileName);
+}
+
+/** Tokenize a mapped file in place. */
+TokenNode *TokenizeMapping(char *buffer, size_t size, const char *fileName) {
+  arena = new TokenArena();
+  if (size % sysconf(_SC_PAGESIZE) == 0) {
+    /* Nothing after the file terminates it. */
+    char *copy = arena->CopyBytes(buffer, size);
+    munmap(buffer, size);
+    return TokenizeBuffer(copy, fileName);
+  }
+  arena->mapping = buffer;
+  arena->mappingSize = size;
+  return TokenizeBuffer(buffer, fileName);
+}
+
+/** Tokenize a terminated, writable buffer owned by the arena. */
+TokenNode *TokenizeBuffer(char *line, const char *fileName) {
   TokenNode *current;
-  char *temp;
+  TokenView view;
+  char *pending;
   unsigned x;
-  unsigned offset;
+  unsigned len;
   unsigned lineNumber;
   char inElement;
 
@@ -74,6 +241,15 @@ TokenNode *Tokenize(const char *line, const char *fileName) {
   inElement = 0;
   lineNumber = 1;
 
+  /* End of the last view, which is terminated once the lexer is past
+   * it since the lexer still needs the character there. */
+  pending = NULL;
+#define TERMINATE_PENDING() \
+  if (pending && line + x > pending) { \
+    *pending = 0; \
+    pending = NULL; \
+  }
+
   x = 0;
   /* Skip any initial white space. */
   while (IsSpace(line[x], &lineNumber)) {
@@ -121,75 +297,79 @@ TokenNode *Tokenize(const char *line, const char *fileName) {
       }
 
     } while (found);
+    TERMINATE_PENDING();
 
     switch (line[x]) {
     case '<':
       x += 1;
+      TERMINATE_PENDING();
       if (line[x] == '/') {
 
         /* Close tag. */
         x += 1;
-        temp = ReadElementName(line + x);
+        len = ReadElementName(line + x);
         if (current) {
-          if (JLIKELY(temp)) {
-            if (JUNLIKELY(current->type != LookupType(temp, NULL))) {
-              Warning(_("%s[%u]: close tag \"%s\" does not "
-                  "match open tag \"%s\""), fileName, lineNumber, temp, GetTokenName(current));
+          if (JLIKELY(len)) {
+            if (JUNLIKELY(current->type != LookupType(line + x, len, NULL))) {
+              Warning(_("%s[%u]: close tag \"%.*s\" does not "
+                  "match open tag \"%s\""), fileName, lineNumber, len, line + x, GetTokenName(current));
             }
           } else {
             Warning(_("%s[%u]: unexpected and invalid close tag"), fileName, lineNumber);
           }
           current = current->parent;
         } else {
-          if (temp) {
-            Warning(_("%s[%u]: close tag \"%s\" without open tag"), fileName, lineNumber, temp);
+          if (len) {
+            Warning(_("%s[%u]: close tag \"%.*s\" without open tag"), fileName, lineNumber, len, line + x);
           } else {
             Warning(_("%s[%u]: invalid close tag"), fileName, lineNumber);
           }
         }
-        if (temp) {
-          x += strlen(temp);
-          delete[] temp;
-        }
+        x += len;
 
       } else if (current && !strncmp(line + x, "![CDATA[", 8)) {
 
-        int start, stop;
+        unsigned start, stop;
 
         /* CDATA */
         x += 8;
         start = x;
+        stop = 0;
         while (line[x]) {
           lineNumber += line[x] == '\n';
           if (!strncmp(line + x, "]]>", 3)) {
+            stop = x;
             x += 3;
             break;
           }
           x += 1;
         }
-        stop = x - 3;
+        if (!stop) {
+          stop = x;
+        }
         if (JLIKELY(stop > start)) {
-          const unsigned new_len = stop - start;
-          unsigned value_len = 0;
+          view.start = line + start;
+          view.length = stop - start;
           if (current->value) {
-            value_len = strlen(current->value);
-            current->value = (char*)Reallocate(current->value, value_len + new_len + 1);
+            current->value = AppendValue(current->value, &view);
           } else {
-            current->value = new char[new_len + 1];
+            current->value = view.start;
+            if (view.start + view.length < line + x) {
+              view.start[view.length] = 0;
+            } else {
+              pending = view.start + view.length;
+            }
           }
-          memcpy(&current->value[value_len], &line[start], new_len);
-          current->value[value_len + new_len] = 0;
         }
 
       } else {
 
         /* Open tag. */
         current = CreateNode(current, fileName, lineNumber);
-        temp = ReadElementName(line + x);
-        if (JLIKELY(temp)) {
-          x += strlen(temp);
-          LookupType(temp, current);
-          delete[] temp;
+        len = ReadElementName(line + x);
+        if (JLIKELY(len)) {
+          LookupType(line + x, len, current);
+          x += len;
         } else {
           Warning(_("%s[%u]: invalid open tag"), fileName, lineNumber);
         }
@@ -227,54 +407,83 @@ TokenNode *Tokenize(const char *line, const char *fileName) {
         /* In the open tag; read attributes. */
         if (current) {
           AttributeNode *ap = CreateAttribute(current);
-          ap->name = ReadElementName(line + x);
-          if (ap->name) {
-            x += strlen(ap->name);
-            if (line[x] == '=') {
-              x += 1;
-            }
-            if (line[x] == '\"') {
-              x += 1;
-            }
-            ap->value = ReadAttributeValue(line + x, fileName, &offset, &lineNumber);
-            x += offset;
-            if (line[x] == '\"') {
-              x += 1;
-            }
+          char *name = line + x;
+          len = ReadElementName(name);
+          x += len;
+          if (line[x] == '=') {
+            /* The lexer is done with the '='. */
+            x += 1;
+            name[len] = 0;
+            ap->name = name;
+          } else {
+            ap->name = arena->CopyBytes(name, len);
           }
+          if (line[x] == '\"') {
+            x += 1;
+          }
+          view = ReadAttributeValue(line + x, fileName, &lineNumber);
+          x += view.offset;
+          if (line[x] == '\"') {
+            x += 1;
+          }
+          if (!view.copied) {
+            view.start[view.length] = 0;
+          }
+          ap->value = view.start;
         }
 
       } else {
 
         /* In tag body; read text. */
-        temp = ReadElementValue(line + x, fileName, &offset, &lineNumber);
-        x += offset;
-        if (temp) {
-          if (current) {
-            if (current->value) {
-              const unsigned value_len = strlen(current->value);
-              const unsigned temp_len = strlen(temp);
-              current->value = (char*)Reallocate(current->value, value_len + temp_len + 1);
-              memcpy(&current->value[value_len], temp, temp_len + 1);
-              Release(temp);
-            } else {
-              current->value = temp;
-            }
+        view = ReadElementValue(line + x, fileName, &lineNumber);
+        x += view.offset;
+        if (current) {
+          if (current->value) {
+            current->value = AppendValue(current->value, &view);
+          } else if (view.copied) {
+            current->value = view.start;
           } else {
-            if (JUNLIKELY(temp[0])) {
-              Warning(_("%s[%u]: unexpected text: \"%s\""), fileName, lineNumber, temp);
+            current->value = view.start;
+            if (view.start + view.length < line + x) {
+              view.start[view.length] = 0;
+            } else {
+              pending = view.start + view.length;
             }
-            delete[] temp;
           }
+        } else if (JUNLIKELY(view.length)) {
+          Warning(_("%s[%u]: unexpected text: \"%.*s\""), fileName, lineNumber, view.length, view.start);
         }
       }
       break;
     }
   }
+  TERMINATE_PENDING();
+  if (pending) {
+    *pending = 0;
+  }
+#undef TERMINATE_PENDING
 
+  if (head) {
+    head->arena = arena;
+  } else {
+    delete arena;
+  }
+  arena = NULL;
   return head;
 }
 
+/** Append a string to the value of a token. */
+char *AppendValue(char *value, const TokenView *view) {
+  const unsigned len = strlen(value);
+  char *result;
+
+  result = (char*) arena->AllocateBytes(len + view->length + 1);
+  memcpy(result, value, len);
+  memcpy(&result[len], view->start, view->length);
+  result[len + view->length] = 0;
+  return result;
+}
+
 /** Parse an entity reference.
  * The entity value is returned in ch and the length of the entity
  * is returned as the value of the function.
@@ -342,94 +551,102 @@ bool IsValueEnd(char ch) {
   return ch == '\0' || ch == '<';
 }
 
-/** Get the name of the next element. */
-char *ReadElementName(const char *line) {
-
-  char *buffer;
-  unsigned int len;
-
-  /* Get the length of the element. */
+/** Get the length of the name of the next element. */
+unsigned ReadElementName(const char *line) {
+  unsigned len;
   for (len = 0; !IsElementEnd(line[len]); len++)
     ;
-
-  /* Allocate space for the element. */
-  buffer = new char[len + 1];
-  memcpy(buffer, line, len);
-  buffer[len] = 0;
-
-  return buffer;
-
+  return len;
 }
 
-/** Read the value of an element or attribute. */
-char *ReadValue(const char *line, const char *file, bool (*IsEnd)(char), unsigned int *offset,
-    unsigned int *lineNumber) {
-  char *buffer = NULL;
-  char ch;
-  unsigned int len, max;
+/** Read the value of an element or attribute.
+ * The value is trimmed and left in the buffer unless it contains
+ * entities, in which case it is decoded into the arena.
+ */
+TokenView ReadValue(char *line, const char *file, bool (*IsEnd)(char), unsigned int *lineNumber) {
+  TokenView view;
+  unsigned int dummy = 0;
+  unsigned int lines = 0;
   unsigned int x;
+  unsigned int end;
+  bool entities = false;
+  char *buffer;
+  char ch;
 
-  len = 0;
-  max = BLOCK_SIZE;
-  buffer = new char[max + 1];
-  memset(buffer, 0, max+1);
+  for (end = 0; !(IsEnd)(line[end]); end++) {
+    lines += line[end] == '\n';
+    entities |= line[end] == '&';
+  }
+  view.offset = end;
+
+  if (JLIKELY(!entities)) {
+    *lineNumber += lines;
+    for (x = 0; x < end && IsSpace(line[x], &dummy); x++)
+      ;
+    while (end > x && IsSpace(line[end - 1], &dummy)) {
+      end -= 1;
+    }
+    view.start = line + x;
+    view.length = end - x;
+    view.copied = false;
+    return view;
+  }
 
-  for (x = 0; !(IsEnd)(line[x]); x++) {
+  /* Entities only ever get shorter when decoded. */
+  buffer = (char*) arena->AllocateBytes(end + 1);
+  view.length = 0;
+  for (x = 0; x < end; x++) {
     if (line[x] == '&') {
       x += ParseEntity(line + x, &ch, file, *lineNumber) - 1;
       if (ch) {
-        buffer[len] = ch;
+        buffer[view.length] = ch;
       } else {
-        buffer[len] = line[x];
+        buffer[view.length] = line[x];
       }
     } else {
       if (line[x] == '\n') {
         *lineNumber += 1;
       }
-      buffer[len] = line[x];
-    }
-    len += 1;
-    if (len >= max) {
-      max += BLOCK_SIZE;
-      delete[] buffer;
-      buffer = new char[max + 1];
-      memset(buffer, 0, max+1);
-      if (JUNLIKELY(buffer == NULL)) {
-        FatalError(_("out of memory"));
-      }
+      buffer[view.length] = line[x];
     }
+    view.length += 1;
   }
-  buffer[len] = 0;
+  buffer[view.length] = 0;
   Trim(buffer);
-  *offset = x;
-
-  return buffer;
+  view.start = buffer;
+  view.length = strlen(buffer);
+  view.copied = true;
+  return view;
 }
 
 /** Get the value of the current element. */
-char *ReadElementValue(const char *line, const char *file, unsigned int *offset, unsigned int *lineNumber) {
-  return ReadValue(line, file, IsValueEnd, offset, lineNumber);
+TokenView ReadElementValue(char *line, const char *file, unsigned int *lineNumber) {
+  return ReadValue(line, file, IsValueEnd, lineNumber);
 }
 
 /** Get the value of the current attribute. */
-char *ReadAttributeValue(const char *line, const char *file, unsigned int *offset, unsigned int *lineNumber) {
-  return ReadValue(line, file, IsAttributeEnd, offset, lineNumber);
+TokenView ReadAttributeValue(char *line, const char *file, unsigned int *lineNumber) {
+  return ReadValue(line, file, IsAttributeEnd, lineNumber);
 }
 
 /** Get the token for a tag name. */
-TokenType LookupType(const char *name, TokenNode *np) {
-  const TokenType x = (TokenType)FindValue(TOKEN_MAP, TOKEN_MAP_COUNT, name);
-  if (x >= 0) {
-    if (np) {
-      np->type = x;
+TokenType LookupType(const char *name, unsigned len, TokenNode *np) {
+  const unsigned slot = TOKEN_HASH.slots[HashName(TOKEN_HASH.seed, name, len)];
+  if (JLIKELY(slot)) {
+    const StringMappingType *mp = &TOKEN_MAP[slot - 1];
+    if (!strncmp(mp->key, name, len) && mp->key[len] == 0) {
+      const TokenType x = (TokenType) mp->value;
+      if (np) {
+        np->type = x;
+      }
+      return x;
     }
-    return x;
   }
 
-  Warning(_("CRAP %s is set to type %d"), name, x);
+  Warning(_("CRAP %.*s is set to type %d"), len, name, -1);
   if (JUNLIKELY(np)) {
     np->type = TOK_INVALID;
-    np->invalidName = CopyString(name);
+    np->invalidName = arena->CopyBytes(name, len);
   }
 
   return TOK_INVALID;
@@ -455,7 +672,7 @@ const char *GetTokenTypeName(TokenType type) {
 TokenNode *CreateNode(TokenNode *current, const char *file, unsigned int line) {
   TokenNode *np;
 
-  np = new TokenNode;
+  np = (TokenNode*) arena->AllocateBytes(sizeof(TokenNode));
   np->type = TOK_INVALID;
   np->value = NULL;
   np->attributes = NULL;
@@ -463,6 +680,7 @@ TokenNode *CreateNode(TokenNode *current, const char *file, unsigned int line) {
   np->subnodeTail = NULL;
   np->parent = current;
   np->next = NULL;
+  np->arena = NULL;
 
   np->fileName = file;
   np->line = line;
@@ -487,8 +705,8 @@ TokenNode *CreateNode(TokenNode *current, const char *file, unsigned int line) {
 
     /* A duplicate top-level node.
      * This is probably a configuration error.
+     * The node is left in the arena.
      */
-    ReleaseTokens(np);
     np = head->subnodeTail ? head->subnodeTail : head;
 
   }
@@ -499,7 +717,7 @@ TokenNode *CreateNode(TokenNode *current, const char *file, unsigned int line) {
 /** Create an empty XML attribute node. */
 AttributeNode *CreateAttribute(TokenNode *np) {
   AttributeNode *ap;
-  ap = new AttributeNode;
+  ap = (AttributeNode*) arena->AllocateBytes(sizeof(AttributeNode));
   ap->name = NULL;
   ap->value = NULL;
   ap->next = np->attributes;
@@ -507,41 +725,20 @@ AttributeNode *CreateAttribute(TokenNode *np) {
   return ap;
 }
 
+/** Make tokens live as long as another tree. */
+void AdoptTokens(TokenNode *dest, TokenNode *src) {
+  while (dest->parent) {
+    dest = dest->parent;
+  }
+  Assert(dest->arena && src->arena);
+  src->arena->sibling = dest->arena->adopted;
+  dest->arena->adopted = src->arena;
+  src->arena = NULL;
+}
+
 /** Release a token list. */
 void ReleaseTokens(TokenNode *np) {
-
-  AttributeNode *ap;
-  TokenNode *tp;
-
-  while (np) {
-    tp = np->next;
-
-    while (np->attributes) {
-      ap = np->attributes->next;
-      if (np->attributes->name) {
-        delete[] np->attributes->name;
-      }
-      if (np->attributes->value) {
-        delete[] np->attributes->value;
-      }
-      Release(np->attributes);
-      np->attributes = ap;
-    }
-
-    if (np->subnodeHead) {
-      ReleaseTokens(np->subnodeHead);
-    }
-
-    if (np->value) {
-      delete[] np->value;
-    }
-
-    if (np->invalidName) {
-      Release(np->invalidName);
-    }
-
-    Release(np);
-    np = tp;
+  if (np && np->arena) {
+    delete np->arena;
   }
-
 }
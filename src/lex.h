@@ -76,6 +76,7 @@ typedef enum {
    TOK_SNAPMODE,
    TOK_SPACER,
    TOK_STARTUPCOMMAND,
+   TOK_STATUS,
    TOK_STICK,
    TOK_SWALLOW,
    TOK_TASKLIST,
@@ -113,16 +114,27 @@ typedef struct TokenNode {
    struct TokenNode *subnodeHead;      /**< Start of children. */
    struct TokenNode *subnodeTail;      /**< End of children. */
    struct TokenNode *next;             /**< Next tag at the current level. */
+   struct TokenArena *arena;  /**< Memory of the tree (top-level tag only). */
 
 } TokenNode;
 
 /** Tokenize a buffer.
- * @param line The buffer to tokenize.
+ * @param line The buffer to tokenize (copied).
  * @param fileName The name of the file for error reporting.
  * @return A linked list of tokens from the buffer.
  */
 TokenNode *Tokenize(const char *line, const char *fileName);
 
+/** Tokenize a mapped file in place.
+ * Names and values point into the mapping, which is unmapped when the
+ * tokens are released (or right away if there are no tokens).
+ * @param buffer A private, writable mapping of a file.
+ * @param size The size of the file.
+ * @param fileName The name of the file for error reporting.
+ * @return A linked list of tokens from the buffer.
+ */
+TokenNode *TokenizeMapping(char *buffer, size_t size, const char *fileName);
+
 /** Get a string represention of a token.
  * This is identical to GetTokenTypeName if tp is a valid token.
  * @param tp The token node.
@@ -136,8 +148,16 @@ const char *GetTokenName(const TokenNode *tp);
  */
 const char *GetTokenTypeName(TokenType type);
 
+/** Make tokens live as long as another tree.
+ * This allows moving tokens from one tree into another.
+ * @param dest A token of the tree that takes over the tokens.
+ * @param src The top-level token of the tokens to take over.
+ */
+void AdoptTokens(TokenNode *dest, TokenNode *src);
+
 /** Release token nodes.
- * @param np The top-level token to release.
+ * All tokens of the tree are released at once.
+ * @param np The top-level token to release (may be NULL).
  */
 void ReleaseTokens(TokenNode *np);
 
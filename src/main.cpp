@@ -13,6 +13,7 @@
 #include "help.h"
 #include "error.h"
 #include "misc.h"
+#include "ConfigCache.h"
 
 #include <fcntl.h>
 #include <errno.h>
@@ -31,12 +32,14 @@ int main(int argc, char *argv[]) {
 	Logger::Log("Hello World!\n");
 
 	int x;
+	unsigned long start;
 	enum {
 		COMMAND_RUN,
 		COMMAND_RESTART,
 		COMMAND_EXIT,
 		COMMAND_RELOAD,
-		COMMAND_PARSE
+		COMMAND_PARSE,
+		COMMAND_CHECK
 	} action;
 
 	StartDebug();
@@ -52,6 +55,8 @@ int main(int argc, char *argv[]) {
 			WindowManager::DoExit(0);
 		} else if (!strcmp(argv[x], "-p")) {
 			action = COMMAND_PARSE;
+		} else if (!strcmp(argv[x], CHECK_OPTION)) {
+			action = COMMAND_CHECK;
 		} else if (!strcmp(argv[x], "-restart")) {
 			action = COMMAND_RESTART;
 		} else if (!strcmp(argv[x], "-exit")) {
@@ -77,9 +82,15 @@ int main(int argc, char *argv[]) {
 	case COMMAND_PARSE:
 		Log("Initializing\n");
 		WindowManager::Initialize();
+		start = ConfigCache::GetMicroseconds();
 		Parser::ParseConfig(configPath);
+		ConfigCache::PrintReport(ConfigCache::GetMicroseconds() - start);
 		WindowManager::DoExit(0);
 		break;
+	case COMMAND_CHECK:
+		WindowManager::Initialize();
+		WindowManager::DoExit(!Parser::CheckConfig(configPath));
+		break;
 	case COMMAND_RESTART:
 		Log("Restarting\n");
 		WindowManager::SendRestart();
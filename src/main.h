@@ -10,6 +10,13 @@
 #ifndef MAIN_H
 #define MAIN_H
 
+/** Internal option to check a configuration before reloading it.
+ * Unlike -p, this runs no exec includes, leaves the compiled
+ * configuration alone, and exits with status 1 on warnings.
+ * It creates no tray components, so it does not need the display.
+ */
+#define CHECK_OPTION "-check-config"
+
 extern Display *display;
 extern Window rootWindow;
 extern int rootWidth, rootHeight;
@@ -42,6 +49,13 @@ extern int shapeEvent;
 #ifdef USE_XRENDER
 extern char haveRender;
 #endif
+#ifdef USE_XCOMPOSITE
+extern char haveComposite;
+#endif
+#ifdef USE_XDAMAGE
+extern char haveDamage;
+extern int damageEvent;
+#endif
 
 extern char *configPath;
 
@@ -26,15 +26,65 @@
 #include "binding.h"
 #include "DesktopEnvironment.h"
 
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #define BASE_ICON_OFFSET   3
 #define MENU_BORDER_SIZE   1
 
+/** Longest search string. */
+#define MAX_SEARCH_LENGTH  64
+
 #define MENU_NOSELECTION   0
 #define MENU_LEAVE         1
 #define MENU_SUBSELECT     2
 
 int menuShown = 0;
 
+/** Type-to-search state of a menu.
+ * The index covers the items of the menu and its submenus. It is built
+ * on the first key typed in the menu and kept until the menu is destroyed.
+ * While a search is active the menu shows the matching items instead of
+ * its own; the fields that are swapped out are saved here.
+ */
+typedef struct MenuSearch {
+
+	std::vector<MenuItem*> entries; /**< Searchable items. */
+	std::vector<std::string> names; /**< Lowercase names of the entries. */
+	std::vector<int> widths; /**< Label widths of the entries. */
+
+	/** Entries containing each trigram of lowercase bytes. */
+	std::unordered_map<unsigned, std::vector<unsigned> > trigrams;
+
+	std::string query; /**< The lowercase search string. */
+	std::string matchedQuery; /**< The query that produced matches. */
+	std::vector<unsigned> matches; /**< Entries matching matchedQuery. */
+	std::vector<MenuItem*> table; /**< Items shown while searching. */
+	std::vector<int> offsets; /**< Offsets of the shown items. */
+	char active; /**< Set while the results are shown. */
+
+	/* Fields of the menu while it is not filtered. */
+	MenuItem **savedTable;
+	int *savedOffsets;
+	unsigned savedCount;
+	int savedHeight;
+	char *savedLabel;
+	int savedX, savedY;
+	int savedWidth, savedViewHeight;
+
+} MenuSearch;
+
+/** Get the trigram key of three characters. */
+static inline unsigned GetTrigram(const char *str) {
+	return ((unsigned char) str[0] << 16) | ((unsigned char) str[1] << 8)
+			| (unsigned char) str[2];
+}
+
+/** The innermost open menu (or NULL). */
+static Menu *openMenu = NULL;
+
 /** Allocate an empty menu. */
 Menu* Menus::CreateMenu() {
 	Menu *menu = new Menu;
@@ -43,6 +93,10 @@ Menu* Menus::CreateMenu() {
 	menu->label = NULL;
 	menu->dynamic = NULL;
 	menu->timeout_ms = DEFAULT_TIMEOUT_MS;
+	menu->offsets = NULL;
+	menu->itemTable = NULL;
+	menu->initialized = 0;
+	menu->search = NULL;
 	return menu;
 }
 
@@ -63,6 +117,11 @@ void Menus::InitializeMenu(Menu *menu) {
 	int hasSubmenu;
 	char hasIcon;
 
+	if (menu->initialized) {
+		return;
+	}
+	menu->initialized = 1;
+
 	menu->textOffset = 0;
 	menu->itemCount = 0;
 
@@ -75,10 +134,11 @@ void Menus::InitializeMenu(Menu *menu) {
 	menu->itemHeight = Fonts::GetStringHeight(FONT_MENU);
 	for (np = menu->items; np; np = np->next) {
 		if (np->iconName) {
-			np->icon = Icons::LoadNamedIcon(np->iconName, 1, 1);
-			if (np->icon) {
-				hasIcon = 1;
+			/* Leave room for icons that are still loading. */
+			if (!Icons::RequestNamedIcon(np->iconName, 1, &np->icon)) {
+				np->icon = &Icons::emptyIcon;
 			}
+			hasIcon = 1;
 		} else if (np->icon) {
 			hasIcon = 1;
 		}
@@ -116,10 +176,12 @@ void Menus::InitializeMenu(Menu *menu) {
 	}
 
 	menu->offsets = new int[menu->itemCount];
+	menu->itemTable = new MenuItem*[menu->itemCount];
 
 	hasSubmenu = 0;
 	index = 0;
 	for (np = menu->items; np; np = np->next) {
+		menu->itemTable[index] = np;
 		menu->offsets[index++] = menu->height;
 		if (np->type == MENU_ITEM_SEPARATOR) {
 			menu->height += 6;
@@ -137,7 +199,6 @@ void Menus::InitializeMenu(Menu *menu) {
 		}
 		if (np->submenu) {
 			hasSubmenu = (menu->itemHeight + 3) / 4;
-			InitializeMenu(np->submenu);
 		}
 	}
 	menu->width += hasSubmenu + menu->textOffset;
@@ -162,6 +223,7 @@ char Menus::ShowMenu(Menu *menu, RunMenuCommandType runner, int x, int y, char k
 	if (JUNLIKELY(shouldExit)) {
 		return 0;
 	}
+	InitializeMenu(menu);
 
 	if (x < 0 && y < 0) {
 		Window w;
@@ -180,7 +242,9 @@ char Menus::ShowMenu(Menu *menu, RunMenuCommandType runner, int x, int y, char k
 	}
 
 	Events::_RegisterCallback(settings.popupDelay, MenuCallback, menu);
+	Icons::SetIconListener(HandleIconsLoaded);
 	ShowSubmenu(menu, NULL, runner, x, y, keyboard);
+	Icons::SetIconListener(NULL);
 	Events::_UnregisterCallback(MenuCallback, menu);
 	UnpatchMenu(menu);
 
@@ -207,6 +271,10 @@ void Menus::HideMenu(Menu *menu) {
 void Menus::DestroyMenu(Menu *menu) {
 	MenuItem *np;
 	if (menu) {
+		if (menu->search) {
+			EndSearch(menu);
+			delete menu->search;
+		}
 		while (menu->items) {
 			np = menu->items->next;
 			if (menu->items->name) {
@@ -244,6 +312,9 @@ void Menus::DestroyMenu(Menu *menu) {
 		if (menu->offsets) {
 		  delete[](menu->offsets);
 		}
+		if (menu->itemTable) {
+			delete[](menu->itemTable);
+		}
 		Release(menu);
 	}
 }
@@ -251,23 +322,60 @@ void Menus::DestroyMenu(Menu *menu) {
 /** Show a submenu. */
 char Menus::ShowSubmenu(Menu *menu, Menu *parent, RunMenuCommandType runner, int x, int y, char keyboard) {
 
+	Menu *previous;
 	char status;
 
+	InitializeMenu(menu);
+	ResolveIcons(menu);
 	PatchMenu(menu);
 	menu->parent = parent;
 	MapMenu(menu, x, y, keyboard);
 
+	previous = openMenu;
+	openMenu = menu;
 	menuShown += 1;
 	status = MenuLoop(menu, runner);
 	menuShown -= 1;
+	openMenu = previous;
 
 	JXDestroyWindow(display, menu->window);
-	menu->graphics->free();
+	Graphics::destroy(menu->graphics);
+	menu->graphics = NULL;
+	EndSearch(menu);
 
 	return status;
 
 }
 
+/** Replace icon placeholders with the icons that finished loading.
+ * @return 1 if an icon was replaced.
+ */
+char Menus::ResolveIcons(Menu *menu) {
+	MenuItem *np;
+	IconNode *icon;
+	unsigned i;
+	char changed = 0;
+	for (i = 0; i < menu->itemCount; i++) {
+		np = menu->itemTable[i];
+		if (np->iconName && np->icon == &Icons::emptyIcon
+				&& Icons::RequestNamedIcon(np->iconName, 1, &icon) && icon) {
+			np->icon = icon;
+			changed = 1;
+		}
+	}
+	return changed;
+}
+
+/** Redraw the open menus that were waiting for icons. */
+void Menus::HandleIconsLoaded(void) {
+	Menu *mp;
+	for (mp = openMenu; mp; mp = mp->parent) {
+		if (ResolveIcons(mp)) {
+			DrawMenu(mp);
+		}
+	}
+}
+
 /** Prepare a menu to be shown. */
 void Menus::PatchMenu(Menu *menu) {
 	Log("Preparing the patch menu");
@@ -345,12 +453,14 @@ char Menus::MenuLoop(Menu *menu, RunMenuCommandType runner) {
 	  Events::_WaitForEvent(&event);
 
 		switch (event.type) {
-		case Expose:
-			if (event.xexpose.count == 0) {
+		case Expose: {
+				/* The pixmap always holds the current contents. */
+				const XExposeEvent *expose = &event.xexpose;
 				Menu *mp = menu;
 				while (mp) {
-					if (mp->window == event.xexpose.window) {
-						DrawMenu(mp);
+					if (mp->window == expose->window) {
+						mp->graphics->copy(mp->window, expose->x, expose->y,
+								expose->width, expose->height, expose->x, expose->y);
 						break;
 					}
 					mp = mp->parent;
@@ -406,10 +516,10 @@ char Menus::MenuLoop(Menu *menu, RunMenuCommandType runner) {
 				} else if (ip->type == MENU_ITEM_SUBMENU) {
 					const Menu *parent = menu->parent;
 					if (event.xbutton.x >= menu->x && event.xbutton.x < menu->x + menu->width
-							&& event.xbutton.y >= menu->y && event.xbutton.y < menu->y + menu->height) {
+							&& event.xbutton.y >= menu->y && event.xbutton.y < menu->y + menu->viewHeight) {
 						break;
 					} else if (parent && event.xbutton.x >= parent->x && event.xbutton.x < parent->x + parent->width
-							&& event.xbutton.y >= parent->y && event.xbutton.y < parent->y + parent->height) {
+							&& event.xbutton.y >= parent->y && event.xbutton.y < parent->y + parent->viewHeight) {
 						break;
 					}
 				}
@@ -426,7 +536,6 @@ char Menus::MenuLoop(Menu *menu, RunMenuCommandType runner) {
 void Menus::MenuCallback(const TimeType *now, int x, int y, Window w, void *data) {
 	Menu *menu = (Menu*) data;
 	MenuItem *item;
-	int i;
 
 	/* Check if the mouse moved (and reset if it did). */
 	if (abs(menu->mousex - x) > settings.doubleClickDelta || abs(menu->mousey - y) > settings.doubleClickDelta) {
@@ -445,30 +554,18 @@ void Menus::MenuCallback(const TimeType *now, int x, int y, Window w, void *data
 	/* Locate the active menu item. */
 	while (menu) {
 		if (x > menu->x && x < menu->x + menu->width) {
-			if (y > menu->y && y < menu->y + menu->height) {
+			if (y > menu->y && y < menu->y + menu->viewHeight) {
 				break;
 			}
 		}
-		if (menu->currentIndex < 0) {
-			return;
-		}
-		item = menu->items;
-		for (i = 0; i < menu->currentIndex; i++) {
-			item = item->next;
-		}
-		if (item->type != MENU_ITEM_SUBMENU) {
+		item = GetMenuItem(menu, menu->currentIndex);
+		if (!item || item->type != MENU_ITEM_SUBMENU) {
 			return;
 		}
 		menu = item->submenu;
 	}
-	if (menu->currentIndex < 0) {
-		return;
-	}
-	item = menu->items;
-	for (i = 0; i < menu->currentIndex; i++) {
-		item = item->next;
-	}
-	if (item->tooltip) {
+	item = GetMenuItem(menu, menu->currentIndex);
+	if (item && item->tooltip) {
 		Popups::ShowPopup(x, y, item->tooltip, POPUP_MENU);
 	}
 
@@ -492,9 +589,14 @@ void Menus::MapMenu(Menu *menu, int x, int y, char keyboard) {
 			x = menu->screen->x + menu->screen->width - menu->width;
 		}
 	}
+
+	/* Menus taller than the screen scroll inside a window that fits. */
+	menu->viewHeight = Min(menu->height, menu->screen->height);
+	menu->scroll = 0;
+
 	temp = y;
-	if (y + menu->height > menu->screen->y + menu->screen->height) {
-		y = menu->screen->y + menu->screen->height - menu->height;
+	if (y + menu->viewHeight > menu->screen->y + menu->screen->height) {
+		y = menu->screen->y + menu->screen->height - menu->viewHeight;
 	}
 	if (y < 0) {
 		y = 0;
@@ -515,61 +617,104 @@ void Menus::MapMenu(Menu *menu, int x, int y, char keyboard) {
 	attrMask |= CWSaveUnder;
 	attr.save_under = True;
 
-	menu->window = JXCreateWindow(display, rootWindow, x, y, menu->width, menu->height, 0, CopyFromParent, InputOutput,
+	menu->window = JXCreateWindow(display, rootWindow, x, y, menu->width, menu->viewHeight, 0, CopyFromParent, InputOutput,
 			CopyFromParent, attrMask, &attr);
 	Hints::SetAtomAtom(menu->window, ATOM_NET_WM_WINDOW_TYPE, ATOM_NET_WM_WINDOW_TYPE_MENU);
-	menu->graphics = Graphics::create(display, rootGC, menu->window, menu->width, menu->height, rootDepth);
+	menu->graphics = Graphics::create(display, rootGC, menu->window, menu->width, menu->viewHeight, rootDepth);
 
 	if (settings.menuOpacity < UINT_MAX) {
 		Hints::SetCardinalAtom(menu->window, ATOM_NET_WM_WINDOW_OPACITY, settings.menuOpacity);
 	}
 
-	JXMapRaised(display, menu->window);
-
 	if (keyboard && menu->itemCount != 0) {
-		const int y = menu->offsets[0] + menu->itemHeight / 2;
 		menu->lastIndex = 0;
 		menu->currentIndex = 0;
-		Cursors::MoveMouse(menu->window, menu->itemHeight / 2, y);
 	} else {
 		menu->lastIndex = -1;
 		menu->currentIndex = -1;
 	}
 
+	/* Render before mapping so exposes can be copied from the pixmap. */
+	DrawMenu(menu);
+	JXMapRaised(display, menu->window);
+
+	if (keyboard && menu->itemCount != 0) {
+		const int y = menu->offsets[0] + menu->itemHeight / 2;
+		Cursors::MoveMouse(menu->window, menu->itemHeight / 2, y);
+	}
+
 }
 
-/** Draw a menu. */
+/** Draw the visible part of a menu. */
 void Menus::DrawMenu(Menu *menu) {
 
-	MenuItem *np;
-	int x;
+	const int height = menu->viewHeight;
+	int index;
 
 	JXSetForeground(display, rootGC, Colors::lookupColor(COLOR_MENU_BG));
-	menu->graphics->fillRectangle(0, 0, menu->width, menu->height);
+	menu->graphics->fillRectangle(0, 0, menu->width, height);
+
+	if (menu->label) {
+		DrawMenuItem(menu, NULL, -1);
+	}
+
+	/* Items are drawn from the first one in view until the window is full. */
+	index = Max(GetMenuIndex(menu, menu->scroll), 0);
+	for (; index < (int) menu->itemCount; index++) {
+		if (menu->offsets[index] >= menu->scroll + height) {
+			break;
+		}
+		DrawMenuItem(menu, menu->itemTable[index], index);
+	}
 
+	/* The border goes on top of items that are partially scrolled out. */
 	if (settings.menuDecorations == DECO_MOTIF) {
 		JXSetForeground(display, rootGC, Colors::lookupColor(COLOR_MENU_UP));
 		menu->graphics->line(0, 0, menu->width, 0);
-		menu->graphics->line(0, 0, 0, menu->height);
+		menu->graphics->line(0, 0, 0, height);
 
 		JXSetForeground(display, rootGC, Colors::lookupColor(COLOR_MENU_DOWN));
-		menu->graphics->line(0, menu->height - 1, menu->width, menu->height - 1);
-		menu->graphics->line(menu->width - 1, 0, menu->width - 1, menu->height);
+		menu->graphics->line(0, height - 1, menu->width, height - 1);
+		menu->graphics->line(menu->width - 1, 0, menu->width - 1, height);
 	} else {
 		JXSetForeground(display, rootGC, Colors::lookupColor(COLOR_MENU_DOWN));
-		menu->graphics->drawRectangle(0, 0, menu->width - 1, menu->height - 1);
+		menu->graphics->drawRectangle(0, 0, menu->width - 1, height - 1);
 	}
 
-	if (menu->label) {
-		DrawMenuItem(menu, NULL, -1);
+	menu->graphics->copy(menu->window, 0, 0, menu->width, height, 0, 0);
+}
+
+/** Copy a drawn menu item to the menu window. */
+void Menus::CopyMenuItem(Menu *menu, int index) {
+	int top, bottom;
+	if (index < 0 || index >= (int) menu->itemCount) {
+		return;
+	}
+	top = menu->offsets[index] - menu->scroll;
+	bottom = top + menu->itemHeight;
+	top = Max(top, MENU_BORDER_SIZE);
+	bottom = Min(bottom, menu->viewHeight - MENU_BORDER_SIZE);
+	if (top < bottom) {
+		menu->graphics->copy(menu->window, 0, top, menu->width, bottom - top, 0, top);
 	}
+}
 
-	x = 0;
-	for (np = menu->items; np; np = np->next) {
-		DrawMenuItem(menu, np, x);
-		++x;
+/** Scroll a menu taller than the screen so that an item is visible. */
+void Menus::ScrollMenu(Menu *menu, int index) {
+	const int top = menu->offsets[index];
+	const int bottom = top + menu->itemHeight;
+	int scroll = menu->scroll;
+
+	if (top - scroll < MENU_BORDER_SIZE) {
+		scroll = top - MENU_BORDER_SIZE;
+	} else if (bottom - scroll > menu->viewHeight - MENU_BORDER_SIZE) {
+		scroll = bottom - menu->viewHeight + MENU_BORDER_SIZE;
+	}
+	scroll = Max(Min(scroll, menu->height - menu->viewHeight), 0);
+	if (scroll != menu->scroll) {
+		menu->scroll = scroll;
+		DrawMenu(menu);
 	}
-	menu->graphics->copy(menu->window, 0, 0, menu->width, menu->height, 0, 0);
 }
 
 /** Determine the action to take given an event. */
@@ -578,14 +723,17 @@ MenuSelectionType Menus::UpdateMotion(Menu *menu, RunMenuCommandType runner, XEv
 	Menu *tp;
 	Window subwindow;
 	int x, y;
+	int wy;
 
 	if (event->type == MotionNotify) {
 
 		Cursors::SetMousePosition(event->xmotion.x_root, event->xmotion.y_root, event->xmotion.window);
 		Events::_DiscardMotionEvents(event, menu->window);
 
+		/* y is relative to the menu contents, wy to the window. */
 		x = event->xmotion.x_root - menu->x;
-		y = event->xmotion.y_root - menu->y;
+		wy = event->xmotion.y_root - menu->y;
+		y = wy + menu->scroll;
 		subwindow = event->xmotion.subwindow;
 
 	} else if (event->type == ButtonPress) {
@@ -618,6 +766,14 @@ MenuSelectionType Menus::UpdateMotion(Menu *menu, RunMenuCommandType runner, XEv
 			tp = menu->parent;
 		}
 
+		/* Once a search has started, text goes to the query even if
+		 * the key is bound to a menu action. */
+		if (menu->search && menu->search->active
+				&& !(event->xkey.state & ~(Binding::lockMask | ShiftMask))
+				&& HandleSearchKey(menu, &event->xkey)) {
+			return MENU_NOSELECTION;
+		}
+
 		y = -1;
 		action = Binding::GetKey(MC_NONE, event->xkey.state, event->xkey.keycode);
 		switch (action.action) {
@@ -642,6 +798,11 @@ MenuSelectionType Menus::UpdateMotion(Menu *menu, RunMenuCommandType runner, XEv
 			}
 			break;
 		case ESC:
+			/* Escape leaves the search before closing the menu. */
+			if (EndSearch(menu)) {
+				DrawMenu(menu);
+				return MENU_NOSELECTION;
+			}
 			return MENU_SUBSELECT;
 		case ENTER:
 			ip = GetMenuItem(tp, tp->currentIndex);
@@ -651,6 +812,7 @@ MenuSelectionType Menus::UpdateMotion(Menu *menu, RunMenuCommandType runner, XEv
 			}
 			return MENU_SUBSELECT;
 		default:
+			HandleSearchKey(menu, &event->xkey);
 			break;
 		}
 
@@ -666,7 +828,7 @@ MenuSelectionType Menus::UpdateMotion(Menu *menu, RunMenuCommandType runner, XEv
 	}
 
 	/* Update the selection on the current menu */
-	if (x > 0 && y > 0 && x < menu->width && y < menu->height) {
+	if (x > 0 && wy > 0 && x < menu->width && wy < menu->viewHeight) {
 		menu->currentIndex = GetMenuIndex(menu, y);
 	} else if (menu->parent && subwindow != menu->parent->window) {
 
@@ -683,7 +845,7 @@ MenuSelectionType Menus::UpdateMotion(Menu *menu, RunMenuCommandType runner, XEv
 		/* Leave if over the parent, but not on this selection. */
 		tp = menu->parent;
 		if (tp && subwindow == tp->window) {
-			if (y < menu->parentOffset || y > tp->itemHeight + menu->parentOffset) {
+			if (wy < menu->parentOffset || wy > tp->itemHeight + menu->parentOffset) {
 				return MENU_LEAVE;
 			}
 		}
@@ -692,19 +854,20 @@ MenuSelectionType Menus::UpdateMotion(Menu *menu, RunMenuCommandType runner, XEv
 
 	}
 
-	/* Move the menu if needed. */
-	if (menu->height > menu->screen->height && menu->currentIndex >= 0) {
+	/* Scroll the menu if needed. */
+	if (menu->height > menu->viewHeight && menu->currentIndex >= 0) {
 
-		/* If near the top, shift down. */
-		if (y + menu->y <= 0) {
+		/* If near the top, scroll up. */
+		if (wy < menu->itemHeight / 2 && menu->scroll > 0) {
 			if (menu->currentIndex > 0) {
 				menu->currentIndex -= 1;
 				SetPosition(menu, menu->currentIndex);
 			}
 		}
 
-		/* If near the bottom, shift up. */
-		if (y + menu->y + menu->itemHeight / 2 >= menu->screen->y + menu->screen->height) {
+		/* If near the bottom, scroll down. */
+		if (wy + menu->itemHeight / 2 >= menu->viewHeight
+				&& menu->scroll < menu->height - menu->viewHeight) {
 			if (menu->currentIndex + 1 < menu->itemCount) {
 				menu->currentIndex += 1;
 				SetPosition(menu, menu->currentIndex);
@@ -722,7 +885,7 @@ MenuSelectionType Menus::UpdateMotion(Menu *menu, RunMenuCommandType runner, XEv
 	ip = GetMenuItem(menu, menu->currentIndex);
 	if (ip && IsMenuValid(ip->submenu)) {
 		const int x = menu->x + menu->width - (settings.menuDecorations == DECO_MOTIF ? 0 : 1);
-		const int y = menu->y + menu->offsets[menu->currentIndex] - 1;
+		const int y = menu->y + menu->offsets[menu->currentIndex] - menu->scroll - 1;
 		if (ShowSubmenu(ip->submenu, menu, runner, x, y, 0)) {
 
 			/* Item selected; destroy the menu tree. */
@@ -747,29 +910,38 @@ void Menus::UpdateMenu(Menu *menu) {
 
 	/* Clear the old selection. */
 	ip = GetMenuItem(menu, menu->lastIndex);
-	DrawMenuItem(menu, ip, menu->lastIndex);
+	if (ip != NULL) {
+		DrawMenuItem(menu, ip, menu->lastIndex);
+		CopyMenuItem(menu, menu->lastIndex);
+	}
 
 	/* Highlight the new selection. */
 	ip = GetMenuItem(menu, menu->currentIndex);
 	if (ip != NULL) {
 		DrawMenuItem(menu, ip, menu->currentIndex);
+		CopyMenuItem(menu, menu->currentIndex);
 	}
-
-	menu->graphics->copy(menu->window, 0, 0, menu->width, menu->height, 0, 0);
 }
 
 /** Draw a menu item. */
 void Menus::DrawMenuItem(Menu *menu, MenuItem *item, int index) {
+	int offset;
 	Assert(menu);
 
 	if (!item) {
-		if (index == -1 && menu->label) {
+		if (index == -1 && menu->label && menu->scroll < menu->itemHeight) {
 			menu->graphics->drawButton(BUTTON_LABEL, ALIGN_LEFT, FONT_MENU, menu->label, true, false, NULL,
-			MENU_BORDER_SIZE, MENU_BORDER_SIZE, menu->width - MENU_BORDER_SIZE * 2, menu->itemHeight - 1, 0, 0);
+			MENU_BORDER_SIZE, MENU_BORDER_SIZE - menu->scroll, menu->width - MENU_BORDER_SIZE * 2, menu->itemHeight - 1, 0, 0);
 		}
 		return;
 	}
 
+	/* Skip items that are scrolled out of view. */
+	offset = menu->offsets[index] - menu->scroll;
+	if (offset + menu->itemHeight <= 0 || offset >= menu->viewHeight) {
+		return;
+	}
+
 	if (item->type != MENU_ITEM_SEPARATOR) {
 		ButtonType type = BUTTON_LABEL;
 		ColorName fg = COLOR_MENU_FG;
@@ -779,12 +951,12 @@ void Menus::DrawMenuItem(Menu *menu, MenuItem *item, int index) {
 		}
 
 		menu->graphics->drawButton(type, ALIGN_LEFT, FONT_MENU, item->name, true, false, item->icon,
-				MENU_BORDER_SIZE, menu->offsets[index], menu->width - MENU_BORDER_SIZE * 2, menu->itemHeight - 1, 0, 0);
+				MENU_BORDER_SIZE, offset, menu->width - MENU_BORDER_SIZE * 2, menu->itemHeight - 1, 0, 0);
 
 		if (item->submenu) {
 
 			const int asize = (menu->itemHeight + 7) / 8;
-			const int y = menu->offsets[index] + (menu->itemHeight + 1) / 2;
+			const int y = offset + (menu->itemHeight + 1) / 2;
 			int x = menu->width - 2 * asize - 1;
 			int i;
 
@@ -802,15 +974,249 @@ void Menus::DrawMenuItem(Menu *menu, MenuItem *item, int index) {
 	} else {
 		if (settings.menuDecorations == DECO_MOTIF) {
 			menu->graphics->setForeground(COLOR_MENU_DOWN);
-			menu->graphics->line(4, menu->offsets[index] + 2, menu->width - 6, menu->offsets[index] + 2);
+			menu->graphics->line(4, offset + 2, menu->width - 6, offset + 2);
 			menu->graphics->setForeground(COLOR_MENU_UP);
-			menu->graphics->line(4, menu->offsets[index] + 3, menu->width - 6, menu->offsets[index] + 3);
+			menu->graphics->line(4, offset + 3, menu->width - 6, offset + 3);
 		} else {
 			menu->graphics->setForeground(COLOR_MENU_FG);
-			menu->graphics->line(4, menu->offsets[index] + 2, menu->width - 6, menu->offsets[index] + 2);
+			menu->graphics->line(4, offset + 2, menu->width - 6, offset + 2);
+		}
+	}
+
+}
+
+/** Add a key to the search string of a menu.
+ * @return 1 if the key was used, 0 otherwise.
+ */
+char Menus::HandleSearchKey(Menu *menu, XKeyEvent *event) {
+	MenuSearch *search;
+	char buffer[8];
+	KeySym sym;
+	int len;
+	int i;
+
+	len = JXLookupString(event, buffer, sizeof(buffer), &sym, NULL);
+	search = menu->search;
+	if (sym == XK_BackSpace) {
+		if (!search || search->query.empty()) {
+			return 0;
+		}
+		search->query.erase(search->query.size() - 1);
+	} else {
+		for (i = 0; i < len; i++) {
+			if ((unsigned char) buffer[i] < 0x20 || buffer[i] == 0x7F) {
+				return 0;
+			}
+		}
+		if (len == 0) {
+			return 0;
+		}
+		if (!search) {
+			search = new MenuSearch;
+			search->active = 0;
+			BuildSearchIndex(search, menu);
+			menu->search = search;
+		}
+		if (search->query.size() + len > MAX_SEARCH_LENGTH) {
+			return 1;
+		}
+		for (i = 0; i < len; i++) {
+			search->query += (char) tolower((unsigned char) buffer[i]);
 		}
 	}
+	UpdateSearch(menu);
+	return 1;
+}
+
+/** Index the items of a menu and its submenus. */
+void Menus::BuildSearchIndex(MenuSearch *search, Menu *menu) {
+	MenuItem *np;
+	for (np = menu->items; np; np = np->next) {
+
+		/* Generated submenus only exist while they are shown. */
+		switch (np->action.type & MA_ACTION_MASK) {
+		case MA_DESKTOP_MENU:
+		case MA_SENDTO_MENU:
+		case MA_WINDOW_MENU:
+		case MA_DYNAMIC:
+			continue;
+		default:
+			break;
+		}
 
+		if (np->submenu) {
+			BuildSearchIndex(search, np->submenu);
+		} else if (np->type == MENU_ITEM_NORMAL && np->name) {
+			const unsigned id = search->entries.size();
+			std::string name = np->name;
+			size_t i;
+			for (i = 0; i < name.size(); i++) {
+				name[i] = tolower((unsigned char) name[i]);
+			}
+			for (i = 0; i + 2 < name.size(); i++) {
+				std::vector<unsigned> &list = search->trigrams[GetTrigram(&name[i])];
+				if (list.empty() || list.back() != id) {
+					list.push_back(id);
+				}
+			}
+			search->entries.push_back(np);
+			search->names.push_back(name);
+			search->widths.push_back(Fonts::GetStringWidth(FONT_MENU, np->name));
+		}
+	}
+}
+
+/** Show the items matching the search string. */
+void Menus::UpdateSearch(Menu *menu) {
+	MenuSearch *search = menu->search;
+	const std::string &query = search->query;
+	std::vector<unsigned> candidates;
+	std::vector<unsigned>::const_iterator it;
+	unsigned i;
+	int x, y;
+	int width, height;
+
+	if (query.empty()) {
+		EndSearch(menu);
+		DrawMenu(menu);
+		return;
+	}
+
+	/* Narrow the candidates to the shortest list of a trigram in the
+	 * query; shorter queries check every entry. Extending the query only
+	 * removes matches, so the previous matches are a candidate list too.
+	 */
+	if (query.size() >= 3) {
+		const std::vector<unsigned> *shortest = NULL;
+		for (i = 0; i + 2 < query.size(); i++) {
+			std::unordered_map<unsigned, std::vector<unsigned> >::const_iterator entry;
+			entry = search->trigrams.find(GetTrigram(&query[i]));
+			if (entry == search->trigrams.end()) {
+				shortest = &candidates;
+				break;
+			}
+			if (!shortest || entry->second.size() < shortest->size()) {
+				shortest = &entry->second;
+			}
+		}
+		candidates = *shortest;
+	} else {
+		candidates.resize(search->entries.size());
+		for (i = 0; i < candidates.size(); i++) {
+			candidates[i] = i;
+		}
+	}
+	if (search->active && query.find(search->matchedQuery) != std::string::npos
+			&& search->matches.size() < candidates.size()) {
+		candidates.swap(search->matches);
+	}
+
+	search->matches.clear();
+	for (it = candidates.begin(); it != candidates.end(); ++it) {
+		if (search->names[*it].find(query) != std::string::npos) {
+			search->matches.push_back(*it);
+		}
+	}
+	search->matchedQuery = query;
+
+	if (!search->active) {
+		search->savedTable = menu->itemTable;
+		search->savedOffsets = menu->offsets;
+		search->savedCount = menu->itemCount;
+		search->savedHeight = menu->height;
+		search->savedLabel = menu->label;
+		search->savedX = menu->x;
+		search->savedY = menu->y;
+		search->savedWidth = menu->width;
+		search->savedViewHeight = menu->viewHeight;
+		search->active = 1;
+	}
+
+	/* The query takes the place of the label. */
+	search->table.clear();
+	search->offsets.clear();
+	width = Fonts::GetStringWidth(FONT_MENU, query.c_str());
+	y = MENU_BORDER_SIZE + menu->itemHeight;
+	for (it = search->matches.begin(); it != search->matches.end(); ++it) {
+		MenuItem *np = search->entries[*it];
+		width = Max(width, search->widths[*it]);
+		if (np->iconName && !np->icon
+				&& !Icons::RequestNamedIcon(np->iconName, 1, &np->icon)) {
+			np->icon = &Icons::emptyIcon;
+		}
+		search->table.push_back(np);
+		search->offsets.push_back(y);
+		y += menu->itemHeight;
+	}
+
+	/* The end of the list keeps the offsets valid when nothing matched. */
+	search->offsets.push_back(y);
+	menu->itemTable = search->table.data();
+	menu->offsets = search->offsets.data();
+	menu->itemCount = search->table.size();
+	menu->height = y + MENU_BORDER_SIZE;
+	menu->label = (char*) query.c_str();
+
+	/* Grow the window to fit the results, which may come from wider
+	 * submenus, but keep it on the screen. */
+	width += menu->textOffset + 7 + 2 * MENU_BORDER_SIZE;
+	width = Min(Max(width, search->savedWidth), menu->screen->width);
+	height = Min(menu->height, menu->screen->height);
+	x = Min(search->savedX, menu->screen->x + menu->screen->width - width);
+	y = Min(search->savedY, menu->screen->y + menu->screen->height - height);
+	ResizeMenu(menu, x, Max(y, 0), width, height);
+
+	menu->scroll = 0;
+	menu->currentIndex = menu->itemCount ? 0 : -1;
+	menu->lastIndex = menu->currentIndex;
+	if (menu->currentIndex >= 0) {
+		ScrollMenu(menu, menu->currentIndex);
+	}
+	DrawMenu(menu);
+}
+
+/** Move and resize a menu, updating its window if it is shown. */
+void Menus::ResizeMenu(Menu *menu, int x, int y, int width, int height) {
+	if (x == menu->x && y == menu->y && width == menu->width
+			&& height == menu->viewHeight) {
+		return;
+	}
+	menu->x = x;
+	menu->y = y;
+	menu->width = width;
+	menu->viewHeight = height;
+	if (menu->graphics) {
+		JXMoveResizeWindow(display, menu->window, x, y, width, height);
+		Graphics::destroy(menu->graphics);
+		menu->graphics = Graphics::create(display, rootGC, menu->window, width,
+				height, rootDepth);
+	}
+}
+
+/** Show the items of a menu again after a search.
+ * @return 1 if a search was active, 0 otherwise.
+ */
+char Menus::EndSearch(Menu *menu) {
+	MenuSearch *search = menu->search;
+	if (!search || !search->active) {
+		return 0;
+	}
+	menu->itemTable = search->savedTable;
+	menu->offsets = search->savedOffsets;
+	menu->itemCount = search->savedCount;
+	menu->height = search->savedHeight;
+	menu->label = search->savedLabel;
+	ResizeMenu(menu, search->savedX, search->savedY, search->savedWidth,
+			search->savedViewHeight);
+	search->active = 0;
+	search->query.clear();
+	search->matchedQuery.clear();
+	search->matches.clear();
+
+	menu->scroll = 0;
+	menu->currentIndex = -1;
+	menu->lastIndex = -1;
+	return 1;
 }
 
 /** Get the next item in the menu. */
@@ -866,60 +1272,31 @@ int Menus::GetPreviousMenuIndex(Menu *menu) {
 /** Get the item in the menu given a y-coordinate. */
 int Menus::GetMenuIndex(Menu *menu, int y) {
 
-	int x;
+	int *const last = menu->offsets + menu->itemCount;
 
-	if (y < menu->offsets[0]) {
+	if (menu->itemCount == 0 || y < menu->offsets[0]) {
 		return -1;
 	}
-	for (x = 0; x < menu->itemCount - 1; x++) {
-		if (y >= menu->offsets[x] && y < menu->offsets[x + 1]) {
-			return x;
-		}
-	}
-	return x;
+	return std::upper_bound(menu->offsets, last, y) - menu->offsets - 1;
 
 }
 
 /** Get the menu item associated with an index. */
 MenuItem* Menus::GetMenuItem(Menu *menu, int index) {
 
-	MenuItem *ip;
-
-	if (index >= 0) {
-		for (ip = menu->items; ip; ip = ip->next) {
-			if (!index) {
-				return ip;
-			}
-			--index;
-		}
-	} else {
-		ip = NULL;
+	if (index >= 0 && index < (int) menu->itemCount) {
+		return menu->itemTable[index];
 	}
-
-	return ip;
+	return NULL;
 
 }
 
 /** Set the active menu item. */
 void Menus::SetPosition(Menu *tp, int index) {
-	int y = tp->offsets[index] + tp->itemHeight / 2;
-	if (tp->height > tp->screen->height) {
+	int y;
 
-		int updated = 0;
-		while (y + tp->y < tp->itemHeight / 2) {
-			tp->y += tp->itemHeight;
-			updated = tp->itemHeight;
-		}
-		while (y + tp->y >= tp->screen->y + tp->screen->height) {
-			tp->y -= tp->itemHeight;
-			updated = -tp->itemHeight;
-		}
-		if (updated) {
-			JXMoveWindow(display, tp->window, tp->x, tp->y);
-			y += updated;
-		}
-
-	}
+	ScrollMenu(tp, index);
+	y = tp->offsets[index] - tp->scroll + tp->itemHeight / 2;
 
 	/* We need to do this twice so the event gets registered
 	 * on the submenu if one exists. */
@@ -49,6 +49,7 @@ typedef unsigned char MenuActionType;
 #define MA_GROUP_MASK         0x80
 
 struct Menu;
+struct MenuSearch;
 class ClientNode;
 
 /** Structure to represent a menu action for callbacks. */
@@ -112,6 +113,11 @@ typedef struct Menu {
 	int parentOffset; /**< y-offset of this menu wrt the parent. */
 	int textOffset; /**< x-offset of text in the menu. */
 	int *offsets; /**< y-offsets of menu items. */
+	struct MenuItem **itemTable; /**< Menu items by index. */
+	int scroll; /**< y-offset of the visible part of the menu. */
+	int viewHeight; /**< Height of the menu window. */
+	char initialized; /**< Set once the layout has been computed. */
+	struct MenuSearch *search; /**< Search index and state (or NULL). */
 	struct Menu *parent; /**< The parent menu (or NULL). */
 	const struct ScreenType *screen;
 	int mousex, mousey;
@@ -133,6 +139,8 @@ public:
 	static MenuItem *CreateMenuItem(MenuItemType type);
 
 	/** Initialize a menu structure to be shown.
+	 * The layout is computed once and kept until the menu is destroyed.
+	 * Submenus are initialized when they are first opened.
 	 * @param menu The menu to initialize.
 	 */
 	static void InitializeMenu(Menu *menu);
@@ -162,6 +170,15 @@ private:
 	static void MapMenu(Menu *menu, int x, int y, char keyboard);
 	static void HideMenu(Menu *menu);
 	static void DrawMenu(Menu *menu);
+	static void CopyMenuItem(Menu *menu, int index);
+	static void ScrollMenu(Menu *menu, int index);
+	static void ResizeMenu(Menu *menu, int x, int y, int width, int height);
+	static char ResolveIcons(Menu *menu);
+	static char HandleSearchKey(Menu *menu, XKeyEvent *event);
+	static void BuildSearchIndex(MenuSearch *search, Menu *menu);
+	static void UpdateSearch(Menu *menu);
+	static char EndSearch(Menu *menu);
+	static void HandleIconsLoaded(void);
 
 	static char MenuLoop(Menu *menu, RunMenuCommandType runner);
 	static void MenuCallback(const TimeType *now, int x, int y,
@@ -11,6 +11,7 @@
 #include "outline.h"
 #include "main.h"
 #include "grab.h"
+#include "Graphics.h"
 
 static GC outlineGC = None;
 static int lastX, lastY;
@@ -19,13 +20,8 @@ static int lastWidth, lastHeight;
 /** Draw an outline. */
 void Outline::DrawOutline(int x, int y, int width, int height)
 {
-   XGCValues gcValues;
-   gcValues.function = GXinvert;
-   gcValues.subwindow_mode = IncludeInferiors;
-   gcValues.line_width = 2;
-   outlineGC = JXCreateGC(display, rootWindow,
-                          GCFunction | GCSubwindowMode | GCLineWidth,
-                          &gcValues);
+   outlineGC = Graphics::AcquireGC(rootDepth, GXinvert, 2);
+   JXSetSubwindowMode(display, outlineGC, IncludeInferiors);
    Grabs::GrabServer();
    JXDrawRectangle(display, rootWindow, outlineGC, x, y, width, height);
    lastX = x;
@@ -41,7 +37,7 @@ void Outline::ClearOutline(void)
       JXDrawRectangle(display, rootWindow, outlineGC,
                       lastX, lastY, lastWidth, lastHeight);
       Grabs::UngrabServer();
-      JXFreeGC(display, outlineGC);
+      Graphics::ReleaseGC(outlineGC);
       outlineGC = None;
    }
 }
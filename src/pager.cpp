@@ -19,15 +19,26 @@
 #include "timing.h"
 #include "popup.h"
 #include "font.h"
+#include "misc.h"
 #include "settings.h"
+#include "thumbnail.h"
 #include "DesktopEnvironment.h"
 
+/** Default maximum thumbnail refreshes per second. */
+#define DEFAULT_THUMBNAIL_FPS 4
+
+/** Highest thumbnail refresh rate; the refresh delay is in milliseconds. */
+#define MAX_THUMBNAIL_FPS 1000
+
 std::vector<PagerType*> PagerType::pagers;
 
 /** Shutdown the pager. */
 void PagerType::ShutdownPager(void) {
   for (auto pp : pagers) {
     JXFreePixmap(display, pp->buffer);
+    pp->drawGeneration += 1;
+    pp->PruneThumbnails();
+    pp->FreeLabels();
   }
 }
 
@@ -35,22 +46,36 @@ void PagerType::ShutdownPager(void) {
 void PagerType::DestroyPager(void) {
   for(auto pp : pagers) {
     Events::_UnregisterCallback(SignalPager, pp);
+    if (pp->thumbnails) {
+      Events::_UnregisterCallback(SignalThumbnails, pp);
+    }
     delete pp;
   }
   pagers.clear();
 }
 
 /** Create a new pager tray component. */
-PagerType::PagerType(char labeled, Tray *tray, TrayComponent *parent) :
+PagerType::PagerType(char labeled, char thumbnails, int fps, Tray *tray,
+    TrayComponent *parent) :
     TrayComponent(tray, parent) {
   this->labeled = labeled;
+  this->thumbnails = thumbnails;
+  this->fps = fps > 0 ? Min(fps, MAX_THUMBNAIL_FPS) : DEFAULT_THUMBNAIL_FPS;
   this->mousex = -settings.doubleClickDelta;
   this->mousey = -settings.doubleClickDelta;
   this->mouseTime.seconds = 0;
   this->mouseTime.ms = 0;
   this->buffer = None;
+  this->drawGeneration = 0;
+  this->drawnSerial = 0;
+  this->refreshThumbnails = 0;
+  this->thumbnailsStale = 0;
+  this->modelValid = 0;
 
   Events::_RegisterCallback(settings.popupDelay / 2, SignalPager, this);
+  if (this->thumbnails) {
+    Events::_RegisterCallback(1000 / this->fps, SignalThumbnails, this);
+  }
 }
 
 PagerType::~PagerType() {
@@ -370,7 +395,7 @@ void PagerType::StartPagerMove(int x, int y) {
       JXMoveWindow(display, np->getParent(), np->getX() - west,
           np->getY() - north);
       np->SendConfigureEvent();
-      Events::_RequirePagerUpdate();
+      Events::_RequirePagerUpdate(np);
 
       break;
 
@@ -399,9 +424,6 @@ void PagerType::Draw() {
   int width, height;
   int deskWidth, deskHeight;
   unsigned int x;
-  const char *name;
-  int xc, yc;
-  int textWidth, textHeight;
   int dx, dy;
 
   buffer = this->getPixmap();
@@ -422,58 +444,264 @@ void PagerType::Draw() {
       dy * (deskHeight + 1), deskWidth, deskHeight);
 
   /* Draw the labels. */
-  if (this->labeled) {
-    textHeight = Fonts::GetStringHeight(FONT_PAGER);
-    if (textHeight < deskHeight) {
-      for (x = 0; x < settings.desktopCount; x++) {
-        dx = x % settings.desktopWidth;
-        dy = x / settings.desktopWidth;
-        name = DesktopEnvironment::DefaultEnvironment()->GetDesktopName(x);
-        textWidth = Fonts::GetStringWidth(FONT_PAGER, name);
-        if (textWidth < deskWidth) {
-          xc = dx * (deskWidth + 1) + (deskWidth - textWidth) / 2;
-          yc = dy * (deskHeight + 1) + (deskHeight - textHeight) / 2;
-          Fonts::RenderString(buffer, FONT_PAGER, COLOR_PAGER_TEXT, xc, yc,
-              deskWidth, name);
-        }
-      }
-    }
+  for (x = 0; x < settings.desktopCount; x++) {
+    this->DrawDesktopLabel(buffer, x);
   }
 
-  /* Draw the clients. */
+  /* Draw the clients, remembering where each one went. */
+  this->drawGeneration += 1;
+  this->thumbnailsStale = 0;
+  this->clientRects.clear();
+  this->desktopClients.assign(settings.desktopCount,
+      std::vector<ClientNode*>());
   std::vector<ClientNode*> all = ClientList::GetList();
   for (int i = 0; i < all.size(); ++i) {
-    this->DrawPagerClient(all[i]);
+    PagerRect r;
+    this->GetClientRect(all[i], &r);
+    this->clientRects[all[i]] = r;
+    if (r.desktop >= 0) {
+      this->desktopClients[r.desktop].push_back(all[i]);
+      this->DrawPagerClient(all[i], r);
+    }
+  }
+  this->modelValid = buffer != None;
+  if (this->thumbnails) {
+    this->PruneThumbnails();
+    if (this->refreshThumbnails) {
+      this->drawnSerial = Thumbnails::GetSerial();
+    }
   }
 
   /* Draw the desktop dividers. */
+  this->DrawDividers(buffer);
+
+}
+
+/** Draw the lines between desktops. */
+void PagerType::DrawDividers(Drawable d) {
+  unsigned int x;
   JXSetForeground(display, rootGC, Colors::lookupColor(COLOR_PAGER_OUTLINE));
   for (x = 1; x < settings.desktopHeight; x++) {
-    JXDrawLine(display, buffer, rootGC, 0, (deskHeight + 1) * x - 1, width,
-        (deskHeight + 1) * x - 1);
+    JXDrawLine(display, d, rootGC, 0, (this->deskHeight + 1) * x - 1,
+        this->getWidth(), (this->deskHeight + 1) * x - 1);
   }
   for (x = 1; x < settings.desktopWidth; x++) {
-    JXDrawLine(display, buffer, rootGC, (deskWidth + 1) * x - 1, 0,
-        (deskWidth + 1) * x - 1, height);
+    JXDrawLine(display, d, rootGC, (this->deskWidth + 1) * x - 1, 0,
+        (this->deskWidth + 1) * x - 1, this->getHeight());
+  }
+}
+
+/** Draw the label of a desktop.
+ * Labels are rendered once per name and background and then copied.
+ */
+void PagerType::DrawDesktopLabel(Drawable d, unsigned int desktop) {
+  LabelNode *lp;
+  const char *name;
+  int textHeight;
+  int active;
+  int xc, yc;
+
+  if (!this->labeled) {
+    return;
+  }
+  textHeight = Fonts::GetStringHeight(FONT_PAGER);
+  if (textHeight >= this->deskHeight) {
+    return;
+  }
+
+  if (this->labels.size() != settings.desktopCount) {
+    this->FreeLabels();
+    LabelNode empty;
+    empty.pixmaps[0] = None;
+    empty.pixmaps[1] = None;
+    empty.width = 0;
+    empty.height = 0;
+    this->labels.assign(settings.desktopCount, empty);
+  }
+  lp = &this->labels[desktop];
+
+  name = DesktopEnvironment::DefaultEnvironment()->GetDesktopName(desktop);
+  if (JUNLIKELY(name == NULL)) {
+    return;
+  }
+  if (lp->height != textHeight || lp->name != name) {
+    for (active = 0; active < 2; active++) {
+      if (lp->pixmaps[active] != None) {
+        JXFreePixmap(display, lp->pixmaps[active]);
+        lp->pixmaps[active] = None;
+      }
+    }
+    lp->name = name;
+    lp->width = Fonts::GetStringWidth(FONT_PAGER, name);
+    lp->height = textHeight;
+  }
+  if (lp->width <= 0 || lp->width >= this->deskWidth) {
+    return;
+  }
+
+  active = desktop == currentDesktop;
+  if (lp->pixmaps[active] == None) {
+    GC gc;
+    XGCValues gcValues;
+    lp->pixmaps[active] = JXCreatePixmap(display, rootWindow, lp->width,
+        lp->height, rootDepth);
+
+    /* rootGC may be clipped to the area being repainted. */
+    gcValues.foreground = Colors::lookupColor(
+        active ? COLOR_PAGER_ACTIVE_BG : COLOR_PAGER_BG);
+    gc = JXCreateGC(display, lp->pixmaps[active], GCForeground, &gcValues);
+    JXFillRectangle(display, lp->pixmaps[active], gc, 0, 0, lp->width,
+        lp->height);
+    JXFreeGC(display, gc);
+    Fonts::RenderString(lp->pixmaps[active], FONT_PAGER, COLOR_PAGER_TEXT, 0,
+        0, lp->width, name);
+  }
+
+  xc = (desktop % settings.desktopWidth) * (this->deskWidth + 1)
+      + (this->deskWidth - lp->width) / 2;
+  yc = (desktop / settings.desktopWidth) * (this->deskHeight + 1)
+      + (this->deskHeight - lp->height) / 2;
+  JXCopyArea(display, lp->pixmaps[active], d, rootGC, 0, 0, lp->width,
+      lp->height, xc, yc);
+}
+
+/** Free the pre-rendered desktop labels. */
+void PagerType::FreeLabels(void) {
+  for (auto &label : this->labels) {
+    for (int i = 0; i < 2; i++) {
+      if (label.pixmaps[i] != None) {
+        JXFreePixmap(display, label.pixmaps[i]);
+      }
+    }
+  }
+  this->labels.clear();
+}
+
+/** Repaint part of a desktop on the pager.
+ * Only the clients on the desktop that overlap the area are drawn.
+ */
+void PagerType::RepaintArea(int desktop, int x, int y, int width,
+    int height) {
+  XRectangle clip;
+  Pixmap buffer;
+  int dx, dy;
+
+  /* Keep the area inside the pager. */
+  if (x < 0) {
+    width += x;
+    x = 0;
+  }
+  if (y < 0) {
+    height += y;
+    y = 0;
+  }
+  width = Min(width, this->getWidth() - x);
+  height = Min(height, this->getHeight() - y);
+  if (width <= 0 || height <= 0) {
+    return;
+  }
+
+  buffer = this->getPixmap();
+  clip.x = x;
+  clip.y = y;
+  clip.width = width;
+  clip.height = height;
+  JXSetClipRectangles(display, rootGC, 0, 0, &clip, 1, Unsorted);
+
+  JXSetForeground(display, rootGC, Colors::lookupColor(COLOR_PAGER_BG));
+  JXFillRectangle(display, buffer, rootGC, x, y, width, height);
+  dx = (desktop % settings.desktopWidth) * (this->deskWidth + 1);
+  dy = (desktop / settings.desktopWidth) * (this->deskHeight + 1);
+  if ((unsigned) desktop == currentDesktop) {
+    JXSetForeground(display, rootGC,
+        Colors::lookupColor(COLOR_PAGER_ACTIVE_BG));
+    JXFillRectangle(display, buffer, rootGC, dx, dy, this->deskWidth,
+        this->deskHeight);
   }
+  this->DrawDesktopLabel(buffer, desktop);
 
+  for (auto np : this->desktopClients[desktop]) {
+    const PagerRect &r = this->clientRects[np];
+    if (r.x > x + width || r.x + r.width < x) {
+      continue;
+    }
+    if (r.y > y + height || r.y + r.height < y) {
+      continue;
+    }
+    this->DrawPagerClient(np, r);
+  }
+
+  this->DrawDividers(buffer);
+  JXSetClipMask(display, rootGC, None);
+
+  this->UpdateArea(x, y, width, height);
+}
+
+/** Repaint a client that changed.
+ * @return 0 if the whole pager must be redrawn instead.
+ */
+char PagerType::UpdateClient(const ClientNode *np) {
+  std::unordered_map<const ClientNode*, PagerRect>::iterator it;
+  PagerRect r, old;
+  int x1, y1, x2, y2;
+
+  it = this->clientRects.find(np);
+  if (it == this->clientRects.end()) {
+    return 0;
+  }
+  this->GetClientRect(np, &r);
+  old = it->second;
+  if (r == old) {
+    return 1;
+  }
+
+  /* The draw order is per desktop. */
+  if (r.desktop != old.desktop) {
+    return 0;
+  }
+  it->second = r;
+  if (r.desktop < 0) {
+    return 1;
+  }
+
+  /* Repaint the union of the old and new outlines. */
+  x1 = Min(old.x, r.x);
+  y1 = Min(old.y, r.y);
+  x2 = Max(old.x + old.width, r.x + r.width);
+  y2 = Max(old.y + old.height, r.y + r.height);
+  this->RepaintArea(r.desktop, x1, y1, x2 - x1 + 1, y2 - y1 + 1);
+  return 1;
 }
 
 void PagerType::Draw(Graphics *g) {
 
 }
 
+char PagerType::fullUpdate = 1;
+std::vector<const ClientNode*> PagerType::dirtyClients;
+
 /** Update the pager. */
 void PagerType::UpdatePager(void) {
 
-  PagerType *pp;
-
   if (JUNLIKELY(shouldExit)) {
     return;
   }
 
   for(auto pp : pagers) {
 
+    /* Redraw only the clients that changed if possible. */
+    if (!fullUpdate && pp->modelValid) {
+      unsigned int i;
+      for (i = 0; i < dirtyClients.size(); i++) {
+        if (!pp->UpdateClient(dirtyClients[i])) {
+          break;
+        }
+      }
+      if (i == dirtyClients.size()) {
+        continue;
+      }
+    }
+
     /* Draw the pager. */
     pp->Draw();
 
@@ -482,6 +710,52 @@ void PagerType::UpdatePager(void) {
 
   }
 
+  fullUpdate = 0;
+  dirtyClients.clear();
+
+}
+
+/** Redraw all of every pager on the next update. */
+void PagerType::InvalidatePager(void) {
+  fullUpdate = 1;
+  dirtyClients.clear();
+}
+
+/** Redraw a client on the next update. */
+void PagerType::InvalidateClient(const ClientNode *np) {
+  if (fullUpdate) {
+    return;
+  }
+  for (auto dp : dirtyClients) {
+    if (dp == np) {
+      return;
+    }
+  }
+  dirtyClients.push_back(np);
+}
+
+/** Forget a client that is being removed. */
+void PagerType::RemoveClient(const ClientNode *np) {
+  std::vector<const ClientNode*>::iterator it;
+  for (it = dirtyClients.begin(); it != dirtyClients.end(); ++it) {
+    if (*it == np) {
+      dirtyClients.erase(it);
+      break;
+    }
+  }
+  for (auto pp : pagers) {
+    std::map<const ClientNode*, ThumbnailNode>::iterator tp;
+    if (pp->clientRects.erase(np)) {
+      pp->modelValid = 0;
+    }
+    tp = pp->thumbnailCache.find(np);
+    if (tp != pp->thumbnailCache.end()) {
+      if (tp->second.pixmap != None) {
+        JXFreePixmap(display, tp->second.pixmap);
+      }
+      pp->thumbnailCache.erase(tp);
+    }
+  }
 }
 
 /** Signal pagers (for popups). */
@@ -506,31 +780,165 @@ void PagerType::SignalPager(const TimeType *now, int x, int y, Window w,
   }
 }
 
-/** Draw a client on the pager. */
-void PagerType::DrawPagerClient(ClientNode *np) {
+/** Refresh pager thumbnails (limited to the pager's frame rate). */
+void PagerType::SignalThumbnails(const TimeType *now, int x, int y, Window w,
+    void *data) {
+  PagerType *pp = (PagerType*) data;
+
+  if (JUNLIKELY(shouldExit) || !Thumbnails::IsAvailable()) {
+    return;
+  }
+  if (pp->buffer == None) {
+    return;
+  }
+
+  /* Without damage reports, assume visible windows changed. */
+  if (!Thumbnails::HasDamage()) {
+    Thumbnails::Invalidate();
+  }
+  if (pp->drawnSerial == Thumbnails::GetSerial() && !pp->thumbnailsStale) {
+    return;
+  }
+
+  pp->refreshThumbnails = 1;
+  pp->Draw();
+  pp->refreshThumbnails = 0;
+  pp->UpdateSpecificTray(pp->getTray());
+}
+
+/** Draw the thumbnail of a client over its pager rectangle.
+ * Thumbnails are only re-rendered from a refresh (see SignalThumbnails)
+ * or when a client is first shown; other redraws reuse the cached copy.
+ * Clients on hidden desktops are unmapped, so they always use the copy
+ * taken while they were last visible.
+ */
+void PagerType::DrawThumbnail(ClientNode *np, int x, int y, int width,
+    int height) {
+
+  std::map<const ClientNode*, ThumbnailNode>::iterator it;
+  ThumbnailNode *tp;
+  unsigned int serial;
+  char render;
+
+  serial = Thumbnails::TrackClient(np);
+
+  it = this->thumbnailCache.find(np);
+  if (it == this->thumbnailCache.end()) {
+    ThumbnailNode node;
+    node.frame = np->getParent();
+    node.pixmap = None;
+    node.width = 0;
+    node.height = 0;
+    node.serial = 0;
+    it = this->thumbnailCache.insert(std::make_pair(np, node)).first;
+  }
+  tp = &it->second;
+  tp->generation = this->drawGeneration;
+
+  /* The frame changes if the border is toggled. */
+  if (tp->frame != np->getParent()) {
+    if (tp->pixmap != None) {
+      JXFreePixmap(display, tp->pixmap);
+      tp->pixmap = None;
+    }
+    tp->frame = np->getParent();
+  }
+
+  if (tp->pixmap == None) {
+    render = 1;
+  } else if (this->refreshThumbnails) {
+    render = tp->serial != serial || tp->width != width
+        || tp->height != height;
+  } else {
+    render = 0;
+  }
+
+  if (render && !np->isHidden()) {
+    if (tp->pixmap != None && (tp->width != width || tp->height != height)) {
+      JXFreePixmap(display, tp->pixmap);
+      tp->pixmap = None;
+    }
+    if (tp->pixmap == None) {
+      tp->pixmap = JXCreatePixmap(display, rootWindow, width, height,
+          rootDepth);
+      tp->width = width;
+      tp->height = height;
+    }
+    if (Thumbnails::RenderThumbnail(np, tp->pixmap, width, height)) {
+      tp->serial = serial;
+    } else {
+      JXFreePixmap(display, tp->pixmap);
+      tp->pixmap = None;
+    }
+  }
+
+  if (tp->pixmap == None) {
+    return;
+  }
+  if ((tp->width != width || tp->height != height) && !np->isHidden()) {
+    this->thumbnailsStale = 1;
+  }
+  JXCopyArea(display, tp->pixmap, this->getPixmap(), rootGC, 0, 0,
+      Min(width, tp->width), Min(height, tp->height), x, y);
+
+}
+
+/** Free thumbnails that were not used by the last draw. */
+void PagerType::PruneThumbnails(void) {
+  std::map<const ClientNode*, ThumbnailNode>::iterator it;
+  it = this->thumbnailCache.begin();
+  while (it != this->thumbnailCache.end()) {
+    if (it->second.generation != this->drawGeneration) {
+      if (it->second.pixmap != None) {
+        JXFreePixmap(display, it->second.pixmap);
+      }
+      it = this->thumbnailCache.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+/** Compare retained client positions. */
+bool PagerType::PagerRect::operator==(const PagerRect &other) const {
+  return desktop == other.desktop && x == other.x && y == other.y
+      && width == other.width && height == other.height
+      && fill == other.fill;
+}
+
+/** Determine where a client is drawn on the pager.
+ * @return 1 if the client is drawn, 0 otherwise (rp->desktop is -1).
+ */
+char PagerType::GetClientRect(const ClientNode *np, PagerRect *rp) const {
 
   int x, y;
   int width, height;
-  int offx, offy;
+  int desktop;
+
+  rp->desktop = -1;
+  rp->x = 0;
+  rp->y = 0;
+  rp->width = 0;
+  rp->height = 0;
+  rp->fill = COLOR_PAGER_FG;
 
   /* Don't draw the client if it isn't mapped. */
   if (!(np->isMapped())) {
-    return;
+    return 0;
   }
   if (np->shouldNotShowInPager()) {
-    return;
+    return 0;
   }
 
   /* Determine the desktop for the client. */
   if (np->isSticky()) {
-    offx = currentDesktop % settings.desktopWidth;
-    offy = currentDesktop / settings.desktopWidth;
+    desktop = currentDesktop;
   } else {
-    offx = np->getDesktop() % settings.desktopWidth;
-    offy = np->getDesktop() / settings.desktopWidth;
+    desktop = np->getDesktop();
+  }
+  if (desktop < 0 || (size_t) desktop >= this->desktopClients.size()) {
+    return 0;
   }
-  offx *= this->deskWidth + 1;
-  offy *= this->deskHeight + 1;
 
   /* Determine the location and size of the client on the pager. */
   x = 1 + ((np->getX() * this->scalex) >> 16);
@@ -556,39 +964,51 @@ void PagerType::DrawPagerClient(ClientNode *np) {
 
   /* Return if there's nothing to do. */
   if (width <= 0 || height <= 0) {
-    return;
+    return 0;
   }
 
   /* Move to the correct desktop on the pager. */
-  x += offx;
-  y += offy;
+  rp->x = x + (desktop % settings.desktopWidth) * (this->deskWidth + 1);
+  rp->y = y + (desktop / settings.desktopWidth) * (this->deskHeight + 1);
+  rp->width = width;
+  rp->height = height;
+  rp->desktop = desktop;
+
+  if ((np->isActive())
+      && (np->getDesktop() == currentDesktop
+          || (np->isSticky()))) {
+    rp->fill = COLOR_PAGER_ACTIVE_FG;
+  } else if (np->shouldFlash()) {
+    rp->fill = COLOR_PAGER_ACTIVE_FG;
+  }
+  return 1;
+
+}
+
+/** Draw a client on the pager. */
+void PagerType::DrawPagerClient(ClientNode *np, const PagerRect &r) {
 
   /* Draw the client outline. */
   JXSetForeground(display, rootGC, Colors::lookupColor(COLOR_PAGER_OUTLINE));
-  JXDrawRectangle(display, this->getPixmap(), rootGC, x, y, width, height);
+  JXDrawRectangle(display, this->getPixmap(), rootGC, r.x, r.y, r.width,
+      r.height);
 
   /* Fill the client if there's room. */
-  if (width > 1 && height > 1) {
-    ColorName fillColor;
-    if ((np->isActive())
-        && (np->getDesktop() == currentDesktop
-            || (np->isSticky()))) {
-      fillColor = COLOR_PAGER_ACTIVE_FG;
-    } else if (np->shouldFlash()) {
-      fillColor = COLOR_PAGER_ACTIVE_FG;
-    } else {
-      fillColor = COLOR_PAGER_FG;
+  if (r.width > 1 && r.height > 1) {
+    JXSetForeground(display, rootGC, Colors::lookupColor(r.fill));
+    JXFillRectangle(display, this->getPixmap(), rootGC, r.x + 1, r.y + 1,
+        r.width - 1, r.height - 1);
+    if (this->thumbnails && Thumbnails::IsAvailable()) {
+      this->DrawThumbnail(np, r.x + 1, r.y + 1, r.width - 1, r.height - 1);
     }
-    JXSetForeground(display, rootGC, Colors::lookupColor(fillColor));
-    JXFillRectangle(display, this->getPixmap(), rootGC, x + 1, y + 1, width - 1,
-        height - 1);
   }
 
 }
 
 
-TrayComponent *PagerType::CreatePager(char labeled, Tray * tray, TrayComponent *parent) {
-  PagerType *pager = new PagerType(labeled, tray, parent);
+TrayComponent *PagerType::CreatePager(char labeled, char thumbnails, int fps,
+    Tray * tray, TrayComponent *parent) {
+  PagerType *pager = new PagerType(labeled, thumbnails, fps, tray, parent);
   pagers.push_back(pager);
   return pager;
 }
@@ -10,8 +10,13 @@
 #ifndef PAGER_H
 #define PAGER_H
 
+#include <map>
+#include <string>
+#include <unordered_map>
+
 #include "timing.h"
 #include "client.h"
+#include "color.h"
 #include "TrayComponent.h"
 
 /** Structure to represent a pager tray component. */
@@ -20,8 +25,37 @@ private: /* statics */
 
   static std::vector<PagerType*> pagers;
   static char shouldStopMove;
+  static char fullUpdate;
+  static std::vector<const ClientNode*> dirtyClients;
   static void PagerMoveController(int wasDestroyed);
   static void SignalPager(const TimeType *now, int x, int y, Window w, void *data);
+  static void SignalThumbnails(const TimeType *now, int x, int y, Window w,
+      void *data);
+
+  /** Cached thumbnail of a client. */
+  struct ThumbnailNode {
+    Window frame; /**< Frame the thumbnail was taken from. */
+    Pixmap pixmap; /**< Scaled contents (None if not rendered). */
+    int width, height; /**< Size of the pixmap. */
+    unsigned int serial; /**< Frame serial when rendered. */
+    unsigned int generation; /**< Last pager draw using this entry. */
+  };
+
+  /** Retained position of a client on the pager. */
+  struct PagerRect {
+    int desktop; /**< Desktop drawn on or -1 if not drawn. */
+    int x, y; /**< Location of the outline. */
+    int width, height; /**< Size of the outline. */
+    ColorName fill; /**< Fill color. */
+    bool operator==(const PagerRect &other) const;
+  };
+
+  /** Pre-rendered desktop label. */
+  struct LabelNode {
+    std::string name; /**< Name the pixmaps were rendered for. */
+    Pixmap pixmaps[2]; /**< Label on the normal and active background. */
+    int width, height; /**< Size of the label. */
+  };
 
 private:
 
@@ -31,6 +65,19 @@ private:
   int scalex; /**< Horizontal scale factor (fixed point). */
   int scaley; /**< Vertical scale factor (fixed point). */
   char labeled; /**< Set to label the pager. */
+  char thumbnails; /**< Set to show window thumbnails. */
+  int fps; /**< Maximum thumbnail refreshes per second. */
+
+  std::map<const ClientNode*, ThumbnailNode> thumbnailCache;
+  unsigned int drawGeneration; /**< Incremented for each draw. */
+  unsigned int drawnSerial; /**< Thumbnail serial of the last refresh. */
+  char refreshThumbnails; /**< Set to re-render out of date thumbnails. */
+  char thumbnailsStale; /**< Set if a visible thumbnail is the wrong size. */
+
+  std::unordered_map<const ClientNode*, PagerRect> clientRects;
+  std::vector<std::vector<ClientNode*> > desktopClients; /**< Draw order. */
+  std::vector<LabelNode> labels;
+  char modelValid; /**< Set if clientRects matches the buffer. */
 
   Pixmap buffer; /**< Buffer for rendering the pager. */
 
@@ -49,17 +96,27 @@ private:
   void StartPagerMove(int x, int y);
   void StopPagerMove(ClientNode *np, int x, int y, int desktop, MaxFlags maxFlags);
 
-  void DrawPagerClient(ClientNode *np);
+  char GetClientRect(const ClientNode *np, PagerRect *rp) const;
+  void DrawPagerClient(ClientNode *np, const PagerRect &r);
+  char UpdateClient(const ClientNode *np);
+  void RepaintArea(int desktop, int x, int y, int width, int height);
+  void DrawDesktopLabel(Drawable d, unsigned int desktop);
+  void DrawDividers(Drawable d);
+  void FreeLabels(void);
+  void DrawThumbnail(ClientNode *np, int x, int y, int width, int height);
+  void PruneThumbnails(void);
 
 public:
   virtual void Draw();
   virtual ~PagerType();
 
 private:
-  PagerType(char labelled, Tray *tray, TrayComponent *parent);
+  PagerType(char labelled, char thumbnails, int fps, Tray *tray,
+      TrayComponent *parent);
 
 public:
-  static TrayComponent *CreatePager(char labeled, Tray * tray, TrayComponent *parent);
+  static TrayComponent *CreatePager(char labeled, char thumbnails, int fps,
+      Tray * tray, TrayComponent *parent);
   /*@{*/
   static void InitializePager() {}
   static void StartupPager() {}
@@ -69,6 +126,21 @@ public:
 
   /** Update pagers. */
   static void UpdatePager(void);
+
+  /** Redraw all of every pager on the next update. */
+  static void InvalidatePager(void);
+
+  /** Redraw a client on the next update.
+   * Only the area covered by the old and new position of the client
+   * is repainted.
+   * @param np The client.
+   */
+  static void InvalidateClient(const ClientNode *np);
+
+  /** Forget a client that is being removed.
+   * @param np The client.
+   */
+  static void RemoveClient(const ClientNode *np);
 };
 
 #endif /* PAGER_H */
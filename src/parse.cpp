@@ -27,16 +27,21 @@
 #include "traybutton.h"
 #include "clock.h"
 #include "battery.h"
+#include "StatusComponent.h"
+#include "StatusSource.h"
 #include "spacer.h"
 #include "border.h"
 #include "binding.h"
 #include "DesktopEnvironment.h"
+#include "ConfigCache.h"
 
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <string>
+#include <vector>
 
 /** Mapping of action names to values.
  * Note that this mapping must be sorted.
@@ -92,6 +97,12 @@ static const char *DYNAMIC_ATTRIBUTE = "dynamic";
 static const char *SPACING_ATTRIBUTE = "spacing";
 static const char *TIMEOUT_ATTRIBUTE = "timeout";
 static const char *POPUP_ATTRIBUTE = "popup";
+static const char *THUMBNAILS_ATTRIBUTE = "thumbnails";
+static const char *FPS_ATTRIBUTE = "fps";
+static const char *TYPE_ATTRIBUTE = "type";
+static const char *COMMAND_ATTRIBUTE = "command";
+static const char *DEVICE_ATTRIBUTE = "device";
+static const char *INTERVAL_ATTRIBUTE = "interval";
 
 static const char *FALSE_VALUE = "false";
 static const char *TRUE_VALUE = "true";
@@ -100,12 +111,65 @@ static const char *const CONFIG_FILES[] = { "$XDG_CONFIG_HOME/jwm/jwmrc", "$HOME
 SYSTEM_CONFIG };
 static const unsigned CONFIG_FILE_COUNT = ARRAY_LENGTH(CONFIG_FILES);
 
+/** Sections of the configuration that are compared on reload. */
+typedef enum {
+	SECTION_MENUS, /**< Root menus. */
+	SECTION_KEYS, /**< Key and mouse bindings. */
+	SECTION_GROUPS, /**< Groups. */
+	SECTION_TRAYS, /**< Trays and their components. */
+	SECTION_STYLES, /**< Styles, icons, and title buttons. */
+	SECTION_DESKTOPS, /**< Virtual desktops. */
+	SECTION_OTHER, /**< Behavior settings and commands. */
+	SECTION_COUNT
+} ConfigSection;
+
+/** Names of the sections for messages. */
+static const char *const SECTION_NAMES[SECTION_COUNT] = {
+	"menus", "bindings", "groups", "trays", "styles", "desktops", "options"
+};
+
+/** Sections that a reload replaces; the others need a restart. */
+static const unsigned IN_PLACE_SECTIONS = (1 << SECTION_MENUS) | (1 << SECTION_KEYS) | (1 << SECTION_GROUPS);
+
+/** Every section. */
+static const unsigned ALL_SECTIONS = (1 << SECTION_COUNT) - 1;
+
+/** A configuration with its includes resolved, split into sections.
+ * The model owns the token trees that its tags point into.
+ */
+typedef struct ConfigModel {
+	TokenNode *tokens; /**< The top-level token tree. */
+	char cached; /**< Set if tokens is the compiled configuration. */
+	std::vector<TokenNode*> includes; /**< Token trees of includes. */
+	std::vector<const TokenNode*> tags; /**< Top-level tags in order. */
+	unsigned dynamic; /**< Sections with content generated at parse time. */
+	unsigned long long hashes[SECTION_COUNT]; /**< Section signatures. */
+} ConfigModel;
+
+/** Signatures of the sections of the live configuration. */
+static unsigned long long liveHashes[SECTION_COUNT];
+
+/** Set while checking a configuration; exec includes are not run and
+ * tray components are not created. */
+static char checking = 0;
+
 static char ParseFile(const char *fileName, int depth);
+static char LoadConfig(ConfigModel *model, const char *fileName);
+static char LoadConfigFile(ConfigModel *model, const char *fileName);
+static void CollectConfig(ConfigModel *model, const TokenNode *start, int depth);
+static void CollectInclude(ConfigModel *model, const TokenNode *tp, int depth);
+static void ApplyConfig(const ConfigModel *model, unsigned sections);
+static void ReleaseConfig(ConfigModel *model);
+static ConfigSection GetSection(TokenType type);
+static unsigned long long HashTokens(const TokenNode *tp, unsigned long long hash);
+static unsigned long long HashString(const char *str, unsigned long long hash);
+static char HasInclude(const TokenNode *tp);
 static TokenNode* TokenizeFile(const char *fileName);
 static TokenNode* TokenizePipe(const char *command, unsigned timeout_ms);
 
 /* Misc. */
 static void Parse(const TokenNode *start, int depth);
+static void ParseTag(const TokenNode *tp, int depth);
 static void ParseInclude(const TokenNode *tp, int depth);
 static void ParseDesktops(const TokenNode *tp);
 static void ParseDesktop(int desktop, const TokenNode *tp);
@@ -128,6 +192,7 @@ static void ParseSwallow(const TokenNode *tp, Tray *tray);
 static void ParseTrayButton(const TokenNode *tp, Tray *tray);
 static void ParseClock(const TokenNode *tp, Tray *tray);
 static void ParseBattery(const TokenNode *tp, Tray *tray);
+static void ParseStatus(const TokenNode *tp, Tray *tray);
 static void ParseTrayComponentActions(const TokenNode *tp, TrayComponent *cp);
 static void ParseDock(const TokenNode *tp, Tray *tray);
 static void ParseSpacer(const TokenNode *tp, Tray *tray);
@@ -175,25 +240,340 @@ static T findOrDefault(const TokenNode *tok, const char *attrName, T defaultVal)
 
 /** Parse the JWM configuration. */
 void Parser::ParseConfig(const char *fileName) {
+	ConfigModel model;
+	LoadConfig(&model, fileName);
+	ApplyConfig(&model, ALL_SECTIONS);
+	memcpy(liveHashes, model.hashes, sizeof(liveHashes));
+	ReleaseConfig(&model);
+	Binding::ValidateKeys();
+}
+
+/** Check a configuration file without applying it. */
+char Parser::CheckConfig(const char *fileName) {
+	const unsigned warnings = GetWarningCount();
+	ConfigModel model;
+	char loaded;
+
+	checking = 1;
+	ConfigCache::SetReadOnly();
+	loaded = LoadConfig(&model, fileName);
+	ApplyConfig(&model, ALL_SECTIONS);
+	ReleaseConfig(&model);
+	Binding::ValidateKeys();
+	checking = 0;
+
+	return loaded && GetWarningCount() == warnings;
+}
+
+/** Reload the JWM configuration. */
+void Parser::ReloadConfig(const char *fileName) {
+	ConfigModel model;
+	unsigned changed;
+	unsigned i;
+
+	/* Keep the live configuration if the new one cannot be read. */
+	if (JUNLIKELY(!LoadConfig(&model, fileName))) {
+		ReleaseConfig(&model);
+		return;
+	}
+
+	changed = model.dynamic;
+	for (i = 0; i < SECTION_COUNT; i++) {
+		if (model.hashes[i] != liveHashes[i]) {
+			changed |= 1 << i;
+		}
+	}
+
+	/* Other sections keep their live state until the next restart.
+	 * Their signatures are not updated, so they are reported again on
+	 * each reload until then. */
+	if (changed & ~IN_PLACE_SECTIONS) {
+		std::string message = "Restart JWM to apply changes to:";
+		for (i = 0; i < SECTION_COUNT; i++) {
+			if (changed & ~IN_PLACE_SECTIONS & (1 << i)) {
+				message += " ";
+				message += SECTION_NAMES[i];
+			}
+		}
+		message += "\n";
+		Log(message.c_str());
+		changed &= IN_PLACE_SECTIONS;
+	}
+
+	if (changed & (1 << SECTION_MENUS)) {
+		Roots::ShutdownRootMenu();
+		Roots::DestroyRootMenu();
+		Roots::InitializeRootMenu();
+	}
+	if (changed & (1 << SECTION_KEYS)) {
+		Binding::ShutdownBindings();
+		Binding::DestroyBindings();
+		Binding::InitializeBindings();
+	}
+	if (changed & (1 << SECTION_GROUPS)) {
+		Groups::DestroyGroups();
+	}
+
+	ApplyConfig(&model, changed);
+
+	if (changed & (1 << SECTION_MENUS)) {
+		Roots::StartupRootMenu();
+	}
+	if (changed & (1 << SECTION_KEYS)) {
+		Binding::StartupBindings();
+	}
+	if (changed & ((1 << SECTION_MENUS) | (1 << SECTION_KEYS))) {
+		Binding::ValidateKeys();
+	}
+
+	for (i = 0; i < SECTION_COUNT; i++) {
+		if (IN_PLACE_SECTIONS & (1 << i)) {
+			liveHashes[i] = model.hashes[i];
+		}
+	}
+	ReleaseConfig(&model);
+}
+
+/**
+ * Load the configuration into a model.
+ * @param model The model to initialize.
+ * @param fileName The user-specified config file or NULL.
+ * @return 1 on success and 0 if no configuration file was found.
+ */
+char LoadConfig(ConfigModel *model, const char *fileName) {
+	model->tokens = NULL;
+	model->cached = 0;
+	model->dynamic = 0;
+	memset(model->hashes, 0, sizeof(model->hashes));
+
 	if (fileName) {
-		if (!ParseFile(fileName, 0)) {
-			ParseError(NULL, _("could not open %s"), fileName);
+		if (LoadConfigFile(model, fileName)) {
+			return 1;
 		}
+		ParseError(NULL, _("could not open %s"), fileName);
 	} else {
 		unsigned i;
-		char found = 0;
 		for (i = 0; i < CONFIG_FILE_COUNT; i++) {
-			if (ParseFile(CONFIG_FILES[i], 0)) {
-				found = 1;
-				break;
+			if (LoadConfigFile(model, CONFIG_FILES[i])) {
+				return 1;
 			}
 		}
-		if (!found) {
-			ParseError(NULL, _("could not open %s or %s"), CONFIG_FILES[0],
-			SYSTEM_CONFIG);
+		ParseError(NULL, _("could not open %s or %s"), CONFIG_FILES[0],
+		SYSTEM_CONFIG);
+	}
+	return 0;
+}
+
+/**
+ * Load the top-level configuration file.
+ * The compiled configuration is used if it is still valid; otherwise the
+ * file is tokenized with its includes inlined and compiled for next time.
+ * @return 1 on success and 0 on failure.
+ */
+char LoadConfigFile(ConfigModel *model, const char *fileName) {
+
+	TokenNode *tokens;
+
+	tokens = ConfigCache::LoadCache(fileName);
+	if (tokens) {
+		Log("Parsing cached config file: ");
+		Log(fileName);
+		Log("\n");
+		model->cached = 1;
+	} else {
+		tokens = ConfigCache::BuildCache(fileName);
+		if (!tokens) {
+			Log("Looked for config file '");
+			Log(fileName);
+			Log("' but did not find it\n");
+			return 0;
 		}
+		Log("Parsing config file loaded from: ");
+		Log(fileName);
+		Log("\n");
 	}
-	Binding::ValidateKeys();
+
+	model->tokens = tokens;
+	CollectConfig(model, tokens, 1);
+	return 1;
+}
+
+/** Add the top-level tags of a token list to a model. */
+void CollectConfig(ConfigModel *model, const TokenNode *start, int depth) {
+
+	const TokenNode *tp;
+	ConfigSection section;
+
+	if (JUNLIKELY(start->type != TOK_JWM)) {
+		ParseError(start, _("invalid start tag: %s"), GetTokenName(start));
+		return;
+	}
+
+	for (tp = start->subnodeHead; tp; tp = tp->next) {
+		if (tp->type == TOK_INCLUDE) {
+			CollectInclude(model, tp, depth);
+			continue;
+		}
+		section = GetSection(tp->type);
+		if (section == SECTION_MENUS && HasInclude(tp)) {
+			model->dynamic |= 1 << section;
+		}
+		model->hashes[section] = HashTokens(tp, model->hashes[section]);
+		model->tags.push_back(tp);
+	}
+
+}
+
+/** Resolve a top-level include into a model. */
+void CollectInclude(ConfigModel *model, const TokenNode *tp, int depth) {
+
+	TokenNode *tokens;
+
+	if (JUNLIKELY(!tp->value)) {
+		ParseError(tp, _("no include file specified"));
+		return;
+	}
+
+	if (!strncmp(tp->value, "exec:", 5)) {
+		tokens = TokenizePipe(&tp->value[5], ParseTimeout(tp));
+		if (JUNLIKELY(!tokens)) {
+			ParseError(tp, _("could not process include: %s"), &tp->value[5]);
+			return;
+		}
+		depth = 0;
+	} else {
+		depth += 1;
+		if (JUNLIKELY(depth > MAX_INCLUDE_DEPTH)) {
+			ParseError(NULL, _("include depth (%d) exceeded"),
+			MAX_INCLUDE_DEPTH);
+			return;
+		}
+		tokens = TokenizeFile(tp->value);
+		if (JUNLIKELY(!tokens)) {
+			ParseError(tp, _("could not open included file: %s"), tp->value);
+			return;
+		}
+	}
+
+	model->includes.push_back(tokens);
+	CollectConfig(model, tokens, depth);
+
+}
+
+/** Parse the tags of a model that belong to the specified sections. */
+void ApplyConfig(const ConfigModel *model, unsigned sections) {
+	std::vector<const TokenNode*>::const_iterator it;
+	for (it = model->tags.begin(); it != model->tags.end(); ++it) {
+		if (sections & (1 << GetSection((*it)->type))) {
+			ParseTag(*it, 0);
+		}
+	}
+}
+
+/** Release the token trees of a model. */
+void ReleaseConfig(ConfigModel *model) {
+	std::vector<TokenNode*>::iterator it;
+	for (it = model->includes.begin(); it != model->includes.end(); ++it) {
+		ReleaseTokens(*it);
+	}
+	model->includes.clear();
+	model->tags.clear();
+	if (model->cached) {
+		ConfigCache::UnloadCache();
+	} else if (model->tokens) {
+		ReleaseTokens(model->tokens);
+	}
+	model->tokens = NULL;
+}
+
+/** Get the configuration section of a top-level tag. */
+ConfigSection GetSection(TokenType type) {
+	switch (type) {
+	case TOK_ROOTMENU:
+		return SECTION_MENUS;
+	case TOK_KEY:
+	case TOK_MOUSE:
+		return SECTION_KEYS;
+	case TOK_GROUP:
+		return SECTION_GROUPS;
+	case TOK_TRAY:
+		return SECTION_TRAYS;
+	case TOK_WINDOWSTYLE:
+	case TOK_TRAYSTYLE:
+	case TOK_TASKLISTSTYLE:
+	case TOK_TRAYBUTTONSTYLE:
+	case TOK_CLOCKSTYLE:
+	case TOK_MENUSTYLE:
+	case TOK_PAGERSTYLE:
+	case TOK_POPUPSTYLE:
+	case TOK_BUTTONCLOSE:
+	case TOK_BUTTONMAX:
+	case TOK_BUTTONMAXACTIVE:
+	case TOK_BUTTONMIN:
+	case TOK_BUTTONMENU:
+	case TOK_DEFAULTICON:
+	case TOK_ICONPATH:
+	case TOK_TITLEBUTTONORDER:
+		return SECTION_STYLES;
+	case TOK_DESKTOPS:
+		return SECTION_DESKTOPS;
+	default:
+		return SECTION_OTHER;
+	}
+}
+
+/** Hash a token and its children (FNV-1a).
+ * File names and line numbers are ignored so that moving a tag to an
+ * included file does not count as a change.
+ */
+unsigned long long HashTokens(const TokenNode *tp, unsigned long long hash) {
+	const AttributeNode *ap;
+	const TokenNode *np;
+
+	if (!hash) {
+		hash = 0xCBF29CE484222325ULL;
+	}
+	hash = (hash ^ (unsigned) tp->type) * 0x100000001B3ULL;
+	hash = HashString(tp->type == TOK_INVALID ? tp->invalidName : NULL, hash);
+	hash = HashString(tp->value, hash);
+	for (ap = tp->attributes; ap; ap = ap->next) {
+		hash = HashString(ap->name, hash);
+		hash = HashString(ap->value, hash);
+	}
+	for (np = tp->subnodeHead; np; np = np->next) {
+		hash = HashTokens(np, hash);
+	}
+
+	/* Mark the end of the children. */
+	return (hash ^ 0xFF) * 0x100000001B3ULL;
+}
+
+/** Add a string, which may be NULL, to a hash. */
+unsigned long long HashString(const char *str, unsigned long long hash) {
+	if (str) {
+		while (*str) {
+			hash = (hash ^ (unsigned char) *str) * 0x100000001B3ULL;
+			str += 1;
+		}
+		hash = (hash ^ 0) * 0x100000001B3ULL;
+	} else {
+		hash = (hash ^ 0xFE) * 0x100000001B3ULL;
+	}
+	return hash;
+}
+
+/** Determine if a tree contains an include.
+ * Includes in menus are read while parsing, so their content is unknown
+ * until the menu is parsed again.
+ */
+char HasInclude(const TokenNode *tp) {
+	const TokenNode *np;
+	for (np = tp->subnodeHead; np; np = np->next) {
+		if (np->type == TOK_INCLUDE || HasInclude(np)) {
+			return 1;
+		}
+	}
+	return 0;
 }
 
 /**
@@ -246,120 +626,7 @@ void Parse(const TokenNode *start, int depth) {
 
 	if (JLIKELY(start->type == TOK_JWM)) {
 		for (tp = start->subnodeHead; tp; tp = tp->next) {
-			if (shouldReload) {
-				switch (tp->type) {
-				case TOK_ROOTMENU:
-					ParseRootMenu(tp);
-					break;
-				case TOK_INCLUDE:
-					ParseInclude(tp, depth);
-					break;
-				default:
-					break;
-				}
-			} else {
-				switch (tp->type) {
-				case TOK_DESKTOPS:
-					ParseDesktops(tp);
-					break;
-				case TOK_DOUBLECLICKSPEED:
-					settings.doubleClickSpeed = ParseUnsigned(tp, tp->value);
-					break;
-				case TOK_DOUBLECLICKDELTA:
-					settings.doubleClickDelta = ParseUnsigned(tp, tp->value);
-					break;
-				case TOK_FOCUSMODEL:
-					ParseFocusModel(tp);
-					break;
-				case TOK_GROUP:
-					ParseGroup(tp);
-					break;
-				case TOK_ICONPATH:
-					Icons::AddIconPath(tp->value);
-					break;
-				case TOK_INCLUDE:
-					ParseInclude(tp, depth);
-					break;
-				case TOK_KEY:
-					ParseKey(tp);
-					break;
-				case TOK_MOUSE:
-					ParseMouse(tp);
-					break;
-				case TOK_MENUSTYLE:
-					ParseMenuStyle(tp);
-					break;
-				case TOK_MOVEMODE:
-					ParseMoveMode(tp);
-					break;
-				case TOK_PAGERSTYLE:
-					ParsePagerStyle(tp);
-					break;
-				case TOK_POPUPSTYLE:
-					ParsePopupStyle(tp);
-					break;
-				case TOK_RESIZEMODE:
-					ParseResizeMode(tp);
-					break;
-				case TOK_RESTARTCOMMAND:
-					Commands::AddRestartCommand(tp->value);
-					break;
-				case TOK_ROOTMENU:
-					ParseRootMenu(tp);
-					break;
-				case TOK_SHUTDOWNCOMMAND:
-					Commands::AddShutdownCommand(tp->value);
-					break;
-				case TOK_SNAPMODE:
-					ParseSnapMode(tp);
-					break;
-				case TOK_STARTUPCOMMAND:
-					Commands::AddStartupCommand(tp->value);
-					break;
-				case TOK_TRAY:
-					ParseTray(tp);
-					break;
-				case TOK_TRAYSTYLE:
-					ParseTrayStyle(tp, FONT_TRAY, COLOR_TRAY_FG);
-					break;
-				case TOK_TASKLISTSTYLE:
-					ParseTrayStyle(tp, FONT_TASKLIST, COLOR_TASKLIST_FG);
-					break;
-				case TOK_TRAYBUTTONSTYLE:
-					ParseTrayStyle(tp, FONT_TRAYBUTTON, COLOR_TRAYBUTTON_FG);
-					break;
-				case TOK_CLOCKSTYLE:
-					ParseClockStyle(tp);
-					break;
-				case TOK_WINDOWSTYLE:
-					ParseWindowStyle(tp);
-					break;
-				case TOK_BUTTONCLOSE:
-					Border::SetBorderIcon(BI_CLOSE, tp->value);
-					break;
-				case TOK_BUTTONMAX:
-					Border::SetBorderIcon(BI_MAX, tp->value);
-					break;
-				case TOK_BUTTONMAXACTIVE:
-					Border::SetBorderIcon(BI_MAX_ACTIVE, tp->value);
-					break;
-				case TOK_BUTTONMIN:
-					Border::SetBorderIcon(BI_MIN, tp->value);
-					break;
-				case TOK_BUTTONMENU:
-					Border::SetBorderIcon(BI_MENU, tp->value);
-					break;
-				case TOK_DEFAULTICON:
-					Icons::SetDefaultIcon(tp->value);
-					break;
-				case TOK_TITLEBUTTONORDER:
-					Setting::SetTitleButtonOrder(tp->value);
-					break;
-				default:
-					InvalidTag(tp, TOK_JWM);
-					break;
-				}
-			}
+			ParseTag(tp, depth);
 		}
 	} else {
 		ParseError(start, _("invalid start tag: %s"), GetTokenName(start));
@@ -367,6 +634,111 @@ void Parse(const TokenNode *start, int depth) {
 
 }
 
+/** Parse a top-level tag. */
+void ParseTag(const TokenNode *tp, int depth) {
+	switch (tp->type) {
+	case TOK_DESKTOPS:
+		ParseDesktops(tp);
+		break;
+	case TOK_DOUBLECLICKSPEED:
+		settings.doubleClickSpeed = ParseUnsigned(tp, tp->value);
+		break;
+	case TOK_DOUBLECLICKDELTA:
+		settings.doubleClickDelta = ParseUnsigned(tp, tp->value);
+		break;
+	case TOK_FOCUSMODEL:
+		ParseFocusModel(tp);
+		break;
+	case TOK_GROUP:
+		ParseGroup(tp);
+		break;
+	case TOK_ICONPATH:
+		Icons::AddIconPath(tp->value);
+		break;
+	case TOK_INCLUDE:
+		ParseInclude(tp, depth);
+		break;
+	case TOK_KEY:
+		ParseKey(tp);
+		break;
+	case TOK_MOUSE:
+		ParseMouse(tp);
+		break;
+	case TOK_MENUSTYLE:
+		ParseMenuStyle(tp);
+		break;
+	case TOK_MOVEMODE:
+		ParseMoveMode(tp);
+		break;
+	case TOK_PAGERSTYLE:
+		ParsePagerStyle(tp);
+		break;
+	case TOK_POPUPSTYLE:
+		ParsePopupStyle(tp);
+		break;
+	case TOK_RESIZEMODE:
+		ParseResizeMode(tp);
+		break;
+	case TOK_RESTARTCOMMAND:
+		Commands::AddRestartCommand(tp->value);
+		break;
+	case TOK_ROOTMENU:
+		ParseRootMenu(tp);
+		break;
+	case TOK_SHUTDOWNCOMMAND:
+		Commands::AddShutdownCommand(tp->value);
+		break;
+	case TOK_SNAPMODE:
+		ParseSnapMode(tp);
+		break;
+	case TOK_STARTUPCOMMAND:
+		Commands::AddStartupCommand(tp->value);
+		break;
+	case TOK_TRAY:
+		ParseTray(tp);
+		break;
+	case TOK_TRAYSTYLE:
+		ParseTrayStyle(tp, FONT_TRAY, COLOR_TRAY_FG);
+		break;
+	case TOK_TASKLISTSTYLE:
+		ParseTrayStyle(tp, FONT_TASKLIST, COLOR_TASKLIST_FG);
+		break;
+	case TOK_TRAYBUTTONSTYLE:
+		ParseTrayStyle(tp, FONT_TRAYBUTTON, COLOR_TRAYBUTTON_FG);
+		break;
+	case TOK_CLOCKSTYLE:
+		ParseClockStyle(tp);
+		break;
+	case TOK_WINDOWSTYLE:
+		ParseWindowStyle(tp);
+		break;
+	case TOK_BUTTONCLOSE:
+		Border::SetBorderIcon(BI_CLOSE, tp->value);
+		break;
+	case TOK_BUTTONMAX:
+		Border::SetBorderIcon(BI_MAX, tp->value);
+		break;
+	case TOK_BUTTONMAXACTIVE:
+		Border::SetBorderIcon(BI_MAX_ACTIVE, tp->value);
+		break;
+	case TOK_BUTTONMIN:
+		Border::SetBorderIcon(BI_MIN, tp->value);
+		break;
+	case TOK_BUTTONMENU:
+		Border::SetBorderIcon(BI_MENU, tp->value);
+		break;
+	case TOK_DEFAULTICON:
+		Icons::SetDefaultIcon(tp->value);
+		break;
+	case TOK_TITLEBUTTONORDER:
+		Setting::SetTitleButtonOrder(tp->value);
+		break;
+	default:
+		InvalidTag(tp, TOK_JWM);
+		break;
+	}
+}
+
 /** Parse focus model. */
 void ParseFocusModel(const TokenNode *tp) {
 	static const StringMappingType mapping[] = { { "click", FOCUS_CLICK }, { "clicktitle", FOCUS_CLICK_TITLE }, {
@@ -1181,6 +1553,8 @@ void ParseTray(const TokenNode *tp) {
 		tray->SetTrayLayer(ParseLayer(tp, attr));
 	}
 
+	/* Tray components need the display. While checking, the component
+	 * parsers only read the attributes and do not create anything. */
 	for (np = tp->subnodeHead; np; np = np->next) {
 		switch (np->type) {
 		case TOK_PAGER:
@@ -1201,6 +1575,9 @@ void ParseTray(const TokenNode *tp) {
 		case TOK_BATTERY:
 			ParseBattery(np, tray);
 			break;
+		case TOK_STATUS:
+			ParseStatus(np, tray);
+			break;
 		case TOK_DOCK:
 			ParseDock(np, tray);
 			break;
@@ -1221,6 +1598,8 @@ void ParsePager(const TokenNode *tp, Tray *tray) {
 
 	const char *temp;
 	int labeled;
+	int thumbnails;
+	int fps;
 
 	Assert(tp);
 	Assert(tray);
@@ -1230,7 +1609,21 @@ void ParsePager(const TokenNode *tp, Tray *tray) {
 	if (temp && !strcmp(temp, TRUE_VALUE)) {
 		labeled = 1;
 	}
-	PagerType *pager = PagerType::CreatePager(labeled, tray, tray->getLastComponent());
+	thumbnails = 0;
+	temp = FindAttribute(tp->attributes, THUMBNAILS_ATTRIBUTE);
+	if (temp && !strcmp(temp, TRUE_VALUE)) {
+		thumbnails = 1;
+	}
+	fps = 0;
+	temp = FindAttribute(tp->attributes, FPS_ATTRIBUTE);
+	if (temp) {
+		fps = ParseUnsigned(tp, temp);
+	}
+	if (checking) {
+		return;
+	}
+	PagerType *pager = PagerType::CreatePager(labeled, thumbnails, fps, tray,
+			tray->getLastComponent());
 	tray->AddTrayComponent(pager);
 
 }
@@ -1239,17 +1632,24 @@ void ParsePager(const TokenNode *tp, Tray *tray) {
 void ParseTaskList(const TokenNode *tp, Tray *tray) {
 	TaskBar *cp;
 	const char *temp;
+	int maxWidth, height;
 
 	Assert(tp);
 	Assert(tray);
 
+	maxWidth = findOrDefault(tp, "maxwidth", 0);
+	height = findOrDefault(tp, "height", 0);
+	temp = FindAttribute(tp->attributes, "labeled");
+	if (checking) {
+		return;
+	}
+
 	cp = TaskBar::Create(tray, tray->getLastComponent());
 	tray->AddTrayComponent(cp);
 
-	cp->SetMaxTaskBarItemWidth(findOrDefault(tp, "maxwidth", 0));
-	cp->SetTaskBarHeight(findOrDefault(tp, "height", 0));
+	cp->SetMaxTaskBarItemWidth(maxWidth);
+	cp->SetTaskBarHeight(height);
 
-	temp = FindAttribute(tp->attributes, "labeled");
 	if (temp && !strcmp(temp, FALSE_VALUE)) {
 		TaskBar::SetTaskBarLabeled(cp, 0);
 	}
@@ -1304,6 +1704,9 @@ void ParseSwallow(const TokenNode *tp, Tray *tray) {
 
 	width = findOrDefault(tp, WIDTH_ATTRIBUTE, 0);
 	height = findOrDefault(tp, HEIGHT_ATTRIBUTE, 0);
+	if (checking) {
+		return;
+	}
 
 	cp = new SwallowNode(name, tp->value, width, height, tray, tray->getLastComponent());
 	tray->AddTrayComponent(cp);
@@ -1330,6 +1733,10 @@ void ParseTrayButton(const TokenNode *tp, Tray *tray) {
 	width = findOrDefault(tp, WIDTH_ATTRIBUTE, 0);
 	height = findOrDefault(tp, HEIGHT_ATTRIBUTE, 0);
 
+	if (checking) {
+		ParseTrayComponentActions(tp, NULL);
+		return;
+	}
 	cp = TrayButton::Create(icon, label, popup, width, height, tray, tray->getLastComponent());
 	if (JLIKELY(cp)) {
 		tray->AddTrayComponent(cp);
@@ -1348,11 +1755,59 @@ void ParseBattery(const TokenNode *tp, Tray *tray) {
 
 	width = findOrDefault(tp, WIDTH_ATTRIBUTE, 0);
 	height = findOrDefault(tp, HEIGHT_ATTRIBUTE, 0);
+	if (checking) {
+		return;
+	}
 
 	TrayComponent *cp = new Battery(width, height, tray, tray->getLastComponent());
 	tray->AddTrayComponent(cp);
 }
 
+/** Parse a status tray component. */
+void ParseStatus(const TokenNode *tp, Tray *tray) {
+	static const StringMappingType mapping[] = {
+		{ "command", StatusComponent::STATUS_COMMAND },
+		{ "cpu", StatusComponent::STATUS_CPU },
+		{ "memory", StatusComponent::STATUS_MEMORY },
+		{ "network", StatusComponent::STATUS_NETWORK }
+	};
+	StatusComponent::StatusType type;
+	const char *argument;
+	unsigned interval;
+	int width, height;
+
+	Assert(tp);
+	Assert(tray);
+
+	type = (StatusComponent::StatusType) ParseAttribute(mapping,
+			ARRAY_LENGTH(mapping), tp, TYPE_ATTRIBUTE,
+			StatusComponent::STATUS_CPU);
+	if (type == StatusComponent::STATUS_COMMAND) {
+		argument = FindAttribute(tp->attributes, COMMAND_ATTRIBUTE);
+		if (JUNLIKELY(!argument)) {
+			ParseError(tp, _("no command specified for status"));
+			return;
+		}
+	} else {
+		argument = FindAttribute(tp->attributes, DEVICE_ATTRIBUTE);
+	}
+	interval = findOrDefault(tp, INTERVAL_ATTRIBUTE,
+			(unsigned) STATUS_DEFAULT_INTERVAL);
+
+	width = findOrDefault(tp, WIDTH_ATTRIBUTE, 0);
+	height = findOrDefault(tp, HEIGHT_ATTRIBUTE, 0);
+	if (checking) {
+		ParseTrayComponentActions(tp, NULL);
+		return;
+	}
+
+	StatusComponent *cp = StatusComponent::CreateStatus(type,
+			FindAttribute(tp->attributes, LABEL_ATTRIBUTE), argument, interval,
+			ParseTimeout(tp), width, height, tray, tray->getLastComponent());
+	ParseTrayComponentActions(tp, cp);
+	tray->AddTrayComponent(cp);
+}
+
 /** Parse a clock tray component. */
 void ParseClock(const TokenNode *tp, Tray *tray) {
 	const char *format;
@@ -1367,6 +1822,10 @@ void ParseClock(const TokenNode *tp, Tray *tray) {
 
 	width = findOrDefault(tp, WIDTH_ATTRIBUTE, 0);
 	height = findOrDefault(tp, HEIGHT_ATTRIBUTE, 0);
+	if (checking) {
+		ParseTrayComponentActions(tp, NULL);
+		return;
+	}
 
 	ClockType *clock = ClockType::CreateClock(format, zone, width, height, tray, tray->getLastComponent());
 	ParseTrayComponentActions(tp, clock);
@@ -1374,14 +1833,14 @@ void ParseClock(const TokenNode *tp, Tray *tray) {
 
 }
 
-/** Parse tray component actions. */
+/** Parse tray component actions. cp is NULL to only check them. */
 void ParseTrayComponentActions(const TokenNode *tp, TrayComponent *cp) {
 	const TokenNode *np;
 	const char *mask_str;
 	const int default_mask = (1 << 1) | (1 << 2) | (1 << 3);
 	int mask;
 
-	if (tp->value) {
+	if (tp->value && cp) {
 		cp->addAction(tp->value, default_mask);
 	}
 
@@ -1398,7 +1857,9 @@ void ParseTrayComponentActions(const TokenNode *tp, TrayComponent *cp) {
 			} else {
 				mask = default_mask;
 			}
-			cp->addAction(np->value, mask);
+			if (cp) {
+				cp->addAction(np->value, mask);
+			}
 			break;
 		default:
 			InvalidTag(np, tp->type);
@@ -1421,6 +1882,9 @@ void ParseDock(const TokenNode *tp, Tray *tray) {
 	if (str) {
 		settings.dockSpacing = ParseUnsigned(tp, str);
 	}
+	if (checking) {
+		return;
+	}
 
 	TrayComponent *cp = DesktopEnvironment::DefaultEnvironment()->CreateDock(width, tray, tray->getLastComponent());
 	tray->AddTrayComponent(cp);
@@ -1454,6 +1918,9 @@ void ParseSpacer(const TokenNode *tp, Tray *tray) {
 	}
 
 	/* Create the spacer. */
+	if (checking) {
+		return;
+	}
 	Spacer *cp = new Spacer(width, height, tray, tray->getLastComponent());
 	tray->AddTrayComponent(cp);
 }
@@ -1792,14 +2259,14 @@ TokenNode* TokenizeFile(const char *fileName) {
 		close(fd);
 		return NULL;
 	}
-	buffer = (char*) mmap(NULL, sbuf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	/* The lexer terminates strings in place, so map a private copy. */
+	buffer = (char*) mmap(NULL, sbuf.st_size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE, fd, 0);
+	close(fd);
 	if (JUNLIKELY(buffer == MAP_FAILED)) {
-		close(fd);
 		return NULL;
 	}
-	tokens = Tokenize(buffer, fileName);
-	munmap(buffer, sbuf.st_size);
-	close(fd);
+	tokens = TokenizeMapping(buffer, sbuf.st_size, fileName);
 	return tokens;
 }
 
@@ -1809,6 +2276,11 @@ TokenNode* TokenizePipe(const char *command, unsigned timeout_ms) {
 	char *path;
 	char *buffer;
 
+	/* The output of a command can't be checked without running it again. */
+	if (checking) {
+		return Tokenize("<JWM></JWM>", command);
+	}
+
 	path = CopyString(command);
 	ExpandPath(&path);
 
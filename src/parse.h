@@ -19,6 +19,24 @@ public:
 	 */
 	static void ParseConfig(const char *fileName);
 
+	/** Reload a configuration file.
+	 * The new configuration is compared with the live one section by
+	 * section and the menus, bindings, and groups that changed are
+	 * replaced. Changes to other sections are logged and take effect
+	 * on the next restart.
+	 * @param fileName The user-specified config file to parse.
+	 */
+	static void ReloadConfig(const char *fileName);
+
+	/** Check a configuration file without applying it.
+	 * Exec includes are not run and the compiled configuration is not
+	 * written. This is only used in a separate process since the
+	 * configuration is still parsed into the global state.
+	 * @param fileName The user-specified config file to check.
+	 * @return 1 if the configuration parsed without warnings, 0 otherwise.
+	 */
+	static char CheckConfig(const char *fileName);
+
 	/** Parse a dynamic menu.
 	 * @param timeout_ms The timeout in milliseconds.
 	 * @param command The command to generate the menu.
@@ -14,6 +14,7 @@
 #include "main.h"
 #include "color.h"
 #include "misc.h"
+#include "Graphics.h"
 
 /** Draw a scaled icon. */
 void PutScaledRenderIcon(const IconNode *icon,
@@ -109,7 +110,7 @@ ScaledIconNode *CreateScaledRenderIcon(ImageNode *image, long fg)
    result->height = height;
 
    mask = JXCreatePixmap(display, rootWindow, width, height, 8);
-   maskGC = JXCreateGC(display, mask, 0, NULL);
+   maskGC = Graphics::AcquireGC(8);
    pmap = JXCreatePixmap(display, rootWindow, width, height, rootDepth);
 
    destImage = JXCreateImage(display, rootVisual, rootDepth,
@@ -174,7 +175,7 @@ ScaledIconNode *CreateScaledRenderIcon(ImageNode *image, long fg)
    delete[](destMask->data);
    destMask->data = NULL;
    JXDestroyImage(destMask);
-   JXFreeGC(display, maskGC);
+   Graphics::ReleaseGC(maskGC);
 
    /* Create the alpha picture. */
    fp = JXRenderFindStandardFormat(display, PictStandardA8);
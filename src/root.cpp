@@ -19,6 +19,7 @@
 #include "parse.h"
 #include "settings.h"
 #include "DesktopEnvironment.h"
+#include "ConfigWatcher.h"
 
 /** Number of root menus to support. */
 #define ROOT_MENU_COUNT 36
@@ -217,15 +218,15 @@ void Roots::Exit(char confirm) {
 	}
 }
 
-/** Reload the menu. */
+/** Reload the configuration.
+ * Changes to menus, bindings, and groups are applied in place; other
+ * changes wait for a restart.
+ */
 void Roots::ReloadMenu(void) {
 	shouldReload = 1;
 	if (!menuShown) {
-		ShutdownRootMenu();
-		DestroyRootMenu();
-		InitializeRootMenu();
-		Parser::ParseConfig(configPath);
-		StartupRootMenu();
+		Parser::ReloadConfig(configPath);
+		ConfigWatcher::UpdateWatches();
 		shouldReload = 0;
 	}
 }
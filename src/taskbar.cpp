@@ -14,6 +14,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <algorithm>
 #include <iterator>
 #include <utility>
 
@@ -40,7 +41,10 @@
 using namespace std;
 using ::TaskBar;
 std::vector<TaskBar*> TaskBar::bars;
-std::map<const char*, TaskBar::BarItem*> TaskBar::taskEntries;
+std::vector<TaskBar::BarItem*> TaskBar::taskEntries;
+std::unordered_map<std::string, TaskBar::BarItem*> TaskBar::classIndex;
+std::unordered_map<const ClientNode*, TaskBar::BarItem*> TaskBar::clientIndex;
+unsigned int TaskBar::generation = 1;
 
 /** Initialize task bar data. */
 void TaskBar::InitializeTaskBar(void) {
@@ -75,10 +79,12 @@ void TaskBar::DestroyTaskBar(void) {
     Release((*it));
   }
 
-  for (auto t : taskEntries) {
-    delete t.second;
+  for (auto tp : taskEntries) {
+    delete tp;
   }
   taskEntries.clear();
+  classIndex.clear();
+  clientIndex.clear();
 }
 
 void TaskBar::Draw(Graphics *g) {
@@ -98,6 +104,7 @@ TaskBar::TaskBar(Tray *tray, TrayComponent *parent) :
   this->mousey = -settings.doubleClickDelta;
   this->mouseTime.seconds = 0;
   this->mouseTime.ms = 0;
+  this->drawnValid = false;
   this->pixmap = JXCreatePixmap(display, rootWindow, this->getWidth(),
       this->getHeight(), rootDepth);
   this->buffer = this->pixmap;
@@ -130,6 +137,7 @@ void TaskBar::Resize() {
   }
   this->pixmap = JXCreatePixmap(display, rootWindow, this->getWidth(),
       this->getHeight(), rootDepth);
+  this->drawnValid = false;
   Tray::ClearTrayDrawable(this);
   this->UpdateSpecificTray(this->getTray());
 }
@@ -150,8 +158,8 @@ void TaskBar::ComputeItemSize() {
     unsigned itemCount = 0;
 
     this->itemHeight = this->getHeight();
-    for (auto &entry : taskEntries) {
-      if (entry.second->ShouldFocusEntry()) {
+    for (auto tp : taskEntries) {
+      if (tp->ShouldFocusEntry()) {
         itemCount += 1;
       }
     }
@@ -397,41 +405,70 @@ void TaskBar::RunTaskBarCommand(MenuAction *action, unsigned button) {
 
 /** Add a client to the task bar. */
 void TaskBar::AddClientToTaskBar(ClientNode *np) {
-  BarItem *tp;
-  if (np->getClassName() && settings.groupTasks) {
-    for (auto &entry : taskEntries) {
-      const char *className = entry.second->getClassName();
-      if (className && !strcmp(np->getClassName(), className)) {
-        break;
-      }
+  BarItem *tp = NULL;
+  const bool grouped = np->getClassName() && settings.groupTasks;
+
+  if (grouped) {
+    std::unordered_map<std::string, BarItem*>::iterator it;
+    it = classIndex.find(np->getClassName());
+    if (it != classIndex.end()) {
+      tp = it->second;
+      tp->AddClient(np);
     }
   }
   if (tp == NULL) {
     tp = new BarItem(np);
-    taskEntries[tp->getClassName()] = tp;
+    taskEntries.push_back(tp);
+    if (grouped) {
+      classIndex[np->getClassName()] = tp;
+    }
   }
+  clientIndex[np] = tp;
 
-  Events::_RequireTaskUpdate();
+  Events::_RequireTaskUpdate(np);
   UpdateNetClientList();
 
 }
 
 /** Remove a client from the task bar. */
 void TaskBar::RemoveClientFromTaskBar(ClientNode *np) {
+  std::unordered_map<const ClientNode*, BarItem*>::iterator it;
   BarItem *tp;
-  std::vector<BarItem*>::iterator te;
-  for (auto &entry : taskEntries) {
-    tp = entry.second;
-
-    if (tp->RemoveClient(np)) {
-      if (tp->empty()) {
-        taskEntries.erase(entry.first);
-        Release(tp);
+
+  it = clientIndex.find(np);
+  if (it == clientIndex.end()) {
+    return;
+  }
+  tp = it->second;
+  Events::_RequireTaskUpdate(np);
+  clientIndex.erase(it);
+
+  tp->RemoveClient(np);
+  if (tp->empty()) {
+    if (np->getClassName()) {
+      std::unordered_map<std::string, BarItem*>::iterator ci;
+      ci = classIndex.find(np->getClassName());
+      if (ci != classIndex.end() && ci->second == tp) {
+        classIndex.erase(ci);
       }
-      Events::_RequireTaskUpdate();
-      UpdateNetClientList();
-      return;
     }
+    taskEntries.erase(std::find(taskEntries.begin(), taskEntries.end(), tp));
+    delete tp;
+  }
+  UpdateNetClientList();
+}
+
+/** Mark the cached state of every task entry as stale. */
+void TaskBar::InvalidateEntries(void) {
+  generation += 1;
+}
+
+/** Mark the cached state of the entry containing a client as stale. */
+void TaskBar::InvalidateClient(const ClientNode *np) {
+  std::unordered_map<const ClientNode*, BarItem*>::iterator it;
+  it = clientIndex.find(np);
+  if (it != clientIndex.end()) {
+    it->second->Invalidate();
   }
 }
 
@@ -454,8 +491,8 @@ void TaskBar::UpdateTaskBar(void) {
         bar->itemHeight = Fonts::GetStringHeight(FONT_TASKLIST) + 12;
       }
       bar->requestedHeight = 0;
-      for (auto &entry : taskEntries) {
-        if (entry.second->ShouldFocusEntry()) {
+      for (auto tp : taskEntries) {
+        if (tp->ShouldFocusEntry()) {
           bar->requestedHeight += bar->itemHeight;
         }
       }
@@ -495,137 +532,155 @@ void TaskBar::SignalTaskbar(const TimeType *now, int x, int y, Window w,
 
 }
 
-/** Draw a specific task bar. */
+/** Draw a specific task bar.
+ * Only buttons that differ from what is already in the pixmap are drawn.
+ */
 void TaskBar::Draw() {
-  char *displayName;
-  Drawable drawable = this->getPixmap();
-  bool border = false, fill = true;
-  int x, y, width, height, xoffset, yoffset;
-  IconNode *icon = NULL;
-  const char *text = NULL;
-  AlignmentType alignment = ALIGN_CENTER;
-  FontType font = FONT_TASKLIST;
-  ButtonType type;
+  std::vector<ButtonState> buttons;
+  ButtonState state;
+  char displayName[256];
+  bool border;
+  bool full;
+  int xoffset = 0, yoffset = 0;
+  unsigned int i;
 
   if (JUNLIKELY(shouldExit)) {
     return;
   }
 
-  Tray::ClearTrayDrawable(this);
-  if (taskEntries.empty()) {
-    this->UpdateSpecificTray(this->getTray());
-    return;
-  }
-
-  border = settings.taskListDecorations == DECO_MOTIF;
-  font = FONT_TASKLIST;
-  height = this->itemHeight;
-  width = this->itemWidth;
-  text = NULL;
-
-  x = 0;
-  y = 0;
-  for (const auto &entry : taskEntries) {
-    BarItem *client = entry.second;
+  /* Determine what each button should look like. */
+  state.x = 0;
+  state.y = 0;
+  state.width = this->itemWidth;
+  state.height = this->itemHeight;
+  for (auto client : taskEntries) {
 
     if (!client->ShouldFocusEntry()) {
       continue;
     }
 
     /* Check for an active or urgent window and count clients. */
-    unsigned clientCount = client->activeCount();
-    type = BUTTON_TASK;
+    state.entry = client;
+    state.type = client->activeCount() > 0 ? BUTTON_TASK_ACTIVE : BUTTON_TASK;
     if (!client->getIcon()) {
-      icon = Icons::GetDefaultIcon();
+      state.icon = Icons::GetDefaultIcon();
     } else {
-      icon = client->getIcon();
+      state.icon = client->getIcon();
     }
-    displayName = NULL;
+    state.text.clear();
     if (this->labeled) {
       if (client->getClassName() && settings.groupTasks) {
+        const unsigned clientCount = client->focusCount();
         if (clientCount != 1) {
-          const size_t len = strlen(client->getClassName()) + 16;
-          displayName = new char[len];
-          snprintf(displayName, len, "%s (%u)", client->getClassName(),
-              clientCount);
-          text = displayName;
+          snprintf(displayName, sizeof(displayName), "%s (%u)",
+              client->getClassName(), clientCount);
+          state.text = displayName;
         } else {
-          text = client->getClassName();
+          state.text = client->getClassName();
         }
-      } else {
-        text = client->getName();
+      } else if (client->getName()) {
+        state.text = client->getName();
       }
     }
-    DrawButton(type, alignment, font, text, fill, border, drawable, icon, x, y,
-        width, height, xoffset, yoffset);
-    if (displayName) {
-      Release(displayName);
-    }
+    buttons.push_back(state);
 
     if (this->layout == LAYOUT_HORIZONTAL) {
-      x += this->itemWidth;
+      state.x += this->itemWidth;
     } else {
-      y += this->itemHeight;
+      state.y += this->itemHeight;
     }
   }
 
-  this->UpdateSpecificTray(this->getTray());
+  /* Redraw everything if the buttons moved or the pixmap was replaced. */
+  full = !this->drawnValid || buttons.size() != drawnButtons.size()
+      || (!buttons.empty() && (buttons[0].width != drawnButtons[0].width
+          || buttons[0].height != drawnButtons[0].height));
+  if (full) {
+    Tray::ClearTrayDrawable(this);
+  }
 
+  border = settings.taskListDecorations == DECO_MOTIF;
+  for (i = 0; i < buttons.size(); i++) {
+    const ButtonState &bp = buttons[i];
+    if (!full && bp == drawnButtons[i]) {
+      continue;
+    }
+    DrawButton(bp.type, ALIGN_CENTER, FONT_TASKLIST,
+        bp.text.empty() ? NULL : bp.text.c_str(), true, border, this->getPixmap(),
+        bp.icon, bp.x, bp.y, bp.width, bp.height, xoffset, yoffset);
+    if (!full) {
+      this->UpdateArea(bp.x, bp.y, bp.width, bp.height);
+    }
+  }
+
+  if (full) {
+    this->UpdateSpecificTray(this->getTray());
+  }
+  drawnButtons.swap(buttons);
+  this->drawnValid = true;
+
+}
+
+/** Find the index of the task entry containing the active client.
+ * Returns the number of entries if there is no active entry.
+ */
+size_t TaskBar::FindActiveEntry(void) {
+  size_t i;
+  for (i = 0; i < taskEntries.size(); i++) {
+    if (taskEntries[i]->hasActiveClient()) {
+      break;
+    }
+  }
+  return i;
 }
 
 /** Focus the next client in the task bar. */
 void TaskBar::FocusNext(void) {
-  BarItem *tp;
+  const size_t count = taskEntries.size();
+  size_t start, i;
 
-  /* Find the current entry. */
-  for (auto &entry : taskEntries) {
-    tp = entry.second;
+  if (count == 0) {
+    return;
+  }
 
-    if (tp->hasActiveClient()) {
-      break;
-    }
+  /* Find the current entry. */
+  start = FindActiveEntry();
+  if (start == count) {
+    start = count - 1;
   }
 
-  /* Focus the group if one exists. */
-  if (tp) {
-    tp->focusGroup();
+  /* Move to the next group, wrapping around. */
+  for (i = 1; i <= count; i++) {
+    BarItem *tp = taskEntries[(start + i) % count];
+    if (tp->ShouldFocusEntry()) {
+      tp->focusGroup();
+      return;
+    }
   }
 }
 
 /** Focus the previous client in the task bar. */
 void TaskBar::FocusPrevious(void) {
-  BarItem *tp = NULL;
+  const size_t count = taskEntries.size();
+  size_t start, i;
 
-  /* Find the current entry. */
-  std::map<const char*, BarItem*>::iterator it = taskEntries.begin();
-  for (; it != taskEntries.end(); ++it) {
-    tp = it->second;
-
-    if (it->second->hasActiveClient()) {
-      break;
-    }
+  if (count == 0) {
+    return;
   }
 
-  /* Move to the previous group. */
-  if (tp) {
-    do {
-      ++it;
-      tp = it->second;
-    } while (it != taskEntries.end() && !tp->ShouldFocusEntry());
-  }
-  if (!tp) {
-    /* Wrap around; start at the end. */
-    for (std::map<const char*, BarItem*>::reverse_iterator i =
-        taskEntries.rbegin(); i != taskEntries.rend(); ++i) {
-      if (i->second->ShouldFocusEntry()) {
-        break;
-      }
-    }
+  /* Find the current entry. */
+  start = FindActiveEntry();
+  if (start == count) {
+    start = 0;
   }
 
-  /* Focus the group if one exists. */
-  if (tp) {
-    tp->focusGroup();
+  /* Move to the previous group, wrapping around. */
+  for (i = 1; i <= count; i++) {
+    BarItem *tp = taskEntries[(start + count - i) % count];
+    if (tp->ShouldFocusEntry()) {
+      tp->focusGroup();
+      return;
+    }
   }
 }
 
@@ -681,27 +736,38 @@ void TaskBar::UpdateNetClientList(void) {
 
 }
 
-unsigned int TaskBar::BarItem::activeCount() {
-  int count = 0;
+/** Recompute the cached counts if they are stale. */
+void TaskBar::BarItem::RefreshCounts() {
+  if (this->countGeneration == generation) {
+    return;
+  }
+  this->cachedActive = 0;
+  this->cachedFocus = 0;
+  this->cachedShouldFocus = false;
   for (auto client : clients) {
-    if (ClientList::ShouldFocus(client, 0)
-        && ((client->shouldFlash()) != 0
-            || ((client->isActive())
-                && IsClientOnCurrentDesktop(client)))) {
-      count += 1;
+    if (ClientList::ShouldFocus(client, 0)) {
+      this->cachedFocus += 1;
+      if ((client->shouldFlash()) != 0
+          || ((client->isActive()) && IsClientOnCurrentDesktop(client))) {
+        this->cachedActive += 1;
+      }
+    }
+    if (client->isStatus(STAT_CANFOCUS | STAT_TAKEFOCUS)
+        && ClientList::ShouldFocus(client, 1)) {
+      this->cachedShouldFocus = true;
     }
   }
-  return count;
+  this->countGeneration = generation;
+}
+
+unsigned int TaskBar::BarItem::activeCount() {
+  this->RefreshCounts();
+  return this->cachedActive;
 }
 
 unsigned int TaskBar::BarItem::focusCount() {
-  int count = 0;
-  for (auto client : clients) {
-    if (ClientList::ShouldFocus(client, 0)) {
-      count += 1;
-    }
-  }
-  return count;
+  this->RefreshCounts();
+  return this->cachedFocus;
 }
 
 bool TaskBar::BarItem::hasActiveClient() {
@@ -718,14 +784,8 @@ bool TaskBar::BarItem::hasActiveClient() {
 
 /** Determine if we should attempt to focus an entry. */
 bool TaskBar::BarItem::ShouldFocusEntry() {
-  for (auto client : clients) {
-    if (client->isStatus(STAT_CANFOCUS | STAT_TAKEFOCUS)) {
-      if (ClientList::ShouldFocus(client, 1)) {
-        return true;
-      }
-    }
-  }
-  return false;
+  this->RefreshCounts();
+  return this->cachedShouldFocus;
 }
 
 /** Check if all clients in this grou are on the top of their layer. */
@@ -751,8 +811,8 @@ TaskBar::BarItem* TaskBar::GetEntry(int x, int y) {
   int offset;
 
   offset = 0;
-  for (auto &entry : taskEntries) {
-    tp = entry.second;
+  for (auto entry : taskEntries) {
+    tp = entry;
     if (!tp->ShouldFocusEntry()) {
       continue;
     }
@@ -911,11 +971,17 @@ IconNode* TaskBar::BarItem::getIcon() {
 bool TaskBar::BarItem::empty() {
   return clients.empty();
 }
+void TaskBar::BarItem::AddClient(ClientNode *np) {
+  clients.push_back(np);
+  this->Invalidate();
+}
+
 bool TaskBar::BarItem::RemoveClient(ClientNode *np) {
   vector<ClientNode*>::iterator pos;
   for (pos = clients.begin(); pos != clients.end(); ++pos) {
     if (np == (*pos)) {
       clients.erase(pos);
+      this->Invalidate();
       return true;
     }
   }
@@ -947,7 +1013,9 @@ void TaskBar::BarItem::RunTaskBarCommand(MenuAction *action, unsigned button) {
   }
 }
 
-TaskBar::BarItem::BarItem(ClientNode *atLeastOne) {
+TaskBar::BarItem::BarItem(ClientNode *atLeastOne) :
+    countGeneration(generation - 1), cachedActive(0), cachedFocus(0),
+    cachedShouldFocus(false) {
   Assert(atLeastOne);
   clients.push_back(atLeastOne);
 }
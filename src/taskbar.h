@@ -11,8 +11,10 @@
 #define TASKBAR_H
 
 #include <vector>
-#include <map>
+#include <string>
+#include <unordered_map>
 #include "menu.h"
+#include "button.h"
 #include "tray.h"
 #include "TrayComponent.h"
 
@@ -49,9 +51,11 @@ private:
 	  bool hasActiveClient();
 	  bool IsGroupOnTop();
 	  bool empty();
+	  void AddClient(ClientNode *np);
 	  bool RemoveClient(ClientNode *np);
 	  unsigned int activeCount();
 	  unsigned int focusCount();
+	  void Invalidate() {this->countGeneration = generation - 1;}
 	  void MinimizeGroup();
 	  void focusGroup();
 	  std::vector<Window> getClientWindows();
@@ -62,12 +66,53 @@ private:
 	  void ShowClientList(TaskBar *bar);
 	  void RunTaskBarCommand(MenuAction* action, unsigned button);
 	private:
+	  void RefreshCounts();
+
 	  std::vector<ClientNode*> clients;
+
+	  /** Cached counts, valid when countGeneration matches generation. */
+	  unsigned int countGeneration;
+	  unsigned int cachedActive;
+	  unsigned int cachedFocus;
+	  bool cachedShouldFocus;
 	};
 
 
+	/** What was last drawn for a task bar button. */
+	struct ButtonState {
+	  const BarItem *entry;
+	  std::string text;
+	  IconNode *icon;
+	  ButtonType type;
+	  int x, y;
+	  int width, height;
+	  bool operator==(const ButtonState &other) const {
+	    return entry == other.entry && text == other.text
+	        && icon == other.icon && type == other.type && x == other.x
+	        && y == other.y && width == other.width && height == other.height;
+	  }
+	};
+
+	/** Buttons currently in the pixmap (valid if drawnValid is set). */
+	std::vector<ButtonState> drawnButtons;
+	bool drawnValid;
+
 	static std::vector<TaskBar*> bars;
-	static std::map<const char*, BarItem*> taskEntries;
+
+	/** Task entries in the order they were added. */
+	static std::vector<BarItem*> taskEntries;
+
+	/** Grouped entries by class name. */
+	static std::unordered_map<std::string, BarItem*> classIndex;
+
+	/** Entry containing each client. */
+	static std::unordered_map<const ClientNode*, BarItem*> clientIndex;
+
+	/** Bumped to invalidate the cached counts of every entry. */
+	static unsigned int generation;
+
+	static size_t FindActiveEntry(void);
+
 public:
 	void ComputeItemSize();
 	//static char ShouldFocusEntry(const BarItem *tp);
@@ -112,6 +157,14 @@ public:
 	/** Update all task bars. */
 	static void UpdateTaskBar(void);
 
+	/** Mark the cached state of every task entry as stale. */
+	static void InvalidateEntries(void);
+
+	/** Mark the cached state of the entry containing a client as stale.
+	 * @param np The client whose state changed.
+	 */
+	static void InvalidateClient(const ClientNode *np);
+
 	/** Focus the next client in the task bar. */
 	static void FocusNext(void);
 
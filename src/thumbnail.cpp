@@ -0,0 +1,188 @@
+/**
+ * @file thumbnail.cpp
+ *
+ * @brief Live window thumbnails using the composite extension.
+ *
+ */
+
+#include "jwm.h"
+#include "thumbnail.h"
+#include "client.h"
+#include "border.h"
+#include "main.h"
+
+std::map<Window, Thumbnails::FrameNode> Thumbnails::frames;
+unsigned int Thumbnails::serial = 0;
+
+/** Startup thumbnails. */
+void Thumbnails::StartupThumbnails(void) {
+  serial = 0;
+}
+
+/** Shutdown thumbnails. */
+void Thumbnails::ShutdownThumbnails(void) {
+#ifdef USE_XCOMPOSITE
+  std::map<Window, FrameNode>::iterator it;
+  for (it = frames.begin(); it != frames.end(); ++it) {
+#ifdef USE_XDAMAGE
+    if (it->second.damage != None) {
+      JXDamageDestroy(display, it->second.damage);
+    }
+#endif
+    JXCompositeUnredirectWindow(display, it->first, CompositeRedirectAutomatic);
+  }
+#endif
+  frames.clear();
+}
+
+/** Determine if thumbnails can be rendered. */
+char Thumbnails::IsAvailable(void) {
+#ifdef USE_XCOMPOSITE
+  return haveComposite && haveRender;
+#else
+  return 0;
+#endif
+}
+
+/** Determine if changes to frames are reported by the server. */
+char Thumbnails::HasDamage(void) {
+#ifdef USE_XDAMAGE
+  return haveDamage;
+#else
+  return 0;
+#endif
+}
+
+/** Start tracking a client frame. */
+unsigned int Thumbnails::TrackClient(const ClientNode *np) {
+#ifdef USE_XCOMPOSITE
+  std::map<Window, FrameNode>::iterator it;
+  const Window frame = np->getParent();
+
+  if (frame == None || !IsAvailable()) {
+    return 0;
+  }
+
+  it = frames.find(frame);
+  if (it != frames.end()) {
+    return it->second.serial;
+  }
+
+  FrameNode node;
+  JXCompositeRedirectWindow(display, frame, CompositeRedirectAutomatic);
+#ifdef USE_XDAMAGE
+  node.damage = None;
+  if (haveDamage) {
+    node.damage = JXDamageCreate(display, frame, XDamageReportNonEmpty);
+  }
+#endif
+  node.serial = ++serial;
+  frames[frame] = node;
+  return node.serial;
+#else
+  return 0;
+#endif
+}
+
+/** Stop tracking a client frame. */
+void Thumbnails::UntrackClient(const ClientNode *np) {
+#ifdef USE_XCOMPOSITE
+  std::map<Window, FrameNode>::iterator it;
+  it = frames.find(np->getParent());
+  if (it == frames.end()) {
+    return;
+  }
+#ifdef USE_XDAMAGE
+  if (it->second.damage != None) {
+    JXDamageDestroy(display, it->second.damage);
+  }
+#endif
+  JXCompositeUnredirectWindow(display, it->first, CompositeRedirectAutomatic);
+  frames.erase(it);
+#endif
+}
+
+/** Mark all tracked frames as changed. */
+void Thumbnails::Invalidate(void) {
+  std::map<Window, FrameNode>::iterator it;
+  serial += 1;
+  for (it = frames.begin(); it != frames.end(); ++it) {
+    it->second.serial = serial;
+  }
+}
+
+#ifdef USE_XDAMAGE
+/** Handle a damage event. */
+void Thumbnails::HandleDamageEvent(const XDamageNotifyEvent *event) {
+  std::map<Window, FrameNode>::iterator it;
+  it = frames.find(event->drawable);
+  if (it != frames.end()) {
+    it->second.serial = ++serial;
+  }
+  /* Acknowledge the damage so the server reports the next change. */
+  JXDamageSubtract(display, event->damage, None, None);
+}
+#endif
+
+/** Render a scaled copy of a client to a pixmap. */
+char Thumbnails::RenderThumbnail(const ClientNode *np, Pixmap dest, int width,
+    int height) {
+#ifdef USE_XCOMPOSITE
+
+  XRenderPictFormat *fp;
+  XRenderPictureAttributes pa;
+  XTransform xf;
+  Pixmap contents;
+  Picture source, target;
+  int north, south, east, west;
+
+  if (!IsAvailable() || width <= 0 || height <= 0) {
+    return 0;
+  }
+  if (np->getParent() == None || np->isHidden() || np->isShaded()
+      || !np->isMapped()) {
+    return 0;
+  }
+  if (frames.find(np->getParent()) == frames.end()) {
+    return 0;
+  }
+
+  fp = JXRenderFindVisualFormat(display, rootVisual);
+  if (JUNLIKELY(fp == NULL)) {
+    return 0;
+  }
+
+  contents = JXCompositeNameWindowPixmap(display, np->getParent());
+  if (contents == None) {
+    return 0;
+  }
+
+  Border::GetBorderSize(np, &north, &south, &east, &west);
+
+  pa.subwindow_mode = IncludeInferiors;
+  source = JXRenderCreatePicture(display, contents, fp, 0, NULL);
+  target = JXRenderCreatePicture(display, dest, fp, CPSubwindowMode, &pa);
+
+  /* Scale the client area of the frame down to the thumbnail. */
+  memset(&xf, 0, sizeof(xf));
+  xf.matrix[0][0] = (np->getWidth() << 16) / width;
+  xf.matrix[0][2] = west << 16;
+  xf.matrix[1][1] = (np->getHeight() << 16) / height;
+  xf.matrix[1][2] = north << 16;
+  xf.matrix[2][2] = 1 << 16;
+  JXRenderSetPictureTransform(display, source, &xf);
+  JXRenderSetPictureFilter(display, source, FilterBilinear, NULL, 0);
+
+  JXRenderComposite(display, PictOpSrc, source, None, target, 0, 0, 0, 0, 0,
+      0, width, height);
+
+  JXRenderFreePicture(display, target);
+  JXRenderFreePicture(display, source);
+  JXFreePixmap(display, contents);
+
+  return 1;
+
+#else
+  return 0;
+#endif
+}
@@ -0,0 +1,95 @@
+/**
+ * @file thumbnail.h
+ *
+ * @brief Live window thumbnails using the composite extension.
+ *
+ * Client frames are redirected (automatically, so the server still paints
+ * them) and their contents are read back through a named pixmap and scaled
+ * with XRender. When the damage extension is available each frame carries
+ * a damage object and a serial that is bumped whenever the frame changes,
+ * so callers only re-render thumbnails that are out of date.
+ *
+ */
+
+#ifndef THUMBNAIL_H
+#define THUMBNAIL_H
+
+#include <map>
+
+class ClientNode;
+
+class Thumbnails {
+public:
+
+  /*@{*/
+  static void StartupThumbnails(void);
+  static void ShutdownThumbnails(void);
+  /*@}*/
+
+  /** Determine if thumbnails can be rendered.
+   * @return 1 if the composite and render extensions are available.
+   */
+  static char IsAvailable(void);
+
+  /** Determine if changes to frames are reported by the server.
+   * If not, callers must refresh visible thumbnails periodically.
+   * @return 1 if the damage extension is available.
+   */
+  static char HasDamage(void);
+
+  /** Start tracking a client frame.
+   * @param np The client.
+   * @return The current serial for the frame.
+   */
+  static unsigned int TrackClient(const ClientNode *np);
+
+  /** Stop tracking a client frame.
+   * This must be called before the frame is destroyed.
+   * @param np The client.
+   */
+  static void UntrackClient(const ClientNode *np);
+
+  /** Mark all tracked frames as changed. */
+  static void Invalidate(void);
+
+  /** Get the serial of the last change to any frame.
+   * @return The serial.
+   */
+  static unsigned int GetSerial(void) {
+    return serial;
+  }
+
+  /** Render a scaled copy of a client to a pixmap.
+   * The client must be visible on the current desktop.
+   * @param np The client.
+   * @param dest The pixmap to render to (root depth).
+   * @param width The width of the thumbnail.
+   * @param height The height of the thumbnail.
+   * @return 1 if the thumbnail was rendered, 0 otherwise.
+   */
+  static char RenderThumbnail(const ClientNode *np, Pixmap dest, int width,
+      int height);
+
+#ifdef USE_XDAMAGE
+  /** Handle a damage event.
+   * @param event The event.
+   */
+  static void HandleDamageEvent(const XDamageNotifyEvent *event);
+#endif
+
+private:
+
+  /** A tracked client frame. */
+  struct FrameNode {
+#ifdef USE_XDAMAGE
+    Damage damage;
+#endif
+    unsigned int serial; /**< Serial of the last change. */
+  };
+
+  static std::map<Window, FrameNode> frames;
+  static unsigned int serial;
+
+};
+
+#endif /* THUMBNAIL_H */
@@ -51,6 +51,7 @@ void Tray::StartupTray(void) {
   std::vector<Tray*>::iterator it;
   for (it = trays.begin(); it != trays.end(); ++it) {
     Tray *tp = (*it);
+    tp->CheckLayoutRequests();
     tp->LayoutTray(&variableSize, &variableRemainder);
 
     /* Create the tray window. */
@@ -125,6 +126,8 @@ void Tray::StartupTray(void) {
       }
     }
 
+    tp->UpdateBuffer();
+
     /* Show the tray. */
     JXMapWindow(display, tp->window);
   }
@@ -154,6 +157,11 @@ void Tray::ShutdownTray(void) {
       TrayComponent *comp = (*it);
       comp->Destroy();
     }
+    if (tray->buffer != None) {
+      JXFreePixmap(display, tray->buffer);
+      tray->buffer = None;
+    }
+    tray->layoutRequests.clear();
     JXDestroyWindow(display, tray->window);
   }
 }
@@ -190,6 +198,9 @@ Tray::Tray() {
   this->hidden = 0;
 
   this->window = None;
+  this->buffer = None;
+  this->bufferWidth = 0;
+  this->bufferHeight = 0;
 }
 
 Tray::~Tray() {
@@ -627,7 +638,12 @@ void Tray::UngrabKeys(Display *d, unsigned int keyCode,
 
 /** Handle a tray expose event. */
 void Tray::HandleTrayExpose(Tray *tp, const XExposeEvent *event) {
-  tp->DrawSpecificTray();
+  if (tp->buffer == None) {
+    tp->DrawSpecificTray();
+    return;
+  }
+  JXCopyArea(display, tp->buffer, tp->window, rootGC, event->x, event->y,
+      event->width, event->height, event->x, event->y);
 }
 
 /** Handle a tray enter notify (for autohide). */
@@ -733,28 +749,86 @@ void Tray::DrawSpecificTray() {
   std::vector<TrayComponent*>::iterator it;
   for (it = this->components.begin(); it != this->components.end(); ++it) {
     cp = *it;
-    cp->Resize();
+    cp->UpdateSize();
     cp->Draw();
     cp->UpdateSpecificTray(this);
   }
 
+  if (this->buffer != None) {
+    this->DrawTrayBorder(this->buffer);
+  }
+  this->DrawTrayBorder(this->window);
+}
+
+/** Draw the tray border on a drawable. */
+void Tray::DrawTrayBorder(Drawable d) {
   if (settings.trayDecorations == DECO_MOTIF) {
     JXSetForeground(display, rootGC, Colors::lookupColor(COLOR_TRAY_UP));
-    JXDrawLine(display, this->window, rootGC, 0, 0, this->width - 1, 0);
-    JXDrawLine(display, this->window, rootGC, 0, this->height - 1, 0, 0);
+    JXDrawLine(display, d, rootGC, 0, 0, this->width - 1, 0);
+    JXDrawLine(display, d, rootGC, 0, this->height - 1, 0, 0);
 
     JXSetForeground(display, rootGC, Colors::lookupColor(COLOR_TRAY_DOWN));
-    JXDrawLine(display, this->window, rootGC, 0, this->height - 1,
-        this->width - 1, this->height - 1);
-    JXDrawLine(display, this->window, rootGC, this->width - 1, 0,
-        this->width - 1, this->height - 1);
+    JXDrawLine(display, d, rootGC, 0, this->height - 1, this->width - 1,
+        this->height - 1);
+    JXDrawLine(display, d, rootGC, this->width - 1, 0, this->width - 1,
+        this->height - 1);
   } else {
     JXSetForeground(display, rootGC, Colors::lookupColor(COLOR_TRAY_UP));
-    JXDrawRectangle(display, this->window, rootGC, 0, 0, this->width - 1,
+    JXDrawRectangle(display, d, rootGC, 0, 0, this->width - 1,
         this->height - 1);
   }
 }
 
+/** Make sure the expose buffer matches the tray size. */
+void Tray::UpdateBuffer() {
+  if (this->buffer != None && this->bufferWidth == this->width
+      && this->bufferHeight == this->height) {
+    return;
+  }
+  if (this->buffer != None) {
+    JXFreePixmap(display, this->buffer);
+  }
+  this->bufferWidth = this->width;
+  this->bufferHeight = this->height;
+  this->buffer = JXCreatePixmap(display, rootWindow, this->width,
+      this->height, rootDepth);
+  JXSetForeground(display, rootGC, Colors::lookupColor(COLOR_TRAY_BG2));
+  JXFillRectangle(display, this->buffer, rootGC, 0, 0, this->width,
+      this->height);
+}
+
+/** Record the component size requests and the screen geometry.
+ * Returns 1 if they changed since the last call.
+ */
+char Tray::CheckLayoutRequests() {
+  std::vector<int> requests;
+  std::vector<TrayComponent*>::iterator it;
+  const int screenCount = Screens::GetScreenCount();
+  int i;
+
+  requests.reserve(this->components.size() * 2 + screenCount * 4 + 2);
+  for (it = this->components.begin(); it != this->components.end(); ++it) {
+    requests.push_back((*it)->getRequestedWidth());
+    requests.push_back((*it)->getRequestedHeight());
+  }
+
+  /* The tray size and position depend on the root and screens too. */
+  requests.push_back(rootWidth);
+  requests.push_back(rootHeight);
+  for (i = 0; i < screenCount; i++) {
+    const ScreenType *sp = Screens::GetScreen(i);
+    requests.push_back(sp->x);
+    requests.push_back(sp->y);
+    requests.push_back(sp->width);
+    requests.push_back(sp->height);
+  }
+  if (requests == this->layoutRequests) {
+    return 0;
+  }
+  this->layoutRequests.swap(requests);
+  return 1;
+}
+
 /** Raise tray windows. */
 void Tray::RaiseTrays(void) {
 
@@ -764,6 +838,7 @@ void Tray::RaiseTrays(void) {
     (*it)->ShowTray();
     JXRaiseWindow(display, (*it)->window);
   }
+  ClientNode::InvalidateStack();
 }
 
 /** Lower tray windows. */
@@ -864,6 +939,12 @@ void Tray::ResizeTray() {
 
   Assert(this);
 
+  /* Nothing to do if no component asked for a different size and the
+   * screens did not change. */
+  if (!this->CheckLayoutRequests() && this->window != None) {
+    return;
+  }
+
   this->LayoutTray(&variableSize, &variableRemainder);
 
   /* Reposition items on the tray. */
@@ -872,12 +953,10 @@ void Tray::ResizeTray() {
   std::vector<TrayComponent*>::iterator it;
   for (it = this->components.begin(); it != this->components.end(); ++it) {
     TrayComponent *tc = *it;
-    //tc->SetLocation(xoffset, yoffset);
-    //tc->SetScreenLocation(this->x + xoffset, this->y + yoffset);
 
     if (this->layout == LAYOUT_HORIZONTAL) {
       height = this->height - TRAY_BORDER_SIZE * 2;
-      width = this->getWidth();
+      width = tc->getWidth();
       if (width == 0) {
         width = variableSize;
         if (variableRemainder) {
@@ -887,7 +966,7 @@ void Tray::ResizeTray() {
       }
     } else {
       width = this->width - TRAY_BORDER_SIZE * 2;
-      height = this->getHeight();
+      height = tc->getHeight();
       if (height == 0) {
         height = variableSize;
         if (variableRemainder) {
@@ -896,22 +975,25 @@ void Tray::ResizeTray() {
         }
       }
     }
-    tc->SetSize(width, height);
-    tc->Resize();
+    tc->SetSize(Max(1, width), Max(1, height));
+    tc->SetLocation(xoffset, yoffset);
+    tc->SetScreenLocation(this->x + xoffset, this->y + yoffset);
+    tc->UpdateSize();
 
-    if (this->window != None) {
-      JXMoveWindow(display, this->window, xoffset, yoffset);
+    if (tc->getWindow() != None) {
+      JXMoveWindow(display, tc->getWindow(), xoffset, yoffset);
     }
 
     if (this->layout == LAYOUT_HORIZONTAL) {
-      xoffset += this->getWidth();
+      xoffset += tc->getWidth();
     } else {
-      yoffset += this->getHeight();
+      yoffset += tc->getHeight();
     }
   }
 
   JXMoveResizeWindow(display, this->window, this->x, this->y, this->width,
       this->height);
+  this->UpdateBuffer();
 
   Events::_RequireTaskUpdate();
   this->DrawSpecificTray();
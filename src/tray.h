@@ -90,6 +90,13 @@ private:
 
   Window window; /**< The tray window. */
 
+  Pixmap buffer; /**< Copy of the tray contents for serving exposes. */
+  int bufferWidth; /**< Width of buffer. */
+  int bufferHeight; /**< Height of buffer. */
+
+  /** Component size requests and screen geometry used for the last layout. */
+  std::vector<int> layoutRequests;
+
   /** Start of the tray components. */
   std::vector<TrayComponent*> components;
   static std::vector<Tray*> trays;
@@ -101,6 +108,7 @@ private:
 public:
   LayoutType getLayout() const {return this->layout;}
   Window getWindow() const {return this->window;}
+  Pixmap getBuffer() const {return this->buffer;}
   WinLayerType getLayer() const {return this->layer;}
   int getHeight() const {return this->height;}
   int getWidth() const {return this->width;}
@@ -135,6 +143,9 @@ public:
   int ComputeTotalHeight();
   char CheckHorizontalFill();
   char CheckVerticalFill();
+  char CheckLayoutRequests();
+  void UpdateBuffer();
+  void DrawTrayBorder(Drawable d);
   TrayComponent *getLastComponent();
 
 public:
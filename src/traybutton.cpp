@@ -97,7 +97,7 @@ TrayButton::TrayButton(const char *iconName, const char *label,
 
   Events::_RegisterCallback(settings.popupDelay / 2, SignalTrayButton, this);
 
-  this->Create();
+  /* The pixmap is created when the tray sets the size. */
 }
 
 TrayButton::~TrayButton() {
@@ -4,6 +4,16 @@
 #include "../src/DockComponent.h"
 #include "../src/DesktopComponent.h"
 #include "../src/parse.h"
+#include "../src/ConfigCache.h"
+#include "../src/lex.h"
+#include "../src/PowerMonitor.h"
+#include "../src/StatusSource.h"
+#include "../src/main.h"
+
+#include <ftw.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 
 TEST(DockComponent, InitializeComponent) {
   DockComponent *dc = new DockComponent();
@@ -103,6 +113,265 @@ TEST(DesktopEnvironment, RegisterComponentTest) {
   ASSERT_EQ(defaultCount + 2, de->ComponentCount());
 }
 
+static int RemoveEntry(const char *path, const struct stat *sb, int flag,
+    struct FTW *ftw) {
+  return remove(path);
+}
+
+/** Remove a temporary directory and everything in it. */
+static void RemoveTree(const std::string &root) {
+  nftw(root.c_str(), RemoveEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+/** Write a file in a fake power_supply tree. */
+static void WriteSupplyFile(const std::string &root, const char *supply,
+    const char *attribute, const char *value) {
+  std::string path = root + "/" + supply;
+  mkdir(path.c_str(), 0755);
+  path += "/";
+  path += attribute;
+  FILE *fp = fopen(path.c_str(), "w");
+  ASSERT_TRUE(fp != NULL);
+  fprintf(fp, "%s\n", value);
+  fclose(fp);
+}
+
+static std::string CreateSupplyTree() {
+  char dir[] = "/tmp/jwm-power-XXXXXX";
+  std::string root = mkdtemp(dir);
+  WriteSupplyFile(root, "BAT0", "type", "Battery");
+  WriteSupplyFile(root, "BAT0", "energy_now", "30000");
+  WriteSupplyFile(root, "BAT0", "energy_full", "100000");
+  WriteSupplyFile(root, "BAT1", "type", "Battery");
+  WriteSupplyFile(root, "BAT1", "energy_now", "50000");
+  WriteSupplyFile(root, "BAT1", "energy_full", "100000");
+  WriteSupplyFile(root, "AC", "type", "Mains");
+  WriteSupplyFile(root, "AC", "online", "0");
+  return root;
+}
+
+/** Send a uevent message (NUL-separated strings) to a mock source. */
+static void SendUevent(int fd, const char *subsystem) {
+  char msg[256];
+  int len = snprintf(msg, sizeof(msg), "change@/devices/test") + 1;
+  len += snprintf(&msg[len], sizeof(msg) - len, "ACTION=change") + 1;
+  len += snprintf(&msg[len], sizeof(msg) - len, "SUBSYSTEM=%s", subsystem) + 1;
+  ASSERT_EQ(len, send(fd, msg, len, 0));
+}
+
+TEST(PowerMonitor, CombinesSupplies) {
+  std::string root = CreateSupplyTree();
+  PowerMonitor monitor(root.c_str(), NULL);
+  ASSERT_TRUE(monitor.Refresh());
+  ASSERT_EQ(40, monitor.GetState().percentage);
+  ASSERT_FALSE(monitor.GetState().online);
+  ASSERT_FALSE(monitor.Refresh());
+
+  WriteSupplyFile(root, "AC", "online", "1");
+  ASSERT_TRUE(monitor.Refresh());
+  ASSERT_TRUE(monitor.GetState().online);
+  RemoveTree(root);
+}
+
+TEST(PowerMonitor, ReportsOnlyPercentageChanges) {
+  std::string root = CreateSupplyTree();
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds));
+  PowerMonitor monitor(root.c_str(), new UeventSource(fds[0]));
+  monitor.Refresh();
+
+  /* Other subsystems are ignored. */
+  WriteSupplyFile(root, "BAT0", "energy_now", "10000");
+  SendUevent(fds[1], "usb");
+  ASSERT_FALSE(monitor.HandleEvents());
+  ASSERT_EQ(40, monitor.GetState().percentage);
+
+  /* Several events are coalesced into one update. */
+  SendUevent(fds[1], "power_supply");
+  SendUevent(fds[1], "power_supply");
+  ASSERT_TRUE(monitor.HandleEvents());
+  ASSERT_EQ(30, monitor.GetState().percentage);
+  ASSERT_FALSE(monitor.HandleEvents());
+
+  /* Changes below one percent are not reported. */
+  WriteSupplyFile(root, "BAT0", "energy_now", "10500");
+  SendUevent(fds[1], "power_supply");
+  ASSERT_FALSE(monitor.HandleEvents());
+
+  close(fds[1]);
+  RemoveTree(root);
+}
+
+/** Write a file for a producer to read. */
+static std::string WriteStatusFile(const char *contents) {
+  char path[] = "/tmp/jwm-status-XXXXXX";
+  int fd = mkstemp(path);
+  EXPECT_GE(fd, 0);
+  EXPECT_EQ((ssize_t) strlen(contents), write(fd, contents, strlen(contents)));
+  close(fd);
+  return path;
+}
+
+TEST(StatusSource, SamplesProcFiles) {
+  std::string text;
+  std::string meminfo = WriteStatusFile(
+      "MemTotal:       1000 kB\nMemFree:         100 kB\n"
+      "MemAvailable:    250 kB\n");
+  MemoryProducer memory(meminfo.c_str());
+  ASSERT_TRUE(memory.Sample(&text));
+  ASSERT_EQ("75%", text);
+
+  /* CPU usage needs two samples. */
+  std::string stat = WriteStatusFile("cpu  100 0 100 800 0 0 0 0\n");
+  CpuProducer cpu(stat.c_str());
+  ASSERT_FALSE(cpu.Sample(&text));
+  FILE *fp = fopen(stat.c_str(), "w");
+  fprintf(fp, "cpu  150 0 100 850 0 0 0 0\n");
+  fclose(fp);
+  ASSERT_TRUE(cpu.Sample(&text));
+  ASSERT_EQ("50%", text);
+  unlink(meminfo.c_str());
+  unlink(stat.c_str());
+}
+
+/** Count the lines of a file. */
+static unsigned CountLines(const std::string &path) {
+  unsigned count = 0;
+  int c;
+  FILE *fp = fopen(path.c_str(), "r");
+  if (fp) {
+    while ((c = fgetc(fp)) != EOF) {
+      count += c == '\n';
+    }
+    fclose(fp);
+  }
+  return count;
+}
+
+TEST(StatusSource, QueuesOnlyChanges) {
+  std::string runs = WriteStatusFile("");
+  std::string command = "echo run >> " + runs + "; echo same; echo ignored";
+  StatusWorker worker;
+  worker.AddProducer(new CommandProducer(command.c_str(), 1000), 0);
+  ASSERT_TRUE(worker.Start());
+
+  fd_set fds;
+  FD_ZERO(&fds);
+  FD_SET(worker.GetDescriptor(), &fds);
+  ASSERT_EQ(1, select(worker.GetDescriptor() + 1, &fds, NULL, NULL, NULL));
+  worker.Acknowledge();
+  const StatusSnapshot *sp = worker.Next();
+  ASSERT_TRUE(sp != NULL);
+  ASSERT_EQ("same", sp->text);
+  delete sp;
+
+  /* The command is run again, but its output didn't change.
+   * Once the third run has started, the second one has been handled. */
+  for (int waited = 0; CountLines(runs) < 3; waited += 10) {
+    ASSERT_LT(waited, 10000);
+    usleep(10000);
+  }
+
+  /* Check before stopping, since Stop discards the queue. */
+  sp = worker.Next();
+  worker.Stop();
+  unlink(runs.c_str());
+  ASSERT_TRUE(sp == NULL);
+}
+
+TEST(Lex, TokenizesInPlace) {
+  TokenNode *tokens = Tokenize(
+      "<JWM><Program label=\"a &amp; b\" icon=\"/usr/share/icons/terminal.png\">"
+      "  xterm -e a-command-longer-than-a-block  </Program>"
+      "<Bogus/></JWM>", "test");
+  ASSERT_TRUE(tokens != NULL);
+  ASSERT_EQ(TOK_JWM, tokens->type);
+  const TokenNode *np = tokens->subnodeHead;
+  ASSERT_EQ(TOK_PROGRAM, np->type);
+  ASSERT_STREQ("xterm -e a-command-longer-than-a-block", np->value);
+  ASSERT_STREQ("icon", np->attributes->name);
+  ASSERT_STREQ("/usr/share/icons/terminal.png", np->attributes->value);
+  ASSERT_STREQ("label", np->attributes->next->name);
+  ASSERT_STREQ("a & b", np->attributes->next->value);
+  ASSERT_EQ(TOK_INVALID, np->next->type);
+  ASSERT_STREQ("Bogus", GetTokenName(np->next));
+  ReleaseTokens(tokens);
+}
+
+TEST(ConfigCache, InlinesIncludes) {
+  char dir[] = "/tmp/jwm-cache-XXXXXX";
+  char cwd[4096];
+  const char *oldCache = getenv("XDG_CACHE_HOME");
+  const std::string savedCache = oldCache ? oldCache : "";
+  ASSERT_TRUE(mkdtemp(dir) != NULL);
+  ASSERT_TRUE(getcwd(cwd, sizeof(cwd)) != NULL);
+  ASSERT_EQ(0, chdir(dir));
+  setenv("XDG_CACHE_HOME", (std::string(dir) + "/cache").c_str(), 1);
+
+  FILE *fp = fopen("rc", "w");
+  fprintf(fp, "<JWM><Include>keys</Include><Desktops width=\"2\"/></JWM>");
+  fclose(fp);
+  fp = fopen("keys", "w");
+  fprintf(fp, "<JWM><Key key=\"F1\">close</Key></JWM>");
+  fclose(fp);
+
+  /* The include is replaced by the tokens of the included file. */
+  ASSERT_TRUE(ConfigCache::LoadCache("rc") == NULL);
+  TokenNode *tokens = ConfigCache::BuildCache("rc");
+  ASSERT_TRUE(tokens != NULL);
+  ASSERT_EQ(TOK_KEY, tokens->subnodeHead->type);
+  ReleaseTokens(tokens);
+  ASSERT_EQ(2u, ConfigCache::GetInputs().size());
+
+  tokens = ConfigCache::LoadCache("rc");
+  ASSERT_TRUE(tokens != NULL);
+  ASSERT_EQ(TOK_JWM, tokens->type);
+  const TokenNode *np = tokens->subnodeHead;
+  ASSERT_EQ(TOK_KEY, np->type);
+  ASSERT_STREQ("close", np->value);
+  ASSERT_STREQ("key", np->attributes->name);
+  ASSERT_STREQ("F1", np->attributes->value);
+  ASSERT_EQ(tokens, np->parent);
+  ASSERT_EQ(TOK_DESKTOPS, np->next->type);
+  ASSERT_EQ(np->next, tokens->subnodeTail);
+  ConfigCache::UnloadCache();
+
+  /* Changing an included file invalidates the cache. */
+  fp = fopen("keys", "w");
+  fprintf(fp, "<JWM><Key key=\"F2\">close</Key></JWM>");
+  fclose(fp);
+  ASSERT_TRUE(ConfigCache::LoadCache("rc") == NULL);
+  ConfigCache::DestroyCache();
+  ASSERT_EQ(0, chdir(cwd));
+  if (oldCache) {
+    setenv("XDG_CACHE_HOME", savedCache.c_str(), 1);
+  } else {
+    unsetenv("XDG_CACHE_HOME");
+  }
+  RemoveTree(dir);
+}
+
+TEST(ConfigWatcher, ChecksExampleConfig) {
+  char dir[] = "/tmp/jwm-check-XXXXXX";
+  int status;
+  ASSERT_TRUE(mkdtemp(dir) != NULL);
+
+  /* The check must not need the display, even with a tray. */
+  const pid_t pid = fork();
+  ASSERT_NE(-1, pid);
+  if (pid == 0) {
+    setenv("XDG_CACHE_HOME", dir, 1);
+    unsetenv("DISPLAY");
+    execl(JWM_BINARY, JWM_BINARY, CHECK_OPTION, "-f", EXAMPLE_CONFIG,
+        (char*) NULL);
+    _exit(127);
+  }
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+  RemoveTree(dir);
+  ASSERT_TRUE(WIFEXITED(status));
+  ASSERT_EQ(0, WEXITSTATUS(status));
+}
+
 int main(int argc, char **argv) {
   assert(environment->OpenConnection());
   ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,87 @@
+/**
+ * @file lexbench.cpp
+ *
+ * @brief Microbenchmark of the configuration lexer.
+ *
+ * Tokenizes a configuration file (example.jwmrc by default) and a
+ * synthetic root menu with 10000 entries and prints the average time
+ * per run. Build and run it with "make bench".
+ *
+ */
+
+#include "../src/jwm.h"
+#include "../src/lex.h"
+
+#include <string>
+#include <time.h>
+
+/** Referenced by error.cpp; normally defined with the window manager. */
+char initializing = 0;
+
+/** Number of entries in the synthetic menu. */
+static const int MENU_ENTRIES = 10000;
+
+/** Get a monotonic time in microseconds. */
+static double GetMicroseconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/** Count the tokens in a tree. */
+static unsigned CountTokens(const TokenNode *np) {
+  unsigned count = 0;
+  for (; np; np = np->next) {
+    count += 1 + CountTokens(np->subnodeHead);
+  }
+  return count;
+}
+
+/** Tokenize a buffer repeatedly and print the average time. */
+static void RunBenchmark(const char *name, const std::string &data, int runs) {
+  unsigned count = 0;
+  const double start = GetMicroseconds();
+  for (int i = 0; i < runs; i++) {
+    TokenNode *tokens = Tokenize(data.c_str(), name);
+    count = CountTokens(tokens);
+    ReleaseTokens(tokens);
+  }
+  const double elapsed = GetMicroseconds() - start;
+  printf("%-16s %8lu bytes %7u tokens %10.1f us/run\n", name,
+      (unsigned long) data.size(), count, elapsed / runs);
+}
+
+int main(int argc, char **argv) {
+  const char *path = argc > 1 ? argv[1] : "../example.jwmrc";
+  std::string example;
+  std::string menu;
+  char buffer[256];
+  size_t len;
+  FILE *fp;
+
+  fp = fopen(path, "r");
+  if (!fp) {
+    fprintf(stderr, "could not open %s\n", path);
+    return 1;
+  }
+  while ((len = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+    example.append(buffer, len);
+  }
+  fclose(fp);
+
+  menu = "<?xml version=\"1.0\"?>\n<JWM>\n<RootMenu onroot=\"1\">\n";
+  for (int i = 0; i < MENU_ENTRIES; i++) {
+    snprintf(buffer, sizeof(buffer),
+        "  <Program icon=\"application-%d.png\" label=\"Application &amp; %d\">"
+        "exec-%d --option=value</Program>\n", i, i, i);
+    menu += buffer;
+    if (i % 100 == 99) {
+      menu += "  <Separator/>\n";
+    }
+  }
+  menu += "</RootMenu>\n</JWM>\n";
+
+  RunBenchmark("example.jwmrc", example, 2000);
+  RunBenchmark("menu-10k", menu, 20);
+  return 0;
+}